@@ -26,8 +26,9 @@ use tokio::sync::RwLock;
 use tower::ServiceBuilder;
 use tower_http::{cors::CorsLayer, trace::TraceLayer};
 
-use crate::blockchain::Blockchain;
+use crate::blockchain::{AttestationService, Blockchain, GenerationReading};
 use crate::config::ApiConfig;
+use crate::demand_response::{DemandResponseEngine, DispatchRequest, DispatchSignal};
 use crate::energy::{EnergyTrading, GridManager};
 use crate::governance::GovernanceSystem;
 
@@ -39,6 +40,8 @@ pub struct AppState {
     pub energy_trading: Arc<RwLock<EnergyTrading>>,
     pub grid_manager: Arc<RwLock<GridManager>>,
     pub governance: Arc<RwLock<GovernanceSystem>>,
+    pub attestations: Arc<AttestationService>,
+    pub demand_response: Arc<DemandResponseEngine>,
 }
 
 /// API Server structure
@@ -77,6 +80,27 @@ pub struct SubmitTransactionRequest {
     pub metadata: Option<String>,
 }
 
+/// Metered generation reading submission
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SubmitReadingRequest {
+    pub producer: String,
+    pub reading: GenerationReading,
+}
+
+/// Demand-response enrollment request
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct EnrollRequest {
+    pub address: String,
+    pub zone: String,
+}
+
+/// Metered flexibility delivered in a demand-response event
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DeliveryReport {
+    pub address: String,
+    pub delivered_kwh: f64,
+}
+
 /// Account balance response
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct AccountBalance {
@@ -144,6 +168,8 @@ impl ApiServer {
         energy_trading: Arc<RwLock<EnergyTrading>>,
         grid_manager: Arc<RwLock<GridManager>>,
         governance: Arc<RwLock<GovernanceSystem>>,
+        attestations: Arc<AttestationService>,
+        demand_response: Arc<DemandResponseEngine>,
     ) -> Self {
         let state = AppState {
             config,
@@ -151,6 +177,8 @@ impl ApiServer {
             energy_trading,
             grid_manager,
             governance,
+            attestations,
+            demand_response,
         };
 
         Self { state }
@@ -196,11 +224,18 @@ impl ApiServer {
             .route("/energy/orders", get(handle_get_energy_orders))
             .route("/energy/stats", get(handle_get_energy_stats))
             .route("/energy/trades", get(handle_get_energy_trades))
+            .route("/energy/readings", post(handle_submit_reading))
             
             // Grid management endpoints
             .route("/grid/status", get(handle_get_grid_status))
             .route("/grid/frequency", get(handle_get_grid_frequency))
             .route("/grid/load", get(handle_get_grid_load))
+            .route("/grid/demand-response/enroll", post(handle_enroll_participant))
+            .route("/grid/demand-response/dispatch", post(handle_dispatch_event))
+            .route(
+                "/grid/demand-response/events/{id}/delivery",
+                post(handle_report_delivery),
+            )
             
             // Account management endpoints
             .route("/accounts/{address}", get(handle_get_account))
@@ -325,6 +360,59 @@ async fn handle_create_energy_order(
     ))
 }
 
+/// Submit a metered generation reading for attestation; returns its interval
+async fn handle_submit_reading(
+    State(state): State<AppState>,
+    Json(request): Json<SubmitReadingRequest>,
+) -> Json<ApiResponse<u64>> {
+    match state
+        .attestations
+        .submit_reading(&request.producer, request.reading)
+        .await
+    {
+        Ok(interval) => success_response(interval),
+        Err(e) => error_response(format!("Failed to submit reading: {}", e)),
+    }
+}
+
+/// Enroll an account as a demand-response participant
+async fn handle_enroll_participant(
+    State(state): State<AppState>,
+    Json(request): Json<EnrollRequest>,
+) -> Json<ApiResponse<String>> {
+    match state.demand_response.enroll(&request.address, &request.zone).await {
+        Ok(()) => success_response(format!("{} enrolled in {}", request.address, request.zone)),
+        Err(e) => error_response(format!("Failed to enroll participant: {}", e)),
+    }
+}
+
+/// Dispatch a demand-response event
+async fn handle_dispatch_event(
+    State(state): State<AppState>,
+    Json(request): Json<DispatchRequest>,
+) -> Json<ApiResponse<DispatchSignal>> {
+    match state.demand_response.dispatch(request).await {
+        Ok(signal) => success_response((*signal).clone()),
+        Err(e) => error_response(format!("Failed to dispatch event: {}", e)),
+    }
+}
+
+/// Report metered delivery for a participant in an event
+async fn handle_report_delivery(
+    Path(id): Path<String>,
+    State(state): State<AppState>,
+    Json(report): Json<DeliveryReport>,
+) -> Json<ApiResponse<String>> {
+    match state
+        .demand_response
+        .report_delivery(&id, &report.address, report.delivered_kwh)
+        .await
+    {
+        Ok(()) => success_response(format!("Delivery recorded for {} in {}", report.address, id)),
+        Err(e) => error_response(format!("Failed to record delivery: {}", e)),
+    }
+}
+
 /// Get energy orders endpoint
 async fn handle_get_energy_orders(State(state): State<AppState>) -> Json<ApiResponse<String>> {
     let energy_trading = state.energy_trading.read().await;
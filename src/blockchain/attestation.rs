@@ -0,0 +1,571 @@
+//! GridTokenX Generation Attestation Module
+//!
+//! This module batches renewable generation readings into Merkle trees, one per
+//! producer and generation interval. Only the tree root is committed on chain in
+//! a single `Attestation` transaction; the per-reading inclusion proofs are kept
+//! in local storage and served off chain, so chain cost stays constant per
+//! producer-interval regardless of how many meter readings back it.
+//! [`AttestationService`] runs this on the node: it batches submitted readings,
+//! seals elapsed intervals and submits their roots to the pending pool.
+
+use anyhow::{anyhow, Result};
+use chrono::{DateTime, Utc};
+use serde::{Deserialize, Serialize};
+use sha2::{Digest, Sha256};
+use std::collections::BTreeMap;
+use std::sync::Arc;
+use std::time::Duration;
+use tokio::sync::{Mutex, RwLock};
+
+use super::carbon::{CarbonLedger, GENERATION_INTERVAL_SECS};
+use super::chain::Blockchain;
+use super::transaction::{EnergySource, Transaction};
+use crate::storage::StorageManager;
+
+/// Domain separation prefixes so a leaf can never be confused with an inner node
+const LEAF_PREFIX: u8 = 0x00;
+const NODE_PREFIX: u8 = 0x01;
+const PROMOTE_PREFIX: u8 = 0x02;
+
+/// A single metered generation reading
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub struct GenerationReading {
+    /// Reading identifier (unique per producer-interval)
+    pub reading_id: String,
+    /// Meter that produced the reading
+    pub meter_id: String,
+    /// Measurement timestamp
+    pub timestamp: DateTime<Utc>,
+    /// Energy generated since the previous reading (kWh)
+    pub energy_kwh: f64,
+    /// Energy source of the metered unit
+    pub energy_source: EnergySource,
+    /// Renewable energy certificate reference from compliance data
+    pub rec_certificate: Option<String>,
+}
+
+impl GenerationReading {
+    /// Merkle leaf hash of this reading
+    pub fn leaf_hash(&self) -> Result<[u8; 32]> {
+        let serialized = bincode::serialize(self)
+            .map_err(|e| anyhow!("Failed to serialize reading: {}", e))?;
+
+        let mut hasher = Sha256::new();
+        hasher.update([LEAF_PREFIX]);
+        hasher.update(&serialized);
+        Ok(hasher.finalize().into())
+    }
+}
+
+/// On-chain commitment to one producer-interval batch of readings
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub struct AttestationCommitment {
+    /// Producer address
+    pub producer: String,
+    /// Generation interval index (same units as certificate vintages)
+    pub interval: u64,
+    /// Hex-encoded Merkle root over the reading leaves
+    pub merkle_root: String,
+    /// Number of leaves in the tree
+    pub reading_count: u32,
+    /// Total energy across all readings (kWh)
+    pub total_energy_kwh: f64,
+    /// Energy from renewable sources (kWh)
+    pub renewable_energy_kwh: f64,
+}
+
+/// Merkle inclusion proof for a single reading
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub struct MerkleProof {
+    /// Leaf position in the tree
+    pub leaf_index: u32,
+    /// Number of leaves in the tree the proof was taken from
+    pub leaf_count: u32,
+    /// Sibling hashes from the leaf level up to (excluding) the root
+    pub siblings: Vec<[u8; 32]>,
+}
+
+impl MerkleProof {
+    /// Recompute the root from a leaf hash and compare it to the expected root.
+    ///
+    /// The path follows the tree shape implied by `leaf_count`: the index must be
+    /// a real leaf, a node without a right neighbour is promoted instead of
+    /// paired, and every sibling must be consumed.
+    pub fn verify(&self, leaf: &[u8; 32], root: &[u8; 32]) -> bool {
+        if self.leaf_index >= self.leaf_count {
+            return false;
+        }
+
+        let mut hash = *leaf;
+        let mut index = self.leaf_index;
+        let mut width = self.leaf_count;
+        let mut siblings = self.siblings.iter();
+
+        while width > 1 {
+            hash = if index % 2 == 0 && index + 1 == width {
+                hash_promoted(&hash)
+            } else {
+                let Some(sibling) = siblings.next() else {
+                    return false;
+                };
+                if index % 2 == 0 {
+                    hash_pair(&hash, sibling)
+                } else {
+                    hash_pair(sibling, &hash)
+                }
+            };
+            index /= 2;
+            width = width.div_ceil(2);
+        }
+
+        siblings.next().is_none() && hash == *root
+    }
+}
+
+/// Binary Merkle tree keeping every level so proofs can be extracted cheaply
+#[derive(Debug, Clone)]
+pub struct MerkleTree {
+    levels: Vec<Vec<[u8; 32]>>,
+}
+
+impl MerkleTree {
+    /// Build a tree from leaf hashes. An odd node at any level is promoted under its
+    /// own domain prefix rather than paired with itself, so a padded tree can never
+    /// hash to the same root as a larger one.
+    pub fn from_leaves(leaves: Vec<[u8; 32]>) -> Result<Self> {
+        if leaves.is_empty() {
+            return Err(anyhow!("Cannot build Merkle tree without leaves"));
+        }
+
+        let mut levels = vec![leaves];
+        while levels.last().map_or(0, |level| level.len()) > 1 {
+            let next = levels
+                .last()
+                .unwrap()
+                .chunks(2)
+                .map(|pair| match pair.get(1) {
+                    Some(right) => hash_pair(&pair[0], right),
+                    None => hash_promoted(&pair[0]),
+                })
+                .collect();
+            levels.push(next);
+        }
+
+        Ok(Self { levels })
+    }
+
+    /// Root hash
+    pub fn root(&self) -> [u8; 32] {
+        self.levels.last().unwrap()[0]
+    }
+
+    /// Hex-encoded root hash
+    pub fn root_hex(&self) -> String {
+        hex::encode(self.root())
+    }
+
+    /// Number of leaves
+    pub fn leaf_count(&self) -> usize {
+        self.levels[0].len()
+    }
+
+    /// Inclusion proof for the leaf at `index`
+    pub fn proof(&self, index: usize) -> Option<MerkleProof> {
+        if index >= self.leaf_count() {
+            return None;
+        }
+
+        let mut siblings = Vec::with_capacity(self.levels.len() - 1);
+        let mut position = index;
+        for level in &self.levels[..self.levels.len() - 1] {
+            // A promoted node has no sibling at this level
+            if let Some(sibling) = level.get(position ^ 1) {
+                siblings.push(*sibling);
+            }
+            position /= 2;
+        }
+
+        Some(MerkleProof {
+            leaf_index: index as u32,
+            leaf_count: self.leaf_count() as u32,
+            siblings,
+        })
+    }
+}
+
+fn hash_promoted(node: &[u8; 32]) -> [u8; 32] {
+    let mut hasher = Sha256::new();
+    hasher.update([PROMOTE_PREFIX]);
+    hasher.update(node);
+    hasher.finalize().into()
+}
+
+fn hash_pair(left: &[u8; 32], right: &[u8; 32]) -> [u8; 32] {
+    let mut hasher = Sha256::new();
+    hasher.update([NODE_PREFIX]);
+    hasher.update(left);
+    hasher.update(right);
+    hasher.finalize().into()
+}
+
+/// Reading together with its proof, as kept in local storage
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct StoredAttestationProof {
+    pub producer: String,
+    pub interval: u64,
+    pub merkle_root: String,
+    pub reading: GenerationReading,
+    pub proof: MerkleProof,
+}
+
+impl StoredAttestationProof {
+    /// Check the proof against the root it was issued for
+    pub fn verify(&self) -> Result<bool> {
+        let root: [u8; 32] = hex::decode(&self.merkle_root)
+            .map_err(|e| anyhow!("Invalid Merkle root encoding: {}", e))?
+            .try_into()
+            .map_err(|_| anyhow!("Merkle root must be 32 bytes"))?;
+        Ok(self.proof.verify(&self.reading.leaf_hash()?, &root))
+    }
+}
+
+/// A sealed producer-interval batch
+#[derive(Debug, Clone)]
+pub struct AttestationBatch {
+    pub commitment: AttestationCommitment,
+    pub readings: Vec<GenerationReading>,
+    pub tree: MerkleTree,
+}
+
+impl AttestationBatch {
+    /// Proofs for every reading in the batch, in leaf order
+    pub fn proofs(&self) -> Vec<StoredAttestationProof> {
+        self.readings
+            .iter()
+            .enumerate()
+            .filter_map(|(index, reading)| {
+                self.tree.proof(index).map(|proof| StoredAttestationProof {
+                    producer: self.commitment.producer.clone(),
+                    interval: self.commitment.interval,
+                    merkle_root: self.commitment.merkle_root.clone(),
+                    reading: reading.clone(),
+                    proof,
+                })
+            })
+            .collect()
+    }
+}
+
+/// Collects readings per producer and interval until the interval can be sealed
+#[derive(Debug, Default)]
+pub struct AttestationBatcher {
+    open: BTreeMap<(String, u64), Vec<GenerationReading>>,
+}
+
+impl AttestationBatcher {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Add a reading to its producer-interval batch
+    pub fn add_reading(&mut self, producer: &str, reading: GenerationReading) -> Result<u64> {
+        if reading.reading_id.is_empty() {
+            return Err(anyhow!("Reading ID cannot be empty"));
+        }
+        if !reading.energy_kwh.is_finite() || reading.energy_kwh < 0.0 {
+            return Err(anyhow!("Reading energy must be a non-negative amount"));
+        }
+
+        let interval = CarbonLedger::vintage_of(reading.timestamp);
+        let batch = self.open.entry((producer.to_string(), interval)).or_default();
+        if batch.iter().any(|r| r.reading_id == reading.reading_id) {
+            return Err(anyhow!("Duplicate reading {}", reading.reading_id));
+        }
+        batch.push(reading);
+        Ok(interval)
+    }
+
+    /// Number of producer-interval batches still open
+    pub fn open_batches(&self) -> usize {
+        self.open.len()
+    }
+
+    /// Seal a single producer-interval batch
+    pub fn seal(&mut self, producer: &str, interval: u64) -> Result<Option<AttestationBatch>> {
+        match self.open.remove(&(producer.to_string(), interval)) {
+            Some(readings) => Self::build_batch(producer.to_string(), interval, readings).map(Some),
+            None => Ok(None),
+        }
+    }
+
+    /// Seal every batch whose interval has fully elapsed at `now`
+    pub fn seal_elapsed(&mut self, now: DateTime<Utc>) -> Result<Vec<AttestationBatch>> {
+        let current = CarbonLedger::vintage_of(now);
+        let elapsed: Vec<(String, u64)> = self
+            .open
+            .keys()
+            .filter(|(_, interval)| *interval < current)
+            .cloned()
+            .collect();
+
+        let mut batches = Vec::with_capacity(elapsed.len());
+        for key in elapsed {
+            if let Some(readings) = self.open.remove(&key) {
+                batches.push(Self::build_batch(key.0, key.1, readings)?);
+            }
+        }
+        Ok(batches)
+    }
+
+    fn build_batch(
+        producer: String,
+        interval: u64,
+        mut readings: Vec<GenerationReading>,
+    ) -> Result<AttestationBatch> {
+        // Canonical leaf order so independent builders derive the same root
+        readings.sort_by(|a, b| {
+            a.timestamp
+                .cmp(&b.timestamp)
+                .then_with(|| a.reading_id.cmp(&b.reading_id))
+        });
+
+        let leaves = readings
+            .iter()
+            .map(GenerationReading::leaf_hash)
+            .collect::<Result<Vec<_>>>()?;
+        let tree = MerkleTree::from_leaves(leaves)?;
+
+        let total_energy_kwh = readings.iter().map(|r| r.energy_kwh).sum();
+        let renewable_energy_kwh = readings
+            .iter()
+            .filter(|r| r.energy_source.is_renewable())
+            .map(|r| r.energy_kwh)
+            .sum();
+
+        Ok(AttestationBatch {
+            commitment: AttestationCommitment {
+                producer,
+                interval,
+                merkle_root: tree.root_hex(),
+                reading_count: readings.len() as u32,
+                total_energy_kwh,
+                renewable_energy_kwh,
+            },
+            readings,
+            tree,
+        })
+    }
+}
+
+/// Batches readings on the node and submits sealed roots on chain
+#[derive(Debug)]
+pub struct AttestationService {
+    blockchain: Arc<RwLock<Blockchain>>,
+    storage: Arc<StorageManager>,
+    batcher: Mutex<AttestationBatcher>,
+    /// Sealed batches whose proofs or commitment have not been accepted yet
+    unsubmitted: Mutex<Vec<AttestationBatch>>,
+}
+
+impl AttestationService {
+    pub fn new(blockchain: Arc<RwLock<Blockchain>>, storage: Arc<StorageManager>) -> Self {
+        Self {
+            blockchain,
+            storage,
+            batcher: Mutex::new(AttestationBatcher::new()),
+            unsubmitted: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Add a reading to its batch. Readings may arrive up to one interval late;
+    /// older intervals have already been sealed.
+    pub async fn submit_reading(&self, producer: &str, reading: GenerationReading) -> Result<u64> {
+        let interval = CarbonLedger::vintage_of(reading.timestamp);
+        if interval < CarbonLedger::vintage_of(Self::seal_cutoff(Utc::now())) {
+            return Err(anyhow!("Interval {} has already been sealed", interval));
+        }
+        self.batcher.lock().await.add_reading(producer, reading)
+    }
+
+    /// Seal intervals older than the late-reading grace period, store their proofs
+    /// and submit their roots. Batches that fail either step are retried on the
+    /// next call. Returns the number of commitments submitted.
+    pub async fn seal_elapsed(&self, now: DateTime<Utc>) -> Result<usize> {
+        let sealed = self.batcher.lock().await.seal_elapsed(Self::seal_cutoff(now))?;
+        let mut queue = self.unsubmitted.lock().await;
+        queue.extend(sealed);
+
+        let blockchain = self.blockchain.read().await;
+        let mut submitted = 0;
+        let mut retry = Vec::new();
+        for batch in queue.drain(..) {
+            if let Err(e) = self.storage.store_attestation_proofs(&batch.proofs()).await {
+                tracing::warn!("Storing attestation proofs failed, will retry: {}", e);
+                retry.push(batch);
+                continue;
+            }
+            let nonce = blockchain.next_nonce(&batch.commitment.producer).await;
+            let tx = Transaction::new_attestation_commitment(batch.commitment.clone(), 0, nonce)?;
+            match blockchain.add_pending_transaction(tx).await {
+                Ok(()) => submitted += 1,
+                Err(e) => {
+                    tracing::warn!(
+                        "Attestation for {} interval {} not admitted, will retry: {}",
+                        batch.commitment.producer,
+                        batch.commitment.interval,
+                        e
+                    );
+                    retry.push(batch);
+                }
+            }
+        }
+        *queue = retry;
+        Ok(submitted)
+    }
+
+    /// Seal and submit elapsed intervals every `period`
+    pub async fn run(self: Arc<Self>, period: Duration) {
+        let mut ticker = tokio::time::interval(period);
+        loop {
+            ticker.tick().await;
+            if let Err(e) = self.seal_elapsed(Utc::now()).await {
+                tracing::warn!("Attestation sealing failed: {}", e);
+            }
+        }
+    }
+
+    fn seal_cutoff(now: DateTime<Utc>) -> DateTime<Utc> {
+        now - chrono::Duration::seconds(GENERATION_INTERVAL_SECS)
+    }
+}
+
+/// Start of a generation interval
+pub fn interval_start(interval: u64) -> Option<DateTime<Utc>> {
+    DateTime::from_timestamp((interval as i64) * GENERATION_INTERVAL_SECS, 0)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn reading(id: &str, offset_secs: i64, energy_kwh: f64, source: EnergySource) -> GenerationReading {
+        GenerationReading {
+            reading_id: id.to_string(),
+            meter_id: "meter-1".to_string(),
+            timestamp: interval_start(1_948_889).unwrap() + chrono::Duration::seconds(offset_secs),
+            energy_kwh,
+            energy_source: source,
+            rec_certificate: Some("REC-TH-001".to_string()),
+        }
+    }
+
+    #[test]
+    fn test_proofs_verify_for_every_leaf() {
+        let mut batcher = AttestationBatcher::new();
+        for i in 0..7 {
+            batcher
+                .add_reading("producer", reading(&format!("r{}", i), i * 60, 1.5, EnergySource::Solar))
+                .unwrap();
+        }
+
+        let batch = batcher.seal("producer", 1_948_889).unwrap().unwrap();
+        assert_eq!(batch.commitment.reading_count, 7);
+        assert_eq!(batch.commitment.total_energy_kwh, 10.5);
+        assert_eq!(batcher.open_batches(), 0);
+
+        for stored in batch.proofs() {
+            assert!(stored.verify().unwrap());
+        }
+    }
+
+    #[test]
+    fn test_tampered_reading_fails_verification() {
+        let mut batcher = AttestationBatcher::new();
+        batcher.add_reading("producer", reading("a", 0, 2.0, EnergySource::Wind)).unwrap();
+        batcher.add_reading("producer", reading("b", 60, 3.0, EnergySource::NaturalGas)).unwrap();
+
+        let batch = batcher.seal("producer", 1_948_889).unwrap().unwrap();
+        assert_eq!(batch.commitment.renewable_energy_kwh, 2.0);
+
+        let mut stored = batch.proofs().remove(0);
+        stored.reading.energy_kwh = 20.0;
+        assert!(!stored.verify().unwrap());
+    }
+
+    #[test]
+    fn test_proof_cannot_claim_padding_leaf() {
+        let mut batcher = AttestationBatcher::new();
+        for i in 0..3 {
+            batcher
+                .add_reading("producer", reading(&format!("r{}", i), i * 60, 1.0, EnergySource::Solar))
+                .unwrap();
+        }
+        let batch = batcher.seal("producer", 1_948_889).unwrap().unwrap();
+
+        // The last leaf has no neighbour; it must not verify as a fourth leaf
+        // or as part of a four-leaf tree
+        let mut stored = batch.proofs().remove(2);
+        stored.proof.leaf_index = 3;
+        assert!(!stored.verify().unwrap());
+
+        stored.proof.leaf_index = 2;
+        stored.proof.leaf_count = 4;
+        assert!(!stored.verify().unwrap());
+
+        let mut padded = stored.clone();
+        padded.proof.siblings.insert(0, padded.reading.leaf_hash().unwrap());
+        assert!(!padded.verify().unwrap());
+
+        stored.proof.leaf_count = 3;
+        assert!(stored.verify().unwrap());
+    }
+
+    #[tokio::test]
+    async fn test_service_seals_and_submits_after_grace_period() {
+        let storage = Arc::new(StorageManager::new_memory());
+        let blockchain = Arc::new(RwLock::new(Blockchain::new(storage.clone()).await.unwrap()));
+        let service = AttestationService::new(blockchain.clone(), storage.clone());
+
+        let interval = CarbonLedger::vintage_of(Utc::now());
+        let mut late = reading("a", 0, 1.0, EnergySource::Solar);
+        late.timestamp = interval_start(interval - 2).unwrap();
+        assert!(service.submit_reading("producer", late).await.is_err());
+
+        let mut current = reading("b", 0, 1.0, EnergySource::Solar);
+        current.timestamp = interval_start(interval).unwrap();
+        service.submit_reading("producer", current).await.unwrap();
+
+        // Still within the grace period for late readings
+        let next = interval_start(interval + 1).unwrap();
+        assert_eq!(service.seal_elapsed(next).await.unwrap(), 0);
+
+        let after_grace = interval_start(interval + 2).unwrap();
+        assert_eq!(service.seal_elapsed(after_grace).await.unwrap(), 1);
+
+        let pending = blockchain.read().await.get_pending_transactions(10).await;
+        assert_eq!(pending.len(), 1);
+        assert!(matches!(
+            pending[0].transaction_type,
+            crate::blockchain::TransactionType::Attestation(_)
+        ));
+        assert!(storage
+            .get_attestation_proof("producer", interval, "b")
+            .await
+            .unwrap()
+            .is_some());
+    }
+
+    #[test]
+    fn test_seal_elapsed_keeps_current_interval_open() {
+        let mut batcher = AttestationBatcher::new();
+        batcher.add_reading("producer", reading("a", 0, 1.0, EnergySource::Solar)).unwrap();
+        assert!(batcher.add_reading("producer", reading("a", 30, 1.0, EnergySource::Solar)).is_err());
+
+        let now = interval_start(1_948_889).unwrap() + chrono::Duration::minutes(5);
+        assert!(batcher.seal_elapsed(now).unwrap().is_empty());
+
+        let later = interval_start(1_948_890).unwrap();
+        assert_eq!(batcher.seal_elapsed(later).unwrap().len(), 1);
+        assert_eq!(batcher.open_batches(), 0);
+    }
+}
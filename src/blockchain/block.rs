@@ -11,6 +11,9 @@ use std::collections::HashMap;
 
 use super::{Transaction, ValidationResult};
 
+/// Gas limit per block
+pub const BLOCK_GAS_LIMIT: u64 = 10_000_000;
+
 /// Block structure for GridTokenX blockchain
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Block {
@@ -53,6 +56,9 @@ pub struct BlockHeader {
     pub gas_limit: u64,
     /// Extra data field (up to 32 bytes)
     pub extra_data: Vec<u8>,
+    /// Proposer's signature over `hash` (hex); not covered by the hash
+    #[serde(default)]
+    pub signature: String,
 }
 
 /// Validator information for block creation
@@ -115,6 +121,57 @@ pub struct GovernanceAction {
     pub executed_at: DateTime<Utc>,
 }
 
+/// Path from a transaction hash to the block's Merkle root
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct TransactionProof {
+    /// Position of the transaction in the block
+    pub index: u32,
+    /// Sibling hashes from the leaf level up to (excluding) the root
+    pub siblings: Vec<String>,
+}
+
+impl TransactionProof {
+    /// Whether `tx_hash` hashes up to `merkle_root` along this path
+    pub fn verify(&self, tx_hash: &str, merkle_root: &str) -> bool {
+        let mut hash = tx_hash.to_string();
+        let mut index = self.index;
+        for sibling in &self.siblings {
+            hash = if index % 2 == 0 {
+                merkle_parent(&hash, sibling)
+            } else {
+                merkle_parent(sibling, &hash)
+            };
+            index /= 2;
+        }
+        index == 0 && hash == merkle_root
+    }
+}
+
+/// Inner node of the transaction Merkle tree (hex-encoded hashes)
+fn merkle_parent(left: &str, right: &str) -> String {
+    let mut hasher = Sha256::new();
+    hasher.update(left.as_bytes());
+    hasher.update(right.as_bytes());
+    hex::encode(hasher.finalize())
+}
+
+impl BlockHeader {
+    /// Hash of the header, which is the block hash
+    pub fn calculate_hash(&self) -> Result<String> {
+        // Hash and signature are excluded so the hash is stable and can be signed
+        let mut header_for_hash = self.clone();
+        header_for_hash.hash = String::new();
+        header_for_hash.signature = String::new();
+
+        let header_data = bincode::serialize(&header_for_hash)
+            .map_err(|e| anyhow!("Failed to serialize block header: {}", e))?;
+
+        let mut hasher = Sha256::new();
+        hasher.update(&header_data);
+        Ok(hex::encode(hasher.finalize()))
+    }
+}
+
 impl Block {
     /// Create a new block with given transactions
     pub fn new(
@@ -146,8 +203,9 @@ impl Block {
             hash: String::new(), // Will be calculated after block creation
             validator,
             gas_used,
-            gas_limit: 10_000_000, // 10M gas limit per block
+            gas_limit: BLOCK_GAS_LIMIT,
             extra_data: Vec::new(),
+            signature: String::new(),
         };
 
         let size = Self::calculate_block_size(&header, &transactions)?;
@@ -166,8 +224,34 @@ impl Block {
         Ok(block)
     }
 
+    /// Reassemble a block from a received header and its transactions.
+    ///
+    /// Derived fields are recomputed; the Merkle root must match the header.
+    pub fn from_parts(header: BlockHeader, transactions: Vec<Transaction>) -> Result<Self> {
+        if Self::calculate_merkle_root(&transactions)? != header.merkle_root {
+            return Err(anyhow!("Transactions do not match header Merkle root"));
+        }
+
+        Ok(Self {
+            energy_stats: Self::calculate_energy_stats(&transactions)?,
+            governance_actions: Self::extract_governance_actions(&transactions)?,
+            size: Self::calculate_block_size(&header, &transactions)?,
+            header,
+            transactions,
+        })
+    }
+
     /// Create genesis block with initial transactions
     pub fn new_genesis(transactions: Vec<Transaction>, extra_data: String) -> Result<Self> {
+        Self::new_genesis_at(transactions, extra_data, Utc::now())
+    }
+
+    /// Create genesis block with a fixed timestamp, so its hash is reproducible
+    pub fn new_genesis_at(
+        transactions: Vec<Transaction>,
+        extra_data: String,
+        timestamp: DateTime<Utc>,
+    ) -> Result<Self> {
         let validator = ValidatorInfo {
             address: "genesis".to_string(),
             stake: 0,
@@ -183,6 +267,7 @@ impl Block {
         )?;
 
         genesis_block.header.extra_data = extra_data.as_bytes().to_vec();
+        genesis_block.header.timestamp = timestamp;
         genesis_block.header.hash = genesis_block.calculate_hash()?;
 
         Ok(genesis_block)
@@ -190,16 +275,7 @@ impl Block {
 
     /// Calculate block hash
     pub fn calculate_hash(&self) -> Result<String> {
-        // Create a copy of header with hash field set to empty to ensure consistent hashing
-        let mut header_for_hash = self.header.clone();
-        header_for_hash.hash = String::new();
-        
-        let header_data = bincode::serialize(&header_for_hash)
-            .map_err(|e| anyhow!("Failed to serialize block header: {}", e))?;
-
-        let mut hasher = Sha256::new();
-        hasher.update(&header_data);
-        Ok(hex::encode(hasher.finalize()))
+        self.header.calculate_hash()
     }
 
     /// Calculate Merkle root of transactions
@@ -214,29 +290,44 @@ impl Block {
             .collect::<Result<Vec<_>>>()?;
 
         while hashes.len() > 1 {
-            let mut next_level = Vec::new();
-
-            for chunk in hashes.chunks(2) {
-                if chunk.len() == 2 {
-                    let combined = format!("{}{}", chunk[0], chunk[1]);
-                    let mut hasher = Sha256::new();
-                    hasher.update(combined.as_bytes());
-                    next_level.push(hex::encode(hasher.finalize()));
-                } else {
-                    // Odd number of hashes, duplicate the last one
-                    let combined = format!("{}{}", chunk[0], chunk[0]);
-                    let mut hasher = Sha256::new();
-                    hasher.update(combined.as_bytes());
-                    next_level.push(hex::encode(hasher.finalize()));
-                }
-            }
-
-            hashes = next_level;
+            hashes = hashes
+                .chunks(2)
+                // Odd number of hashes, duplicate the last one
+                .map(|chunk| merkle_parent(&chunk[0], chunk.get(1).unwrap_or(&chunk[0])))
+                .collect();
         }
 
         Ok(hashes.into_iter().next().unwrap_or_default())
     }
 
+    /// Merkle inclusion proof for a transaction, if it is in this block
+    pub fn transaction_proof(&self, tx_id: &str) -> Result<Option<TransactionProof>> {
+        let Some(index) = self.transactions.iter().position(|tx| tx.id == tx_id) else {
+            return Ok(None);
+        };
+        let mut hashes: Vec<String> = self
+            .transactions
+            .iter()
+            .map(|tx| tx.hash())
+            .collect::<Result<Vec<_>>>()?;
+
+        let mut siblings = Vec::new();
+        let mut position = index;
+        while hashes.len() > 1 {
+            siblings.push(hashes.get(position ^ 1).unwrap_or(&hashes[position]).clone());
+            hashes = hashes
+                .chunks(2)
+                .map(|chunk| merkle_parent(&chunk[0], chunk.get(1).unwrap_or(&chunk[0])))
+                .collect();
+            position /= 2;
+        }
+
+        Ok(Some(TransactionProof {
+            index: index as u32,
+            siblings,
+        }))
+    }
+
     /// Calculate energy statistics for the block
     fn calculate_energy_stats(transactions: &[Transaction]) -> Result<BlockEnergyStats> {
         let mut total_energy = 0.0;
@@ -572,6 +663,23 @@ mod tests {
         assert_eq!(merkle_root.len(), 64); // SHA256 hex string
     }
 
+    #[test]
+    fn test_transaction_proofs_verify_against_merkle_root() {
+        let transactions: Vec<Transaction> = (0..5)
+            .map(|i| Transaction::new_genesis_mint(format!("acct{}", i), 100 * i, "Mint".to_string()).unwrap())
+            .collect();
+        let block = Block::new_genesis(transactions.clone(), "Proofs".to_string()).unwrap();
+
+        for tx in &transactions {
+            let proof = block.transaction_proof(&tx.id).unwrap().unwrap();
+            assert!(proof.verify(&tx.hash().unwrap(), &block.header.merkle_root));
+            assert!(!proof.verify(&transactions[0].hash().unwrap(), "00"));
+        }
+        let last = block.transaction_proof(&transactions[4].id).unwrap().unwrap();
+        assert!(!last.verify(&transactions[3].hash().unwrap(), &block.header.merkle_root));
+        assert!(block.transaction_proof("missing").unwrap().is_none());
+    }
+
     #[test]
     fn test_energy_stats_calculation() {
         // This test would require creating energy transactions
@@ -0,0 +1,642 @@
+//! GridTokenX Carbon Credit Ledger Module
+//!
+//! This module implements the renewable energy certificate (REC) ledger for the
+//! GridTokenX blockchain. Certificate lots are issued per producer, energy source
+//! and generation interval, and can then be transferred or retired. Lots are
+//! indexed by owner, source and vintage so that balance and portfolio queries
+//! never need to scan the whole ledger.
+
+use anyhow::{anyhow, Result};
+use chrono::{DateTime, Utc};
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, BTreeSet, HashMap};
+use std::ops::RangeBounds;
+
+use super::transaction::{EnergySource, EnergyTransaction};
+use crate::config::CarbonCreditConfig;
+
+/// Length of a generation interval (certificate vintage) in seconds
+pub const GENERATION_INTERVAL_SECS: i64 = 900; // 15-minute settlement periods
+
+/// Credit amounts below this are treated as zero (floating point dust)
+const CREDIT_EPSILON: f64 = 1e-9;
+
+/// A lot of carbon credits backed by one producer's generation interval
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct CertificateLot {
+    /// Lot identifier
+    pub id: String,
+    /// Current owner address
+    pub owner: String,
+    /// Producer that generated the underlying energy
+    pub producer: String,
+    /// Energy source of the underlying generation
+    pub energy_source: EnergySource,
+    /// Generation interval index (unix seconds / GENERATION_INTERVAL_SECS)
+    pub vintage: u64,
+    /// Energy backing this lot (kWh)
+    pub energy_amount: f64,
+    /// Active (transferable) credits
+    pub credits: f64,
+    /// Credits already retired from this lot
+    pub retired_credits: f64,
+    /// Lot this one was split from by a partial transfer
+    pub parent_lot: Option<String>,
+    /// Renewable energy certificate reference from compliance data
+    pub rec_certificate: Option<String>,
+    /// Block height of issuance
+    pub issued_at_height: u64,
+    /// Issuance timestamp
+    pub issued_at: DateTime<Utc>,
+}
+
+/// Retirement request queued during block execution
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct RetirementRequest {
+    pub tx_id: String,
+    pub owner: String,
+    pub lot_id: String,
+    pub amount: f64,
+    pub beneficiary: Option<String>,
+}
+
+/// Completed retirement
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct RetirementRecord {
+    pub tx_id: String,
+    pub lot_id: String,
+    pub owner: String,
+    pub beneficiary: Option<String>,
+    pub amount: f64,
+    pub block_height: u64,
+}
+
+/// Carbon ledger statistics
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct CarbonLedgerStats {
+    pub total_lots: u64,
+    pub total_issued: f64,
+    pub total_active: f64,
+    pub total_retired: f64,
+    pub holders: u64,
+}
+
+/// Ledger counters persisted alongside the lots
+#[derive(Debug, Clone, Copy, Default, Serialize, Deserialize)]
+pub struct CarbonCounters {
+    pub total_issued: f64,
+    pub total_retired: f64,
+    pub next_lot_seq: u64,
+}
+
+/// Persisted ledger state: everything, on load, or what changed since the last save
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct CarbonLedgerState {
+    pub lots: Vec<CertificateLot>,
+    pub retirements: Vec<RetirementRecord>,
+    pub counters: CarbonCounters,
+}
+
+/// Carbon credit ledger with owner, source and vintage indexes
+#[derive(Debug)]
+pub struct CarbonLedger {
+    /// Credit rates and enablement
+    config: CarbonCreditConfig,
+    /// All lots by ID (including fully retired lots, for audit)
+    lots: HashMap<String, CertificateLot>,
+    /// Lots holding active credits, by owner
+    by_owner: BTreeMap<String, BTreeSet<String>>,
+    /// Lots by energy source name
+    by_source: BTreeMap<&'static str, BTreeSet<String>>,
+    /// Lots by generation interval
+    by_vintage: BTreeMap<u64, BTreeSet<String>>,
+    /// Active credit balance per owner
+    balances: BTreeMap<String, f64>,
+    /// Retirements waiting for the end of the current block
+    pending_retirements: Vec<RetirementRequest>,
+    /// Retirement history
+    retirements: Vec<RetirementRecord>,
+    total_issued: f64,
+    total_retired: f64,
+    /// Sequence for lot IDs created by splits and re-issuance
+    next_lot_seq: u64,
+    /// Lots changed since the last `take_changes`
+    changed_lots: BTreeSet<String>,
+    /// Retirements already handed out by `take_changes`
+    saved_retirements: usize,
+}
+
+impl CarbonLedger {
+    /// Create an empty ledger using the given credit rates
+    pub fn new(config: CarbonCreditConfig) -> Self {
+        Self {
+            config,
+            lots: HashMap::new(),
+            by_owner: BTreeMap::new(),
+            by_source: BTreeMap::new(),
+            by_vintage: BTreeMap::new(),
+            balances: BTreeMap::new(),
+            pending_retirements: Vec::new(),
+            retirements: Vec::new(),
+            total_issued: 0.0,
+            total_retired: 0.0,
+            next_lot_seq: 0,
+            changed_lots: BTreeSet::new(),
+            saved_retirements: 0,
+        }
+    }
+
+    /// Rebuild a ledger and its indexes from persisted state
+    pub fn restore(config: CarbonCreditConfig, state: CarbonLedgerState) -> Self {
+        let mut ledger = Self::new(config);
+        for lot in state.lots {
+            if lot.credits > CREDIT_EPSILON {
+                ledger.credit(&lot.owner, lot.credits);
+                ledger.insert_lot(lot);
+            } else {
+                // Emptied lots stay for audit but leave the owner index
+                let (id, owner) = (lot.id.clone(), lot.owner.clone());
+                ledger.insert_lot(lot);
+                remove_from_index(&mut ledger.by_owner, &owner, &id);
+            }
+        }
+        ledger.saved_retirements = state.retirements.len();
+        ledger.retirements = state.retirements;
+        ledger.total_issued = state.counters.total_issued;
+        ledger.total_retired = state.counters.total_retired;
+        ledger.next_lot_seq = state.counters.next_lot_seq;
+        ledger.changed_lots.clear();
+        ledger
+    }
+
+    /// Lots and retirements changed since the previous call, for persistence
+    pub fn take_changes(&mut self) -> CarbonLedgerState {
+        let lots = std::mem::take(&mut self.changed_lots)
+            .iter()
+            .filter_map(|id| self.lots.get(id).cloned())
+            .collect();
+        let retirements = self.retirements[self.saved_retirements..].to_vec();
+        self.saved_retirements = self.retirements.len();
+        CarbonLedgerState {
+            lots,
+            retirements,
+            counters: CarbonCounters {
+                total_issued: self.total_issued,
+                total_retired: self.total_retired,
+                next_lot_seq: self.next_lot_seq,
+            },
+        }
+    }
+
+    /// Generation interval index for a timestamp
+    pub fn vintage_of(timestamp: DateTime<Utc>) -> u64 {
+        timestamp.timestamp().max(0) as u64 / GENERATION_INTERVAL_SECS as u64
+    }
+
+    /// Issue credits for generation reported by an energy transaction.
+    ///
+    /// Credits are computed from the configured rate for the energy source, and
+    /// generation from the same producer, source and interval is aggregated into
+    /// one lot while the producer still owns it. Returns the lot ID, or `None`
+    /// when the source earns no credits.
+    pub fn issue_for_generation(
+        &mut self,
+        producer: &str,
+        energy_tx: &EnergyTransaction,
+        block_height: u64,
+        timestamp: DateTime<Utc>,
+    ) -> Option<String> {
+        let credits =
+            energy_tx.energy_amount * self.config.credit_rate(energy_tx.energy_source.as_str());
+        if credits <= CREDIT_EPSILON {
+            return None;
+        }
+
+        let source = energy_tx.energy_source.as_str();
+        let vintage = Self::vintage_of(energy_tx.delivery_window.start_time);
+        let mut lot_id = format!("REC-{}-{}-{}", producer, source, vintage);
+
+        match self.lots.get_mut(&lot_id) {
+            Some(lot) if lot.owner == producer => {
+                lot.credits += credits;
+                lot.energy_amount += energy_tx.energy_amount;
+                self.changed_lots.insert(lot_id.clone());
+                if lot.credits - credits <= CREDIT_EPSILON {
+                    // Lot was emptied by retirement, so it left the owner index
+                    self.by_owner
+                        .entry(producer.to_string())
+                        .or_default()
+                        .insert(lot_id.clone());
+                }
+            }
+            existing => {
+                if existing.is_some() {
+                    // Original lot changed hands, start a new one for this interval
+                    lot_id = format!("{}-{}", lot_id, self.next_lot_seq);
+                    self.next_lot_seq += 1;
+                }
+                let lot = CertificateLot {
+                    id: lot_id.clone(),
+                    owner: producer.to_string(),
+                    producer: producer.to_string(),
+                    energy_source: energy_tx.energy_source.clone(),
+                    vintage,
+                    energy_amount: energy_tx.energy_amount,
+                    credits,
+                    retired_credits: 0.0,
+                    parent_lot: None,
+                    rec_certificate: energy_tx.compliance_data.rec_certificate.clone(),
+                    issued_at_height: block_height,
+                    issued_at: timestamp,
+                };
+                self.insert_lot(lot);
+            }
+        }
+
+        *self.balances.entry(producer.to_string()).or_insert(0.0) += credits;
+        self.total_issued += credits;
+        Some(lot_id)
+    }
+
+    /// Transfer credits from a lot owned by `from` to `to`.
+    ///
+    /// A full transfer moves the lot itself; a partial transfer splits off a new
+    /// child lot. Returns the ID of the lot now holding the transferred credits.
+    pub fn transfer(&mut self, from: &str, to: &str, lot_id: &str, amount: f64) -> Result<String> {
+        if amount.is_nan() || amount <= 0.0 {
+            return Err(anyhow!("Invalid transfer amount {} for lot {}", amount, lot_id));
+        }
+        let lot = self
+            .lots
+            .get_mut(lot_id)
+            .ok_or_else(|| anyhow!("Certificate lot not found: {}", lot_id))?;
+
+        if lot.owner != from {
+            return Err(anyhow!("Certificate lot {} is not owned by {}", lot_id, from));
+        }
+        if amount > lot.credits + CREDIT_EPSILON {
+            return Err(anyhow!(
+                "Insufficient credits in lot {}: {} requested, {} available",
+                lot_id,
+                amount,
+                lot.credits
+            ));
+        }
+
+        self.changed_lots.insert(lot_id.to_string());
+        let target_id = if lot.credits - amount <= CREDIT_EPSILON {
+            // Whole lot changes owner
+            lot.owner = to.to_string();
+            let moved = lot.credits;
+            remove_from_index(&mut self.by_owner, from, lot_id);
+            self.by_owner
+                .entry(to.to_string())
+                .or_default()
+                .insert(lot_id.to_string());
+            self.debit(from, moved);
+            self.credit(to, moved);
+            lot_id.to_string()
+        } else {
+            let energy_share = lot.energy_amount * amount / lot.credits;
+            lot.credits -= amount;
+            lot.energy_amount -= energy_share;
+
+            let child = CertificateLot {
+                id: format!("{}/{}", lot_id, self.next_lot_seq),
+                owner: to.to_string(),
+                energy_amount: energy_share,
+                credits: amount,
+                retired_credits: 0.0,
+                parent_lot: Some(lot_id.to_string()),
+                ..lot.clone()
+            };
+            self.next_lot_seq += 1;
+
+            let child_id = child.id.clone();
+            self.insert_lot(child);
+            self.debit(from, amount);
+            self.credit(to, amount);
+            child_id
+        };
+
+        Ok(target_id)
+    }
+
+    /// Queue a retirement; it takes effect when `apply_retirements` runs
+    pub fn queue_retirement(&mut self, request: RetirementRequest) {
+        self.pending_retirements.push(request);
+    }
+
+    /// Apply all queued retirements in transaction order.
+    ///
+    /// Invalid requests (unknown lot, wrong owner, insufficient credits) are
+    /// skipped so that every node reaches the same state.
+    pub fn apply_retirements(&mut self, block_height: u64) -> Vec<RetirementRecord> {
+        let requests = std::mem::take(&mut self.pending_retirements);
+        let mut applied = Vec::with_capacity(requests.len());
+
+        for request in requests {
+            if request.amount.is_nan() || request.amount <= 0.0 {
+                tracing::warn!(
+                    "Retirement {} skipped: invalid amount {}",
+                    request.tx_id,
+                    request.amount
+                );
+                continue;
+            }
+            let Some(lot) = self.lots.get_mut(&request.lot_id) else {
+                tracing::warn!("Retirement {} skipped: unknown lot {}", request.tx_id, request.lot_id);
+                continue;
+            };
+            if lot.owner != request.owner || request.amount > lot.credits + CREDIT_EPSILON {
+                tracing::warn!(
+                    "Retirement {} skipped: lot {} not owned by {} or insufficient credits",
+                    request.tx_id,
+                    request.lot_id,
+                    request.owner
+                );
+                continue;
+            }
+
+            let amount = request.amount.min(lot.credits);
+            self.changed_lots.insert(request.lot_id.clone());
+            lot.credits -= amount;
+            lot.retired_credits += amount;
+            if lot.credits <= CREDIT_EPSILON {
+                lot.credits = 0.0;
+                remove_from_index(&mut self.by_owner, &request.owner, &request.lot_id);
+            }
+
+            self.debit(&request.owner, amount);
+            self.total_retired += amount;
+
+            let record = RetirementRecord {
+                tx_id: request.tx_id,
+                lot_id: request.lot_id,
+                owner: request.owner,
+                beneficiary: request.beneficiary,
+                amount,
+                block_height,
+            };
+            self.retirements.push(record.clone());
+            applied.push(record);
+        }
+
+        applied
+    }
+
+    /// Active credit balance of an owner (O(log n))
+    pub fn balance_of(&self, owner: &str) -> f64 {
+        self.balances.get(owner).copied().unwrap_or(0.0)
+    }
+
+    /// Get a lot by ID
+    pub fn get_lot(&self, lot_id: &str) -> Option<&CertificateLot> {
+        self.lots.get(lot_id)
+    }
+
+    /// Lots currently holding active credits for an owner
+    pub fn lots_by_owner(&self, owner: &str) -> Vec<&CertificateLot> {
+        self.collect_lots(self.by_owner.get(owner))
+    }
+
+    /// All lots issued from an energy source
+    pub fn lots_by_source(&self, source: &EnergySource) -> Vec<&CertificateLot> {
+        self.collect_lots(self.by_source.get(source.as_str()))
+    }
+
+    /// All lots whose vintage falls in the given generation interval range
+    pub fn lots_by_vintage<R: RangeBounds<u64>>(&self, vintages: R) -> Vec<&CertificateLot> {
+        self.by_vintage
+            .range(vintages)
+            .flat_map(|(_, ids)| ids.iter())
+            .filter_map(|id| self.lots.get(id))
+            .collect()
+    }
+
+    /// Retirement history for an owner
+    pub fn retirements_by_owner(&self, owner: &str) -> Vec<&RetirementRecord> {
+        self.retirements.iter().filter(|r| r.owner == owner).collect()
+    }
+
+    /// Ledger statistics
+    pub fn stats(&self) -> CarbonLedgerStats {
+        CarbonLedgerStats {
+            total_lots: self.lots.len() as u64,
+            total_issued: self.total_issued,
+            total_active: self.balances.values().sum(),
+            total_retired: self.total_retired,
+            holders: self.balances.len() as u64,
+        }
+    }
+
+    fn insert_lot(&mut self, lot: CertificateLot) {
+        self.changed_lots.insert(lot.id.clone());
+        self.by_owner
+            .entry(lot.owner.clone())
+            .or_default()
+            .insert(lot.id.clone());
+        self.by_source
+            .entry(lot.energy_source.as_str())
+            .or_default()
+            .insert(lot.id.clone());
+        self.by_vintage
+            .entry(lot.vintage)
+            .or_default()
+            .insert(lot.id.clone());
+        self.lots.insert(lot.id.clone(), lot);
+    }
+
+    fn collect_lots(&self, ids: Option<&BTreeSet<String>>) -> Vec<&CertificateLot> {
+        ids.map(|ids| ids.iter().filter_map(|id| self.lots.get(id)).collect())
+            .unwrap_or_default()
+    }
+
+    fn credit(&mut self, owner: &str, amount: f64) {
+        *self.balances.entry(owner.to_string()).or_insert(0.0) += amount;
+    }
+
+    fn debit(&mut self, owner: &str, amount: f64) {
+        if let Some(balance) = self.balances.get_mut(owner) {
+            *balance -= amount;
+            if *balance <= CREDIT_EPSILON {
+                self.balances.remove(owner);
+            }
+        }
+    }
+}
+
+impl Default for CarbonLedger {
+    fn default() -> Self {
+        Self::new(CarbonCreditConfig::default())
+    }
+}
+
+/// Remove a lot ID from a keyed index, dropping empty keys
+fn remove_from_index(index: &mut BTreeMap<String, BTreeSet<String>>, key: &str, lot_id: &str) {
+    if let Some(ids) = index.get_mut(key) {
+        ids.remove(lot_id);
+        if ids.is_empty() {
+            index.remove(key);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::transaction::{DeliveryWindow, GridLocation};
+
+    fn solar_generation(energy_amount: f64) -> EnergyTransaction {
+        let start_time = DateTime::from_timestamp(1_754_000_100, 0).unwrap();
+        EnergyTransaction::new_sell_order(
+            energy_amount,
+            4000,
+            EnergySource::Solar,
+            DeliveryWindow {
+                start_time,
+                end_time: start_time + chrono::Duration::minutes(15),
+                flexibility_minutes: 0,
+            },
+            GridLocation {
+                province_code: "BKK".to_string(),
+                distribution_area: "MEA-01".to_string(),
+                substation_id: "SUB-001".to_string(),
+                voltage_level: 22.0,
+                coordinates: None,
+            },
+            &CarbonCreditConfig::default(),
+        )
+    }
+
+    #[test]
+    fn test_issuance_aggregates_per_interval() {
+        let mut ledger = CarbonLedger::default();
+
+        let lot_a = ledger
+            .issue_for_generation("producer", &solar_generation(100.0), 1, Utc::now())
+            .unwrap();
+        let lot_b = ledger
+            .issue_for_generation("producer", &solar_generation(20.0), 2, Utc::now())
+            .unwrap();
+
+        assert_eq!(lot_a, lot_b);
+        assert_eq!(ledger.balance_of("producer"), 60.0); // 120 kWh * 0.5 for solar
+        assert_eq!(ledger.lots_by_source(&EnergySource::Solar).len(), 1);
+        assert_eq!(ledger.lots_by_vintage(1_948_889..=1_948_889).len(), 1);
+    }
+
+    #[test]
+    fn test_partial_transfer_splits_lot() {
+        let mut ledger = CarbonLedger::default();
+        let lot_id = ledger
+            .issue_for_generation("producer", &solar_generation(100.0), 1, Utc::now())
+            .unwrap();
+
+        let child_id = ledger.transfer("producer", "buyer", &lot_id, 20.0).unwrap();
+
+        assert_ne!(child_id, lot_id);
+        assert_eq!(ledger.balance_of("producer"), 30.0);
+        assert_eq!(ledger.balance_of("buyer"), 20.0);
+        assert_eq!(ledger.lots_by_owner("buyer").len(), 1);
+        assert!(ledger.transfer("buyer", "other", &lot_id, 1.0).is_err());
+    }
+
+    #[test]
+    fn test_batch_retirement() {
+        let mut ledger = CarbonLedger::default();
+        let lot_id = ledger
+            .issue_for_generation("producer", &solar_generation(100.0), 1, Utc::now())
+            .unwrap();
+
+        ledger.queue_retirement(RetirementRequest {
+            tx_id: "tx-1".to_string(),
+            owner: "producer".to_string(),
+            lot_id: lot_id.clone(),
+            amount: 50.0,
+            beneficiary: Some("factory".to_string()),
+        });
+        ledger.queue_retirement(RetirementRequest {
+            tx_id: "tx-2".to_string(),
+            owner: "producer".to_string(),
+            lot_id: lot_id.clone(),
+            amount: 1.0,
+            beneficiary: None,
+        });
+
+        // Nothing changes until the batch is applied
+        assert_eq!(ledger.balance_of("producer"), 50.0);
+
+        let applied = ledger.apply_retirements(2);
+        assert_eq!(applied.len(), 1); // second request exceeds remaining credits
+        assert_eq!(ledger.balance_of("producer"), 0.0);
+        assert!(ledger.lots_by_owner("producer").is_empty());
+        assert_eq!(ledger.stats().total_retired, 50.0);
+    }
+
+    #[test]
+    fn test_restore_from_saved_changes() {
+        let mut ledger = CarbonLedger::default();
+        let lot_id = ledger
+            .issue_for_generation("producer", &solar_generation(100.0), 1, Utc::now())
+            .unwrap();
+        let mut saved = ledger.take_changes();
+
+        let child_id = ledger.transfer("producer", "buyer", &lot_id, 20.0).unwrap();
+        ledger.queue_retirement(RetirementRequest {
+            tx_id: "tx-1".to_string(),
+            owner: "producer".to_string(),
+            lot_id: lot_id.clone(),
+            amount: 30.0,
+            beneficiary: None,
+        });
+        ledger.apply_retirements(2);
+
+        // Merge the second save the way storage overwrites lots by ID
+        let changes = ledger.take_changes();
+        assert_eq!(changes.lots.len(), 2);
+        assert_eq!(changes.retirements.len(), 1);
+        saved.lots.retain(|lot| changes.lots.iter().all(|changed| changed.id != lot.id));
+        saved.lots.extend(changes.lots);
+        saved.retirements.extend(changes.retirements);
+        saved.counters = changes.counters;
+
+        let mut restored = CarbonLedger::restore(CarbonCreditConfig::default(), saved);
+        assert_eq!(restored.balance_of("producer"), 0.0);
+        assert_eq!(restored.balance_of("buyer"), 20.0);
+        assert!(restored.lots_by_owner("producer").is_empty());
+        assert_eq!(restored.stats().total_retired, 30.0);
+        assert_eq!(restored.retirements_by_owner("producer").len(), 1);
+        assert!(restored.take_changes().lots.is_empty());
+
+        // Lots issued before the restart can still move
+        restored.transfer("buyer", "other", &child_id, 5.0).unwrap();
+        assert_eq!(restored.balance_of("other"), 5.0);
+    }
+
+    #[test]
+    fn test_negative_and_nan_amounts_are_rejected() {
+        let mut ledger = CarbonLedger::default();
+        let lot_id = ledger
+            .issue_for_generation("producer", &solar_generation(100.0), 1, Utc::now())
+            .unwrap();
+
+        assert!(ledger.transfer("producer", "buyer", &lot_id, -10.0).is_err());
+        assert!(ledger.transfer("producer", "buyer", &lot_id, f64::NAN).is_err());
+
+        for (tx_id, amount) in [("tx-neg", -10.0), ("tx-nan", f64::NAN), ("tx-zero", 0.0)] {
+            ledger.queue_retirement(RetirementRequest {
+                tx_id: tx_id.to_string(),
+                owner: "producer".to_string(),
+                lot_id: lot_id.clone(),
+                amount,
+                beneficiary: None,
+            });
+        }
+        assert!(ledger.apply_retirements(2).is_empty());
+
+        assert_eq!(ledger.balance_of("producer"), 50.0);
+        assert_eq!(ledger.balance_of("buyer"), 0.0);
+        assert_eq!(ledger.stats().total_retired, 0.0);
+    }
+}
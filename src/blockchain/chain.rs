@@ -6,14 +6,19 @@
 use anyhow::{anyhow, Result};
 use chrono::{DateTime, Utc};
 use serde::{Deserialize, Serialize};
-use std::collections::{HashMap, VecDeque};
+use std::collections::{BTreeMap, HashMap, HashSet, VecDeque};
 use std::sync::Arc;
-use tokio::sync::RwLock;
+use tokio::sync::{Mutex, RwLock};
 
+use super::attestation::{AttestationCommitment, StoredAttestationProof};
+use super::carbon::{CarbonLedger, CarbonLedgerStats, CertificateLot, RetirementRequest};
+use super::registry::{AccountQuery, AccountRegistry};
 use super::{
     Account, AccountType, Block, BlockchainStats, ComplianceStatus, Transaction, TransactionType,
     ValidationResult,
 };
+use crate::config::CarbonCreditConfig;
+use crate::forecast::ForecastCache;
 use crate::storage::StorageManager;
 
 /// Main blockchain structure managing the chain of blocks
@@ -25,6 +30,8 @@ pub struct Blockchain {
     block_cache: RwLock<VecDeque<Block>>,
     /// Account balances and information
     accounts: RwLock<HashMap<String, Account>>,
+    /// Secondary indexes over accounts (type, compliance status, region)
+    account_registry: RwLock<AccountRegistry>,
     /// Pending transactions pool
     pending_transactions: RwLock<Vec<Transaction>>,
     /// Blockchain statistics
@@ -37,6 +44,16 @@ pub struct Blockchain {
     energy_orders: RwLock<EnergyOrderBook>,
     /// Active governance proposals
     governance_proposals: RwLock<HashMap<String, GovernanceProposal>>,
+    /// Carbon credit certificate ledger
+    carbon_ledger: RwLock<CarbonLedger>,
+    /// Committed generation attestations keyed by (producer, interval)
+    attestations: RwLock<BTreeMap<(String, u64), AttestationCommitment>>,
+    /// Highest applied transaction nonce per sender
+    account_nonces: RwLock<HashMap<String, u64>>,
+    /// Per-producer diurnal supply forecasts fitted from sell orders
+    supply_forecasts: RwLock<ForecastCache>,
+    /// Held across validation and application so blocks are added one at a time
+    import_lock: Mutex<()>,
 }
 
 /// Blockchain configuration parameters
@@ -239,24 +256,51 @@ impl Default for ThaiMarketConfig {
 }
 
 impl Blockchain {
-    /// Create a new blockchain instance
+    /// Create a new blockchain instance with the default carbon credit rates
     pub async fn new(storage: Arc<StorageManager>) -> Result<Self> {
+        Self::with_carbon_credits(storage, CarbonCreditConfig::default()).await
+    }
+
+    /// Create a blockchain instance issuing carbon credits at the node's configured rates
+    pub async fn with_carbon_credits(
+        storage: Arc<StorageManager>,
+        carbon_credits: CarbonCreditConfig,
+    ) -> Result<Self> {
         let config = BlockchainConfig::default();
 
         // Load existing blockchain state or initialize
         let stats = storage.load_blockchain_stats().await.unwrap_or_default();
         let accounts = storage.load_accounts().await.unwrap_or_default();
+        let carbon_state = storage.load_carbon_state().await.unwrap_or_default();
+        let account_nonces = storage.load_account_nonces().await.unwrap_or_default();
+        let attestations = storage
+            .load_attestation_commitments()
+            .await
+            .unwrap_or_default()
+            .into_iter()
+            .map(|commitment| ((commitment.producer.clone(), commitment.interval), commitment))
+            .collect();
+        let mut account_registry = AccountRegistry::from_accounts(accounts.values());
+        for (address, region) in storage.load_account_regions().await.unwrap_or_default() {
+            account_registry.set_region(&address, &region);
+        }
 
         Ok(Self {
             storage,
             block_cache: RwLock::new(VecDeque::with_capacity(config.max_cache_blocks)),
             accounts: RwLock::new(accounts),
+            account_registry: RwLock::new(account_registry),
             pending_transactions: RwLock::new(Vec::new()),
             stats: RwLock::new(stats),
             config,
             utxo_set: RwLock::new(HashMap::new()),
             energy_orders: RwLock::new(EnergyOrderBook::default()),
             governance_proposals: RwLock::new(HashMap::new()),
+            carbon_ledger: RwLock::new(CarbonLedger::restore(carbon_credits, carbon_state)),
+            attestations: RwLock::new(attestations),
+            account_nonces: RwLock::new(account_nonces),
+            supply_forecasts: RwLock::new(ForecastCache::default()),
+            import_lock: Mutex::new(()),
         })
     }
 
@@ -287,6 +331,8 @@ impl Blockchain {
         stats.height = 1;
         stats.total_transactions = genesis_block.transactions.len() as u64;
         stats.last_block_time = genesis_block.header.timestamp;
+        self.update_account_counters(&mut stats).await;
+        self.persist_block_state(&genesis_block, &stats).await?;
 
         tracing::info!("Genesis block added successfully");
         Ok(())
@@ -294,6 +340,10 @@ impl Blockchain {
 
     /// Add a new block to the blockchain
     pub async fn add_block(&self, block: Block) -> Result<()> {
+        // Local mining and network imports both land here under a shared read
+        // lock; only one block may be validated against the tip and applied at a time
+        let _import = self.import_lock.lock().await;
+
         // Get the latest block for validation
         let latest_block = self.get_latest_block().await?;
 
@@ -324,11 +374,82 @@ impl Blockchain {
         stats.total_transactions += block.transactions.len() as u64;
         stats.total_energy_traded += block.energy_stats.total_energy_traded;
         stats.last_block_time = block.header.timestamp;
+        self.update_account_counters(&mut stats).await;
+        self.persist_block_state(&block, &stats).await?;
 
         tracing::info!("Block {} added successfully", block.header.height);
         Ok(())
     }
 
+    /// Persist the accounts a block touched, their indexed regions, carbon ledger changes
+    /// and the chain stats
+    async fn persist_block_state(&self, block: &Block, stats: &BlockchainStats) -> Result<()> {
+        let mut touched = HashSet::new();
+        for tx in &block.transactions {
+            touched.insert(tx.from.as_str());
+            touched.extend(tx.to.as_deref());
+            if let TransactionType::AuthorityRegistration { authority_name, .. } =
+                &tx.transaction_type
+            {
+                touched.insert(authority_name.as_str());
+            }
+        }
+
+        let (changed, regions, nonces, commitments) = {
+            let accounts = self.accounts.read().await;
+            let registry = self.account_registry.read().await;
+            let account_nonces = self.account_nonces.read().await;
+            let attestations = self.attestations.read().await;
+            let changed: Vec<Account> = touched
+                .iter()
+                .filter_map(|address| accounts.get(*address).cloned())
+                .collect();
+            let regions: Vec<(String, String)> = touched
+                .iter()
+                .filter_map(|address| {
+                    registry
+                        .region_of(address)
+                        .map(|region| (address.to_string(), region.to_string()))
+                })
+                .collect();
+            let nonces: Vec<(String, u64)> = touched
+                .iter()
+                .filter_map(|address| {
+                    account_nonces
+                        .get(*address)
+                        .map(|nonce| (address.to_string(), *nonce))
+                })
+                .collect();
+            let commitments: Vec<AttestationCommitment> = block
+                .transactions
+                .iter()
+                .filter_map(|tx| match &tx.transaction_type {
+                    TransactionType::Attestation(commitment) => attestations
+                        .get(&(commitment.producer.clone(), commitment.interval))
+                        .cloned(),
+                    _ => None,
+                })
+                .collect();
+            (changed, regions, nonces, commitments)
+        };
+
+        let carbon_changes = self.carbon_ledger.write().await.take_changes();
+
+        self.storage.store_account_state(&changed, &regions, &nonces).await?;
+        self.storage.store_carbon_state(&carbon_changes).await?;
+        if !commitments.is_empty() {
+            self.storage.store_attestation_commitments(&commitments).await?;
+        }
+        self.storage.store_blockchain_stats(stats).await
+    }
+
+    /// Refresh producer/consumer counters from the account registry
+    async fn update_account_counters(&self, stats: &mut BlockchainStats) {
+        let registry = self.account_registry.read().await;
+        stats.active_producers = registry.active_producers();
+        stats.active_consumers = registry.active_consumers();
+    }
+
     /// Get the latest block in the chain
     pub async fn get_latest_block(&self) -> Result<Block> {
         let cache = self.block_cache.read().await;
@@ -422,6 +543,26 @@ impl Blockchain {
         Ok(())
     }
 
+    /// Next unused nonce for a sender, counting applied and pending transactions
+    pub async fn next_nonce(&self, address: &str) -> u64 {
+        let applied = self
+            .account_nonces
+            .read()
+            .await
+            .get(address)
+            .map_or(0, |nonce| nonce + 1);
+        let pending = self
+            .pending_transactions
+            .read()
+            .await
+            .iter()
+            .filter(|tx| tx.from == address)
+            .map(|tx| tx.nonce + 1)
+            .max()
+            .unwrap_or(0);
+        applied.max(pending)
+    }
+
     /// Get pending transactions for block creation
     pub async fn get_pending_transactions(&self, limit: usize) -> Vec<Transaction> {
         let pending = self.pending_transactions.read().await;
@@ -430,8 +571,9 @@ impl Blockchain {
 
     /// Remove transactions from pending pool (after inclusion in block)
     pub async fn remove_pending_transactions(&self, tx_ids: &[String]) {
+        let confirmed: HashSet<&str> = tx_ids.iter().map(String::as_str).collect();
         let mut pending = self.pending_transactions.write().await;
-        pending.retain(|tx| !tx_ids.contains(&tx.id));
+        pending.retain(|tx| !confirmed.contains(tx.id.as_str()));
     }
 
     /// Get account information
@@ -497,6 +639,11 @@ impl Blockchain {
             }
         }
 
+        let mut registry = self.account_registry.write().await;
+        for account in accounts.values() {
+            registry.upsert(account);
+        }
+
         Ok(())
     }
 
@@ -505,8 +652,16 @@ impl Blockchain {
         let mut accounts = self.accounts.write().await;
         let mut utxo_set = self.utxo_set.write().await;
         let mut energy_orders = self.energy_orders.write().await;
+        let mut carbon_ledger = self.carbon_ledger.write().await;
+        let mut attestations = self.attestations.write().await;
+        let mut supply_forecasts = self.supply_forecasts.write().await;
+        let mut registry = self.account_registry.write().await;
+        let mut account_nonces = self.account_nonces.write().await;
 
         for tx in &block.transactions {
+            let nonce = account_nonces.entry(tx.from.clone()).or_insert(tx.nonce);
+            *nonce = (*nonce).max(tx.nonce);
+
             match &tx.transaction_type {
                 super::TransactionType::TokenTransfer { amount, .. } => {
                     // Update sender balance
@@ -534,17 +689,45 @@ impl Blockchain {
                     }
                 }
                 TransactionType::EnergyTrade(energy_tx) => {
+                    supply_forecasts.observe_trade(&tx.from, energy_tx, block.header.timestamp);
                     self.process_energy_transaction(
                         tx,
                         energy_tx,
+                        block.header.height,
                         &mut accounts,
                         &mut energy_orders,
+                        &mut carbon_ledger,
                     )
                     .await?;
                 }
                 TransactionType::Governance(gov_tx) => {
                     self.process_governance_transaction(tx, gov_tx).await?;
                 }
+                TransactionType::CarbonCredit(carbon_tx) => {
+                    Self::process_carbon_transaction(
+                        tx,
+                        carbon_tx,
+                        &mut accounts,
+                        &mut carbon_ledger,
+                    );
+                }
+                TransactionType::Attestation(commitment) => {
+                    // One root per producer-interval; the first commitment wins
+                    let key = (commitment.producer.clone(), commitment.interval);
+                    if attestations.contains_key(&key) {
+                        tracing::warn!(
+                            "Duplicate attestation {} for {} interval {} skipped",
+                            tx.id,
+                            commitment.producer,
+                            commitment.interval
+                        );
+                    } else {
+                        attestations.insert(key, commitment.clone());
+                    }
+                    if let Some(producer) = accounts.get_mut(&tx.from) {
+                        producer.last_activity = tx.timestamp;
+                    }
+                }
                 _ => {}
             }
 
@@ -575,23 +758,95 @@ impl Blockchain {
                 };
                 utxo_set.insert(format!("{}:0", tx.id), utxo);
             }
+
+            // Keep secondary indexes in step with the accounts this transaction touched
+            for address in std::iter::once(&tx.from).chain(tx.to.as_ref()) {
+                if let Some(account) = accounts.get(address) {
+                    registry.upsert(account);
+                }
+            }
+            if let TransactionType::EnergyTrade(energy_tx) = &tx.transaction_type {
+                registry.set_region(&tx.from, &energy_tx.grid_location.province_code);
+            }
+        }
+
+        // Retirements are batch-processed once all transfers in the block are applied
+        for record in carbon_ledger.apply_retirements(block.header.height) {
+            Self::sync_carbon_balance(&mut accounts, &carbon_ledger, &record.owner);
         }
 
         Ok(())
     }
 
+    /// Process carbon credit transfer or retirement
+    fn process_carbon_transaction(
+        tx: &Transaction,
+        carbon_tx: &super::transaction::CarbonCreditTransaction,
+        accounts: &mut HashMap<String, Account>,
+        carbon_ledger: &mut CarbonLedger,
+    ) {
+        match carbon_tx {
+            super::transaction::CarbonCreditTransaction::Transfer { lot_id, amount } => {
+                let Some(to) = &tx.to else {
+                    return;
+                };
+                match carbon_ledger.transfer(&tx.from, to, lot_id, *amount) {
+                    Ok(_) => {
+                        Self::sync_carbon_balance(accounts, carbon_ledger, &tx.from);
+                        Self::sync_carbon_balance(accounts, carbon_ledger, to);
+                    }
+                    Err(e) => {
+                        tracing::warn!("Carbon credit transfer {} skipped: {}", tx.id, e);
+                    }
+                }
+            }
+            super::transaction::CarbonCreditTransaction::Retire {
+                lot_id,
+                amount,
+                beneficiary,
+            } => {
+                carbon_ledger.queue_retirement(RetirementRequest {
+                    tx_id: tx.id.clone(),
+                    owner: tx.from.clone(),
+                    lot_id: lot_id.clone(),
+                    amount: *amount,
+                    beneficiary: beneficiary.clone(),
+                });
+            }
+        }
+    }
+
+    /// Mirror the ledger balance into the account's carbon credit field
+    fn sync_carbon_balance(
+        accounts: &mut HashMap<String, Account>,
+        carbon_ledger: &CarbonLedger,
+        address: &str,
+    ) {
+        if let Some(account) = accounts.get_mut(address) {
+            account.carbon_credits = carbon_ledger.balance_of(address);
+        }
+    }
+
     /// Process energy trading transaction
     async fn process_energy_transaction(
         &self,
         tx: &Transaction,
         energy_tx: &super::transaction::EnergyTransaction,
+        block_height: u64,
         accounts: &mut HashMap<String, Account>,
         energy_orders: &mut EnergyOrderBook,
+        carbon_ledger: &mut CarbonLedger,
     ) -> Result<()> {
+        // Issue certificates once per delivered generation: on the seller's trade only,
+        // not for buy orders or the Match that settles an earlier Sell
+        if energy_tx.order_type == super::transaction::EnergyOrderType::Sell && tx.to.is_some() {
+            carbon_ledger.issue_for_generation(&tx.from, energy_tx, block_height, tx.timestamp);
+        }
+
         // Update energy trading balances
         if let Some(sender) = accounts.get_mut(&tx.from) {
             sender.token_balance -= energy_tx.total_value + tx.fee;
-            sender.carbon_credits += energy_tx.carbon_credits;
+            sender.carbon_credits = carbon_ledger.balance_of(&tx.from);
             sender.last_activity = tx.timestamp;
         }
 
@@ -690,6 +945,79 @@ impl Blockchain {
         Ok(())
     }
 
+    /// Find accounts by type, compliance status and region using the registry indexes
+    pub async fn query_accounts(&self, query: &AccountQuery) -> Vec<Account> {
+        let addresses = self.account_registry.read().await.query(query);
+        let accounts = self.accounts.read().await;
+        addresses
+            .iter()
+            .filter_map(|address| accounts.get(address).cloned())
+            .collect()
+    }
+
+    /// Count accounts matching a query without materialising them
+    pub async fn count_accounts(&self, query: &AccountQuery) -> u64 {
+        self.account_registry.read().await.count(query)
+    }
+
+    /// Get active carbon credit balance backed by certificate lots
+    pub async fn get_carbon_balance(&self, address: &str) -> f64 {
+        self.carbon_ledger.read().await.balance_of(address)
+    }
+
+    /// Get certificate lots currently held by an address
+    pub async fn get_certificate_lots(&self, address: &str) -> Vec<CertificateLot> {
+        let carbon_ledger = self.carbon_ledger.read().await;
+        carbon_ledger
+            .lots_by_owner(address)
+            .into_iter()
+            .cloned()
+            .collect()
+    }
+
+    /// Get carbon ledger statistics
+    pub async fn get_carbon_stats(&self) -> CarbonLedgerStats {
+        self.carbon_ledger.read().await.stats()
+    }
+
+    /// Get the committed attestation for a producer-interval
+    pub async fn get_attestation(
+        &self,
+        producer: &str,
+        interval: u64,
+    ) -> Option<AttestationCommitment> {
+        self.attestations
+            .read()
+            .await
+            .get(&(producer.to_string(), interval))
+            .cloned()
+    }
+
+    /// Verify an off-chain reading proof against the root committed on chain
+    pub async fn verify_attestation_proof(&self, stored: &StoredAttestationProof) -> Result<bool> {
+        let attestations = self.attestations.read().await;
+        let commitment = attestations
+            .get(&(stored.producer.clone(), stored.interval))
+            .ok_or_else(|| anyhow!("No attestation committed for this producer interval"))?;
+
+        if commitment.merkle_root != stored.merkle_root
+            || stored.proof.leaf_count != commitment.reading_count
+        {
+            return Ok(false);
+        }
+        stored.verify()
+    }
+
+    /// Forecast a producer's supply for the 15-minute slot containing `at` (kWh)
+    pub async fn get_supply_forecast(&self, producer: &str, at: DateTime<Utc>) -> f64 {
+        self.supply_forecasts.read().await.forecast(producer, at)
+    }
+
+    /// Forecast total producer supply for the 15-minute slot containing `at` (kWh)
+    pub async fn get_total_supply_forecast(&self, at: DateTime<Utc>) -> f64 {
+        self.supply_forecasts.read().await.total_forecast(at)
+    }
+
     /// Get blockchain statistics
     pub async fn get_stats(&self) -> BlockchainStats {
         self.stats.read().await.clone()
@@ -789,6 +1117,275 @@ mod tests {
         assert_eq!(balance, 1_000_000);
     }
 
+    #[tokio::test]
+    async fn test_concurrent_blocks_at_one_height_apply_once() {
+        let storage = Arc::new(StorageManager::new_memory());
+        let mut blockchain = Blockchain::new(storage).await.unwrap();
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("alice".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        blockchain.add_genesis_block(genesis.clone()).await.unwrap();
+        let blockchain = Arc::new(blockchain);
+
+        // Stall block application so both imports are in flight at once
+        let accounts = blockchain.accounts.write().await;
+        let imports: Vec<_> = ["bob", "carol"]
+            .iter()
+            .map(|to| {
+                let transfer = Transaction::new(
+                    TransactionType::TokenTransfer {
+                        amount: 100,
+                        message: None,
+                    },
+                    "alice".to_string(),
+                    Some(to.to_string()),
+                    1,
+                    1,
+                )
+                .unwrap();
+                let block =
+                    Block::new(genesis.header.hash.clone(), vec![transfer], 1, Default::default())
+                        .unwrap();
+                let blockchain = blockchain.clone();
+                tokio::spawn(async move { blockchain.add_block(block).await })
+            })
+            .collect();
+        tokio::time::sleep(std::time::Duration::from_millis(20)).await;
+        drop(accounts);
+
+        let mut added = 0;
+        for import in imports {
+            added += import.await.unwrap().is_ok() as usize;
+        }
+        assert_eq!(added, 1);
+        assert_eq!(blockchain.get_height().await.unwrap(), 2);
+        assert_eq!(blockchain.get_balance("alice").await, 899);
+    }
+
+    #[tokio::test]
+    async fn test_carbon_credit_issuance_and_retirement() {
+        use crate::blockchain::transaction::{
+            DeliveryWindow, EnergyOrderType, EnergySource, EnergyTransaction, GridLocation,
+        };
+
+        // Issued at the node's rates, not the defaults
+        let mut rates = CarbonCreditConfig::default();
+        rates.credit_rates.insert("solar".to_string(), 0.8);
+        let storage = Arc::new(StorageManager::new_memory());
+        let mut blockchain = Blockchain::with_carbon_credits(storage, rates.clone()).await.unwrap();
+
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("system".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        blockchain.add_genesis_block(genesis.clone()).await.unwrap();
+
+        let energy_tx = EnergyTransaction::new_sell_order(
+            100.0,
+            4000,
+            EnergySource::Solar,
+            DeliveryWindow {
+                start_time: Utc::now(),
+                end_time: Utc::now() + chrono::Duration::hours(1),
+                flexibility_minutes: 15,
+            },
+            GridLocation {
+                province_code: "BKK".to_string(),
+                distribution_area: "MEA-01".to_string(),
+                substation_id: "SUB-001".to_string(),
+                voltage_level: 22.0,
+                coordinates: None,
+            },
+            &rates,
+        );
+        assert_eq!(energy_tx.carbon_credits, 80.0);
+        let mut settlement = energy_tx.clone();
+        settlement.order_type = EnergyOrderType::Match {
+            buy_order_id: "buy-1".to_string(),
+            sell_order_id: "sell-1".to_string(),
+        };
+        let trade = Transaction::new_energy_trade(
+            "producer".to_string(),
+            "consumer".to_string(),
+            energy_tx,
+            0,
+            1,
+        )
+        .unwrap();
+        let block1 = Block::new(genesis.header.hash.clone(), vec![trade], 1, Default::default())
+            .unwrap();
+        blockchain.add_block(block1.clone()).await.unwrap();
+
+        assert_eq!(blockchain.get_carbon_balance("producer").await, 80.0);
+        let lots = blockchain.get_certificate_lots("producer").await;
+        assert_eq!(lots.len(), 1);
+
+        let retire = Transaction::new_carbon_retirement(
+            "producer".to_string(),
+            lots[0].id.clone(),
+            30.0,
+            Some("factory".to_string()),
+            0,
+            2,
+        )
+        .unwrap();
+        // Settling the sale must not issue the same generation again
+        let matched = Transaction::new_energy_trade(
+            "producer".to_string(),
+            "consumer".to_string(),
+            settlement,
+            0,
+            3,
+        )
+        .unwrap();
+        let block2 = Block::new(
+            block1.header.hash.clone(),
+            vec![matched, retire],
+            2,
+            Default::default(),
+        )
+        .unwrap();
+        blockchain.add_block(block2).await.unwrap();
+
+        assert_eq!(blockchain.get_carbon_balance("producer").await, 50.0);
+        assert_eq!(blockchain.get_carbon_stats().await.total_retired, 30.0);
+    }
+
+    #[tokio::test]
+    async fn test_account_state_survives_restart() {
+        use crate::blockchain::transaction::{
+            DeliveryWindow, EnergySource, EnergyTransaction, GridLocation,
+        };
+
+        let storage = Arc::new(StorageManager::new_memory());
+        let mut blockchain = Blockchain::new(storage.clone()).await.unwrap();
+
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint(
+                "producer".to_string(),
+                1_000_000,
+                "Mint".to_string(),
+            )
+            .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        blockchain.add_genesis_block(genesis.clone()).await.unwrap();
+
+        let energy_tx = EnergyTransaction::new_sell_order(
+            100.0,
+            4000,
+            EnergySource::Solar,
+            DeliveryWindow {
+                start_time: Utc::now(),
+                end_time: Utc::now() + chrono::Duration::hours(1),
+                flexibility_minutes: 15,
+            },
+            GridLocation {
+                province_code: "BKK".to_string(),
+                distribution_area: "MEA-01".to_string(),
+                substation_id: "SUB-001".to_string(),
+                voltage_level: 22.0,
+                coordinates: None,
+            },
+            &CarbonCreditConfig::default(),
+        );
+        let trade = Transaction::new_energy_trade(
+            "producer".to_string(),
+            "consumer".to_string(),
+            energy_tx,
+            0,
+            1,
+        )
+        .unwrap();
+        let block1 = Block::new(genesis.header.hash.clone(), vec![trade], 1, Default::default())
+            .unwrap();
+        blockchain.add_block(block1).await.unwrap();
+
+        let in_bkk = AccountQuery::default().in_region("BKK");
+        assert_eq!(blockchain.count_accounts(&in_bkk).await, 1);
+
+        drop(blockchain);
+
+        let restarted = Blockchain::new(storage).await.unwrap();
+        assert_eq!(restarted.get_height().await.unwrap(), 2);
+        assert_eq!(restarted.get_carbon_balance("producer").await, 50.0);
+        assert_eq!(restarted.get_certificate_lots("producer").await.len(), 1);
+        assert_eq!(restarted.count_accounts(&in_bkk).await, 1);
+        let found = restarted.query_accounts(&in_bkk).await;
+        assert_eq!(found.len(), 1);
+        assert_eq!(found[0].address, "producer");
+    }
+
+    #[tokio::test]
+    async fn test_generation_attestation_commitment() {
+        use crate::blockchain::attestation::{interval_start, AttestationBatcher, GenerationReading};
+        use crate::blockchain::transaction::EnergySource;
+
+        let storage = Arc::new(StorageManager::new_memory());
+        let mut blockchain = Blockchain::new(storage.clone()).await.unwrap();
+
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("system".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        blockchain.add_genesis_block(genesis.clone()).await.unwrap();
+
+        let mut batcher = AttestationBatcher::new();
+        for i in 0..5 {
+            batcher
+                .add_reading(
+                    "producer",
+                    GenerationReading {
+                        reading_id: format!("reading-{}", i),
+                        meter_id: "meter-1".to_string(),
+                        timestamp: interval_start(1_948_889).unwrap()
+                            + chrono::Duration::minutes(i),
+                        energy_kwh: 2.0,
+                        energy_source: EnergySource::Solar,
+                        rec_certificate: Some("REC-TH-001".to_string()),
+                    },
+                )
+                .unwrap();
+        }
+        let batch = batcher.seal("producer", 1_948_889).unwrap().unwrap();
+        storage.store_attestation_proofs(&batch.proofs()).await.unwrap();
+
+        let commit =
+            Transaction::new_attestation_commitment(batch.commitment.clone(), 0, 1).unwrap();
+        assert!(commit.validate().is_ok());
+        let block1 = Block::new(genesis.header.hash.clone(), vec![commit], 1, Default::default())
+            .unwrap();
+        blockchain.add_block(block1).await.unwrap();
+
+        let committed = blockchain.get_attestation("producer", 1_948_889).await.unwrap();
+        assert_eq!(committed.reading_count, 5);
+
+        let mut stored = storage
+            .get_attestation_proof("producer", 1_948_889, "reading-3")
+            .await
+            .unwrap()
+            .unwrap();
+        assert!(blockchain.verify_attestation_proof(&stored).await.unwrap());
+        let original = stored.clone();
+
+        stored.reading.energy_kwh = 4.0;
+        assert!(!blockchain.verify_attestation_proof(&stored).await.unwrap());
+
+        // Committed roots and sender nonces survive a restart
+        drop(blockchain);
+        let restarted = Blockchain::new(storage).await.unwrap();
+        assert!(restarted.verify_attestation_proof(&original).await.unwrap());
+        assert_eq!(restarted.next_nonce("producer").await, 2);
+    }
+
     #[tokio::test]
     async fn test_pending_transactions() {
         let storage = Arc::new(StorageManager::new_memory());
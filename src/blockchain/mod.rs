@@ -9,13 +9,26 @@ use serde::{Deserialize, Serialize};
 use sha2::{Digest, Sha256};
 use uuid::Uuid;
 
+pub mod attestation;
 pub mod block;
+pub mod carbon;
 pub mod chain;
+pub mod genesis;
+pub mod registry;
 pub mod transaction;
 
+pub use attestation::{
+    AttestationBatcher, AttestationCommitment, AttestationService, GenerationReading,
+};
 pub use block::{Block, ValidatorInfo};
+pub use carbon::{CarbonLedger, CertificateLot};
 pub use chain::Blockchain;
-pub use transaction::{EnergyTransaction, GovernanceTransaction, Transaction, TransactionType};
+pub use genesis::{build_genesis, verify_genesis};
+pub use registry::{AccountQuery, AccountRegistry};
+pub use transaction::{
+    CarbonCreditTransaction, EnergyTransaction, GovernanceTransaction, Transaction,
+    TransactionType,
+};
 
 /// Blockchain configuration parameters
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -111,7 +124,7 @@ pub struct Account {
     pub compliance_status: ComplianceStatus,
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+#[derive(Debug, Clone, Copy, Serialize, Deserialize, PartialEq, Eq, Hash)]
 pub enum AccountType {
     /// Energy producer (solar, wind, etc.)
     Producer,
@@ -125,7 +138,7 @@ pub enum AccountType {
     Prosumer,
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+#[derive(Debug, Clone, Copy, Serialize, Deserialize, PartialEq, Eq, Hash)]
 pub enum ComplianceStatus {
     /// Fully compliant with Thai energy regulations
     Compliant,
@@ -220,16 +233,13 @@ pub mod utils {
         tokens as f64 / 1_000_000.0 // Convert from micro-tokens
     }
 
-    /// Calculate carbon credits for renewable energy
-    pub fn calculate_carbon_credits(energy_kwh: f64, source_type: &str) -> f64 {
-        match source_type.to_lowercase().as_str() {
-            "solar" => energy_kwh * 0.5,      // 0.5 credits per kWh
-            "wind" => energy_kwh * 0.6,       // 0.6 credits per kWh
-            "hydro" => energy_kwh * 0.4,      // 0.4 credits per kWh
-            "biomass" => energy_kwh * 0.3,    // 0.3 credits per kWh
-            "geothermal" => energy_kwh * 0.7, // 0.7 credits per kWh
-            _ => 0.0,                         // No credits for non-renewable
-        }
+    /// Calculate carbon credits for renewable energy at the given rates
+    pub fn calculate_carbon_credits(
+        energy_kwh: f64,
+        source_type: &str,
+        rates: &crate::config::CarbonCreditConfig,
+    ) -> f64 {
+        energy_kwh * rates.credit_rate(source_type)
     }
 
     /// Validate energy trading compliance with Thai regulations
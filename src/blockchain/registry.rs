@@ -0,0 +1,305 @@
+//! GridTokenX Account Registry Module
+//!
+//! This module maintains secondary indexes over accounts so that filtered
+//! queries ("compliant producers in province X") and the producer/consumer
+//! counters in `BlockchainStats` never scan the account map. Each address is
+//! assigned a dense `u32` id, and each account type, compliance status and
+//! region keeps a roaring bitmap of the ids in it; queries are bitmap
+//! intersections.
+
+use roaring::RoaringBitmap;
+use std::collections::HashMap;
+
+use super::{Account, AccountType, ComplianceStatus};
+
+/// Indexed attributes of one account, kept to remove stale index entries
+#[derive(Debug, Clone)]
+struct IndexedAccount {
+    account_type: AccountType,
+    compliance_status: ComplianceStatus,
+    region: Option<String>,
+}
+
+/// Filter for account queries; `None` fields match everything
+#[derive(Debug, Clone, Default)]
+pub struct AccountQuery {
+    pub account_types: Vec<AccountType>,
+    pub compliance_status: Option<ComplianceStatus>,
+    pub region: Option<String>,
+}
+
+impl AccountQuery {
+    /// Accounts of any of the given types
+    pub fn of_types(account_types: &[AccountType]) -> Self {
+        Self {
+            account_types: account_types.to_vec(),
+            ..Default::default()
+        }
+    }
+
+    /// Restrict to a compliance status
+    pub fn with_status(mut self, status: ComplianceStatus) -> Self {
+        self.compliance_status = Some(status);
+        self
+    }
+
+    /// Restrict to a region (province code)
+    pub fn in_region(mut self, region: &str) -> Self {
+        self.region = Some(region.to_string());
+        self
+    }
+}
+
+/// Account secondary indexes over dense ids
+#[derive(Debug, Default)]
+pub struct AccountRegistry {
+    ids: HashMap<String, u32>,
+    addresses: Vec<String>,
+    indexed: Vec<Option<IndexedAccount>>,
+    all: RoaringBitmap,
+    by_type: HashMap<AccountType, RoaringBitmap>,
+    by_status: HashMap<ComplianceStatus, RoaringBitmap>,
+    by_region: HashMap<String, RoaringBitmap>,
+}
+
+impl AccountRegistry {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Build the registry from an existing account map
+    pub fn from_accounts<'a>(accounts: impl IntoIterator<Item = &'a Account>) -> Self {
+        let mut registry = Self::new();
+        for account in accounts {
+            registry.upsert(account);
+        }
+        registry
+    }
+
+    /// Insert or refresh an account's type and compliance status
+    pub fn upsert(&mut self, account: &Account) {
+        let id = self.id_for(&account.address);
+        let slot = &mut self.indexed[id as usize];
+
+        let region = match slot.take() {
+            Some(previous) => {
+                if previous.account_type == account.account_type
+                    && previous.compliance_status == account.compliance_status
+                {
+                    *slot = Some(previous);
+                    return;
+                }
+                Self::bitmap_remove(&mut self.by_type, &previous.account_type, id);
+                Self::bitmap_remove(&mut self.by_status, &previous.compliance_status, id);
+                previous.region
+            }
+            None => None,
+        };
+
+        self.by_type.entry(account.account_type).or_default().insert(id);
+        self.by_status
+            .entry(account.compliance_status)
+            .or_default()
+            .insert(id);
+        self.all.insert(id);
+        self.indexed[id as usize] = Some(IndexedAccount {
+            account_type: account.account_type,
+            compliance_status: account.compliance_status,
+            region,
+        });
+    }
+
+    /// Record the region (province code) an indexed account operates in
+    pub fn set_region(&mut self, address: &str, region: &str) {
+        let Some(&id) = self.ids.get(address) else {
+            return;
+        };
+        let Some(entry) = self.indexed[id as usize].as_mut() else {
+            return;
+        };
+        if entry.region.as_deref() == Some(region) {
+            return;
+        }
+
+        if let Some(previous) = entry.region.replace(region.to_string()) {
+            Self::bitmap_remove(&mut self.by_region, &previous, id);
+        }
+        self.by_region.entry(region.to_string()).or_default().insert(id);
+    }
+
+    /// Region recorded for an account
+    pub fn region_of(&self, address: &str) -> Option<&str> {
+        let id = *self.ids.get(address)?;
+        self.indexed[id as usize].as_ref()?.region.as_deref()
+    }
+
+    /// Matching ids as a bitmap
+    fn matching(&self, query: &AccountQuery) -> RoaringBitmap {
+        let mut result = if query.account_types.is_empty() {
+            self.all.clone()
+        } else {
+            let mut union = RoaringBitmap::new();
+            for account_type in &query.account_types {
+                if let Some(bitmap) = self.by_type.get(account_type) {
+                    union |= bitmap;
+                }
+            }
+            union
+        };
+
+        if let Some(status) = &query.compliance_status {
+            match self.by_status.get(status) {
+                Some(bitmap) => result &= bitmap,
+                None => return RoaringBitmap::new(),
+            }
+        }
+        if let Some(region) = &query.region {
+            match self.by_region.get(region) {
+                Some(bitmap) => result &= bitmap,
+                None => return RoaringBitmap::new(),
+            }
+        }
+        result
+    }
+
+    /// Addresses matching a query
+    pub fn query(&self, query: &AccountQuery) -> Vec<String> {
+        self.matching(query)
+            .iter()
+            .map(|id| self.addresses[id as usize].clone())
+            .collect()
+    }
+
+    /// Number of accounts matching a query
+    pub fn count(&self, query: &AccountQuery) -> u64 {
+        self.matching(query).len()
+    }
+
+    /// Accounts of the given types that are not suspended
+    fn active_count(&self, account_types: &[AccountType]) -> u64 {
+        let mut union = RoaringBitmap::new();
+        for account_type in account_types {
+            if let Some(bitmap) = self.by_type.get(account_type) {
+                union |= bitmap;
+            }
+        }
+        match self.by_status.get(&ComplianceStatus::Suspended) {
+            Some(suspended) => union.difference_len(suspended),
+            None => union.len(),
+        }
+    }
+
+    /// Producers and prosumers that are not suspended
+    pub fn active_producers(&self) -> u64 {
+        self.active_count(&[AccountType::Producer, AccountType::Prosumer])
+    }
+
+    /// Consumers and prosumers that are not suspended
+    pub fn active_consumers(&self) -> u64 {
+        self.active_count(&[AccountType::Consumer, AccountType::Prosumer])
+    }
+
+    /// Number of indexed accounts
+    pub fn len(&self) -> usize {
+        self.all.len() as usize
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.all.is_empty()
+    }
+
+    fn id_for(&mut self, address: &str) -> u32 {
+        if let Some(&id) = self.ids.get(address) {
+            return id;
+        }
+        let id = self.addresses.len() as u32;
+        self.ids.insert(address.to_string(), id);
+        self.addresses.push(address.to_string());
+        self.indexed.push(None);
+        id
+    }
+
+    fn bitmap_remove<K>(index: &mut HashMap<K, RoaringBitmap>, key: &K, id: u32)
+    where
+        K: std::hash::Hash + Eq,
+    {
+        if let Some(bitmap) = index.get_mut(key) {
+            bitmap.remove(id);
+            if bitmap.is_empty() {
+                index.remove(key);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use chrono::Utc;
+
+    fn account(address: &str, account_type: AccountType, status: ComplianceStatus) -> Account {
+        Account {
+            address: address.to_string(),
+            token_balance: 0,
+            energy_production_capacity: 0.0,
+            energy_consumption_demand: 0.0,
+            account_type,
+            carbon_credits: 0.0,
+            reputation_score: 50.0,
+            registered_at: Utc::now(),
+            last_activity: Utc::now(),
+            compliance_status: status,
+        }
+    }
+
+    #[test]
+    fn test_query_intersects_type_status_and_region() {
+        let mut registry = AccountRegistry::new();
+        registry.upsert(&account("p1", AccountType::Producer, ComplianceStatus::Compliant));
+        registry.upsert(&account("p2", AccountType::Producer, ComplianceStatus::Pending));
+        registry.upsert(&account("p3", AccountType::Prosumer, ComplianceStatus::Compliant));
+        registry.upsert(&account("c1", AccountType::Consumer, ComplianceStatus::Compliant));
+        registry.set_region("p1", "BKK");
+        registry.set_region("p2", "BKK");
+        registry.set_region("p3", "CNX");
+        registry.set_region("c1", "BKK");
+
+        let query = AccountQuery::of_types(&[AccountType::Producer, AccountType::Prosumer])
+            .with_status(ComplianceStatus::Compliant)
+            .in_region("BKK");
+        assert_eq!(registry.query(&query), vec!["p1".to_string()]);
+        assert_eq!(registry.count(&AccountQuery::default().in_region("BKK")), 3);
+        assert_eq!(registry.count(&AccountQuery::default().in_region("HKT")), 0);
+    }
+
+    #[test]
+    fn test_upsert_moves_account_between_indexes() {
+        let mut registry = AccountRegistry::new();
+        registry.upsert(&account("a", AccountType::Consumer, ComplianceStatus::Pending));
+        registry.set_region("a", "BKK");
+        registry.upsert(&account("a", AccountType::Producer, ComplianceStatus::Compliant));
+        registry.set_region("a", "CNX");
+
+        assert_eq!(registry.len(), 1);
+        assert_eq!(registry.count(&AccountQuery::of_types(&[AccountType::Consumer])), 0);
+        assert_eq!(
+            registry.count(&AccountQuery::default().with_status(ComplianceStatus::Compliant)),
+            1
+        );
+        assert_eq!(registry.count(&AccountQuery::default().in_region("BKK")), 0);
+        assert_eq!(registry.region_of("a"), Some("CNX"));
+    }
+
+    #[test]
+    fn test_active_counters_exclude_suspended() {
+        let registry = AccountRegistry::from_accounts(&[
+            account("p", AccountType::Producer, ComplianceStatus::Compliant),
+            account("x", AccountType::Prosumer, ComplianceStatus::Pending),
+            account("s", AccountType::Producer, ComplianceStatus::Suspended),
+            account("c", AccountType::Consumer, ComplianceStatus::NonCompliant),
+        ]);
+
+        assert_eq!(registry.active_producers(), 2);
+        assert_eq!(registry.active_consumers(), 2);
+    }
+}
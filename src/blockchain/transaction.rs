@@ -9,6 +9,9 @@ use serde::{Deserialize, Serialize};
 use sha2::{Digest, Sha256};
 use std::collections::HashMap;
 
+use super::attestation::AttestationCommitment;
+use crate::config::CarbonCreditConfig;
+
 /// Main transaction structure for GridTokenX blockchain
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Transaction {
@@ -48,6 +51,10 @@ pub enum TransactionType {
     EnergyTrade(EnergyTransaction),
     /// Governance-related transaction
     Governance(GovernanceTransaction),
+    /// Carbon credit certificate transfer or retirement
+    CarbonCredit(CarbonCreditTransaction),
+    /// Merkle root committing a producer's generation readings for one interval
+    Attestation(AttestationCommitment),
     /// Genesis block mint transaction
     GenesisMint { amount: u64, description: String },
     /// Authority registration
@@ -209,6 +216,19 @@ pub enum EnergyOrderType {
     },
 }
 
+/// Carbon credit certificate operations
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub enum CarbonCreditTransaction {
+    /// Transfer credits from a certificate lot to the transaction recipient
+    Transfer { lot_id: String, amount: f64 },
+    /// Permanently retire credits (batch-processed at the end of the block)
+    Retire {
+        lot_id: String,
+        amount: f64,
+        beneficiary: Option<String>,
+    },
+}
+
 /// Governance transaction types
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum GovernanceTransaction {
@@ -388,6 +408,38 @@ impl Transaction {
         )
     }
 
+    /// Create a carbon credit retirement transaction
+    pub fn new_carbon_retirement(
+        from: String,
+        lot_id: String,
+        amount: f64,
+        beneficiary: Option<String>,
+        fee: u64,
+        nonce: u64,
+    ) -> Result<Self> {
+        Self::new(
+            TransactionType::CarbonCredit(CarbonCreditTransaction::Retire {
+                lot_id,
+                amount,
+                beneficiary,
+            }),
+            from,
+            None,
+            fee,
+            nonce,
+        )
+    }
+
+    /// Create a generation attestation commitment transaction
+    pub fn new_attestation_commitment(
+        commitment: AttestationCommitment,
+        fee: u64,
+        nonce: u64,
+    ) -> Result<Self> {
+        let from = commitment.producer.clone();
+        Self::new(TransactionType::Attestation(commitment), from, None, fee, nonce)
+    }
+
     /// Create a governance vote transaction
     pub fn new_governance_vote(
         from: String,
@@ -459,6 +511,12 @@ impl Transaction {
             TransactionType::Governance(gov_tx) => {
                 self.validate_governance_transaction(gov_tx)?;
             }
+            TransactionType::CarbonCredit(carbon_tx) => {
+                self.validate_carbon_transaction(carbon_tx)?;
+            }
+            TransactionType::Attestation(commitment) => {
+                self.validate_attestation(commitment)?;
+            }
             _ => {} // Other types validated elsewhere
         }
 
@@ -527,6 +585,47 @@ impl Transaction {
         Ok(())
     }
 
+    /// Validate carbon credit transaction specifics
+    fn validate_carbon_transaction(&self, carbon_tx: &CarbonCreditTransaction) -> Result<()> {
+        let (lot_id, amount) = match carbon_tx {
+            CarbonCreditTransaction::Transfer { lot_id, amount } => {
+                if self.to.is_none() {
+                    return Err(anyhow!("Carbon credit transfer must have a recipient"));
+                }
+                (lot_id, amount)
+            }
+            CarbonCreditTransaction::Retire { lot_id, amount, .. } => (lot_id, amount),
+        };
+
+        if lot_id.is_empty() {
+            return Err(anyhow!("Certificate lot ID cannot be empty"));
+        }
+        if !amount.is_finite() || *amount <= 0.0 {
+            return Err(anyhow!("Carbon credit amount must be positive"));
+        }
+        Ok(())
+    }
+
+    /// Validate attestation commitment specifics
+    fn validate_attestation(&self, commitment: &AttestationCommitment) -> Result<()> {
+        if commitment.producer != self.from {
+            return Err(anyhow!("Attestations can only be committed by the producer"));
+        }
+        if commitment.reading_count == 0 {
+            return Err(anyhow!("Attestation must cover at least one reading"));
+        }
+        if commitment.merkle_root.len() != 64 || hex::decode(&commitment.merkle_root).is_err() {
+            return Err(anyhow!("Attestation Merkle root must be a SHA256 hex string"));
+        }
+        if !commitment.total_energy_kwh.is_finite()
+            || commitment.total_energy_kwh < 0.0
+            || !(0.0..=commitment.total_energy_kwh).contains(&commitment.renewable_energy_kwh)
+        {
+            return Err(anyhow!("Invalid attested energy totals"));
+        }
+        Ok(())
+    }
+
     /// Sign transaction with private key
     pub fn sign(&mut self, private_key: &[u8]) -> Result<()> {
         // This would implement actual cryptographic signing
@@ -600,20 +699,16 @@ impl EnergyTransaction {
         }
     }
 
-    /// Create a new energy sell order
+    /// Create a new energy sell order, claiming carbon credits at the node's configured rates
     pub fn new_sell_order(
         energy_amount: f64,
         min_price_per_kwh: u64,
         energy_source: EnergySource,
         delivery_window: DeliveryWindow,
         grid_location: GridLocation,
+        rates: &CarbonCreditConfig,
     ) -> Self {
-        let carbon_credits = match energy_source {
-            EnergySource::Solar => energy_amount * 0.5,
-            EnergySource::Wind => energy_amount * 0.6,
-            EnergySource::Hydro => energy_amount * 0.4,
-            _ => 0.0,
-        };
+        let carbon_credits = energy_amount * rates.credit_rate(energy_source.as_str());
 
         Self {
             energy_amount,
@@ -630,6 +725,36 @@ impl EnergyTransaction {
     }
 }
 
+impl EnergySource {
+    /// Canonical lowercase name, matching the keys of `CarbonCreditConfig::credit_rates`
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            EnergySource::Solar => "solar",
+            EnergySource::Wind => "wind",
+            EnergySource::Hydro => "hydro",
+            EnergySource::Biomass => "biomass",
+            EnergySource::Geothermal => "geothermal",
+            EnergySource::NaturalGas => "natural_gas",
+            EnergySource::Coal => "coal",
+            EnergySource::Nuclear => "nuclear",
+            EnergySource::GridMix => "grid_mix",
+            EnergySource::Battery => "battery",
+        }
+    }
+
+    /// Whether the source qualifies for renewable energy certificates
+    pub fn is_renewable(&self) -> bool {
+        matches!(
+            self,
+            EnergySource::Solar
+                | EnergySource::Wind
+                | EnergySource::Hydro
+                | EnergySource::Biomass
+                | EnergySource::Geothermal
+        )
+    }
+}
+
 impl Default for EnergyQualityMetrics {
     fn default() -> Self {
         Self {
@@ -699,6 +824,7 @@ mod tests {
                     voltage_level: 22.0,
                     coordinates: Some((13.7563, 100.5018)),
                 },
+                &CarbonCreditConfig::default(),
             ),
             100,
             1,
@@ -4,11 +4,14 @@
 //! including network settings, consensus parameters, and Thai energy market specifics.
 
 use anyhow::{anyhow, Result};
+use chrono::{DateTime, Utc};
 use serde::{Deserialize, Serialize};
 use std::fs;
 use std::path::Path;
 use uuid::Uuid;
 
+use crate::consensus_poa::ThaiAuthorityType;
+
 /// Main node configuration structure
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct NodeConfig {
@@ -18,6 +21,9 @@ pub struct NodeConfig {
     pub node_type: NodeType,
     /// Network configuration
     pub network: NetworkConfig,
+    /// Genesis block contents
+    #[serde(default)]
+    pub genesis: GenesisConfig,
     /// P2P networking settings
     pub p2p: P2PConfig,
     /// API server settings
@@ -39,6 +45,9 @@ pub struct NodeConfig {
         /// Thai market specific settings
     /// Thai market specific settings
     pub thai_market: ThaiMarketConfig,
+    /// Performance tuning
+    #[serde(default)]
+    pub performance: PerformanceConfig,
 }
 
 /// Node types in the GridTokenX network
@@ -73,6 +82,38 @@ pub struct NetworkConfig {
     pub max_peers: usize,
 }
 
+/// Genesis block contents, identical on every node of a network
+///
+/// The genesis block is built from these values alone, so nodes started
+/// independently agree on its hash.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(default)]
+pub struct GenesisConfig {
+    /// Timestamp of the genesis block and its transactions
+    pub timestamp: DateTime<Utc>,
+    /// Text stored in the genesis block header
+    pub extra_data: String,
+    /// Tokens minted at genesis
+    pub allocations: Vec<GenesisAllocation>,
+    /// Energy authorities registered at genesis
+    pub authorities: Vec<GenesisAuthority>,
+}
+
+/// Tokens minted to one account at genesis
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct GenesisAllocation {
+    pub address: String,
+    pub amount: u64,
+    pub description: String,
+}
+
+/// Authority registered at genesis
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct GenesisAuthority {
+    pub name: String,
+    pub description: String,
+}
+
 /// P2P networking configuration
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct P2PConfig {
@@ -92,6 +133,21 @@ pub struct P2PConfig {
     pub enable_mdns: bool,
     /// Gossip protocol settings
     pub gossip: GossipConfig,
+    /// Peers dialed at startup (multiaddrs or `host:port`)
+    #[serde(default)]
+    pub bootstrap_peers: Vec<String>,
+    /// Block range sync settings
+    #[serde(default)]
+    pub sync: SyncConfig,
+    /// Message compression settings
+    #[serde(default)]
+    pub compression: CompressionConfig,
+    /// Light-client request serving
+    #[serde(default)]
+    pub light_client: LightClientConfig,
+    /// How new blocks are sent to peers
+    #[serde(default)]
+    pub propagation: PropagationConfig,
 }
 
 /// Gossip protocol configuration
@@ -107,6 +163,83 @@ pub struct GossipConfig {
     pub mesh_maintenance_interval: u64,
 }
 
+/// Block range sync configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SyncConfig {
+    /// Download and verify the header chain before block bodies
+    #[serde(default)]
+    pub fast_sync: bool,
+    /// Blocks per request
+    pub chunk_size: u64,
+    /// Upper bound on concurrent requests to one peer
+    pub max_requests_per_peer: usize,
+    /// Seconds before an unanswered request is sent to another peer
+    pub request_timeout_secs: u64,
+}
+
+/// Message compression configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct CompressionConfig {
+    /// Offer compressed frames to peers
+    pub enabled: bool,
+    /// Payloads smaller than this are sent uncompressed (bytes)
+    pub min_size_bytes: usize,
+    /// Zstd compression level
+    pub level: i32,
+}
+
+/// Light-client protocol configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct LightClientConfig {
+    /// Answer header, proof and account requests from light clients
+    pub enabled: bool,
+    /// Requests served per client per second
+    pub requests_per_second: u32,
+    /// Most headers returned for one request
+    pub max_headers_per_request: u64,
+    /// Recent headers kept in memory
+    pub header_cache_size: usize,
+}
+
+/// Block announcement modes
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub enum BlockPropagation {
+    /// Header and short transaction ids, rebuilt from the mempool
+    Compact,
+    /// The whole block in one message
+    Full,
+    /// Reed-Solomon chunks of the whole block, any `data_shards` of which rebuild it
+    Erasure,
+}
+
+/// Block propagation configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct PropagationConfig {
+    /// Announcement mode for blocks this node produces
+    pub mode: BlockPropagation,
+    /// Chunks needed to rebuild an erasure-coded block
+    pub data_shards: usize,
+    /// Extra chunks that may be lost or arrive late
+    pub parity_shards: usize,
+    /// Smaller blocks are announced compactly even in erasure mode (bytes)
+    pub min_block_bytes: usize,
+}
+
+/// Performance tuning configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct PerformanceConfig {
+    /// Optimization switches
+    #[serde(default)]
+    pub optimization: OptimizationConfig,
+}
+
+/// Optimization switches
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct OptimizationConfig {
+    /// Header-first block sync
+    pub enable_fast_sync: bool,
+}
+
 /// API server configuration
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct ApiConfig {
@@ -214,6 +347,9 @@ pub struct ConsensusConfig {
     pub validator: ValidatorConfig,
     /// Proof of Work settings (if applicable)
     pub pow: Option<PoWConfig>,
+    /// Proof of Authority settings
+    #[serde(default)]
+    pub poa: POAConfig,
 }
 
 /// Consensus algorithms
@@ -229,6 +365,47 @@ pub enum ConsensusAlgorithm {
     Hybrid,
 }
 
+/// Proof of Authority configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct POAConfig {
+    /// Target interval between blocks (milliseconds)
+    pub block_time_ms: u64,
+    /// Time the in-turn authority has before the next one may propose (milliseconds)
+    pub proposer_timeout_ms: u64,
+    /// Most transactions in one block
+    pub max_block_transactions: usize,
+    /// Stake recorded for every authority
+    pub authority_stake_requirement: u64,
+    /// File holding this node's hex-encoded Ed25519 authority secret key
+    pub signing_key_file: Option<String>,
+    /// Authorities in proposer order
+    pub initial_authorities: Vec<AuthorityConfig>,
+    /// Vote-based finality among the authorities
+    #[serde(default)]
+    pub finality: FinalityConfig,
+}
+
+/// PoA finality gadget configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct FinalityConfig {
+    /// Run prevote/precommit rounds and store commit certificates
+    pub enabled: bool,
+    /// Timeout of the first round at each height (milliseconds)
+    pub base_timeout_ms: u64,
+    /// Cap on the round timeout, which doubles after every failed round (milliseconds)
+    pub max_timeout_ms: u64,
+}
+
+/// Authority known at startup
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct AuthorityConfig {
+    /// Hex-encoded Ed25519 public key
+    pub public_key: String,
+    pub authority_type: ThaiAuthorityType,
+    pub license_number: String,
+    pub organization: String,
+}
+
 /// Validator configuration
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct ValidatorConfig {
@@ -349,6 +526,9 @@ pub struct GridConfig {
     pub smart_meters: SmartMeterConfig,
     /// Grid stability monitoring
     pub stability_monitoring: StabilityConfig,
+    /// Demand-response dispatch settings
+    #[serde(default)]
+    pub demand_response: DemandResponseConfig,
 }
 
 /// Grid operator configuration
@@ -434,6 +614,25 @@ pub struct StabilityThresholds {
     pub load_imbalance: f64,
 }
 
+/// Demand-response configuration
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DemandResponseConfig {
+    /// Enable demand-response dispatch
+    pub enabled: bool,
+    /// Compensation paid per delivered kWh of flexibility (tokens)
+    pub compensation_per_kwh: u64,
+    /// Account funding demand-response compensation
+    pub settlement_account: String,
+    /// Capacity of the dispatch signal broadcast channel
+    pub signal_buffer: usize,
+    /// Participants offering less flexibility than this are not indexed (kWh)
+    pub min_flexibility_kwh: f64,
+    /// How often completed events are settled (seconds)
+    pub settlement_interval_secs: u64,
+    /// How long settled events stay queryable before they are pruned (hours)
+    pub event_retention_hours: u64,
+}
+
 /// Governance configuration
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct GovernanceConfig {
@@ -513,6 +712,9 @@ pub struct ConnectionLimits {
     pub connection_rate_limit: u32,
     /// Ban duration in seconds
     pub ban_duration: u64,
+    /// Gossip frames accepted per peer per second (0 = unlimited)
+    #[serde(default)]
+    pub message_rate_limit: u32,
 }
 
 /// Access control configuration
@@ -659,6 +861,7 @@ impl Default for NodeConfig {
             node_id: Uuid::new_v4().to_string(),
             node_type: NodeType::Validator,
             network: NetworkConfig::default(),
+            genesis: GenesisConfig::default(),
             p2p: P2PConfig::default(),
             api: ApiConfig::default(),
             storage: StorageConfig::default(),
@@ -669,6 +872,7 @@ impl Default for NodeConfig {
             security: SecurityConfig::default(),
             logging: LoggingConfig::default(),
             thai_market: ThaiMarketConfig::default(),
+            performance: PerformanceConfig::default(),
         }
     }
 }
@@ -686,6 +890,41 @@ impl Default for NetworkConfig {
     }
 }
 
+impl Default for GenesisConfig {
+    fn default() -> Self {
+        let authority = |name: &str, description: &str| GenesisAuthority {
+            name: name.to_string(),
+            description: description.to_string(),
+        };
+        Self {
+            timestamp: DateTime::from_timestamp(1_754_006_400, 0).unwrap_or_default(), // 2025-08-01
+            extra_data: "GridTokenX Genesis Block - Thai Energy Market".to_string(),
+            allocations: vec![GenesisAllocation {
+                address: "system".to_string(),
+                amount: 1_000_000_000, // 1 billion tokens initial supply
+                description: "Initial token supply for Thai energy market".to_string(),
+            }],
+            authorities: vec![
+                // Electricity Generating Authority of Thailand
+                authority("EGAT", "Primary electricity generator"),
+                // Metropolitan Electricity Authority
+                authority("MEA", "Bangkok and surrounding areas distribution"),
+                // Provincial Electricity Authority
+                authority("PEA", "Provincial electricity distribution"),
+            ],
+        }
+    }
+}
+
+impl GenesisConfig {
+    /// Load a genesis configuration from a TOML file
+    pub fn load(path: &str) -> Result<Self> {
+        let config_str = fs::read_to_string(path)
+            .map_err(|e| anyhow!("Failed to read genesis config: {}", e))?;
+        toml::from_str(&config_str).map_err(|e| anyhow!("Failed to parse genesis config: {}", e))
+    }
+}
+
 impl Default for P2PConfig {
     fn default() -> Self {
         Self {
@@ -697,6 +936,11 @@ impl Default for P2PConfig {
             connection_timeout: 30,
             enable_mdns: true,
             gossip: GossipConfig::default(),
+            bootstrap_peers: vec![],
+            sync: SyncConfig::default(),
+            compression: CompressionConfig::default(),
+            light_client: LightClientConfig::default(),
+            propagation: PropagationConfig::default(),
         }
     }
 }
@@ -712,6 +956,65 @@ impl Default for GossipConfig {
     }
 }
 
+impl Default for SyncConfig {
+    fn default() -> Self {
+        Self {
+            fast_sync: false,
+            chunk_size: 8,
+            max_requests_per_peer: 8,
+            request_timeout_secs: 10,
+        }
+    }
+}
+
+impl Default for CompressionConfig {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            min_size_bytes: 1024,
+            level: 3,
+        }
+    }
+}
+
+impl Default for LightClientConfig {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            requests_per_second: 10,
+            max_headers_per_request: 512,
+            header_cache_size: 4096,
+        }
+    }
+}
+
+impl Default for PropagationConfig {
+    fn default() -> Self {
+        Self {
+            mode: BlockPropagation::Compact,
+            data_shards: 8,
+            parity_shards: 4,
+            min_block_bytes: 65536, // 64KB
+        }
+    }
+}
+
+impl Default for PerformanceConfig {
+    fn default() -> Self {
+        Self {
+            optimization: OptimizationConfig::default(),
+        }
+    }
+}
+
+impl Default for OptimizationConfig {
+    fn default() -> Self {
+        Self {
+            enable_fast_sync: false,
+        }
+    }
+}
+
 impl Default for ApiConfig {
     fn default() -> Self {
         Self {
@@ -780,6 +1083,31 @@ impl Default for ConsensusConfig {
             min_validator_stake: 100_000,
             validator: ValidatorConfig::default(),
             pow: Some(PoWConfig::default()),
+            poa: POAConfig::default(),
+        }
+    }
+}
+
+impl Default for POAConfig {
+    fn default() -> Self {
+        Self {
+            block_time_ms: 2000,
+            proposer_timeout_ms: 4000,
+            max_block_transactions: 1000,
+            authority_stake_requirement: 1_000_000,
+            signing_key_file: None,
+            initial_authorities: vec![],
+            finality: FinalityConfig::default(),
+        }
+    }
+}
+
+impl Default for FinalityConfig {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            base_timeout_ms: 500,
+            max_timeout_ms: 8000,
         }
     }
 }
@@ -866,6 +1194,7 @@ impl Default for CarbonCreditConfig {
         credit_rates.insert("wind".to_string(), 0.6);
         credit_rates.insert("hydro".to_string(), 0.4);
         credit_rates.insert("biomass".to_string(), 0.3);
+        credit_rates.insert("geothermal".to_string(), 0.7);
 
         Self {
             enabled: true,
@@ -875,6 +1204,20 @@ impl Default for CarbonCreditConfig {
     }
 }
 
+impl CarbonCreditConfig {
+    /// Get carbon credits issued per kWh for an energy source (0.0 if not eligible)
+    pub fn credit_rate(&self, energy_source: &str) -> f64 {
+        if !self.enabled {
+            return 0.0;
+        }
+
+        self.credit_rates
+            .get(&energy_source.to_lowercase())
+            .copied()
+            .unwrap_or(0.0)
+    }
+}
+
 impl Default for PriceLimitConfig {
     fn default() -> Self {
         Self {
@@ -911,6 +1254,21 @@ impl Default for GridConfig {
             scada: ScadaConfig::default(),
             smart_meters: SmartMeterConfig::default(),
             stability_monitoring: StabilityConfig::default(),
+            demand_response: DemandResponseConfig::default(),
+        }
+    }
+}
+
+impl Default for DemandResponseConfig {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            compensation_per_kwh: 5,
+            settlement_account: "demand_response_pool".to_string(),
+            signal_buffer: 1024,
+            min_flexibility_kwh: 0.5,
+            settlement_interval_secs: 60,
+            event_retention_hours: 24,
         }
     }
 }
@@ -1045,6 +1403,7 @@ impl Default for ConnectionLimits {
             max_connections_per_ip: 10,
             connection_rate_limit: 100, // per minute
             ban_duration: 3600,         // 1 hour
+            message_rate_limit: 500,    // per second
         }
     }
 }
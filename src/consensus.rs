@@ -2,10 +2,15 @@
 //!
 //! This module implements the consensus mechanism for the GridTokenX blockchain,
 //! supporting hybrid consensus with Proof of Stake and Proof of Work components.
+//!
+//! PoS proposers are drawn with probability proportional to stake from a
+//! Fenwick tree ([`StakeIndex`]), seeded by the previous block hash, so every
+//! node selects the same proposer for a given parent.
 
-use anyhow::{anyhow, Result};
+use anyhow::Result;
 use chrono::{DateTime, Utc};
 use serde::{Deserialize, Serialize};
+use sha2::{Digest, Sha256};
 use std::collections::HashMap;
 use std::sync::Arc;
 use tokio::sync::RwLock;
@@ -28,9 +33,101 @@ pub struct ConsensusEngine {
 pub struct ValidatorSet {
     validators: HashMap<String, Validator>,
     active_validators: Vec<String>,
+    /// Stake of active validators, for weighted proposer selection
+    stake_index: StakeIndex,
     current_proposer: Option<String>,
 }
 
+/// Fenwick tree over validator stake.
+///
+/// Validators keep the slot they were first added in, so nodes that add
+/// validators in the same (chain) order build identical trees. Updates and
+/// weighted sampling are O(log n); the total is kept alongside.
+#[derive(Debug, Default, Clone)]
+pub struct StakeIndex {
+    addresses: Vec<String>,
+    slots: HashMap<String, usize>,
+    stakes: Vec<u64>,
+    /// 1-based partial sums
+    tree: Vec<u64>,
+    total: u64,
+}
+
+impl StakeIndex {
+    /// Set a validator's stake, adding it in the next slot if new (0 to remove)
+    pub fn set(&mut self, address: &str, stake: u64) {
+        let Some(&slot) = self.slots.get(address) else {
+            if stake > 0 {
+                self.push(address, stake);
+            }
+            return;
+        };
+        let previous = std::mem::replace(&mut self.stakes[slot], stake);
+        self.total = self.total - previous + stake;
+        let mut i = slot + 1;
+        while i < self.tree.len() {
+            self.tree[i] = self.tree[i] - previous + stake;
+            i += i & i.wrapping_neg();
+        }
+    }
+
+    fn push(&mut self, address: &str, stake: u64) {
+        if self.tree.is_empty() {
+            self.tree.push(0);
+        }
+        let i = self.tree.len();
+        // Node i covers slots (i - lowbit(i), i]: the new stake plus the nodes below it
+        let lowbit = i & i.wrapping_neg();
+        let mut node = stake;
+        let mut child = i - 1;
+        while child > i - lowbit {
+            node += self.tree[child];
+            child -= child & child.wrapping_neg();
+        }
+        self.tree.push(node);
+        self.slots.insert(address.to_string(), self.addresses.len());
+        self.addresses.push(address.to_string());
+        self.stakes.push(stake);
+        self.total += stake;
+    }
+
+    pub fn stake(&self, address: &str) -> u64 {
+        self.slots.get(address).map_or(0, |slot| self.stakes[*slot])
+    }
+
+    pub fn total(&self) -> u64 {
+        self.total
+    }
+
+    /// Validator whose cumulative stake range contains `target` (< total)
+    pub fn find(&self, target: u64) -> Option<&str> {
+        if target >= self.total {
+            return None;
+        }
+        let mut position = 0;
+        let mut remaining = target;
+        let mut step = (self.tree.len() - 1).checked_next_power_of_two()?;
+        while step > 0 {
+            let next = position + step;
+            if next < self.tree.len() && self.tree[next] <= remaining {
+                position = next;
+                remaining -= self.tree[next];
+            }
+            step >>= 1;
+        }
+        self.addresses.get(position).map(String::as_str)
+    }
+
+    /// Stake-weighted choice determined by `seed`
+    pub fn select(&self, seed: &[u8]) -> Option<&str> {
+        let digest = Sha256::digest(seed);
+        let draw = u64::from_le_bytes(digest[..8].try_into().ok()?);
+        // Scale the 64-bit draw onto [0, total) without modulo bias
+        let target = ((draw as u128 * self.total as u128) >> 64) as u64;
+        self.find(target)
+    }
+}
+
 /// Individual validator information
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Validator {
@@ -46,11 +143,11 @@ pub struct Validator {
 /// Current consensus state
 #[derive(Debug, Default)]
 pub struct ConsensusState {
-    current_round: u64,
-    current_height: u64,
-    last_block_time: Option<DateTime<Utc>>,
-    difficulty: u64,
-    block_rewards_distributed: u64,
+    pub current_round: u64,
+    pub current_height: u64,
+    pub last_block_time: Option<DateTime<Utc>>,
+    pub difficulty: u64,
+    pub block_rewards_distributed: u64,
 }
 
 /// Consensus algorithm types
@@ -167,6 +264,9 @@ impl ConsensusEngine {
         validator_set
             .validators
             .insert(genesis_validator.address.clone(), genesis_validator);
+        validator_set
+            .stake_index
+            .set("genesis_validator", 1_000_000);
         validator_set
             .active_validators
             .push("genesis_validator".to_string());
@@ -253,39 +353,25 @@ impl ConsensusEngine {
         Ok(())
     }
 
-    /// Select validator for PoS based on stake
+    /// Select the PoS proposer for the next block, weighted by stake and
+    /// seeded by the previous block hash
     async fn select_pos_validator(&self) -> Result<Option<String>> {
-        let validator_set = self.validator_set.read().await;
-
-        if validator_set.active_validators.is_empty() {
-            return Ok(None);
-        }
-
-        // Simple random selection weighted by stake
-        let total_stake: u64 = validator_set
-            .validators
-            .values()
-            .filter(|v| v.is_active)
-            .map(|v| v.stake)
-            .sum();
-
-        if total_stake == 0 {
-            return Ok(None);
-        }
-
-        let random_stake = (rand::random::<f64>() * total_stake as f64) as u64;
-        let mut cumulative_stake = 0;
-
-        for validator in validator_set.validators.values() {
-            if validator.is_active {
-                cumulative_stake += validator.stake;
-                if cumulative_stake >= random_stake {
-                    return Ok(Some(validator.address.clone()));
-                }
-            }
-        }
+        let previous_hash = self
+            .blockchain
+            .read()
+            .await
+            .get_latest_block()
+            .await?
+            .header
+            .hash;
 
-        Ok(validator_set.active_validators.first().cloned())
+        let mut validator_set = self.validator_set.write().await;
+        let proposer = validator_set
+            .stake_index
+            .select(previous_hash.as_bytes())
+            .map(String::from);
+        validator_set.current_proposer = proposer.clone();
+        Ok(proposer)
     }
 
     /// Select authority validator for PoA
@@ -306,7 +392,9 @@ impl ConsensusEngine {
     /// Create and propose a new block
     async fn create_and_propose_block(&self, proposer: &str) -> Result<()> {
         let blockchain = self.blockchain.read().await;
-        let pending_transactions = blockchain.get_pending_transactions(self.config.max_block_size);
+        let pending_transactions = blockchain
+            .get_pending_transactions(self.config.max_block_size)
+            .await;
 
         if pending_transactions.is_empty() {
             return Ok(());
@@ -408,8 +496,9 @@ impl ConsensusEngine {
         if let Some(proposer) = self.select_pos_validator().await? {
             // Create block with these transactions
             tracing::info!(
-                "Processing {} regular transactions with PoS",
-                transactions.len()
+                "Processing {} regular transactions with PoS validator {}",
+                transactions.len(),
+                proposer
             );
         }
         Ok(())
@@ -487,11 +576,13 @@ impl ConsensusEngine {
             .validators
             .insert(validator.address.clone(), validator.clone());
 
+        tracing::info!("Added new validator: {}", validator.address);
         if validator.is_active {
+            validator_set
+                .stake_index
+                .set(&validator.address, validator.stake);
             validator_set.active_validators.push(validator.address);
         }
-
-        tracing::info!("Added new validator: {}", validator.address);
         Ok(())
     }
 
@@ -500,6 +591,7 @@ impl ConsensusEngine {
         let mut validator_set = self.validator_set.write().await;
 
         validator_set.validators.remove(address);
+        validator_set.stake_index.set(address, 0);
         validator_set
             .active_validators
             .retain(|addr| addr != address);
@@ -508,17 +600,17 @@ impl ConsensusEngine {
         Ok(())
     }
 
+    /// Proposer chosen by the last PoS selection
+    pub async fn current_proposer(&self) -> Option<String> {
+        self.validator_set.read().await.current_proposer.clone()
+    }
+
     /// Get consensus metrics
     pub async fn get_metrics(&self) -> ConsensusMetrics {
         let validator_set = self.validator_set.read().await;
         let consensus_state = self.consensus_state.read().await;
 
-        let total_stake = validator_set
-            .validators
-            .values()
-            .filter(|v| v.is_active)
-            .map(|v| v.stake)
-            .sum();
+        let total_stake = validator_set.stake_index.total();
 
         ConsensusMetrics {
             current_validators: validator_set.active_validators.len() as u64,
@@ -531,3 +623,100 @@ impl ConsensusEngine {
     }
 }
 
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_stake_index_matches_prefix_sums() {
+        let mut index = StakeIndex::default();
+        let mut stakes = Vec::new();
+        for i in 0..37u64 {
+            let stake = (i * 7919) % 101;
+            index.set(&format!("v{}", i), stake);
+            if stake > 0 {
+                stakes.push((format!("v{}", i), stake));
+            }
+        }
+        index.set("v3", 500);
+        index.set("v5", 0);
+        for (address, stake) in stakes.iter_mut() {
+            *stake = index.stake(address);
+        }
+        assert_eq!(index.total(), stakes.iter().map(|(_, stake)| stake).sum::<u64>());
+
+        // Every unit of stake maps to the validator owning it
+        let mut target = 0;
+        for (address, stake) in &stakes {
+            for offset in [0, stake.saturating_sub(1)] {
+                if *stake > 0 {
+                    assert_eq!(index.find(target + offset), Some(address.as_str()));
+                }
+            }
+            target += stake;
+        }
+        assert_eq!(index.find(index.total()), None);
+    }
+
+    #[test]
+    fn test_selection_is_seeded_and_stake_weighted() {
+        let mut index = StakeIndex::default();
+        index.set("small", 1_000);
+        index.set("large", 9_000);
+        index.set("gone", 5_000);
+        index.set("gone", 0);
+
+        let seed = b"previous-block-hash";
+        assert_eq!(index.select(seed), index.clone().select(seed));
+
+        let large = (0..2_000u32)
+            .filter(|i| index.select(&i.to_le_bytes()) == Some("large"))
+            .count();
+        assert!((1_700..1_900).contains(&large), "large chosen {} times", large);
+        assert!((0..2_000u32).all(|i| index.select(&i.to_le_bytes()) != Some("gone")));
+        assert_eq!(StakeIndex::default().select(seed), None);
+    }
+
+    #[tokio::test]
+    async fn test_pos_proposer_follows_the_previous_block() {
+        use crate::storage::StorageManager;
+
+        let mut chain = Blockchain::new(Arc::new(StorageManager::new_memory())).await.unwrap();
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("system".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        chain.add_genesis_block(genesis.clone()).await.unwrap();
+        let engine = ConsensusEngine::new(
+            Arc::new(RwLock::new(chain)),
+            ConsensusConfig::default(),
+            false,
+        )
+        .await
+        .unwrap();
+        for (address, stake) in [("alice", 300), ("bob", 700)] {
+            engine
+                .add_validator(Validator {
+                    address: address.to_string(),
+                    stake,
+                    reputation: 100.0,
+                    last_block_time: None,
+                    consecutive_misses: 0,
+                    total_blocks_proposed: 0,
+                    is_active: true,
+                })
+                .await
+                .unwrap();
+        }
+
+        let proposer = engine.select_pos_validator().await.unwrap();
+        let mut index = StakeIndex::default();
+        index.set("alice", 300);
+        index.set("bob", 700);
+        assert_eq!(proposer.as_deref(), index.select(genesis.header.hash.as_bytes()));
+        assert_eq!(engine.current_proposer().await, proposer);
+        assert_eq!(engine.get_metrics().await.total_stake, 1_000);
+    }
+}
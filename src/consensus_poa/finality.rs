@@ -0,0 +1,811 @@
+//! GridTokenX PoA Finality Gadget
+//!
+//! PoA authorities produce blocks in turn; this gadget makes them final. For
+//! each new block the authorities run Tendermint-style rounds: every authority
+//! prevotes for the block, and once a quorum (`2f + 1` of `n = 3f + 1`)
+//! prevotes for the same hash it precommits and locks on it. A quorum of
+//! precommits forms a [`CommitCertificate`], which is stored and gossiped.
+//!
+//! Heights are pipelined: votes for the next block are exchanged while the
+//! previous one is still collecting precommits. Tallies are kept in
+//! [`VoteBitset`]s indexed by the authority's position in the schedule. A
+//! round that does not finish before its deadline starts the next round with
+//! twice the timeout, up to `max_timeout_ms`.
+//!
+//! A certificate is a 256-bit signer bitmap plus the raw 64-byte precommit
+//! signatures. Ed25519 signatures cannot be aggregated, so all of them are
+//! checked in a single batch verification: one multiscalar multiplication
+//! over the whole quorum instead of one signature check per signer.
+//!
+//! A height is final here only if the certified hash is the block this node
+//! holds at that height. If a quorum certifies a different block, the node
+//! flags the conflict and stops finalizing from that height. It then asks
+//! peers for the certified block. The chain cannot reorganize, so it does not
+//! finalize that height again until an operator resyncs it.
+
+use anyhow::{anyhow, Result};
+use ed25519_dalek::{verify_batch, Signature, Signer, SigningKey, Verifier, VerifyingKey};
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashMap};
+use std::sync::Arc;
+use std::time::Duration;
+use tokio::sync::broadcast::error::RecvError;
+use tokio::sync::{broadcast, RwLock};
+use tokio::time::Instant;
+
+use crate::blockchain::Blockchain;
+use crate::config::FinalityConfig;
+use crate::p2p::{ConsensusEnvelope, P2PHandle};
+use crate::storage::StorageManager;
+
+/// Most authorities a vote bitset can hold
+pub const MAX_AUTHORITIES: usize = 256;
+/// Heights beyond the last finalized one that may collect votes at once
+const MAX_PENDING_HEIGHTS: u64 = 64;
+/// How often the driver checks round deadlines and the chain tip
+const TICK_INTERVAL: Duration = Duration::from_millis(20);
+
+/// Consensus message types on the P2P consensus topic
+pub const VOTE_MESSAGE: &str = "finality-vote";
+pub const CERTIFICATE_MESSAGE: &str = "commit-certificate";
+
+/// Votes needed out of `authorities` to tolerate `(authorities - 1) / 3` faults
+pub fn quorum(authorities: usize) -> usize {
+    authorities - authorities.saturating_sub(1) / 3
+}
+
+/// Fixed-size set of authority indices
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct VoteBitset([u64; MAX_AUTHORITIES / 64]);
+
+impl VoteBitset {
+    /// Add an authority; false if it was already present
+    pub fn insert(&mut self, index: usize) -> bool {
+        let (word, bit) = (index / 64, 1u64 << (index % 64));
+        let fresh = self.0[word] & bit == 0;
+        self.0[word] |= bit;
+        fresh
+    }
+
+    pub fn contains(&self, index: usize) -> bool {
+        index < MAX_AUTHORITIES && self.0[index / 64] & (1u64 << (index % 64)) != 0
+    }
+
+    pub fn len(&self) -> usize {
+        self.0.iter().map(|word| word.count_ones() as usize).sum()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.iter().all(|word| *word == 0)
+    }
+
+    /// Authority indices in ascending order
+    pub fn iter(&self) -> impl Iterator<Item = usize> + '_ {
+        (0..MAX_AUTHORITIES).filter(|index| self.contains(*index))
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub enum VotePhase {
+    Prevote,
+    Precommit,
+}
+
+/// Signed vote of one authority
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct FinalityVote {
+    pub height: u64,
+    pub round: u32,
+    pub block_hash: String,
+    pub phase: VotePhase,
+    /// Position of the voter in the authority schedule
+    pub authority: u16,
+    /// Ed25519 signature over [`vote_message`]
+    pub signature: Signature,
+}
+
+/// Bytes an authority signs for a vote
+pub fn vote_message(height: u64, round: u32, block_hash: &str, phase: VotePhase) -> Vec<u8> {
+    format!("gridtokenx-finality:{:?}:{}:{}:{}", phase, height, round, block_hash).into_bytes()
+}
+
+impl FinalityVote {
+    fn new(
+        height: u64,
+        round: u32,
+        block_hash: String,
+        phase: VotePhase,
+        authority: u16,
+        key: &SigningKey,
+    ) -> Self {
+        let signature = key.sign(&vote_message(height, round, &block_hash, phase));
+        Self {
+            height,
+            round,
+            block_hash,
+            phase,
+            authority,
+            signature,
+        }
+    }
+
+    fn verify(&self, keys: &[VerifyingKey]) -> Result<()> {
+        let key = keys
+            .get(self.authority as usize)
+            .ok_or_else(|| anyhow!("Vote from unknown authority {}", self.authority))?;
+        key.verify(
+            &vote_message(self.height, self.round, &self.block_hash, self.phase),
+            &self.signature,
+        )
+        .map_err(|_| anyhow!("Invalid vote signature from authority {}", self.authority))
+    }
+}
+
+/// Quorum of precommits that makes a block final
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct CommitCertificate {
+    pub height: u64,
+    pub round: u32,
+    pub block_hash: String,
+    pub signers: VoteBitset,
+    /// Precommit signatures in ascending signer order
+    pub signatures: Vec<Signature>,
+}
+
+impl CommitCertificate {
+    /// Check the quorum and all signatures, in one batch, against the authority keys
+    pub fn verify(&self, keys: &[VerifyingKey]) -> Result<()> {
+        if self.signers.len() < quorum(keys.len()) || self.signers.len() != self.signatures.len() {
+            return Err(anyhow!("Certificate for block {} lacks a quorum", self.height));
+        }
+        let signer_keys = self
+            .signers
+            .iter()
+            .map(|signer| {
+                keys.get(signer)
+                    .copied()
+                    .ok_or_else(|| anyhow!("Certificate signer {} is not an authority", signer))
+            })
+            .collect::<Result<Vec<_>>>()?;
+        let message = vote_message(self.height, self.round, &self.block_hash, VotePhase::Precommit);
+        let messages = vec![message.as_slice(); signer_keys.len()];
+        verify_batch(&messages, &self.signatures, &signer_keys)
+            .map_err(|_| anyhow!("Certificate for block {} has an invalid signature", self.height))
+    }
+}
+
+/// Votes received in one round of one height
+#[derive(Debug, Default)]
+struct RoundTally {
+    /// Authorities that prevoted or precommitted anything; later votes are ignored
+    prevoted: VoteBitset,
+    precommitted: VoteBitset,
+    prevotes: HashMap<String, VoteBitset>,
+    precommits: HashMap<String, BTreeMap<u16, Signature>>,
+}
+
+#[derive(Debug)]
+struct HeightState {
+    /// Block this node has at the height
+    block_hash: Option<String>,
+    /// Hash this node precommitted; later rounds vote only for it
+    locked: Option<String>,
+    round: u32,
+    deadline: Instant,
+    first_seen: Instant,
+    rounds: HashMap<u32, RoundTally>,
+}
+
+/// What handling an event produced
+#[derive(Debug, Default)]
+pub struct Progress {
+    /// Our own votes to gossip
+    pub votes: Vec<FinalityVote>,
+    pub certificate: Option<CommitCertificate>,
+    /// Height at which a quorum certified a block other than ours
+    pub conflict: Option<u64>,
+}
+
+/// How a certificate from the network relates to our chain
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum CertificateOutcome {
+    /// At or below the finalized height
+    Known,
+    /// No block at that height here yet
+    Ahead,
+    /// Finalized the block we hold at that height
+    Finalized,
+    /// Certifies a different block than the one we hold
+    Conflict,
+}
+
+/// Round state machine for all heights that are not yet final
+pub struct FinalityGadget {
+    keys: Vec<VerifyingKey>,
+    local: Option<(u16, SigningKey)>,
+    quorum: usize,
+    base_timeout: Duration,
+    max_timeout: Duration,
+    finalized_height: u64,
+    /// Lowest height at which a quorum certified a block other than ours
+    conflict: Option<u64>,
+    heights: BTreeMap<u64, HeightState>,
+}
+
+impl FinalityGadget {
+    /// `keys` are the authorities in schedule order; `local` is our position and key
+    pub fn new(
+        keys: Vec<VerifyingKey>,
+        local: Option<(usize, SigningKey)>,
+        config: &FinalityConfig,
+    ) -> Result<Self> {
+        if keys.is_empty() || keys.len() > MAX_AUTHORITIES {
+            return Err(anyhow!("Finality needs 1 to {} authorities", MAX_AUTHORITIES));
+        }
+        Ok(Self {
+            quorum: quorum(keys.len()),
+            keys,
+            local: local.map(|(index, key)| (index as u16, key)),
+            base_timeout: Duration::from_millis(config.base_timeout_ms.max(1)),
+            max_timeout: Duration::from_millis(config.max_timeout_ms.max(config.base_timeout_ms)),
+            finalized_height: 0,
+            conflict: None,
+            heights: BTreeMap::new(),
+        })
+    }
+
+    pub fn keys(&self) -> &[VerifyingKey] {
+        &self.keys
+    }
+
+    /// Resume after a restart from the highest certificate in storage, so
+    /// voting continues within the pending window above it
+    pub async fn restore(&mut self, storage: &StorageManager) -> Result<()> {
+        if let Some(certificate) = storage.latest_commit_certificate().await? {
+            certificate.verify(&self.keys)?;
+            self.finalize(certificate.height);
+        }
+        Ok(())
+    }
+
+    pub fn finalized_height(&self) -> u64 {
+        self.finalized_height
+    }
+
+    /// Height at which our chain diverged from a certified block, if any
+    pub fn conflict(&self) -> Option<u64> {
+        self.conflict
+    }
+
+    /// Round timeout: the base timeout, doubled for every failed round
+    pub fn timeout(&self, round: u32) -> Duration {
+        self.base_timeout
+            .saturating_mul(1u32 << round.min(16))
+            .min(self.max_timeout)
+    }
+
+    /// Current round of a height still collecting votes
+    pub fn round(&self, height: u64) -> Option<u32> {
+        self.heights.get(&height).map(|state| state.round)
+    }
+
+    /// A block was added to our chain
+    pub fn on_block(&mut self, height: u64, block_hash: &str, now: Instant) -> Progress {
+        let Some(state) = self.height_state(height, now) else {
+            return Progress::default();
+        };
+        if state.block_hash.is_none() {
+            state.block_hash = Some(block_hash.to_string());
+        }
+        self.advance(height, now)
+    }
+
+    /// A vote arrived from another authority
+    pub fn on_vote(&mut self, vote: FinalityVote, now: Instant) -> Result<Progress> {
+        if vote.height <= self.finalized_height || self.conflicts_at(vote.height) {
+            return Ok(Progress::default());
+        }
+        vote.verify(&self.keys)?;
+        let (height, round) = (vote.height, vote.round);
+        let tolerated = self.keys.len() - self.quorum;
+        let timeout = self.timeout(round);
+        let Some(state) = self.height_state(height, now) else {
+            return Err(anyhow!("Vote for height {} is too far ahead", height));
+        };
+        let tally = state.rounds.entry(round).or_default();
+        Self::record(tally, vote);
+
+        // More than f authorities are in a later round: at least one honest one moved on
+        let voters = tally.prevoted.len().max(tally.precommitted.len());
+        if round > state.round && voters > tolerated {
+            state.round = round;
+            state.deadline = now + timeout;
+        }
+        Ok(self.advance(height, now))
+    }
+
+    /// A certificate arrived from the network; `local_hash` is our block at its height
+    pub fn on_certificate(
+        &mut self,
+        certificate: &CommitCertificate,
+        local_hash: Option<&str>,
+    ) -> Result<CertificateOutcome> {
+        if certificate.height <= self.finalized_height {
+            return Ok(CertificateOutcome::Known);
+        }
+        certificate.verify(&self.keys)?;
+        match local_hash {
+            None => Ok(CertificateOutcome::Ahead),
+            Some(hash) if hash == certificate.block_hash => {
+                self.finalize(certificate.height);
+                Ok(CertificateOutcome::Finalized)
+            }
+            Some(_) => {
+                self.flag_conflict(certificate.height);
+                Ok(CertificateOutcome::Conflict)
+            }
+        }
+    }
+
+    /// Move every height whose round deadline passed to the next round
+    pub fn on_tick(&mut self, now: Instant) -> Progress {
+        let expired: Vec<u64> = self
+            .heights
+            .iter()
+            .filter(|(_, state)| state.deadline <= now)
+            .map(|(height, _)| *height)
+            .collect();
+        let mut progress = Progress::default();
+        for height in expired {
+            let Some(round) = self.round(height) else {
+                continue; // finalized by an earlier height's certificate
+            };
+            let deadline = now + self.timeout(round + 1);
+            if let Some(state) = self.heights.get_mut(&height) {
+                state.round = round + 1;
+                state.deadline = deadline;
+            }
+            tracing::debug!("Finality round {} for block {} timed out", round, height);
+            let step = self.advance(height, now);
+            progress.votes.extend(step.votes);
+            if step.certificate.is_some() {
+                progress.certificate = step.certificate;
+            }
+        }
+        progress
+    }
+
+    fn height_state(&mut self, height: u64, now: Instant) -> Option<&mut HeightState> {
+        if height <= self.finalized_height
+            || height > self.finalized_height + MAX_PENDING_HEIGHTS
+            || self.conflicts_at(height)
+        {
+            return None;
+        }
+        let timeout = self.timeout(0);
+        Some(self.heights.entry(height).or_insert_with(|| HeightState {
+            block_hash: None,
+            locked: None,
+            round: 0,
+            deadline: now + timeout,
+            first_seen: now,
+            rounds: HashMap::new(),
+        }))
+    }
+
+    fn record(tally: &mut RoundTally, vote: FinalityVote) {
+        let authority = vote.authority as usize;
+        match vote.phase {
+            VotePhase::Prevote => {
+                if tally.prevoted.insert(authority) {
+                    tally.prevotes.entry(vote.block_hash).or_default().insert(authority);
+                }
+            }
+            VotePhase::Precommit => {
+                if tally.precommitted.insert(authority) {
+                    tally
+                        .precommits
+                        .entry(vote.block_hash)
+                        .or_default()
+                        .insert(vote.authority, vote.signature);
+                }
+            }
+        }
+    }
+
+    /// Cast our votes for the current round and finalize on a precommit quorum
+    fn advance(&mut self, height: u64, now: Instant) -> Progress {
+        let mut progress = Progress::default();
+        let quorum = self.quorum;
+        let Some(state) = self.heights.get_mut(&height) else {
+            return progress;
+        };
+        let round = state.round;
+
+        if let Some((index, key)) = &self.local {
+            let index = *index;
+            let candidate = state.locked.clone().or_else(|| state.block_hash.clone());
+            let tally = state.rounds.entry(round).or_default();
+            if let Some(hash) = candidate.filter(|_| !tally.prevoted.contains(index as usize)) {
+                let vote = FinalityVote::new(height, round, hash, VotePhase::Prevote, index, key);
+                progress.votes.push(vote.clone());
+                Self::record(tally, vote);
+            }
+
+            // Precommit once a quorum prevoted for a block we hold
+            let polka = tally
+                .prevotes
+                .iter()
+                .find(|(_, voters)| voters.len() >= quorum)
+                .map(|(hash, _)| hash.clone());
+            let holds = |hash: &String| {
+                state.locked.as_ref().or(state.block_hash.as_ref()) == Some(hash)
+            };
+            if let Some(hash) = polka.filter(|hash| holds(hash)) {
+                let tally = state.rounds.entry(round).or_default();
+                if !tally.precommitted.contains(index as usize) {
+                    let vote =
+                        FinalityVote::new(height, round, hash.clone(), VotePhase::Precommit, index, key);
+                    progress.votes.push(vote.clone());
+                    Self::record(tally, vote);
+                    state.locked = Some(hash);
+                }
+            }
+        }
+
+        let committed = state.rounds.iter().find_map(|(round, tally)| {
+            tally
+                .precommits
+                .iter()
+                .find(|(_, signatures)| signatures.len() >= quorum)
+                .map(|(hash, signatures)| (*round, hash.clone(), signatures.clone()))
+        });
+        if let Some((round, block_hash, signatures)) = committed {
+            match state.block_hash.as_ref().map(|ours| *ours == block_hash) {
+                None => return progress, // final once our block at the height arrives
+                Some(false) => {
+                    self.flag_conflict(height);
+                    progress.conflict = Some(height);
+                    return progress;
+                }
+                Some(true) => {}
+            }
+            let mut signers = VoteBitset::default();
+            for index in signatures.keys() {
+                signers.insert(*index as usize);
+            }
+            tracing::info!(
+                "Finalized block {} in round {} after {:?}",
+                height,
+                round,
+                now.saturating_duration_since(state.first_seen)
+            );
+            progress.certificate = Some(CommitCertificate {
+                height,
+                round,
+                block_hash,
+                signers,
+                signatures: signatures.into_values().collect(),
+            });
+            self.finalize(height);
+        }
+        progress
+    }
+
+    fn conflicts_at(&self, height: u64) -> bool {
+        self.conflict.is_some_and(|conflict| height >= conflict)
+    }
+
+    /// Stop voting from `height` on: our chain holds a block the quorum did not certify
+    fn flag_conflict(&mut self, height: u64) {
+        self.conflict = Some(self.conflict.map_or(height, |conflict| conflict.min(height)));
+        self.heights.split_off(&height);
+    }
+
+    /// A certificate at `height` also finalizes every ancestor
+    fn finalize(&mut self, height: u64) {
+        self.finalized_height = self.finalized_height.max(height);
+        self.heights = self.heights.split_off(&(height + 1));
+    }
+}
+
+/// Drive the gadget from the chain tip, consensus gossip and round timers
+pub async fn run(
+    mut gadget: FinalityGadget,
+    blockchain: Arc<RwLock<Blockchain>>,
+    storage: Arc<StorageManager>,
+    network: P2PHandle,
+    mut messages: broadcast::Receiver<ConsensusEnvelope>,
+) -> Result<()> {
+    if let Err(e) = gadget.restore(&storage).await {
+        tracing::warn!("Finality restarting from genesis, stored certificate unusable: {}", e);
+    }
+    tracing::info!("Finality gadget starting at finalized height {}", gadget.finalized_height());
+
+    // Vote on blocks added from now on
+    let mut seen = blockchain.read().await.get_height().await?;
+    let mut tick = tokio::time::interval(TICK_INTERVAL);
+    loop {
+        let progress = tokio::select! {
+            message = messages.recv() => match message {
+                Ok(envelope) => handle_message(&mut gadget, &blockchain, &storage, envelope).await,
+                Err(RecvError::Lagged(_)) => continue,
+                Err(RecvError::Closed) => break,
+            },
+            _ = tick.tick() => {
+                if network.is_closed() {
+                    break;
+                }
+                let now = Instant::now();
+                let mut progress = gadget.on_tick(now);
+                let chain = blockchain.read().await;
+                let next = chain.get_height().await?;
+                while seen < next {
+                    let block = chain.get_block_by_height(seen).await?;
+                    let step = gadget.on_block(seen, &block.header.hash, now);
+                    progress.votes.extend(step.votes);
+                    progress.certificate = step.certificate.or(progress.certificate);
+                    seen += 1;
+                }
+                progress
+            }
+        };
+
+        for vote in &progress.votes {
+            if let Err(e) = network.broadcast_consensus(VOTE_MESSAGE, bincode::serialize(vote)?) {
+                tracing::debug!("Failed to gossip finality vote: {}", e);
+            }
+        }
+        if let Some(certificate) = progress.certificate {
+            storage.store_commit_certificate(&certificate).await?;
+            let data = bincode::serialize(&certificate)?;
+            if let Err(e) = network.broadcast_consensus(CERTIFICATE_MESSAGE, data) {
+                tracing::debug!("Failed to gossip commit certificate: {}", e);
+            }
+        }
+        if let Some(height) = progress.conflict {
+            tracing::error!(
+                "Quorum finalized a different block {} than ours; finality halted, fetching it from peers",
+                height
+            );
+            if let Err(e) = network.request_sync(height, height + 1) {
+                tracing::warn!("Failed to request the certified block {}: {}", height, e);
+            }
+        }
+    }
+    tracing::info!("Finality gadget stopped");
+    Ok(())
+}
+
+async fn handle_message(
+    gadget: &mut FinalityGadget,
+    blockchain: &RwLock<Blockchain>,
+    storage: &StorageManager,
+    envelope: ConsensusEnvelope,
+) -> Progress {
+    let result = match envelope.message_type.as_str() {
+        VOTE_MESSAGE => bincode::deserialize::<FinalityVote>(&envelope.data)
+            .map_err(|e| anyhow!("Malformed vote: {}", e))
+            .and_then(|vote| gadget.on_vote(vote, Instant::now())),
+        CERTIFICATE_MESSAGE => {
+            match bincode::deserialize::<CommitCertificate>(&envelope.data) {
+                Ok(certificate) => {
+                    let local_hash = blockchain
+                        .read()
+                        .await
+                        .get_block_by_height(certificate.height)
+                        .await
+                        .ok()
+                        .map(|block| block.header.hash);
+                    match gadget.on_certificate(&certificate, local_hash.as_deref()) {
+                        Ok(CertificateOutcome::Finalized) => storage
+                            .store_commit_certificate(&certificate)
+                            .await
+                            .map(|_| Progress::default()),
+                        Ok(CertificateOutcome::Conflict) => Ok(Progress {
+                            conflict: Some(certificate.height),
+                            ..Progress::default()
+                        }),
+                        Ok(_) => Ok(Progress::default()),
+                        Err(e) => Err(e),
+                    }
+                }
+                Err(e) => Err(anyhow!("Malformed certificate: {}", e)),
+            }
+        }
+        _ => Ok(Progress::default()),
+    };
+    result.unwrap_or_else(|e| {
+        tracing::debug!("Ignoring finality message from {}: {}", envelope.sender, e);
+        Progress::default()
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn gadgets(count: u8) -> Vec<FinalityGadget> {
+        let keys: Vec<SigningKey> = (0..count).map(|i| SigningKey::from_bytes(&[i + 1; 32])).collect();
+        let verifying: Vec<VerifyingKey> = keys.iter().map(SigningKey::verifying_key).collect();
+        keys.into_iter()
+            .enumerate()
+            .map(|(index, key)| {
+                FinalityGadget::new(verifying.clone(), Some((index, key)), &FinalityConfig::default())
+                    .unwrap()
+            })
+            .collect()
+    }
+
+    /// Deliver votes between the online gadgets until none are produced
+    fn exchange(
+        nodes: &mut [FinalityGadget],
+        online: &[usize],
+        mut pending: Vec<FinalityVote>,
+        now: Instant,
+    ) -> Vec<CommitCertificate> {
+        let mut certificates = Vec::new();
+        while !pending.is_empty() {
+            let mut next = Vec::new();
+            for vote in pending {
+                for &index in online {
+                    if nodes[index].local.as_ref().map(|(i, _)| *i) == Some(vote.authority) {
+                        continue;
+                    }
+                    let progress = nodes[index].on_vote(vote.clone(), now).unwrap();
+                    next.extend(progress.votes);
+                    certificates.extend(progress.certificate);
+                }
+            }
+            pending = next;
+        }
+        certificates
+    }
+
+    #[test]
+    fn test_bitset_and_quorum() {
+        let mut set = VoteBitset::default();
+        assert!(set.is_empty());
+        assert!(set.insert(3));
+        assert!(!set.insert(3));
+        assert!(set.insert(200));
+        assert_eq!(set.len(), 2);
+        assert_eq!(set.iter().collect::<Vec<_>>(), vec![3, 200]);
+        assert!(!set.contains(4));
+
+        assert_eq!(quorum(1), 1);
+        assert_eq!(quorum(4), 3);
+        assert_eq!(quorum(7), 5);
+    }
+
+    #[test]
+    fn test_three_of_four_authorities_finalize() {
+        let mut nodes = gadgets(4);
+        let online = [0, 1, 2];
+        let now = Instant::now();
+        let mut votes = Vec::new();
+        for &index in &online {
+            let progress = nodes[index].on_block(1, "block-1", now);
+            assert_eq!(progress.votes.len(), 1);
+            votes.extend(progress.votes);
+        }
+
+        let certificates = exchange(&mut nodes, &online, votes, now);
+        assert!(!certificates.is_empty());
+        for &index in &online {
+            assert_eq!(nodes[index].finalized_height(), 1);
+        }
+
+        let certificate = &certificates[0];
+        assert_eq!(certificate.block_hash, "block-1");
+        assert!(certificate.verify(nodes[0].keys()).is_ok());
+        assert_eq!(nodes[3].on_certificate(certificate, None).unwrap(), CertificateOutcome::Ahead);
+        assert_eq!(
+            nodes[3].on_certificate(certificate, Some("block-1")).unwrap(),
+            CertificateOutcome::Finalized
+        );
+
+        let mut forged = certificate.clone();
+        forged.block_hash = "block-x".to_string();
+        assert!(forged.verify(nodes[0].keys()).is_err());
+    }
+
+    #[tokio::test]
+    async fn test_restart_resumes_from_stored_certificate() {
+        let storage = StorageManager::new_memory();
+        let mut nodes = gadgets(4);
+        let now = Instant::now();
+        let votes = (0..4).flat_map(|i| nodes[i].on_block(60, "block-60", now).votes).collect();
+        for certificate in exchange(&mut nodes, &[0, 1, 2, 3], votes, now) {
+            storage.store_commit_certificate(&certificate).await.unwrap();
+        }
+
+        // Height 100 is beyond the pending window of a gadget starting from zero
+        let mut fresh = gadgets(4);
+        assert!(fresh[0].on_block(100, "block-100", now).votes.is_empty());
+
+        let mut restarted = gadgets(4);
+        for node in &mut restarted {
+            node.restore(&storage).await.unwrap();
+            assert_eq!(node.finalized_height(), 60);
+        }
+        let votes = (0..4).flat_map(|i| restarted[i].on_block(100, "block-100", now).votes).collect();
+        let certificates = exchange(&mut restarted, &[0, 1, 2, 3], votes, now);
+        assert!(certificates.iter().any(|certificate| certificate.height == 100));
+        assert_eq!(restarted[0].finalized_height(), 100);
+    }
+
+    #[test]
+    fn test_conflicting_local_block_is_not_finalized() {
+        let mut nodes = gadgets(4);
+        let now = Instant::now();
+        let mut votes: Vec<FinalityVote> =
+            (0..3).flat_map(|i| nodes[i].on_block(1, "block-1", now).votes).collect();
+        // Node 3 holds a different block at height 1
+        votes.extend(nodes[3].on_block(1, "block-1-fork", now).votes);
+
+        let certificates = exchange(&mut nodes, &[0, 1, 2, 3], votes, now);
+        assert!(certificates.iter().all(|certificate| certificate.block_hash == "block-1"));
+        assert_eq!(nodes[0].finalized_height(), 1);
+        assert_eq!(nodes[3].finalized_height(), 0);
+        assert_eq!(nodes[3].conflict(), Some(1));
+        assert!(nodes[3].on_block(2, "block-2", now).votes.is_empty());
+
+        // The same holds for a certificate arriving from the network
+        let mut other = gadgets(4).remove(3);
+        assert_eq!(
+            other.on_certificate(&certificates[0], Some("block-1-fork")).unwrap(),
+            CertificateOutcome::Conflict
+        );
+        assert_eq!(other.finalized_height(), 0);
+        assert_eq!(other.conflict(), Some(1));
+    }
+
+    #[test]
+    fn test_certificate_verifies_as_one_batch() {
+        let keys: Vec<SigningKey> = (0..50u8).map(|i| SigningKey::from_bytes(&[i + 1; 32])).collect();
+        let verifying: Vec<VerifyingKey> = keys.iter().map(SigningKey::verifying_key).collect();
+        let message = vote_message(9, 0, "block-9", VotePhase::Precommit);
+
+        let mut certificate = CommitCertificate {
+            height: 9,
+            round: 0,
+            block_hash: "block-9".to_string(),
+            signers: VoteBitset::default(),
+            signatures: Vec::new(),
+        };
+        for (index, key) in keys.iter().enumerate().skip(50 - quorum(50)) {
+            certificate.signers.insert(index);
+            certificate.signatures.push(key.sign(&message));
+        }
+        assert_eq!(certificate.signatures.len(), 34);
+        assert!(certificate.verify(&verifying).is_ok());
+
+        // One bad signature fails the whole batch
+        let mut tampered = certificate.clone();
+        tampered.signatures[20] = keys[0].sign(&message);
+        assert!(tampered.verify(&verifying).is_err());
+
+        let mut short = certificate.clone();
+        short.signatures.pop();
+        assert!(short.verify(&verifying).is_err());
+    }
+
+    #[test]
+    fn test_stalled_rounds_double_their_timeout() {
+        let mut nodes = gadgets(4);
+        let start = Instant::now();
+        let votes: Vec<FinalityVote> = (0..2).flat_map(|i| nodes[i].on_block(1, "block-1", start).votes).collect();
+        assert!(exchange(&mut nodes, &[0, 1], votes, start).is_empty());
+
+        let base = nodes[0].timeout(0);
+        assert_eq!(nodes[0].timeout(1), base * 2);
+        let progress = nodes[0].on_tick(start + base);
+        assert_eq!(nodes[0].round(1), Some(1));
+        assert_eq!(progress.votes[0].round, 1);
+        // The next round waits twice as long before giving up
+        assert!(nodes[0].on_tick(start + base + base).votes.is_empty());
+        assert_eq!(nodes[0].on_tick(start + base * 3).votes[0].round, 2);
+        assert_eq!(nodes[0].timeout(30), nodes[0].max_timeout);
+    }
+}
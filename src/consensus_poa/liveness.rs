@@ -0,0 +1,375 @@
+//! GridTokenX PoA liveness and slashing
+//!
+//! Every committed block tells each node the same story: which in-turn
+//! authorities let their round pass, who finally proposed, and how long after
+//! its round opened. Each authority keeps the most recent outcomes and
+//! latencies in fixed-size ring buffers with running sums, so its health
+//! score is O(1) to read and memory does not grow with the chain.
+//!
+//! Two headers signed by the same authority for the same height are
+//! double-sign evidence. Headers are indexed by (height, authority); evidence
+//! is carried in a later block's `extra_data` so all nodes slash the offender
+//! when that block executes, not when they happen to see the conflict.
+//!
+//! Slashing lowers the stake recorded for an authority, which its later
+//! blocks report in their header. Stake does not yet change the proposer
+//! schedule or finality.
+
+use anyhow::{anyhow, Result};
+use ed25519_dalek::VerifyingKey;
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashSet};
+
+use super::poa::{verify_signature, ReputationWeights};
+use crate::blockchain::block::BlockHeader;
+
+/// Recent slots kept per authority
+pub const LIVENESS_WINDOW: usize = 128;
+/// Heights behind the tip for which double-sign evidence is still accepted
+pub const EVIDENCE_HORIZON: u64 = 1_000;
+/// Evidence entries carried by a single block
+pub const MAX_EVIDENCE_PER_BLOCK: usize = 4;
+
+/// Fixed-capacity buffer that overwrites its oldest entry when full
+#[derive(Debug, Clone)]
+pub struct RingBuffer<T> {
+    slots: Vec<T>,
+    /// Index of the oldest entry once the buffer is full
+    next: usize,
+    capacity: usize,
+}
+
+impl<T: Copy> RingBuffer<T> {
+    pub fn new(capacity: usize) -> Self {
+        let capacity = capacity.max(1);
+        Self {
+            slots: Vec::with_capacity(capacity),
+            next: 0,
+            capacity,
+        }
+    }
+
+    /// Append a value, returning the one that fell out of the window
+    pub fn push(&mut self, value: T) -> Option<T> {
+        if self.slots.len() < self.capacity {
+            self.slots.push(value);
+            return None;
+        }
+        let evicted = std::mem::replace(&mut self.slots[self.next], value);
+        self.next = (self.next + 1) % self.capacity;
+        Some(evicted)
+    }
+
+    pub fn len(&self) -> usize {
+        self.slots.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.slots.is_empty()
+    }
+}
+
+/// Sliding window of one authority's slots
+#[derive(Debug, Clone)]
+pub struct AuthorityLiveness {
+    /// Whether each recent slot was used (`true`) or missed
+    outcomes: RingBuffer<bool>,
+    proposed: usize,
+    /// Delay between round start and block timestamp of recent proposals
+    latencies: RingBuffer<u64>,
+    latency_total: u64,
+    consecutive_misses: u64,
+}
+
+impl AuthorityLiveness {
+    pub fn new(window: usize) -> Self {
+        Self {
+            outcomes: RingBuffer::new(window),
+            proposed: 0,
+            latencies: RingBuffer::new(window),
+            latency_total: 0,
+            consecutive_misses: 0,
+        }
+    }
+
+    pub fn record_proposal(&mut self, latency_ms: u64) {
+        self.record_outcome(true);
+        if let Some(evicted) = self.latencies.push(latency_ms) {
+            self.latency_total -= evicted;
+        }
+        self.latency_total += latency_ms;
+        self.consecutive_misses = 0;
+    }
+
+    /// Record a missed slot and return the current run of misses
+    pub fn record_miss(&mut self) -> u64 {
+        self.record_outcome(false);
+        self.consecutive_misses += 1;
+        self.consecutive_misses
+    }
+
+    /// Start a new run of misses after the previous one was punished
+    pub fn reset_misses(&mut self) {
+        self.consecutive_misses = 0;
+    }
+
+    fn record_outcome(&mut self, proposed: bool) {
+        match self.outcomes.push(proposed) {
+            Some(true) => self.proposed -= 1,
+            Some(false) | None => {}
+        }
+        if proposed {
+            self.proposed += 1;
+        }
+    }
+
+    /// Share of slots in the window that were used
+    pub fn success_rate(&self) -> f64 {
+        if self.outcomes.is_empty() {
+            return 1.0;
+        }
+        self.proposed as f64 / self.outcomes.len() as f64
+    }
+
+    pub fn average_latency_ms(&self) -> Option<f64> {
+        if self.latencies.is_empty() {
+            return None;
+        }
+        Some(self.latency_total as f64 / self.latencies.len() as f64)
+    }
+
+    pub fn consecutive_misses(&self) -> u64 {
+        self.consecutive_misses
+    }
+
+    /// Weighted health in `[0, 1]`.
+    ///
+    /// Latency is measured against `latency_budget_ms` (a proposer later than
+    /// that loses its round) and the miss streak against `downtime_threshold`.
+    pub fn score(
+        &self,
+        weights: &ReputationWeights,
+        latency_budget_ms: u64,
+        downtime_threshold: u64,
+        community_rating: f64,
+    ) -> f64 {
+        let responsiveness = match self.average_latency_ms() {
+            Some(latency) => 1.0 - (latency / latency_budget_ms.max(1) as f64).min(1.0),
+            None => 1.0,
+        };
+        let uptime =
+            1.0 - (self.consecutive_misses as f64 / downtime_threshold.max(1) as f64).min(1.0);
+        weights.block_success_rate * self.success_rate()
+            + weights.response_time * responsiveness
+            + weights.uptime * uptime
+            + weights.community_rating * community_rating.clamp(0.0, 1.0)
+    }
+}
+
+/// Stake removed by slashing `stake` at `rate`.
+///
+/// The rate is rounded to basis points and applied in integers so every node
+/// arrives at the same amount.
+pub fn slash_amount(stake: u64, rate: f64) -> u64 {
+    let basis_points = (rate.clamp(0.0, 1.0) * 10_000.0).round() as u128;
+    (stake as u128 * basis_points / 10_000) as u64
+}
+
+/// Two conflicting headers signed by one authority for one height
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DoubleSignEvidence {
+    pub first: BlockHeader,
+    pub second: BlockHeader,
+}
+
+impl DoubleSignEvidence {
+    pub fn height(&self) -> u64 {
+        self.first.height
+    }
+
+    pub fn authority(&self) -> &str {
+        &self.first.validator.address
+    }
+
+    /// Check that both headers are distinct, intact and signed with `key`
+    pub fn verify(&self, key: &VerifyingKey) -> Result<()> {
+        if self.first.height != self.second.height
+            || self.first.validator.address != self.second.validator.address
+        {
+            return Err(anyhow!("Evidence headers are for different slots"));
+        }
+        if self.first.hash == self.second.hash {
+            return Err(anyhow!("Evidence headers are the same block"));
+        }
+        for header in [&self.first, &self.second] {
+            if header.calculate_hash()? != header.hash {
+                return Err(anyhow!("Evidence header {} has a wrong hash", header.height));
+            }
+            verify_signature(header, key)?;
+        }
+        Ok(())
+    }
+}
+
+/// Evidence list as carried in a block's `extra_data`
+pub fn encode_evidence(evidence: &[DoubleSignEvidence]) -> Result<Vec<u8>> {
+    if evidence.is_empty() {
+        return Ok(Vec::new());
+    }
+    bincode::serialize(evidence).map_err(|e| anyhow!("Failed to encode evidence: {}", e))
+}
+
+pub fn decode_evidence(extra_data: &[u8]) -> Result<Vec<DoubleSignEvidence>> {
+    if extra_data.is_empty() {
+        return Ok(Vec::new());
+    }
+    bincode::deserialize(extra_data).map_err(|e| anyhow!("Failed to decode evidence: {}", e))
+}
+
+/// Signed headers indexed by (height, authority) within the evidence horizon
+#[derive(Debug, Default)]
+pub struct EquivocationIndex {
+    headers: BTreeMap<(u64, String), BlockHeader>,
+    /// Evidence waiting to be included in a block
+    pending: Vec<DoubleSignEvidence>,
+    /// Slots whose double sign has already been punished
+    slashed: HashSet<(u64, String)>,
+}
+
+impl EquivocationIndex {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Index a signed header, returning evidence if it conflicts with an earlier one
+    pub fn observe(&mut self, header: &BlockHeader) -> Option<DoubleSignEvidence> {
+        let slot = (header.height, header.validator.address.clone());
+        let Some(seen) = self.headers.get(&slot) else {
+            self.headers.insert(slot, header.clone());
+            return None;
+        };
+        if seen.hash == header.hash {
+            return None;
+        }
+        let evidence = DoubleSignEvidence {
+            first: seen.clone(),
+            second: header.clone(),
+        };
+        let queued = self
+            .pending
+            .iter()
+            .any(|known| known.height() == header.height && known.authority() == slot.1);
+        if !queued && !self.slashed.contains(&slot) {
+            self.pending.push(evidence.clone());
+        }
+        Some(evidence)
+    }
+
+    /// Evidence to include in the next block
+    pub fn pending(&self) -> &[DoubleSignEvidence] {
+        let count = self.pending.len().min(MAX_EVIDENCE_PER_BLOCK);
+        &self.pending[..count]
+    }
+
+    /// Record that a slot was punished; `false` if it already was
+    pub fn mark_slashed(&mut self, height: u64, authority: &str) -> bool {
+        self.pending
+            .retain(|evidence| evidence.height() != height || evidence.authority() != authority);
+        self.slashed.insert((height, authority.to_string()))
+    }
+
+    /// Forget everything below `height`
+    pub fn prune(&mut self, height: u64) {
+        self.headers = self.headers.split_off(&(height, String::new()));
+        self.pending.retain(|evidence| evidence.height() >= height);
+        self.slashed.retain(|(slot_height, _)| *slot_height >= height);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::{Block, Transaction, ValidatorInfo};
+    use crate::consensus_poa::poa::sign_block;
+    use ed25519_dalek::SigningKey;
+
+    #[test]
+    fn test_liveness_window_is_bounded() {
+        let mut liveness = AuthorityLiveness::new(4);
+        for _ in 0..4 {
+            liveness.record_miss();
+        }
+        assert_eq!(liveness.success_rate(), 0.0);
+        assert_eq!(liveness.consecutive_misses(), 4);
+
+        // Older misses fall out of the window as proposals arrive
+        liveness.record_proposal(100);
+        liveness.record_proposal(300);
+        liveness.record_proposal(200);
+        assert_eq!(liveness.success_rate(), 0.75);
+        assert_eq!(liveness.consecutive_misses(), 0);
+        assert_eq!(liveness.average_latency_ms(), Some(200.0));
+
+        for _ in 0..4 {
+            liveness.record_proposal(1_000);
+        }
+        assert_eq!(liveness.success_rate(), 1.0);
+        assert_eq!(liveness.average_latency_ms(), Some(1_000.0));
+    }
+
+    #[test]
+    fn test_score_weighs_liveness() {
+        let weights = ReputationWeights::default();
+        let fresh = AuthorityLiveness::new(LIVENESS_WINDOW);
+        assert!((fresh.score(&weights, 4_000, 10, 1.0) - 1.0).abs() < 1e-9);
+
+        let mut slow = AuthorityLiveness::new(LIVENESS_WINDOW);
+        slow.record_proposal(2_000);
+        let mut absent = AuthorityLiveness::new(LIVENESS_WINDOW);
+        for _ in 0..10 {
+            absent.record_miss();
+        }
+        assert!((slow.score(&weights, 4_000, 10, 1.0) - 0.85).abs() < 1e-9);
+        assert!((absent.score(&weights, 4_000, 10, 1.0) - 0.4).abs() < 1e-9);
+
+        assert_eq!(slash_amount(1_000_000, 0.05), 50_000);
+        assert_eq!(slash_amount(999, 0.01), 9);
+    }
+
+    #[test]
+    fn test_double_sign_is_indexed_once_per_slot() {
+        let key = SigningKey::from_bytes(&[7; 32]);
+        let validator = ValidatorInfo {
+            address: "egat".to_string(),
+            stake: 0,
+            reputation: 100.0,
+            authority_type: None,
+        };
+        let signed = |amount: u64| {
+            let mint =
+                Transaction::new_genesis_mint("alice".to_string(), amount, "Mint".to_string()).unwrap();
+            let mut block = Block::new("parent".to_string(), vec![mint], 5, validator.clone()).unwrap();
+            sign_block(&mut block, &key);
+            block.header
+        };
+        let (first, second) = (signed(1), signed(2));
+
+        let mut index = EquivocationIndex::new();
+        assert!(index.observe(&first).is_none());
+        assert!(index.observe(&first).is_none());
+        let evidence = index.observe(&second).unwrap();
+        assert!(evidence.verify(&key.verifying_key()).is_ok());
+        assert!(evidence.verify(&SigningKey::from_bytes(&[8; 32]).verifying_key()).is_err());
+        assert_eq!(index.pending().len(), 1);
+
+        let carried = decode_evidence(&encode_evidence(index.pending()).unwrap()).unwrap();
+        assert_eq!(carried[0].second.hash, second.hash);
+        assert!(index.mark_slashed(5, "egat"));
+        assert!(!index.mark_slashed(5, "egat"));
+        assert!(index.observe(&second).is_some());
+        assert!(index.pending().is_empty());
+
+        index.prune(6);
+        assert!(index.observe(&second).is_none());
+    }
+}
@@ -1,5 +1,7 @@
 use anyhow::Result;
 
+pub mod finality;
+pub mod liveness;
 pub mod poa;
 
 pub use poa::{POAConsensusEngine, Authority, ThaiAuthorityType};
@@ -17,6 +19,10 @@ pub trait ConsensusEngine {
     
     /// Get consensus configuration
     fn get_config(&self) -> Result<ConsensusConfig>;
+
+    /// See a header that is not being imported, such as a competing block
+    /// for a height we already have
+    fn observe_header(&self, _header: &crate::blockchain::block::BlockHeader) {}
 }
 
 /// Consensus configuration structure
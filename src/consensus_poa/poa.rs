@@ -1,18 +1,89 @@
-//! GridTokenX Proof of Authority (POA) Consensus Implementation Starter
+//! GridTokenX Proof of Authority (POA) Consensus
 //!
-//! This file provides the foundational structure for implementing POA consensus
-//! in the GridTokenX blockchain for Thailand's energy trading market.
+//! Thai energy-sector authorities take turns producing blocks. The authority
+//! set and its order come from `[consensus.poa]`. Block `h` belongs to
+//! authority `h mod n`; once the proposer timeout passes without it, the turn
+//! moves to the next authority, and so on. The round a block was produced in
+//! follows from its own and its parent's timestamps, so every node checks
+//! turns the same way without extra messages. A block stamped ahead of the
+//! local clock, or in a round that has not opened yet, is rejected so an
+//! authority cannot take a later turn early. Proposers sign the header hash
+//! with their Ed25519 authority key.
+//!
+//! An authority proposes in every slot it is given, with an empty block when
+//! the mempool is idle, so a skipped round always means the in-turn authority
+//! was absent and liveness accounting does not penalise quiet periods.
+//!
+//! While waiting for its slot, an authority prepares the next block on top of
+//! the current tip: transactions are collected and checked, and the Merkle
+//! root and derived fields are computed. When the slot opens it only stamps,
+//! hashes and signs the template. A template built on a parent that is no
+//! longer the tip is dropped.
+//!
+//! Every node replays committed blocks in order to score authority liveness
+//! and apply slashing; see [`super::liveness`].
+//!
+//! Slots and timestamps come from the engine's [`Clock`]: the system clock on
+//! a real node, or the tokio runtime's clock in the network simulator, where
+//! time is paused and advanced virtually.
 
 use anyhow::{anyhow, Result};
-use chrono::{DateTime, Utc};
+use chrono::{DateTime, Duration, Utc};
+use ed25519_dalek::{Signature, Signer, SigningKey, Verifier, VerifyingKey};
 use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
-use std::sync::Arc;
+use std::sync::{Arc, Mutex, OnceLock};
 use tokio::sync::RwLock;
-use uuid::Uuid;
 
-use crate::blockchain::{Block, Blockchain, Transaction};
-use crate::config::POAConfig;
+use super::liveness::{
+    self, AuthorityLiveness, DoubleSignEvidence, EquivocationIndex, EVIDENCE_HORIZON, LIVENESS_WINDOW,
+};
+use super::{ConsensusConfig, ConsensusEngine};
+use crate::blockchain::block::{BlockHeader, BLOCK_GAS_LIMIT};
+use crate::blockchain::{Block, Blockchain, Transaction, ValidationResult, ValidatorInfo};
+use crate::config::{POAConfig, SlashingConfig};
+use crate::p2p::P2PHandle;
+use crate::utils::crypto;
+
+/// How often a waiting authority re-reads the chain tip
+const POLL_INTERVAL: std::time::Duration = std::time::Duration::from_millis(100);
+/// Age after which a waiting authority rebuilds its template to pick up new transactions
+const TEMPLATE_REFRESH: std::time::Duration = std::time::Duration::from_millis(500);
+/// Lowest reputation score at which an authority counts as healthy
+const HEALTHY_SCORE: f64 = 0.5;
+/// Most a block may run ahead of the local clock, capped at half a proposer timeout
+const MAX_CLOCK_DRIFT_MS: u64 = 500;
+
+/// Source of the wall-clock time that slots and block timestamps use
+#[derive(Debug, Clone, Copy)]
+pub enum Clock {
+    System,
+    /// Wall time advanced by the tokio runtime's clock since `started`, so a
+    /// runtime with paused time drives slots through virtual time
+    Runtime {
+        epoch: DateTime<Utc>,
+        started: tokio::time::Instant,
+    },
+}
+
+impl Clock {
+    /// Follow the current runtime's clock from now on
+    pub fn runtime() -> Self {
+        Clock::Runtime {
+            epoch: Utc::now(),
+            started: tokio::time::Instant::now(),
+        }
+    }
+
+    pub fn now(&self) -> DateTime<Utc> {
+        match self {
+            Clock::System => Utc::now(),
+            Clock::Runtime { epoch, started } => {
+                *epoch + Duration::from_std(started.elapsed()).unwrap_or_else(|_| Duration::zero())
+            }
+        }
+    }
+}
 
 /// Thai Energy Authority Types for POA Consensus
 #[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
@@ -107,16 +178,39 @@ pub struct AuthorityEndorsement {
 pub struct POAConsensusEngine {
     /// Authority registry
     authority_registry: Arc<AuthorityRegistry>,
+    /// Authorities in proposer order with their verifying keys
+    schedule: Vec<(Authority, VerifyingKey)>,
+    /// This node's position in the schedule and its key, if it is an authority
+    local: Option<(usize, SigningKey)>,
     /// Link to blockchain
     blockchain: Arc<RwLock<Blockchain>>,
+    /// Where produced blocks are announced, once the network is up
+    network: OnceLock<P2PHandle>,
     /// POA configuration
     config: POAConfig,
     /// Current consensus state
-    state: RwLock<POAState>,
+    state: Mutex<POAState>,
+    /// Block prepared for our next slot
+    template: Mutex<Option<BlockTemplate>>,
     /// Reputation tracking system
     reputation_tracker: Arc<ReputationTracker>,
+    /// Stake penalties for downtime and double signing
+    slashing: SlashingConfig,
+    /// Signed headers seen per (height, authority)
+    equivocations: Mutex<EquivocationIndex>,
     /// Governance system
     governance: Arc<AuthorityGovernance>,
+    /// Time slots and timestamps are measured against
+    clock: Clock,
+}
+
+/// Unsigned block built ahead of the proposer's slot
+#[derive(Debug)]
+struct BlockTemplate {
+    /// Schedule position the block was built for
+    authority: usize,
+    block: Block,
+    built_at: tokio::time::Instant,
 }
 
 /// Authority registry for managing POA validators
@@ -142,23 +236,20 @@ pub struct POAState {
     pub last_block_time: Option<DateTime<Utc>>,
     /// Number of consecutive missed blocks
     pub missed_blocks: u64,
+    /// Height of the next block
+    pub next_height: u64,
 }
 
 /// Reputation tracking system
 pub struct ReputationTracker {
-    /// Performance history for each authority
-    performance_history: RwLock<HashMap<String, Vec<PerformanceRecord>>>,
+    /// Recent slots of each authority
+    liveness: RwLock<HashMap<String, AuthorityLiveness>>,
     /// Reputation calculation weights
     weights: ReputationWeights,
-}
-
-/// Individual performance record
-#[derive(Debug, Clone)]
-pub struct PerformanceRecord {
-    pub timestamp: DateTime<Utc>,
-    pub block_height: u64,
-    pub response_time_ms: u64,
-    pub success: bool,
+    /// Proposal latency at which responsiveness scores zero
+    latency_budget_ms: u64,
+    /// Run of missed slots at which uptime scores zero
+    downtime_threshold: u64,
 }
 
 /// Weights for reputation calculation
@@ -256,284 +347,607 @@ impl Default for GovernanceConfig {
 
 // Implementation starts here
 
+/// Read a hex-encoded Ed25519 secret key from a file
+pub fn load_signing_key(path: &str) -> Result<SigningKey> {
+    let contents = std::fs::read_to_string(path)
+        .map_err(|e| anyhow!("Failed to read authority key {}: {}", path, e))?;
+    let bytes: [u8; 32] = hex::decode(contents.trim())?
+        .try_into()
+        .map_err(|_| anyhow!("Authority key {} must be 32 bytes", path))?;
+    Ok(SigningKey::from_bytes(&bytes))
+}
+
+/// Sign a header hash with an authority key
+pub fn sign_block(block: &mut Block, key: &SigningKey) {
+    block.header.signature = hex::encode(key.sign(block.header.hash.as_bytes()).to_bytes());
+}
+
+/// Check a header's authority signature over its hash
+pub fn verify_signature(header: &BlockHeader, key: &VerifyingKey) -> Result<()> {
+    let signature = hex::decode(&header.signature)
+        .ok()
+        .and_then(|bytes| Signature::from_slice(&bytes).ok())
+        .ok_or_else(|| anyhow!("Block {} has a malformed authority signature", header.height))?;
+    key.verify(header.hash.as_bytes(), &signature)
+        .map_err(|_| anyhow!("Block {} has an invalid authority signature", header.height))
+}
+
 impl POAConsensusEngine {
     /// Create new POA consensus engine
     pub async fn new(
         blockchain: Arc<RwLock<Blockchain>>,
         config: POAConfig,
+    ) -> Result<Self> {
+        let signing_key = match &config.signing_key_file {
+            Some(path) => Some(load_signing_key(path)?),
+            None => None,
+        };
+        Self::with_signing_key(blockchain, config, signing_key).await
+    }
+
+    /// Create an engine with an explicit authority key (`None` to only validate)
+    pub async fn with_signing_key(
+        blockchain: Arc<RwLock<Blockchain>>,
+        config: POAConfig,
+        signing_key: Option<SigningKey>,
     ) -> Result<Self> {
         let authority_registry = Arc::new(AuthorityRegistry::new());
-        let reputation_tracker = Arc::new(ReputationTracker::new());
-        let governance = Arc::new(AuthorityGovernance::new(GovernanceConfig::default()));
-        
+        let mut schedule = Vec::with_capacity(config.initial_authorities.len());
+        for initial_auth in &config.initial_authorities {
+            let public_key = hex::decode(&initial_auth.public_key)?;
+            let key_bytes: [u8; 32] = public_key
+                .as_slice()
+                .try_into()
+                .map_err(|_| anyhow!("Authority public key must be 32 bytes"))?;
+            let verifying_key = VerifyingKey::from_bytes(&key_bytes)?;
+            let authority = Authority {
+                address: crypto::generate_address(&public_key),
+                public_key,
+                authority_type: initial_auth.authority_type.clone(),
+                license_number: initial_auth.license_number.clone(),
+                organization: initial_auth.organization.clone(),
+                stake_amount: config.authority_stake_requirement,
+                joined_at: Utc::now(),
+                last_block_time: None,
+                reputation_score: 1.0, // Start with perfect reputation
+                is_active: true,
+                performance: PerformanceMetrics::default(),
+            };
+            if schedule.iter().any(|(known, _): &(Authority, VerifyingKey)| known.address == authority.address) {
+                return Err(anyhow!("Authority {} configured twice", authority.address));
+            }
+            authority_registry.add_authority(authority.clone()).await?;
+            schedule.push((authority, verifying_key));
+        }
+        if schedule.is_empty() {
+            return Err(anyhow!("PoA consensus needs at least one authority"));
+        }
+        if config.block_time_ms == 0 || config.proposer_timeout_ms == 0 {
+            return Err(anyhow!("PoA block time and proposer timeout must be positive"));
+        }
+
+        let local = match signing_key {
+            Some(key) => {
+                let address = crypto::generate_address(key.verifying_key().as_bytes());
+                let index = schedule
+                    .iter()
+                    .position(|(authority, _)| authority.address == address)
+                    .ok_or_else(|| anyhow!("Signing key {} is not a configured authority", address))?;
+                Some((index, key))
+            }
+            None => None,
+        };
+        tracing::info!("Initialized {} authorities", schedule.len());
+        let slashing = SlashingConfig::default();
+
         Ok(Self {
             authority_registry,
+            schedule,
+            local,
             blockchain,
+            network: OnceLock::new(),
+            state: Mutex::new(POAState::default()),
+            template: Mutex::new(None),
+            reputation_tracker: Arc::new(ReputationTracker::new(
+                config.proposer_timeout_ms,
+                slashing.downtime_threshold,
+            )),
+            slashing,
+            equivocations: Mutex::new(EquivocationIndex::new()),
+            governance: Arc::new(AuthorityGovernance::new(GovernanceConfig::default())),
             config,
-            state: RwLock::new(POAState::default()),
-            reputation_tracker,
-            governance,
+            clock: Clock::System,
         })
     }
-    
+
+    /// Use the validator slashing rates instead of the defaults
+    pub fn with_slashing(mut self, slashing: SlashingConfig) -> Self {
+        self.reputation_tracker = Arc::new(ReputationTracker::new(
+            self.config.proposer_timeout_ms,
+            slashing.downtime_threshold,
+        ));
+        self.slashing = slashing;
+        self
+    }
+
+    /// Take slot times from `clock` instead of the system clock
+    pub fn with_clock(mut self, clock: Clock) -> Self {
+        self.clock = clock;
+        self
+    }
+
+    /// Announce produced blocks through the P2P network
+    pub fn attach_network(&self, handle: P2PHandle) {
+        let _ = self.network.set(handle);
+    }
+
+    /// Address of this node's authority, if it is one
+    pub fn local_authority(&self) -> Option<&str> {
+        let (index, _) = self.local.as_ref()?;
+        Some(&self.schedule[*index].0.address)
+    }
+
+    /// Authority verifying keys in schedule order
+    pub fn authority_keys(&self) -> Vec<VerifyingKey> {
+        self.schedule.iter().map(|(_, key)| *key).collect()
+    }
+
+    /// This node's schedule position and authority key
+    pub fn signing_key(&self) -> Option<(usize, SigningKey)> {
+        self.local.clone()
+    }
+
+    pub fn registry(&self) -> &Arc<AuthorityRegistry> {
+        &self.authority_registry
+    }
+
+    pub fn governance(&self) -> &Arc<AuthorityGovernance> {
+        &self.governance
+    }
+
+    /// Whether an authority's recent slots score as healthy
+    pub async fn is_authority_healthy(&self, address: &str) -> Result<bool> {
+        let rating = self.authority_registry.get_authority(address).await?.reputation_score;
+        Ok(self.reputation_tracker.is_authority_healthy(address, rating).await)
+    }
+
     /// Start POA consensus loop
     pub async fn start_consensus(&self) -> Result<()> {
-        tracing::info!("Starting GridTokenX POA Consensus for Thai Energy Market");
-        
-        // Initialize with configured authorities
-        self.initialize_authorities().await?;
-        
+        let Some((index, _)) = &self.local else {
+            tracing::info!("Not a PoA authority; validating blocks only");
+            return Ok(());
+        };
+        tracing::info!(
+            "Starting GridTokenX POA Consensus for Thai Energy Market as authority {} of {}",
+            index,
+            self.schedule.len()
+        );
+
         loop {
             if let Err(e) = self.consensus_round().await {
                 tracing::error!("Consensus round error: {}", e);
-                tokio::time::sleep(tokio::time::Duration::from_secs(1)).await;
-                continue;
+                tokio::time::sleep(POLL_INTERVAL).await;
             }
-            
-            // Wait for next block time
-            tokio::time::sleep(tokio::time::Duration::from_secs(self.config.block_time_seconds)).await;
         }
     }
-    
-    /// Execute single consensus round
-    async fn consensus_round(&self) -> Result<()> {
-        // Select next authority for block proposal
-        let authority_address = self.select_next_authority().await?;
-        
-        // Check if we are the selected authority
-        if self.is_our_turn(&authority_address).await? {
-            // Propose new block
-            let block = self.propose_block(&authority_address).await?;
-            
-            // Add block to blockchain
-            self.add_block_to_chain(block).await?;
-            
-            // Update performance metrics
-            self.update_authority_performance(&authority_address, true).await?;
+
+    /// Propose a block if it is our turn on top of the current tip.
+    ///
+    /// Sleeps until our next slot (at most [`POLL_INTERVAL`], so a block from
+    /// another authority is noticed promptly) and returns `None` otherwise.
+    pub async fn consensus_round(&self) -> Result<Option<Block>> {
+        let Some((index, key)) = &self.local else {
+            return Ok(None);
+        };
+        let parent = self.blockchain.read().await.get_latest_block().await?;
+        let height = parent.header.height + 1;
+        self.lock_state().next_height = height;
+
+        let now = self.clock.now();
+        let slot = self.next_slot(*index, height, parent.header.timestamp, now);
+        let wait = (slot - now).to_std().unwrap_or_default();
+        if !wait.is_zero() {
+            // Spend the wait preparing the block for our slot
+            self.prepare_template(*index, &parent).await?;
+            tokio::time::sleep(wait.min(POLL_INTERVAL)).await;
+            return Ok(None);
         }
-        
-        // Update consensus state
-        self.advance_consensus_state().await?;
-        
-        Ok(())
-    }
-    
-    /// Select next authority using round-robin
-    async fn select_next_authority(&self) -> Result<String> {
-        let registry = self.authority_registry.get_active_authorities().await;
-        let state = self.state.read().await;
-        
-        if registry.is_empty() {
-            return Err(anyhow!("No active authorities available"));
+
+        let block = self.propose_block(*index, key, &parent).await?;
+        // Building may have run past the end of our slot
+        if self.proposer_index(height, self.round_of(&block, &parent)) != *index {
+            tracing::debug!("Missed slot for block {}, discarding it", height);
+            return Ok(None);
         }
-        
-        let authority_index = state.current_authority_index % registry.len();
-        let selected_authority = &registry[authority_index];
-        
-        // Check if authority is healthy
-        if self.reputation_tracker.is_authority_healthy(&selected_authority.address).await? {
-            Ok(selected_authority.address.clone())
+
+        self.add_block_to_chain(*index, &block).await?;
+        Ok(Some(block))
+    }
+
+    /// Round a block at `at` falls in, counted from its parent's timestamp
+    fn round_at(&self, parent_time: DateTime<Utc>, at: DateTime<Utc>) -> u64 {
+        let elapsed = (at - parent_time).num_milliseconds() - self.config.block_time_ms as i64;
+        if elapsed < 0 {
+            0
         } else {
-            // Skip to next healthy authority
-            self.select_next_healthy_authority(authority_index).await
+            elapsed as u64 / self.config.proposer_timeout_ms
         }
     }
-    
-    /// Find next healthy authority if current is unhealthy
-    async fn select_next_healthy_authority(&self, failed_index: usize) -> Result<String> {
-        let registry = self.authority_registry.get_active_authorities().await;
-        
-        // Try next few authorities
-        for offset in 1..=3 {
-            let next_index = (failed_index + offset) % registry.len();
-            let candidate = &registry[next_index];
-            
-            if self.reputation_tracker.is_authority_healthy(&candidate.address).await? {
-                tracing::warn!("Authority fallback: {} -> {}", failed_index, next_index);
-                return Ok(candidate.address.clone());
-            }
-        }
-        
-        Err(anyhow!("No healthy authorities found"))
+
+    /// Clock skew tolerated between authorities
+    fn clock_drift(&self) -> Duration {
+        Duration::milliseconds(MAX_CLOCK_DRIFT_MS.min(self.config.proposer_timeout_ms / 2) as i64)
     }
-    
-    /// Check if this node should propose the block
-    async fn is_our_turn(&self, authority_address: &str) -> Result<bool> {
-        // This would check if we have the private key for this authority
-        // For now, assume we are always the authority (single node)
-        Ok(true)
+
+    fn round_of(&self, block: &Block, parent: &Block) -> u64 {
+        self.round_at(parent.header.timestamp, block.header.timestamp)
     }
-    
-    /// Propose new block as selected authority
-    async fn propose_block(&self, authority_address: &str) -> Result<Block> {
+
+    /// When `round` opens: one block time after the parent, then one timeout per round
+    fn round_start(&self, parent_time: DateTime<Utc>, round: u64) -> DateTime<Utc> {
+        parent_time
+            + Duration::milliseconds(self.config.block_time_ms as i64)
+            + Duration::milliseconds((round * self.config.proposer_timeout_ms) as i64)
+    }
+
+    /// Schedule position of the authority allowed to propose `height` in `round`
+    pub fn proposer_index(&self, height: u64, round: u64) -> usize {
+        (height.wrapping_add(round) % self.schedule.len() as u64) as usize
+    }
+
+    /// Earliest time at or after `now` when authority `index` may propose `height`
+    pub fn next_slot(
+        &self,
+        index: usize,
+        height: u64,
+        parent_time: DateTime<Utc>,
+        now: DateTime<Utc>,
+    ) -> DateTime<Utc> {
+        let authorities = self.schedule.len() as u64;
+        let current = self.round_at(parent_time, now);
+        let in_turn = self.proposer_index(height, current) as u64;
+        let offset = (index as u64 + authorities - in_turn) % authorities;
+        self.round_start(parent_time, current + offset).max(now)
+    }
+
+    /// Sign a block on `parent`, reusing the prepared template when it still fits
+    async fn propose_block(
+        &self,
+        index: usize,
+        key: &SigningKey,
+        parent: &Block,
+    ) -> Result<Block> {
         let start_time = std::time::Instant::now();
-        
-        // Get pending transactions
-        let transactions = self.get_pending_energy_transactions().await?;
-        
-        // Get previous block
-        let blockchain = self.blockchain.read().await;
-        let previous_block = blockchain.get_latest_block().await?;
-        drop(blockchain);
-        
-        // Create new block
-        let mut block = Block {
-            height: previous_block.height + 1,
-            previous_hash: previous_block.hash.clone(),
-            timestamp: Utc::now(),
-            transactions,
-            merkle_root: String::new(),
-            hash: String::new(),
-            proposer: authority_address.to_string(),
-            authority_signature: None,
+        let prepared = self
+            .lock_template()
+            .take()
+            .filter(|template| {
+                template.authority == index && template.block.header.previous_hash == parent.header.hash
+            })
+            .map(|template| template.block);
+        let prebuilt = prepared.is_some();
+        let mut block = match prepared {
+            Some(block) => block,
+            None => self.build_template(index, parent).await?,
         };
-        
-        // Calculate merkle root and block hash
-        block.merkle_root = self.calculate_merkle_root(&block.transactions)?;
-        block.hash = self.calculate_block_hash(&block)?;
-        
-        // Sign block as authority
-        let signature = self.sign_block_as_authority(&block, authority_address).await?;
-        block.authority_signature = Some(signature);
-        
-        let elapsed = start_time.elapsed();
-        tracing::info!("Block {} proposed by {} in {:?}", block.height, authority_address, elapsed);
-        
+
+        // The timestamp places the block in our round, so it is set at the slot
+        block.header.timestamp = self
+            .clock
+            .now()
+            .max(parent.header.timestamp + Duration::milliseconds(1));
+        // Carry pending double-sign evidence so every node slashes at this block
+        block.header.extra_data = liveness::encode_evidence(self.lock_equivocations().pending())?;
+        block.header.hash = block.calculate_hash()?;
+        sign_block(&mut block, key);
+
+        tracing::info!(
+            "Block {} proposed by {} in {:?} (prebuilt: {})",
+            block.header.height,
+            self.schedule[index].0.organization,
+            start_time.elapsed(),
+            prebuilt
+        );
         Ok(block)
     }
-    
-    /// Get pending energy transactions for block
-    async fn get_pending_energy_transactions(&self) -> Result<Vec<Transaction>> {
-        let blockchain = self.blockchain.read().await;
-        let transactions = blockchain.get_pending_transactions(1000).await;
-        
-        // Filter for energy-related transactions
-        let energy_transactions: Vec<Transaction> = transactions
+
+    /// Build or refresh the template for our next slot on `parent`
+    async fn prepare_template(&self, index: usize, parent: &Block) -> Result<()> {
+        let fresh = self.lock_template().as_ref().is_some_and(|template| {
+            template.block.header.previous_hash == parent.header.hash
+                && template.built_at.elapsed() < TEMPLATE_REFRESH
+        });
+        if fresh {
+            return Ok(());
+        }
+        let block = self.build_template(index, parent).await?;
+        *self.lock_template() = Some(BlockTemplate {
+            authority: index,
+            block,
+            built_at: tokio::time::Instant::now(),
+        });
+        Ok(())
+    }
+
+    /// Unsigned block on `parent` with the pending transactions that pass validation
+    async fn build_template(&self, index: usize, parent: &Block) -> Result<Block> {
+        let transactions: Vec<Transaction> = self
+            .collect_transactions()
+            .await
             .into_iter()
-            .filter(|tx| self.is_energy_transaction(tx))
+            .filter(|tx| tx.validate().is_ok())
             .collect();
-            
-        Ok(energy_transactions)
-    }
-    
-    /// Check if transaction is energy-related
-    fn is_energy_transaction(&self, transaction: &Transaction) -> bool {
-        // Check transaction type for energy trading
-        matches!(transaction.transaction_type, 
-            crate::blockchain::TransactionType::EnergyTrade |
-            crate::blockchain::TransactionType::EnergyOrder
-        )
-    }
-    
-    /// Sign block with authority private key
-    async fn sign_block_as_authority(&self, block: &Block, authority_address: &str) -> Result<Vec<u8>> {
-        // Get authority info
-        let authority = self.authority_registry.get_authority(authority_address).await?;
-        
-        // Create signing payload
-        let signing_data = self.create_block_signing_data(block)?;
-        
-        // Sign with authority private key (placeholder implementation)
-        let signature = self.crypto_sign(&signing_data, &authority.public_key)?;
-        
-        Ok(signature)
+
+        let authority = &self.schedule[index].0;
+        let stake = self.authority_registry.get_authority(&authority.address).await?.stake_amount;
+        let block = Block::new(
+            parent.header.hash.clone(),
+            transactions,
+            parent.header.height + 1,
+            ValidatorInfo {
+                address: authority.address.clone(),
+                stake,
+                reputation: authority.reputation_score * 100.0,
+                authority_type: Some(format!("{:?}", authority.authority_type)),
+            },
+        )?;
+        Ok(block)
     }
-    
-    /// Create data for block signing
-    fn create_block_signing_data(&self, block: &Block) -> Result<Vec<u8>> {
-        let mut signing_data = Vec::new();
-        signing_data.extend_from_slice(&block.height.to_be_bytes());
-        signing_data.extend_from_slice(block.previous_hash.as_bytes());
-        signing_data.extend_from_slice(block.merkle_root.as_bytes());
-        signing_data.extend_from_slice(&block.timestamp.timestamp().to_be_bytes());
-        Ok(signing_data)
+
+    /// Pending transactions of every type, up to the block gas limit
+    async fn collect_transactions(&self) -> Vec<Transaction> {
+        let blockchain = self.blockchain.read().await;
+        let mut gas = 0u64;
+        blockchain
+            .get_pending_transactions(self.config.max_block_transactions)
+            .await
+            .into_iter()
+            .take_while(|tx| {
+                gas += tx.gas_limit;
+                gas <= BLOCK_GAS_LIMIT
+            })
+            .collect()
     }
-    
-    /// Cryptographic signing (placeholder)
-    fn crypto_sign(&self, data: &[u8], _public_key: &[u8]) -> Result<Vec<u8>> {
-        // Placeholder: In real implementation, use actual cryptographic signing
-        use sha2::{Sha256, Digest};
-        let mut hasher = Sha256::new();
-        hasher.update(data);
-        Ok(hasher.finalize().to_vec())
+
+    /// Check a block's proposer turn and signature against its parent
+    pub fn verify_block(&self, block: &Block, parent: &Block) -> Result<()> {
+        self.verify_block_at(block, parent, self.clock.now())
     }
-    
-    /// Calculate merkle root for transactions
-    fn calculate_merkle_root(&self, transactions: &[Transaction]) -> Result<String> {
-        if transactions.is_empty() {
-            return Ok("0".repeat(64));
+
+    /// Check a block as seen at local time `now`
+    fn verify_block_at(&self, block: &Block, parent: &Block, now: DateTime<Utc>) -> Result<()> {
+        let height = block.header.height;
+        if let ValidationResult::Invalid(reason) = block.validate(Some(parent)) {
+            return Err(anyhow!("Invalid block {}: {}", height, reason));
         }
-        
-        // Simple implementation - in practice, use proper merkle tree
-        use sha2::{Sha256, Digest};
-        let mut hasher = Sha256::new();
-        for tx in transactions {
-            hasher.update(&tx.id);
+
+        let latest = now + self.clock_drift();
+        if block.header.timestamp > latest {
+            return Err(anyhow!(
+                "Block {} stamped {} ahead of the local clock",
+                height,
+                block.header.timestamp - now
+            ));
         }
-        Ok(hex::encode(hasher.finalize()))
-    }
-    
-    /// Calculate block hash
-    fn calculate_block_hash(&self, block: &Block) -> Result<String> {
-        use sha2::{Sha256, Digest};
-        let mut hasher = Sha256::new();
-        hasher.update(&block.height.to_be_bytes());
-        hasher.update(block.previous_hash.as_bytes());
-        hasher.update(block.merkle_root.as_bytes());
-        hasher.update(&block.timestamp.timestamp().to_be_bytes());
-        Ok(hex::encode(hasher.finalize()))
+        let round = self.round_of(block, parent);
+        if self.round_start(parent.header.timestamp, round) > latest {
+            return Err(anyhow!("Block {} proposed before round {} opened", height, round));
+        }
+
+        let (authority, key) = &self.schedule[self.proposer_index(height, round)];
+        if block.header.validator.address != authority.address {
+            return Err(anyhow!(
+                "Block {} proposed by {} out of turn (expected {})",
+                height,
+                block.header.validator.address,
+                authority.address
+            ));
+        }
+        verify_signature(&block.header, key)
     }
-    
-    /// Add validated block to blockchain
-    async fn add_block_to_chain(&self, block: Block) -> Result<()> {
-        let mut blockchain = self.blockchain.write().await;
-        blockchain.add_block(block).await?;
+
+    /// Add our block to the chain and announce it
+    async fn add_block_to_chain(&self, index: usize, block: &Block) -> Result<()> {
+        {
+            let blockchain = self.blockchain.read().await;
+            blockchain.add_block(block.clone()).await?;
+            let tx_ids: Vec<String> = block.transactions.iter().map(|tx| tx.id.clone()).collect();
+            blockchain.remove_pending_transactions(&tx_ids).await;
+        }
+        if let Some(network) = self.network.get() {
+            if let Err(e) = network.broadcast_block(block) {
+                tracing::warn!("Failed to announce block {}: {}", block.header.height, e);
+            }
+        }
+
+        let mut state = self.lock_state();
+        state.current_round += 1;
+        state.current_authority_index = index;
+        state.last_block_time = Some(block.header.timestamp);
+        state.next_height = block.header.height + 1;
         Ok(())
     }
-    
-    /// Update authority performance metrics
-    async fn update_authority_performance(&self, authority_address: &str, success: bool) -> Result<()> {
-        self.reputation_tracker.record_block_proposal(authority_address, success).await?;
-        Ok(())
+
+    /// Execute committed blocks in chain order for liveness and slashing.
+    ///
+    /// Runs on every node, authority or not, replaying the chain from genesis
+    /// so stakes and scores agree across nodes.
+    pub async fn follow_chain(&self) -> Result<()> {
+        let mut parent: Option<Block> = None;
+        loop {
+            let next = parent.as_ref().map_or(0, |block| block.header.height + 1);
+            let block = {
+                let blockchain = self.blockchain.read().await;
+                if next < blockchain.get_height().await? {
+                    Some(blockchain.get_block_by_height(next).await?)
+                } else {
+                    None
+                }
+            };
+            let Some(block) = block else {
+                tokio::time::sleep(POLL_INTERVAL).await;
+                continue;
+            };
+            if let Some(parent) = &parent {
+                if let Err(e) = self.execute_block(&block, parent).await {
+                    tracing::warn!("Liveness accounting failed for block {}: {}", next, e);
+                }
+            }
+            parent = Some(block);
+        }
     }
-    
-    /// Advance consensus state for next round
-    async fn advance_consensus_state(&self) -> Result<()> {
-        let mut state = self.state.write().await;
-        state.current_round += 1;
-        state.current_authority_index = (state.current_authority_index + 1) % 
-            self.authority_registry.get_authority_count().await;
-        state.last_block_time = Some(Utc::now());
+
+    /// Record slot outcomes for a committed block and apply any slashing.
+    ///
+    /// Misses, latency and evidence all come from the block and its parent,
+    /// so the outcome does not depend on what this node saw on the network.
+    async fn execute_block(&self, block: &Block, parent: &Block) -> Result<()> {
+        let header = &block.header;
+        let proposer = self.schedule_index(&header.validator.address).ok_or_else(|| {
+            anyhow!("Block {} proposed by unknown authority {}", header.height, header.validator.address)
+        })?;
+        let round = self.round_of(block, parent);
+
+        // In-turn authorities of the earlier rounds let their slot pass
+        for missed_round in 0..round.min(self.schedule.len() as u64) {
+            let index = self.proposer_index(header.height, missed_round);
+            if index == proposer {
+                continue;
+            }
+            let address = &self.schedule[index].0.address;
+            let misses = self.reputation_tracker.record_missed_slot(address).await;
+            if self.slashing.downtime_threshold > 0 && misses >= self.slashing.downtime_threshold {
+                self.reputation_tracker.reset_misses(address).await;
+                self.punish(address, self.slashing.downtime_slash_rate, "downtime", header.height)
+                    .await?;
+            }
+        }
+
+        let latency = (header.timestamp - self.round_start(parent.header.timestamp, round))
+            .num_milliseconds()
+            .max(0) as u64;
+        self.reputation_tracker
+            .record_block_proposal(&header.validator.address, latency)
+            .await;
+        self.authority_registry
+            .record_block(&header.validator.address, header.timestamp)
+            .await;
+
+        let evidence = liveness::decode_evidence(&header.extra_data).unwrap_or_else(|e| {
+            tracing::warn!("Ignoring evidence in block {}: {}", header.height, e);
+            Vec::new()
+        });
+        for evidence in &evidence {
+            self.apply_evidence(evidence, header.height).await?;
+        }
+
+        let mut equivocations = self.lock_equivocations();
+        if let Some(evidence) = equivocations.observe(header) {
+            tracing::warn!(
+                "Authority {} signed two blocks at height {}",
+                evidence.authority(),
+                evidence.height()
+            );
+        }
+        equivocations.prune(header.height.saturating_sub(EVIDENCE_HORIZON));
         Ok(())
     }
-    
-    /// Initialize authorities from configuration
-    async fn initialize_authorities(&self) -> Result<()> {
-        for initial_auth in &self.config.initial_authorities {
-            let authority = Authority {
-                address: initial_auth.address.clone(),
-                public_key: hex::decode(&initial_auth.public_key)?,
-                authority_type: initial_auth.authority_type.clone(),
-                license_number: initial_auth.license_number.clone(),
-                organization: initial_auth.organization.clone(),
-                stake_amount: self.config.authority_stake_requirement,
-                joined_at: Utc::now(),
-                last_block_time: None,
-                reputation_score: 1.0, // Start with perfect reputation
-                is_active: true,
-                performance: PerformanceMetrics::default(),
-            };
-            
-            self.authority_registry.add_authority(authority).await?;
+
+    /// Slash a double signer once, if the evidence holds and is recent enough
+    async fn apply_evidence(&self, evidence: &DoubleSignEvidence, height: u64) -> Result<()> {
+        let Some(index) = self.schedule_index(evidence.authority()) else {
+            return Ok(());
+        };
+        if evidence.height() + EVIDENCE_HORIZON < height {
+            return Ok(());
         }
-        
-        tracing::info!("Initialized {} authorities", self.config.initial_authorities.len());
+        if let Err(e) = evidence.verify(&self.schedule[index].1) {
+            tracing::warn!("Ignoring evidence in block {}: {}", height, e);
+            return Ok(());
+        }
+        if !self.lock_equivocations().mark_slashed(evidence.height(), evidence.authority()) {
+            return Ok(()); // punished by an earlier block
+        }
+        self.punish(evidence.authority(), self.slashing.double_sign_slash_rate, "double signing", height)
+            .await
+    }
+
+    async fn punish(&self, address: &str, rate: f64, offence: &str, height: u64) -> Result<()> {
+        let amount = self.authority_registry.slash(address, rate).await?;
+        tracing::warn!("Slashed {} stake from {} for {} at block {}", amount, address, offence, height);
         Ok(())
     }
+
+    fn schedule_index(&self, address: &str) -> Option<usize> {
+        self.schedule.iter().position(|(authority, _)| authority.address == address)
+    }
+
+    fn lock_equivocations(&self) -> std::sync::MutexGuard<'_, EquivocationIndex> {
+        self.equivocations.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn lock_state(&self) -> std::sync::MutexGuard<'_, POAState> {
+        self.state.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn lock_template(&self) -> std::sync::MutexGuard<'_, Option<BlockTemplate>> {
+        self.template.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
 }
 
-// Additional implementation methods for AuthorityRegistry, ReputationTracker, etc.
-// would continue here...
+impl ConsensusEngine for POAConsensusEngine {
+    fn validate_block(&self, block: &Block, previous_block: Option<&Block>) -> Result<bool> {
+        let result = match previous_block {
+            Some(parent) => self.verify_block(block, parent),
+            None => match block.validate(None) {
+                ValidationResult::Valid => Ok(()),
+                ValidationResult::Invalid(reason) => Err(anyhow!("{}", reason)),
+            },
+        };
+        if let Err(e) = &result {
+            tracing::warn!("Rejected block {}: {}", block.header.height, e);
+        }
+        Ok(result.is_ok())
+    }
+
+    /// In-turn authority for the next block
+    fn select_next_validator(&self) -> Result<String> {
+        let height = self.lock_state().next_height;
+        Ok(self.schedule[self.proposer_index(height, 0)].0.address.clone())
+    }
+
+    /// Every authority may propose any height once the ones before it time out
+    fn is_authorized(&self, authority: &str, _block_height: u64) -> Result<bool> {
+        Ok(self.schedule.iter().any(|(known, _)| known.address == authority))
+    }
+
+    fn get_config(&self) -> Result<ConsensusConfig> {
+        Ok(ConsensusConfig {
+            block_time: self.config.block_time_ms.div_ceil(1000),
+            round_timeout: self.config.proposer_timeout_ms.div_ceil(1000),
+            max_validators: self.schedule.len() as u64,
+            consensus_type: "poa".to_string(),
+        })
+    }
+
+    /// Index a validly signed header so a conflicting one becomes evidence
+    fn observe_header(&self, header: &BlockHeader) {
+        let Some(index) = self.schedule_index(&header.validator.address) else {
+            return;
+        };
+        let intact = header.calculate_hash().is_ok_and(|hash| hash == header.hash);
+        if !intact || verify_signature(header, &self.schedule[index].1).is_err() {
+            return;
+        }
+        if let Some(evidence) = self.lock_equivocations().observe(header) {
+            tracing::warn!(
+                "Authority {} signed two blocks at height {}",
+                evidence.authority(),
+                evidence.height()
+            );
+        }
+    }
+}
 
 impl AuthorityRegistry {
     pub fn new() -> Self {
@@ -548,16 +962,73 @@ impl AuthorityRegistry {
     pub async fn add_authority(&self, authority: Authority) -> Result<()> {
         let address = authority.address.clone();
         
+        self.pending_authorities.write().await.remove(&address);
         self.active_authorities.write().await.insert(address.clone(), authority);
         self.authority_order.write().await.push(address);
         
         Ok(())
     }
+
+    /// Queue a registration for governance review
+    pub async fn submit_registration(&self, registration: AuthorityRegistration) -> Result<()> {
+        if self.active_authorities.read().await.contains_key(&registration.address) {
+            return Err(anyhow!("Authority {} is already active", registration.address));
+        }
+        self.pending_authorities
+            .write()
+            .await
+            .insert(registration.address.clone(), registration);
+        Ok(())
+    }
+
+    /// Move an authority to the revoked set, keeping it for the audit trail
+    pub async fn revoke_authority(&self, address: &str) -> Result<Authority> {
+        let mut authority = self
+            .active_authorities
+            .write()
+            .await
+            .remove(address)
+            .ok_or_else(|| anyhow!("Authority not found"))?;
+        self.authority_order.write().await.retain(|known| known != address);
+        authority.is_active = false;
+        self.revoked_authorities
+            .write()
+            .await
+            .insert(address.to_string(), authority.clone());
+        Ok(authority)
+    }
+
+    /// Note a block produced by an authority
+    pub async fn record_block(&self, address: &str, at: DateTime<Utc>) {
+        if let Some(authority) = self.active_authorities.write().await.get_mut(address) {
+            authority.last_block_time = Some(at);
+            authority.performance.blocks_proposed += 1;
+            authority.performance.last_activity = Some(at);
+        }
+    }
     
+    /// Active authorities in round-robin order
     pub async fn get_active_authorities(&self) -> Vec<Authority> {
-        self.active_authorities.read().await.values().cloned().collect()
+        let active = self.active_authorities.read().await;
+        self.authority_order
+            .read()
+            .await
+            .iter()
+            .filter_map(|address| active.get(address).cloned())
+            .collect()
     }
     
+    /// Remove `rate` of an authority's stake, returning the amount taken
+    pub async fn slash(&self, address: &str, rate: f64) -> Result<u64> {
+        let mut active = self.active_authorities.write().await;
+        let authority = active
+            .get_mut(address)
+            .ok_or_else(|| anyhow!("Authority not found"))?;
+        let amount = liveness::slash_amount(authority.stake_amount, rate);
+        authority.stake_amount -= amount;
+        Ok(amount)
+    }
+
     pub async fn get_authority(&self, address: &str) -> Result<Authority> {
         self.active_authorities.read().await
             .get(address)
@@ -571,32 +1042,60 @@ impl AuthorityRegistry {
 }
 
 impl ReputationTracker {
-    pub fn new() -> Self {
+    pub fn new(latency_budget_ms: u64, downtime_threshold: u64) -> Self {
         Self {
-            performance_history: RwLock::new(HashMap::new()),
+            liveness: RwLock::new(HashMap::new()),
             weights: ReputationWeights::default(),
+            latency_budget_ms,
+            downtime_threshold,
         }
     }
-    
-    pub async fn record_block_proposal(&self, authority: &str, success: bool) -> Result<()> {
-        let record = PerformanceRecord {
-            timestamp: Utc::now(),
-            block_height: 0, // Would get from blockchain
-            response_time_ms: 1000, // Would measure actual response time
-            success,
-        };
-        
-        self.performance_history.write().await
+
+    pub fn weights(&self) -> &ReputationWeights {
+        &self.weights
+    }
+
+    /// Record a block proposed `latency_ms` after its round opened
+    pub async fn record_block_proposal(&self, authority: &str, latency_ms: u64) {
+        self.liveness
+            .write()
+            .await
             .entry(authority.to_string())
-            .or_insert_with(Vec::new)
-            .push(record);
-            
-        Ok(())
+            .or_insert_with(|| AuthorityLiveness::new(LIVENESS_WINDOW))
+            .record_proposal(latency_ms);
     }
-    
-    pub async fn is_authority_healthy(&self, authority: &str) -> Result<bool> {
-        // Simplified health check
-        Ok(true)
+
+    /// Record a missed slot, returning the authority's current run of misses
+    pub async fn record_missed_slot(&self, authority: &str) -> u64 {
+        self.liveness
+            .write()
+            .await
+            .entry(authority.to_string())
+            .or_insert_with(|| AuthorityLiveness::new(LIVENESS_WINDOW))
+            .record_miss()
+    }
+
+    pub async fn reset_misses(&self, authority: &str) {
+        if let Some(window) = self.liveness.write().await.get_mut(authority) {
+            window.reset_misses();
+        }
+    }
+
+    /// Weighted reputation over the authority's recent slots
+    pub async fn score(&self, authority: &str, community_rating: f64) -> f64 {
+        let liveness = self.liveness.read().await;
+        let score = |window: &AuthorityLiveness| {
+            window.score(&self.weights, self.latency_budget_ms, self.downtime_threshold, community_rating)
+        };
+        match liveness.get(authority) {
+            Some(window) => score(window),
+            // No slots yet means a clean record
+            None => score(&AuthorityLiveness::new(1)),
+        }
+    }
+
+    pub async fn is_authority_healthy(&self, authority: &str, community_rating: f64) -> bool {
+        self.score(authority, community_rating).await >= HEALTHY_SCORE
     }
 }
 
@@ -608,11 +1107,40 @@ impl AuthorityGovernance {
             config,
         }
     }
+
+    pub fn config(&self) -> &GovernanceConfig {
+        &self.config
+    }
+
+    pub async fn submit_proposal(&self, id: String, proposal: GovernanceProposal) -> Result<()> {
+        let mut proposals = self.proposals.write().await;
+        if proposals.contains_key(&id) {
+            return Err(anyhow!("Proposal {} already exists", id));
+        }
+        proposals.insert(id, proposal);
+        Ok(())
+    }
+
+    pub async fn record_vote(&self, vote: Vote) -> Result<()> {
+        if !self.proposals.read().await.contains_key(&vote.proposal_id) {
+            return Err(anyhow!("Unknown proposal {}", vote.proposal_id));
+        }
+        self.votes
+            .write()
+            .await
+            .entry(vote.proposal_id.clone())
+            .or_default()
+            .insert(vote.voter.clone(), vote);
+        Ok(())
+    }
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::blockchain::TransactionType;
+    use crate::config::AuthorityConfig;
+    use crate::storage::StorageManager;
     
     #[test]
     fn test_thai_authority_types() {
@@ -644,4 +1172,220 @@ mod tests {
         assert_eq!(authorities.len(), 1);
         assert_eq!(authorities[0].organization, "EGAT");
     }
+    fn authority_key(index: u8) -> SigningKey {
+        SigningKey::from_bytes(&[index + 1; 32])
+    }
+
+    fn four_authorities() -> POAConfig {
+        let initial_authorities = [
+            ThaiAuthorityType::EGAT,
+            ThaiAuthorityType::MEA,
+            ThaiAuthorityType::PEA,
+            ThaiAuthorityType::ERC,
+        ]
+        .into_iter()
+        .enumerate()
+        .map(|(index, authority_type)| AuthorityConfig {
+            public_key: hex::encode(authority_key(index as u8).verifying_key().as_bytes()),
+            organization: format!("{:?}", authority_type),
+            license_number: format!("LIC-{}", index),
+            authority_type,
+        })
+        .collect();
+        POAConfig {
+            initial_authorities,
+            ..POAConfig::default()
+        }
+    }
+
+    /// Genesis plus one pending transfer so proposed blocks are non-empty
+    async fn test_chain() -> (Arc<RwLock<Blockchain>>, Block) {
+        let mut chain = Blockchain::new(Arc::new(StorageManager::new_memory())).await.unwrap();
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("system".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        chain.add_genesis_block(genesis.clone()).await.unwrap();
+        let transfer = Transaction::new(
+            TransactionType::TokenTransfer {
+                amount: 10,
+                message: None,
+            },
+            "system".to_string(),
+            Some("alice".to_string()),
+            1,
+            1,
+        )
+        .unwrap();
+        chain.add_pending_transaction(transfer).await.unwrap();
+        (Arc::new(RwLock::new(chain)), genesis)
+    }
+
+    #[tokio::test]
+    async fn test_turns_rotate_by_height_and_round() {
+        let (blockchain, _) = test_chain().await;
+        let engine = POAConsensusEngine::with_signing_key(blockchain.clone(), four_authorities(), None)
+            .await
+            .unwrap();
+
+        assert_eq!(engine.proposer_index(1, 0), 1);
+        assert_eq!(engine.proposer_index(1, 1), 2);
+        assert_eq!(engine.proposer_index(3, 1), 0);
+
+        let parent = Utc::now();
+        let ms = Duration::milliseconds;
+        assert_eq!(engine.round_at(parent, parent + ms(1_000)), 0);
+        assert_eq!(engine.round_at(parent, parent + ms(6_500)), 1);
+        // In-turn proposer waits one block time, later ones one timeout per round
+        assert_eq!(engine.next_slot(1, 1, parent, parent), parent + ms(2_000));
+        assert_eq!(engine.next_slot(2, 1, parent, parent), parent + ms(6_000));
+        assert_eq!(engine.next_slot(0, 1, parent, parent), parent + ms(14_000));
+        assert_eq!(engine.next_slot(2, 1, parent, parent + ms(6_500)), parent + ms(6_500));
+        assert_eq!(engine.next_slot(2, 1, parent, parent + ms(10_500)), parent + ms(22_000));
+
+        let outsider = SigningKey::from_bytes(&[99; 32]);
+        assert!(POAConsensusEngine::with_signing_key(blockchain.clone(), four_authorities(), Some(outsider))
+            .await
+            .is_err());
+        assert!(POAConsensusEngine::with_signing_key(blockchain, POAConfig::default(), None)
+            .await
+            .is_err());
+    }
+
+    #[tokio::test]
+    async fn test_signed_blocks_are_checked_for_turn_and_signature() {
+        let (blockchain, genesis) = test_chain().await;
+        let engine =
+            POAConsensusEngine::with_signing_key(blockchain.clone(), four_authorities(), Some(authority_key(1)))
+                .await
+                .unwrap();
+        let (index, key) = engine.local.as_ref().unwrap();
+        assert_eq!(*index, 1);
+        let mut block = engine.propose_block(*index, key, &genesis).await.unwrap();
+        let slot = engine.round_start(genesis.header.timestamp, 0);
+        block.header.timestamp = slot;
+        block.header.hash = block.calculate_hash().unwrap();
+        sign_block(&mut block, key);
+        assert!(engine.verify_block_at(&block, &genesis, slot).is_ok());
+
+        let mut tampered = block.clone();
+        tampered.header.signature = hex::encode([0u8; 64]);
+        assert!(engine.verify_block_at(&tampered, &genesis, slot).is_err());
+
+        let out_of_turn = engine.propose_block(2, &authority_key(2), &genesis).await.unwrap();
+        assert!(engine.verify_block_at(&out_of_turn, &genesis, slot).is_err());
+
+        engine.add_block_to_chain(*index, &block).await.unwrap();
+        // An idle mempool still yields a block for the slot
+        let empty = engine.propose_block(2, &authority_key(2), &block).await.unwrap();
+        assert!(empty.transactions.is_empty());
+        assert!(empty.validate(Some(&block)).is_valid());
+        let chain = blockchain.read().await;
+        assert_eq!(chain.get_height().await.unwrap(), 2);
+        assert!(chain.get_pending_transactions(10).await.is_empty());
+        assert_eq!(engine.select_next_validator().unwrap(), engine.schedule[2].0.address);
+    }
+
+    #[tokio::test]
+    async fn test_prepared_template_is_used_only_on_its_parent() {
+        let (blockchain, genesis) = test_chain().await;
+        let engine =
+            POAConsensusEngine::with_signing_key(blockchain, four_authorities(), Some(authority_key(1)))
+                .await
+                .unwrap();
+        let key = authority_key(1);
+
+        engine.prepare_template(1, &genesis).await.unwrap();
+        let prepared_root = engine.lock_template().as_ref().unwrap().block.header.merkle_root.clone();
+        let block = engine.propose_block(1, &key, &genesis).await.unwrap();
+        assert!(engine.lock_template().is_none());
+        assert_eq!(block.header.merkle_root, prepared_root);
+        assert!(block.header.timestamp > genesis.header.timestamp);
+        let slot = engine.round_start(genesis.header.timestamp, 0);
+        assert!(engine.verify_block_at(&block, &genesis, slot).is_ok());
+
+        // A template on a stale parent is dropped and the block is built afresh
+        engine.prepare_template(1, &genesis).await.unwrap();
+        let next = engine.propose_block(1, &key, &block).await.unwrap();
+        assert_eq!(next.header.previous_hash, block.header.hash);
+        assert_eq!(next.header.height, 2);
+    }
+
+    #[tokio::test]
+    async fn test_committed_blocks_drive_liveness_and_slashing() {
+        let (blockchain, genesis) = test_chain().await;
+        let slashing = SlashingConfig {
+            double_sign_slash_rate: 0.05,
+            downtime_slash_rate: 0.01,
+            downtime_threshold: 1,
+        };
+        let engine = POAConsensusEngine::with_signing_key(blockchain, four_authorities(), None)
+            .await
+            .unwrap()
+            .with_slashing(slashing);
+        let address = |index: usize| engine.schedule[index].0.address.clone();
+        let stake = |index: usize| {
+            let registry = engine.registry().clone();
+            let address = address(index);
+            async move { registry.get_authority(&address).await.unwrap().stake_amount }
+        };
+
+        // Authority 1 lets round 0 of height 1 pass; authority 2 proposes 10ms into round 1
+        let mut late = engine.propose_block(2, &authority_key(2), &genesis).await.unwrap();
+        late.header.timestamp = engine.round_start(genesis.header.timestamp, 1) + Duration::milliseconds(10);
+        late.header.hash = late.calculate_hash().unwrap();
+        sign_block(&mut late, &authority_key(2));
+        assert!(engine.verify_block_at(&late, &genesis, late.header.timestamp).is_ok());
+        engine.execute_block(&late, &genesis).await.unwrap();
+        assert_eq!(stake(1).await, 990_000);
+        assert_eq!(stake(2).await, 1_000_000);
+        let missed = engine.reputation_tracker.score(&address(1), 1.0).await;
+        assert!((missed - 0.6).abs() < 1e-9);
+        assert!(engine.is_authority_healthy(&address(2)).await.unwrap());
+
+        // Authority 0 signs two different blocks for height 1
+        let first = engine.propose_block(0, &authority_key(0), &genesis).await.unwrap();
+        let mut second = first.clone();
+        second.header.timestamp += Duration::milliseconds(1);
+        second.header.hash = second.calculate_hash().unwrap();
+        sign_block(&mut second, &authority_key(0));
+        engine.observe_header(&first.header);
+        engine.observe_header(&second.header);
+        assert_eq!(engine.lock_equivocations().pending().len(), 1);
+
+        // The next block carries the evidence and executing it slashes once
+        let carrier = engine.propose_block(2, &authority_key(2), &late).await.unwrap();
+        assert!(!carrier.header.extra_data.is_empty());
+        engine.execute_block(&carrier, &late).await.unwrap();
+        engine.execute_block(&carrier, &late).await.unwrap();
+        assert_eq!(stake(0).await, 950_000);
+        assert!(engine.lock_equivocations().pending().is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_blocks_from_the_future_are_rejected() {
+        let (blockchain, genesis) = test_chain().await;
+        let engine = POAConsensusEngine::with_signing_key(blockchain, four_authorities(), None)
+            .await
+            .unwrap();
+        let slot = engine.round_start(genesis.header.timestamp, 0);
+
+        // Authority 2 stamps its block into round 1 while round 0 is still running
+        let mut early = engine.propose_block(2, &authority_key(2), &genesis).await.unwrap();
+        early.header.timestamp = engine.round_start(genesis.header.timestamp, 1);
+        early.header.hash = early.calculate_hash().unwrap();
+        sign_block(&mut early, &authority_key(2));
+        assert!(engine.verify_block_at(&early, &genesis, slot).is_err());
+        assert!(engine.verify_block_at(&early, &genesis, early.header.timestamp).is_ok());
+
+        // A block stamped before its round opened is rejected until the round opens
+        let mut eager = engine.propose_block(1, &authority_key(1), &genesis).await.unwrap();
+        eager.header.timestamp = genesis.header.timestamp + Duration::milliseconds(1);
+        eager.header.hash = eager.calculate_hash().unwrap();
+        sign_block(&mut eager, &authority_key(1));
+        assert!(engine.verify_block_at(&eager, &genesis, eager.header.timestamp).is_err());
+        assert!(engine.verify_block_at(&eager, &genesis, slot).is_ok());
+    }
 }
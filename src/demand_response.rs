@@ -0,0 +1,682 @@
+//! GridTokenX Demand Response Module
+//!
+//! This module implements demand-response dispatch for grid emergencies and
+//! stability events. Participating prosumers are kept in per-zone indexes sorted
+//! by available flexibility, so an event selects its participants without
+//! scanning accounts. Dispatch signals are pushed to subscribers over a broadcast
+//! channel, and compensation for delivered flexibility is settled afterwards in
+//! a single batch of token transfers. Payouts the pending pool does not admit
+//! stay outstanding and are retried on the next settlement.
+
+use anyhow::{anyhow, Result};
+use chrono::{DateTime, Utc};
+use serde::{Deserialize, Serialize};
+use std::cmp::Reverse;
+use std::collections::{BTreeMap, BTreeSet, HashMap};
+use std::sync::Arc;
+use tokio::sync::{broadcast, Mutex, RwLock};
+
+use crate::blockchain::transaction::EmergencyType;
+use crate::blockchain::{Account, Blockchain, Transaction, TransactionType};
+use crate::config::DemandResponseConfig;
+
+/// Direction of the flexibility being requested
+#[derive(Debug, Clone, Copy, Serialize, Deserialize, PartialEq, Eq, Hash)]
+pub enum DispatchKind {
+    /// Consumers reduce their load
+    LoadCurtailment,
+    /// Producers raise their output
+    GenerationIncrease,
+}
+
+/// Request to dispatch a demand-response event
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DispatchRequest {
+    /// Grid zone the event applies to
+    pub zone: String,
+    /// Requested flexibility direction
+    pub kind: DispatchKind,
+    /// Flexibility needed (kWh)
+    pub target_kwh: f64,
+    /// Event start
+    pub start: DateTime<Utc>,
+    /// Event end
+    pub end: DateTime<Utc>,
+    /// Emergency that triggered the event, if any
+    pub reason: Option<EmergencyType>,
+}
+
+/// Flexibility assigned to one participant
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub struct DispatchAssignment {
+    pub address: String,
+    pub assigned_kwh: f64,
+}
+
+/// Signal broadcast to subscribers when an event is dispatched
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DispatchSignal {
+    pub event_id: String,
+    pub zone: String,
+    pub kind: DispatchKind,
+    pub start: DateTime<Utc>,
+    pub end: DateTime<Utc>,
+    pub reason: Option<EmergencyType>,
+    pub assignments: Vec<DispatchAssignment>,
+    pub issued_at: DateTime<Utc>,
+}
+
+/// Demand-response event lifecycle
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub enum EventStatus {
+    Dispatched,
+    Settled,
+}
+
+/// Dispatched event with delivery reports
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DemandResponseEvent {
+    pub signal: DispatchSignal,
+    pub target_kwh: f64,
+    pub delivered: HashMap<String, f64>,
+    pub status: EventStatus,
+}
+
+impl DemandResponseEvent {
+    /// Total flexibility assigned to participants (kWh)
+    pub fn assigned_kwh(&self) -> f64 {
+        self.signal.assignments.iter().map(|a| a.assigned_kwh).sum()
+    }
+}
+
+/// Compensation computed for a batch of completed events
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct SettlementBatch {
+    /// Settled event identifiers
+    pub event_ids: Vec<String>,
+    /// Compensation per participant (tokens)
+    pub payouts: BTreeMap<String, u64>,
+}
+
+impl SettlementBatch {
+    /// Total tokens paid out by the batch
+    pub fn total_tokens(&self) -> u64 {
+        self.payouts.values().sum()
+    }
+}
+
+/// Enrolled participant
+#[derive(Debug, Clone)]
+struct Participant {
+    zone: String,
+    load_flex_wh: u64,
+    generation_flex_wh: u64,
+    busy_until: Option<DateTime<Utc>>,
+}
+
+/// Zone index ordered by descending flexibility, then address for determinism
+type FlexIndex = BTreeMap<String, BTreeSet<(Reverse<u64>, String)>>;
+
+/// Participant indexes and event book
+#[derive(Debug)]
+pub struct DispatchBook {
+    config: DemandResponseConfig,
+    participants: HashMap<String, Participant>,
+    load_index: FlexIndex,
+    generation_index: FlexIndex,
+    events: HashMap<String, DemandResponseEvent>,
+}
+
+impl DispatchBook {
+    pub fn new(config: DemandResponseConfig) -> Self {
+        Self {
+            config,
+            participants: HashMap::new(),
+            load_index: BTreeMap::new(),
+            generation_index: BTreeMap::new(),
+            events: HashMap::new(),
+        }
+    }
+
+    /// Enroll an account in a zone, or refresh its flexibility if already enrolled
+    pub fn enroll(&mut self, account: &Account, zone: &str) {
+        let busy_until = self.withdraw(&account.address).and_then(|p| p.busy_until);
+
+        let participant = Participant {
+            zone: zone.to_string(),
+            load_flex_wh: self.flex_wh(account.energy_consumption_demand),
+            generation_flex_wh: self.flex_wh(account.energy_production_capacity),
+            busy_until,
+        };
+        Self::index_insert(&mut self.load_index, &participant.zone, participant.load_flex_wh, &account.address);
+        Self::index_insert(
+            &mut self.generation_index,
+            &participant.zone,
+            participant.generation_flex_wh,
+            &account.address,
+        );
+        self.participants.insert(account.address.clone(), participant);
+    }
+
+    /// Refresh flexibility from an updated account; ignored if not enrolled
+    pub fn update_flexibility(&mut self, account: &Account) {
+        if let Some(zone) = self.participants.get(&account.address).map(|p| p.zone.clone()) {
+            self.enroll(account, &zone);
+        }
+    }
+
+    /// Remove a participant from all indexes
+    fn withdraw(&mut self, address: &str) -> Option<Participant> {
+        let participant = self.participants.remove(address)?;
+        Self::index_remove(&mut self.load_index, &participant.zone, participant.load_flex_wh, address);
+        Self::index_remove(
+            &mut self.generation_index,
+            &participant.zone,
+            participant.generation_flex_wh,
+            address,
+        );
+        Some(participant)
+    }
+
+    /// Number of enrolled participants
+    pub fn participant_count(&self) -> usize {
+        self.participants.len()
+    }
+
+    /// Available flexibility in a zone (kWh)
+    pub fn zone_flexibility(&self, zone: &str, kind: DispatchKind) -> f64 {
+        self.index(kind)
+            .get(zone)
+            .map(|set| set.iter().map(|(Reverse(wh), _)| *wh).sum::<u64>())
+            .unwrap_or(0) as f64
+            / 1000.0
+    }
+
+    /// Select participants for a request, largest flexibility first, and record the event
+    pub fn dispatch(&mut self, request: &DispatchRequest) -> Result<DispatchSignal> {
+        if !request.target_kwh.is_finite() || request.target_kwh <= 0.0 {
+            return Err(anyhow!("Dispatch target must be positive"));
+        }
+        if request.start >= request.end {
+            return Err(anyhow!("Invalid dispatch window"));
+        }
+
+        let mut remaining_wh = (request.target_kwh * 1000.0).ceil() as u64;
+        let mut assignments = Vec::new();
+
+        if let Some(candidates) = self.index(request.kind).get(&request.zone) {
+            for (Reverse(flex_wh), address) in candidates {
+                if remaining_wh == 0 {
+                    break;
+                }
+                let busy = self.participants[address]
+                    .busy_until
+                    .is_some_and(|until| until > request.start);
+                if busy {
+                    continue;
+                }
+
+                let assigned_wh = (*flex_wh).min(remaining_wh);
+                remaining_wh -= assigned_wh;
+                assignments.push(DispatchAssignment {
+                    address: address.clone(),
+                    assigned_kwh: assigned_wh as f64 / 1000.0,
+                });
+            }
+        }
+
+        if assignments.is_empty() {
+            return Err(anyhow!("No available flexibility in zone {}", request.zone));
+        }
+        if remaining_wh > 0 {
+            tracing::warn!(
+                "Demand response in {} short by {:.3} kWh",
+                request.zone,
+                remaining_wh as f64 / 1000.0
+            );
+        }
+
+        for assignment in &assignments {
+            if let Some(participant) = self.participants.get_mut(&assignment.address) {
+                participant.busy_until = Some(request.end);
+            }
+        }
+
+        let signal = DispatchSignal {
+            event_id: uuid::Uuid::new_v4().to_string(),
+            zone: request.zone.clone(),
+            kind: request.kind,
+            start: request.start,
+            end: request.end,
+            reason: request.reason.clone(),
+            assignments,
+            issued_at: Utc::now(),
+        };
+        self.events.insert(
+            signal.event_id.clone(),
+            DemandResponseEvent {
+                signal: signal.clone(),
+                target_kwh: request.target_kwh,
+                delivered: HashMap::new(),
+                status: EventStatus::Dispatched,
+            },
+        );
+        Ok(signal)
+    }
+
+    /// Record metered delivery for a participant in an event
+    pub fn report_delivery(&mut self, event_id: &str, address: &str, delivered_kwh: f64) -> Result<()> {
+        let event = self
+            .events
+            .get_mut(event_id)
+            .ok_or_else(|| anyhow!("Unknown demand-response event {}", event_id))?;
+        if event.status != EventStatus::Dispatched {
+            return Err(anyhow!("Event {} already settled", event_id));
+        }
+        if !event.signal.assignments.iter().any(|a| a.address == address) {
+            return Err(anyhow!("{} was not dispatched in event {}", address, event_id));
+        }
+        if !delivered_kwh.is_finite() || delivered_kwh < 0.0 {
+            return Err(anyhow!("Delivered energy must be non-negative"));
+        }
+        event.delivered.insert(address.to_string(), delivered_kwh);
+        Ok(())
+    }
+
+    /// Settle every event that ended at or before `now`.
+    ///
+    /// Delivery is capped at the assigned amount, and payouts are aggregated per
+    /// participant across all events so each participant receives one transfer.
+    pub fn settle_completed(&mut self, now: DateTime<Utc>) -> SettlementBatch {
+        let mut batch = SettlementBatch::default();
+
+        for (event_id, event) in self.events.iter_mut() {
+            if event.status != EventStatus::Dispatched || event.signal.end > now {
+                continue;
+            }
+            for assignment in &event.signal.assignments {
+                let delivered = event
+                    .delivered
+                    .get(&assignment.address)
+                    .copied()
+                    .unwrap_or(0.0)
+                    .min(assignment.assigned_kwh);
+                let tokens = (delivered * self.config.compensation_per_kwh as f64) as u64;
+                if tokens > 0 {
+                    *batch.payouts.entry(assignment.address.clone()).or_default() += tokens;
+                }
+            }
+            event.status = EventStatus::Settled;
+            batch.event_ids.push(event_id.clone());
+        }
+
+        for participant in self.participants.values_mut() {
+            if participant.busy_until.is_some_and(|until| until <= now) {
+                participant.busy_until = None;
+            }
+        }
+
+        batch
+    }
+
+    /// Drop settled events that ended before `before`; returns how many were removed
+    pub fn prune_settled(&mut self, before: DateTime<Utc>) -> usize {
+        let count = self.events.len();
+        self.events
+            .retain(|_, event| event.status != EventStatus::Settled || event.signal.end >= before);
+        count - self.events.len()
+    }
+
+    /// Get an event by id
+    pub fn get_event(&self, event_id: &str) -> Option<&DemandResponseEvent> {
+        self.events.get(event_id)
+    }
+
+    fn flex_wh(&self, kwh: f64) -> u64 {
+        if !kwh.is_finite() || kwh < self.config.min_flexibility_kwh {
+            0
+        } else {
+            (kwh * 1000.0).round() as u64
+        }
+    }
+
+    fn index(&self, kind: DispatchKind) -> &FlexIndex {
+        match kind {
+            DispatchKind::LoadCurtailment => &self.load_index,
+            DispatchKind::GenerationIncrease => &self.generation_index,
+        }
+    }
+
+    fn index_insert(index: &mut FlexIndex, zone: &str, flex_wh: u64, address: &str) {
+        if flex_wh > 0 {
+            index
+                .entry(zone.to_string())
+                .or_default()
+                .insert((Reverse(flex_wh), address.to_string()));
+        }
+    }
+
+    fn index_remove(index: &mut FlexIndex, zone: &str, flex_wh: u64, address: &str) {
+        if let Some(set) = index.get_mut(zone) {
+            set.remove(&(Reverse(flex_wh), address.to_string()));
+            if set.is_empty() {
+                index.remove(zone);
+            }
+        }
+    }
+}
+
+/// Demand-response engine
+#[derive(Debug)]
+pub struct DemandResponseEngine {
+    blockchain: Arc<RwLock<Blockchain>>,
+    config: DemandResponseConfig,
+    book: RwLock<DispatchBook>,
+    signals: broadcast::Sender<Arc<DispatchSignal>>,
+    /// Compensation owed but not yet admitted to the pending pool (tokens)
+    outstanding: Mutex<BTreeMap<String, u64>>,
+}
+
+impl DemandResponseEngine {
+    /// Create new demand-response engine
+    pub fn new(blockchain: Arc<RwLock<Blockchain>>, config: DemandResponseConfig) -> Self {
+        let (signals, _) = broadcast::channel(config.signal_buffer.max(1));
+        Self {
+            blockchain,
+            book: RwLock::new(DispatchBook::new(config.clone())),
+            config,
+            signals,
+            outstanding: Mutex::new(BTreeMap::new()),
+        }
+    }
+
+    /// Subscribe to dispatch signals
+    pub fn subscribe(&self) -> broadcast::Receiver<Arc<DispatchSignal>> {
+        self.signals.subscribe()
+    }
+
+    /// Enroll an on-chain account as a participant in a zone
+    pub async fn enroll(&self, address: &str, zone: &str) -> Result<()> {
+        let account = self
+            .blockchain
+            .read()
+            .await
+            .get_account(address)
+            .await
+            .ok_or_else(|| anyhow!("Account not found: {}", address))?;
+
+        self.book.write().await.enroll(&account, zone);
+        tracing::info!("Demand-response participant enrolled: {} in {}", address, zone);
+        Ok(())
+    }
+
+    /// Refresh a participant's flexibility after its account changed
+    pub async fn refresh_participant(&self, address: &str) {
+        let account = self.blockchain.read().await.get_account(address).await;
+        if let Some(account) = account {
+            self.book.write().await.update_flexibility(&account);
+        }
+    }
+
+    /// Select participants and broadcast the dispatch signal
+    pub async fn dispatch(&self, request: DispatchRequest) -> Result<Arc<DispatchSignal>> {
+        if !self.config.enabled {
+            return Err(anyhow!("Demand response is disabled"));
+        }
+
+        let signal = Arc::new(self.book.write().await.dispatch(&request)?);
+
+        // A send error only means there are no subscribers right now
+        let receivers = self.signals.send(signal.clone()).unwrap_or(0);
+        tracing::info!(
+            "Demand-response event {} dispatched to {} participants ({} subscribers)",
+            signal.event_id,
+            signal.assignments.len(),
+            receivers
+        );
+        Ok(signal)
+    }
+
+    /// Record metered delivery for a participant
+    pub async fn report_delivery(&self, event_id: &str, address: &str, delivered_kwh: f64) -> Result<()> {
+        self.book
+            .write()
+            .await
+            .report_delivery(event_id, address, delivered_kwh)
+    }
+
+    /// Settle completed events and submit one compensation transfer per participant.
+    ///
+    /// Payouts join those still outstanding from earlier settlements and leave
+    /// only once the pending pool admits them, each with the settlement
+    /// account's next nonce.
+    pub async fn settle(&self) -> Result<SettlementBatch> {
+        let now = Utc::now();
+        let batch = {
+            let mut book = self.book.write().await;
+            let batch = book.settle_completed(now);
+            let retention = chrono::Duration::hours(self.config.event_retention_hours as i64);
+            book.prune_settled(now - retention);
+            batch
+        };
+
+        let mut outstanding = self.outstanding.lock().await;
+        for (address, tokens) in &batch.payouts {
+            *outstanding.entry(address.clone()).or_default() += tokens;
+        }
+        if outstanding.is_empty() {
+            return Ok(batch);
+        }
+
+        let blockchain = self.blockchain.read().await;
+        let mut admitted = Vec::new();
+        for (address, tokens) in outstanding.iter() {
+            let nonce = blockchain.next_nonce(&self.config.settlement_account).await;
+            let tx = Transaction::new(
+                TransactionType::TokenTransfer {
+                    amount: *tokens,
+                    message: Some("Demand-response compensation".to_string()),
+                },
+                self.config.settlement_account.clone(),
+                Some(address.clone()),
+                0,
+                nonce,
+            )?;
+            match blockchain.add_pending_transaction(tx).await {
+                Ok(()) => admitted.push(address.clone()),
+                Err(e) => tracing::warn!(
+                    "Demand-response payout of {} to {} not admitted, will retry: {}",
+                    tokens,
+                    address,
+                    e
+                ),
+            }
+        }
+        for address in &admitted {
+            outstanding.remove(address);
+        }
+
+        tracing::info!(
+            "Settled {} demand-response events, {} payouts admitted, {} outstanding",
+            batch.event_ids.len(),
+            admitted.len(),
+            outstanding.len()
+        );
+        Ok(batch)
+    }
+
+    /// Compensation owed but not yet admitted to the pending pool
+    pub async fn outstanding_payouts(&self) -> BTreeMap<String, u64> {
+        self.outstanding.lock().await.clone()
+    }
+
+    /// Settle completed events every configured interval
+    pub async fn run_settlement(self: Arc<Self>) {
+        let period = std::time::Duration::from_secs(self.config.settlement_interval_secs.max(1));
+        let mut ticker = tokio::time::interval(period);
+        loop {
+            ticker.tick().await;
+            if let Err(e) = self.settle().await {
+                tracing::warn!("Demand-response settlement failed: {}", e);
+            }
+        }
+    }
+
+    /// Get an event by id
+    pub async fn get_event(&self, event_id: &str) -> Option<DemandResponseEvent> {
+        self.book.read().await.get_event(event_id).cloned()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::{AccountType, ComplianceStatus};
+
+    fn account(address: &str, demand: f64, capacity: f64) -> Account {
+        Account {
+            address: address.to_string(),
+            token_balance: 0,
+            energy_production_capacity: capacity,
+            energy_consumption_demand: demand,
+            account_type: AccountType::Consumer,
+            carbon_credits: 0.0,
+            reputation_score: 50.0,
+            registered_at: Utc::now(),
+            last_activity: Utc::now(),
+            compliance_status: ComplianceStatus::Compliant,
+        }
+    }
+
+    fn curtailment(zone: &str, target_kwh: f64) -> DispatchRequest {
+        DispatchRequest {
+            zone: zone.to_string(),
+            kind: DispatchKind::LoadCurtailment,
+            target_kwh,
+            start: Utc::now(),
+            end: Utc::now() + chrono::Duration::minutes(30),
+            reason: Some(EmergencyType::GridFailure),
+        }
+    }
+
+    #[test]
+    fn test_dispatch_selects_largest_flexibility_in_zone() {
+        let mut book = DispatchBook::new(DemandResponseConfig::default());
+        book.enroll(&account("small", 2.0, 0.0), "BKK-01");
+        book.enroll(&account("large", 10.0, 0.0), "BKK-01");
+        book.enroll(&account("other_zone", 50.0, 0.0), "CNX-01");
+        book.enroll(&account("producer", 0.0, 20.0), "BKK-01");
+
+        let signal = book.dispatch(&curtailment("BKK-01", 11.0)).unwrap();
+        assert_eq!(
+            signal.assignments,
+            vec![
+                DispatchAssignment { address: "large".to_string(), assigned_kwh: 10.0 },
+                DispatchAssignment { address: "small".to_string(), assigned_kwh: 1.0 },
+            ]
+        );
+
+        // Both participants are committed until the event ends
+        assert!(book.dispatch(&curtailment("BKK-01", 1.0)).is_err());
+        assert_eq!(book.zone_flexibility("BKK-01", DispatchKind::GenerationIncrease), 20.0);
+    }
+
+    #[test]
+    fn test_settlement_caps_delivery_and_batches_payouts() {
+        let mut book = DispatchBook::new(DemandResponseConfig::default());
+        book.enroll(&account("a", 4.0, 0.0), "BKK-01");
+        book.enroll(&account("b", 4.0, 0.0), "BKK-01");
+
+        let signal = book.dispatch(&curtailment("BKK-01", 6.0)).unwrap();
+        book.report_delivery(&signal.event_id, "a", 9.0).unwrap();
+        book.report_delivery(&signal.event_id, "b", 1.5).unwrap();
+        assert!(book.report_delivery(&signal.event_id, "c", 1.0).is_err());
+
+        // Nothing is settled before the event window closes
+        assert!(book.settle_completed(Utc::now()).event_ids.is_empty());
+
+        let batch = book.settle_completed(signal.end);
+        assert_eq!(batch.event_ids, vec![signal.event_id.clone()]);
+        assert_eq!(batch.payouts["a"], 20); // capped at 4 kWh assigned
+        assert_eq!(batch.payouts["b"], 7); // 1.5 kWh of 2 kWh assigned
+        assert_eq!(book.get_event(&signal.event_id).unwrap().status, EventStatus::Settled);
+    }
+
+    #[test]
+    fn test_settled_events_are_pruned() {
+        let mut book = DispatchBook::new(DemandResponseConfig::default());
+        book.enroll(&account("a", 4.0, 0.0), "BKK-01");
+        let signal = book.dispatch(&curtailment("BKK-01", 1.0)).unwrap();
+
+        // Dispatched events are never pruned
+        assert_eq!(book.prune_settled(signal.end + chrono::Duration::hours(1)), 0);
+
+        book.settle_completed(signal.end);
+        assert_eq!(book.prune_settled(signal.end), 0);
+        assert_eq!(book.prune_settled(signal.end + chrono::Duration::seconds(1)), 1);
+        assert!(book.get_event(&signal.event_id).is_none());
+    }
+
+    #[tokio::test]
+    async fn test_engine_broadcasts_and_retries_unadmitted_payouts() {
+        use crate::blockchain::Block;
+        use crate::storage::StorageManager;
+
+        let storage = Arc::new(StorageManager::new_memory());
+        storage
+            .store_account_state(&[account("a", 4.0, 0.0)], &[], &[])
+            .await
+            .unwrap();
+        let blockchain = Arc::new(RwLock::new(Blockchain::new(storage).await.unwrap()));
+        let config = DemandResponseConfig::default();
+        let pool = config.settlement_account.clone();
+        let engine = DemandResponseEngine::new(blockchain.clone(), config);
+
+        let mut signals = engine.subscribe();
+        engine.enroll("a", "BKK-01").await.unwrap();
+        let mut request = curtailment("BKK-01", 2.0);
+        request.start = Utc::now() - chrono::Duration::minutes(30);
+        request.end = Utc::now() - chrono::Duration::minutes(1);
+        let signal = engine.dispatch(request).await.unwrap();
+
+        let received = signals.recv().await.unwrap();
+        assert_eq!(received.event_id, signal.event_id);
+        assert_eq!(received.assignments[0].address, "a");
+
+        engine.report_delivery(&signal.event_id, "a", 2.0).await.unwrap();
+
+        // The pool account does not exist yet, so the payout stays outstanding
+        let batch = engine.settle().await.unwrap();
+        assert_eq!(batch.payouts["a"], 10);
+        assert_eq!(engine.outstanding_payouts().await["a"], 10);
+        assert!(blockchain.read().await.get_pending_transactions(10).await.is_empty());
+
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint(pool.clone(), 1_000, "Pool".to_string()).unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        blockchain.write().await.add_genesis_block(genesis).await.unwrap();
+
+        // Retried on the next settlement even though no new event completed
+        let batch = engine.settle().await.unwrap();
+        assert!(batch.event_ids.is_empty());
+        assert!(engine.outstanding_payouts().await.is_empty());
+        let pending = blockchain.read().await.get_pending_transactions(10).await;
+        assert_eq!(pending.len(), 1);
+        assert_eq!(pending[0].nonce, 0);
+        assert_eq!(blockchain.read().await.next_nonce(&pool).await, 1);
+    }
+
+    #[test]
+    fn test_update_flexibility_reindexes() {
+        let mut book = DispatchBook::new(DemandResponseConfig::default());
+        book.enroll(&account("a", 4.0, 0.0), "BKK-01");
+        book.update_flexibility(&account("a", 0.1, 0.0)); // below minimum
+        book.update_flexibility(&account("unknown", 5.0, 0.0));
+
+        assert_eq!(book.participant_count(), 1);
+        assert_eq!(book.zone_flexibility("BKK-01", DispatchKind::LoadCurtailment), 0.0);
+        assert!(book.dispatch(&curtailment("BKK-01", 1.0)).is_err());
+    }
+}
@@ -249,6 +249,12 @@ impl EnergyTrading {
         Ok(())
     }
 
+    /// Forecast supply available for matching in the 15-minute slot containing `at`
+    pub async fn forecast_supply(&self, at: DateTime<Utc>) -> f64 {
+        let blockchain = self.blockchain.read().await;
+        blockchain.get_total_supply_forecast(at).await
+    }
+
     /// Get energy trading metrics
     pub async fn get_metrics(&self) -> Result<EnergyMetrics> {
         let order_book = self.order_book.read().await;
@@ -0,0 +1,322 @@
+//! GridTokenX Energy Forecasting Module
+//!
+//! This module fits per-producer diurnal supply profiles from historical sell
+//! orders. Each profile is a fixed array of 96 fifteen-minute slots (Thai local
+//! time), updated once per day with an exponentially weighted moving average, so
+//! order-placement tooling and capacity planning can read a forecast with a
+//! single hash lookup and array index. Orders are grouped by the day they were
+//! seen on chain, so day-ahead and same-day orders accumulate together; slots
+//! come from the delivery window.
+
+use chrono::{DateTime, Utc};
+use std::collections::HashMap;
+
+use crate::blockchain::transaction::{EnergyOrderType, EnergyTransaction};
+
+/// Number of 15-minute slots in a day
+pub const SLOTS_PER_DAY: usize = 96;
+
+/// Slot length in seconds
+const SLOT_SECS: i64 = 900;
+
+/// Thailand is UTC+7 all year round
+const THAI_UTC_OFFSET_SECS: i64 = 7 * 3600;
+
+/// Default weight of the most recent day in the profile average
+pub const DEFAULT_SMOOTHING: f32 = 0.3;
+
+/// Producers without a sell order for this many days are dropped
+pub const MAX_IDLE_DAYS: i64 = 30;
+
+/// Local day index and slot for a timestamp
+pub fn day_and_slot(timestamp: DateTime<Utc>) -> (i64, usize) {
+    let local = timestamp.timestamp() + THAI_UTC_OFFSET_SECS;
+    let day = local.div_euclid(86_400);
+    let slot = (local.rem_euclid(86_400) / SLOT_SECS) as usize;
+    (day, slot)
+}
+
+/// Diurnal supply profile for one producer
+#[derive(Debug, Clone)]
+pub struct DiurnalProfile {
+    /// Expected supply per slot (kWh)
+    slots: [f32; SLOTS_PER_DAY],
+    /// Supply observed so far in the day being accumulated (kWh)
+    open_day_slots: [f32; SLOTS_PER_DAY],
+    /// Local day index being accumulated
+    open_day: i64,
+    /// Last local day the producer placed a sell order
+    last_active_day: i64,
+    /// Number of days folded into the profile
+    days_observed: u32,
+}
+
+impl DiurnalProfile {
+    fn new(open_day: i64) -> Self {
+        Self {
+            slots: [0.0; SLOTS_PER_DAY],
+            open_day_slots: [0.0; SLOTS_PER_DAY],
+            open_day,
+            last_active_day: open_day,
+            days_observed: 0,
+        }
+    }
+
+    /// Expected supply for a slot (kWh)
+    pub fn slot(&self, slot: usize) -> f64 {
+        self.slots[slot % SLOTS_PER_DAY] as f64
+    }
+
+    /// Expected daily supply (kWh)
+    pub fn daily_total(&self) -> f64 {
+        self.slots.iter().map(|v| *v as f64).sum()
+    }
+
+    /// Number of completed days the profile was fitted on
+    pub fn days_observed(&self) -> u32 {
+        self.days_observed
+    }
+}
+
+/// Per-producer forecast cache with a network-wide aggregate profile
+#[derive(Debug, Clone)]
+pub struct ForecastCache {
+    profiles: HashMap<String, DiurnalProfile>,
+    /// Sum of all producer profiles, kept in step with each fold
+    aggregate: [f64; SLOTS_PER_DAY],
+    /// Latest local day seen across all producers
+    current_day: Option<i64>,
+    smoothing: f32,
+}
+
+impl ForecastCache {
+    pub fn new(smoothing: f32) -> Self {
+        Self {
+            profiles: HashMap::new(),
+            aggregate: [0.0; SLOTS_PER_DAY],
+            current_day: None,
+            smoothing: smoothing.clamp(0.01, 1.0),
+        }
+    }
+
+    /// Record a producer's sell order seen at `seen_at`; other order types carry
+    /// no supply signal
+    pub fn observe_trade(&mut self, producer: &str, energy_tx: &EnergyTransaction, seen_at: DateTime<Utc>) {
+        if energy_tx.order_type != EnergyOrderType::Sell {
+            return;
+        }
+        self.observe_supply(
+            producer,
+            seen_at,
+            energy_tx.delivery_window.start_time,
+            energy_tx.delivery_window.end_time,
+            energy_tx.energy_amount,
+        );
+    }
+
+    /// Record supply delivered evenly over `[start, end)`, offered on the day of `seen_at`
+    pub fn observe_supply(
+        &mut self,
+        producer: &str,
+        seen_at: DateTime<Utc>,
+        start: DateTime<Utc>,
+        end: DateTime<Utc>,
+        energy_kwh: f64,
+    ) {
+        if !energy_kwh.is_finite() || energy_kwh <= 0.0 {
+            return;
+        }
+
+        let (day, _) = day_and_slot(seen_at);
+        if self.current_day.is_some_and(|current| day < current) {
+            // Late report for a day already folded into the profiles
+            return;
+        }
+        if self.current_day != Some(day) {
+            self.roll_over(day);
+        }
+
+        let (_, first_slot) = day_and_slot(start);
+        let span_slots = ((end - start).num_seconds().max(1) + SLOT_SECS - 1) / SLOT_SECS;
+        let span_slots = (span_slots as usize).clamp(1, SLOTS_PER_DAY);
+        let per_slot = (energy_kwh / span_slots as f64) as f32;
+
+        let profile = self
+            .profiles
+            .entry(producer.to_string())
+            .or_insert_with(|| DiurnalProfile::new(day));
+        profile.last_active_day = day;
+        for offset in 0..span_slots {
+            profile.open_day_slots[(first_slot + offset) % SLOTS_PER_DAY] += per_slot;
+        }
+    }
+
+    /// Close every producer's open day, so idle producers decay in the
+    /// aggregate too, and drop producers idle for more than [`MAX_IDLE_DAYS`]
+    fn roll_over(&mut self, day: i64) {
+        self.current_day = Some(day);
+        let smoothing = self.smoothing;
+        let aggregate = &mut self.aggregate;
+        self.profiles.retain(|_, profile| {
+            if day - profile.last_active_day > MAX_IDLE_DAYS {
+                for (total, slot) in aggregate.iter_mut().zip(profile.slots) {
+                    *total -= slot as f64;
+                }
+                return false;
+            }
+            Self::fold(profile, aggregate, smoothing, day);
+            true
+        });
+    }
+
+    /// Fold the open day into the profile and start accumulating `next_day`
+    fn fold(
+        profile: &mut DiurnalProfile,
+        aggregate: &mut [f64; SLOTS_PER_DAY],
+        smoothing: f32,
+        next_day: i64,
+    ) {
+        // Days with no reports in between count as zero supply
+        let idle_days = (next_day - profile.open_day - 1).clamp(0, MAX_IDLE_DAYS) as i32;
+        let idle_decay = (1.0 - smoothing).powi(idle_days);
+
+        for slot in 0..SLOTS_PER_DAY {
+            let old = profile.slots[slot];
+            let fitted = if profile.days_observed == 0 {
+                profile.open_day_slots[slot]
+            } else {
+                smoothing * profile.open_day_slots[slot] + (1.0 - smoothing) * old
+            };
+            let updated = fitted * idle_decay;
+
+            aggregate[slot] += (updated - old) as f64;
+            profile.slots[slot] = updated;
+        }
+
+        profile.open_day_slots = [0.0; SLOTS_PER_DAY];
+        profile.open_day = next_day;
+        profile.days_observed += 1;
+    }
+
+    /// Expected supply from a producer in the slot containing `at` (kWh)
+    pub fn forecast(&self, producer: &str, at: DateTime<Utc>) -> f64 {
+        let (_, slot) = day_and_slot(at);
+        self.profiles
+            .get(producer)
+            .map(|profile| profile.slot(slot))
+            .unwrap_or(0.0)
+    }
+
+    /// Expected supply across all producers in the slot containing `at` (kWh)
+    pub fn total_forecast(&self, at: DateTime<Utc>) -> f64 {
+        let (_, slot) = day_and_slot(at);
+        self.aggregate[slot].max(0.0)
+    }
+
+    /// Get a producer's full profile
+    pub fn profile(&self, producer: &str) -> Option<&DiurnalProfile> {
+        self.profiles.get(producer)
+    }
+
+    /// Number of producers with a profile
+    pub fn producer_count(&self) -> usize {
+        self.profiles.len()
+    }
+}
+
+impl Default for ForecastCache {
+    fn default() -> Self {
+        Self::new(DEFAULT_SMOOTHING)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// 10:00 Bangkok time on local day `day` (days since epoch)
+    fn morning(day: i64) -> DateTime<Utc> {
+        DateTime::from_timestamp(day * 86_400 + 3 * 3600, 0).unwrap()
+    }
+
+    #[test]
+    fn test_day_and_slot_uses_thai_local_time() {
+        let (day, slot) = day_and_slot(morning(20_000));
+        assert_eq!(day, 20_000);
+        assert_eq!(slot, 40); // 10:00 local
+    }
+
+    #[test]
+    fn test_profile_fits_after_day_rolls_over() {
+        let mut cache = ForecastCache::new(0.5);
+        let start = morning(20_000);
+        cache.observe_supply("solar", start, start, start + chrono::Duration::hours(1), 8.0);
+
+        // The open day is not part of the forecast until it completes
+        assert_eq!(cache.forecast("solar", start), 0.0);
+
+        let next = morning(20_001);
+        cache.observe_supply("solar", next, next, next + chrono::Duration::minutes(15), 4.0);
+        assert_eq!(cache.forecast("solar", start), 2.0);
+        assert_eq!(cache.forecast("solar", start + chrono::Duration::minutes(45)), 2.0);
+        assert_eq!(cache.forecast("solar", start + chrono::Duration::hours(1)), 0.0);
+        assert_eq!(cache.total_forecast(start), 2.0);
+
+        let after = morning(20_002);
+        cache.observe_supply("solar", after, after, after + chrono::Duration::minutes(15), 1.0);
+        assert_eq!(cache.forecast("solar", start), 3.0); // 0.5 * 4 + 0.5 * 2
+        assert_eq!(cache.profile("solar").unwrap().days_observed(), 2);
+    }
+
+    #[test]
+    fn test_idle_days_decay_profile_and_aggregate() {
+        let mut cache = ForecastCache::new(0.5);
+        let start = morning(20_000);
+        cache.observe_supply("a", start, start, start + chrono::Duration::minutes(15), 4.0);
+        cache.observe_supply("b", start, start, start + chrono::Duration::minutes(15), 4.0);
+        cache.observe_supply("a", morning(20_001), morning(20_001), morning(20_001), 1.0);
+        cache.observe_supply("b", morning(20_003), morning(20_003), morning(20_003), 1.0);
+
+        // a's day 20_001 folds in (0.5 * 1 + 0.5 * 4), then one idle day halves it
+        assert_eq!(cache.forecast("a", start), 1.25);
+        assert_eq!(cache.forecast("b", start), 1.0); // two idle days halve it twice
+        assert_eq!(cache.total_forecast(start), 2.25);
+    }
+
+    #[test]
+    fn test_day_ahead_order_does_not_hide_same_day_orders() {
+        let mut cache = ForecastCache::new(0.5);
+        let today = morning(20_000);
+        let tomorrow = morning(20_001);
+        cache.observe_supply("solar", today, tomorrow, tomorrow + chrono::Duration::minutes(15), 2.0);
+        cache.observe_supply("solar", today, today, today + chrono::Duration::minutes(15), 2.0);
+
+        cache.observe_supply("wind", tomorrow, tomorrow, tomorrow, 1.0);
+        assert_eq!(cache.forecast("solar", today), 4.0);
+        assert_eq!(cache.profile("solar").unwrap().days_observed(), 1);
+
+        // Orders seen on a folded day are late reports
+        cache.observe_supply("solar", today, today, today, 8.0);
+        assert_eq!(cache.forecast("solar", today), 4.0);
+    }
+
+    #[test]
+    fn test_inactive_producers_are_evicted() {
+        let mut cache = ForecastCache::new(0.5);
+        let start = morning(20_000);
+        cache.observe_supply("a", start, start, start, 4.0);
+        cache.observe_supply("b", start, start, start, 4.0);
+
+        let later = morning(20_000 + MAX_IDLE_DAYS);
+        cache.observe_supply("b", later, later, later, 4.0);
+        assert_eq!(cache.producer_count(), 2);
+        assert!(cache.forecast("a", start) > 0.0);
+
+        let evicted = morning(20_001 + MAX_IDLE_DAYS);
+        cache.observe_supply("b", evicted, evicted, evicted, 4.0);
+        assert_eq!(cache.producer_count(), 1);
+        assert!(cache.profile("a").is_none());
+        assert_eq!(cache.forecast("a", start), 0.0);
+        assert!((cache.total_forecast(start) - cache.forecast("b", start)).abs() < 1e-6);
+    }
+}
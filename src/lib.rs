@@ -18,7 +18,11 @@
 pub mod api;
 pub mod blockchain;
 pub mod config;
+pub mod consensus;
+pub mod consensus_poa;
+pub mod demand_response;
 pub mod energy;
+pub mod forecast;
 pub mod governance;
 pub mod p2p;
 pub mod storage;
@@ -28,9 +32,10 @@ pub mod utils;
 pub use api::ApiServer;
 pub use blockchain::{Block, Blockchain, Transaction, TransactionType, ValidatorInfo};
 pub use config::{NodeConfig, ApiConfig, GridConfig, P2PConfig, ConsensusConfig};
+pub use demand_response::DemandResponseEngine;
 pub use energy::{EnergyTrading, GridManager};
 pub use governance::GovernanceSystem;
-pub use p2p::P2PNetwork;
+pub use p2p::{P2PHandle, P2PNetwork};
 pub use storage::StorageManager;
 pub use utils::{crypto, EnergyConversion, ThaiEnergyMarket, Utils};
 
@@ -6,13 +6,22 @@
 use anyhow::Result;
 use clap::{Parser, Subcommand};
 use std::sync::Arc;
+use std::time::Duration;
 use tokio::sync::RwLock;
 use tracing::{error, info};
 
 // Use the library exports instead of local modules
 use gridtokenx_blockchain::{
-    Blockchain, Block, Transaction, NodeConfig, StorageManager, ValidatorInfo, crypto,
-    ApiServer, ApiConfig, EnergyTrading, GridManager, GovernanceSystem, P2PNetwork
+    Blockchain, Block, NodeConfig, StorageManager, ValidatorInfo, crypto,
+    ApiServer, ApiConfig, EnergyTrading, GridManager, GovernanceSystem, P2PNetwork, P2PHandle,
+    DemandResponseEngine,
+};
+use gridtokenx_blockchain::blockchain::{build_genesis, verify_genesis, AttestationService};
+use gridtokenx_blockchain::config::{BlockPropagation, ConsensusAlgorithm, GenesisConfig};
+use gridtokenx_blockchain::consensus_poa::finality::{self, FinalityGadget};
+use gridtokenx_blockchain::consensus_poa::POAConsensusEngine;
+use gridtokenx_blockchain::p2p::simulator::{
+    self, LinkConditions, SimulatedConsensus, SimulationConfig,
 };
 
 #[derive(Parser)]
@@ -47,6 +56,36 @@ enum Commands {
     Status,
     /// Generate new wallet
     GenerateWallet,
+    /// Simulate a multi-node network in memory and report performance
+    Simulate {
+        /// Node counts to run, comma separated
+        #[arg(short, long, value_delimiter = ',', default_value = "4,16,50,100")]
+        nodes: Vec<usize>,
+        /// Blocks to produce per run
+        #[arg(short, long, default_value_t = 20)]
+        blocks: u64,
+        /// Block interval (ms)
+        #[arg(long, default_value_t = 1000)]
+        block_interval_ms: u64,
+        /// One-way link latency (ms)
+        #[arg(long, default_value_t = 20)]
+        latency_ms: u64,
+        /// Link bandwidth (Mbit/s)
+        #[arg(long, default_value_t = 100)]
+        bandwidth_mbps: u64,
+        /// Frame loss probability (0.0 - 1.0)
+        #[arg(long, default_value_t = 0.0)]
+        loss: f64,
+        /// Transactions submitted per second
+        #[arg(long, default_value_t = 200)]
+        tps: u64,
+        /// Block propagation modes to compare (compact, full, erasure), comma separated
+        #[arg(long, value_delimiter = ',', default_value = "compact")]
+        propagation: Vec<String>,
+        /// Block production: simulator rotation or the PoA engine with finality (rotation, poa)
+        #[arg(long, default_value = "rotation")]
+        consensus: String,
+    },
 }
 
 #[tokio::main]
@@ -73,6 +112,36 @@ async fn main() -> Result<()> {
         Some(Commands::GenerateWallet) => {
             generate_wallet().await?;
         }
+        Some(Commands::Simulate {
+            nodes,
+            blocks,
+            block_interval_ms,
+            latency_ms,
+            bandwidth_mbps,
+            loss,
+            tps,
+            propagation,
+            consensus,
+        }) => {
+            let config = SimulationConfig {
+                link: LinkConditions {
+                    latency: Duration::from_millis(latency_ms),
+                    bandwidth_bytes_per_sec: Some(bandwidth_mbps * 125_000),
+                    loss,
+                    ..LinkConditions::default()
+                },
+                block_interval: Duration::from_millis(block_interval_ms),
+                blocks,
+                transactions_per_second: tps,
+                consensus: parse_consensus(&consensus)?,
+                ..SimulationConfig::default()
+            };
+            let modes = propagation
+                .iter()
+                .map(|mode| parse_propagation(mode))
+                .collect::<Result<Vec<_>>>()?;
+            run_simulations(config, nodes, modes).await?;
+        }
         None => {
             // Default: start node with default config
             start_node("config.toml".to_string(), false, "validator".to_string()).await?;
@@ -97,7 +166,9 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
     info!("Storage initialized at: {}", config.storage.path);
 
     // Initialize blockchain
-    let blockchain = Arc::new(RwLock::new(Blockchain::new(storage.clone()).await?));
+    let blockchain = Arc::new(RwLock::new(
+        Blockchain::with_carbon_credits(storage.clone(), config.energy.carbon_credits.clone()).await?,
+    ));
     info!("Blockchain initialized");
 
     // Check if genesis block exists
@@ -106,12 +177,23 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
         bc.get_height().await.unwrap_or(0)
     };
 
+    let genesis_block = create_genesis_block(&config, None).await?;
     if height == 0 {
         info!("No genesis block found, creating one...");
-        let genesis_block = create_genesis_block(None).await?;
         let mut bc = blockchain.write().await;
         bc.add_genesis_block(genesis_block).await?;
         info!("Genesis block created");
+    } else {
+        // Blocks from peers only import on top of the genesis they were built on
+        let stored = blockchain.read().await.get_block_by_height(0).await?;
+        if stored.header.hash != genesis_block.header.hash {
+            return Err(anyhow::anyhow!(
+                "Stored genesis {} differs from the configured genesis {}; reinitialize {}",
+                stored.header.hash,
+                genesis_block.header.hash,
+                config.storage.path
+            ));
+        }
     }
 
     info!("GridTokenX Node started successfully!");
@@ -127,18 +209,104 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
     let governance = Arc::new(RwLock::new(GovernanceSystem::new(blockchain.clone()).await?));
     let grid_manager = Arc::new(RwLock::new(GridManager::new(config.grid.clone()).await?));
 
-    // Initialize P2P network
-    let mut p2p_network = P2PNetwork::new(config.p2p.clone(), blockchain.clone()).await?;
-    
-    // Start P2P network in background
-    let p2p_handle = {
-        let mut p2p = p2p_network;
+    // Initialize P2P network; bootstrap peers come from the config and the environment
+    let mut p2p_config = config.p2p.clone();
+    p2p_config
+        .bootstrap_peers
+        .extend(config.network.bootstrap_nodes.iter().cloned());
+    if let Ok(peers) = std::env::var("GRIDTOKEN_BOOTSTRAP_PEERS") {
+        p2p_config.bootstrap_peers.extend(
+            peers
+                .split(',')
+                .map(str::trim)
+                .filter(|peer| !peer.is_empty())
+                .map(String::from),
+        );
+    }
+    p2p_config.sync.fast_sync |= config.performance.optimization.enable_fast_sync;
+    let mut p2p_network = P2PNetwork::new(p2p_config, blockchain.clone())
+        .await?
+        .with_network_security(&config.security.network_security)
+        .with_peer_store(storage.clone())
+        .await?;
+
+    // Proof of Authority: configured authorities sign blocks and take turns
+    let poa_engine = match config.consensus.algorithm {
+        ConsensusAlgorithm::PoA if !config.consensus.poa.initial_authorities.is_empty() => Some(
+            Arc::new(
+                POAConsensusEngine::new(blockchain.clone(), config.consensus.poa.clone())
+                    .await?
+                    .with_slashing(config.consensus.validator.slashing.clone()),
+            ),
+        ),
+        _ => None,
+    };
+    if let Some(engine) = &poa_engine {
+        p2p_network = p2p_network.with_block_verifier(engine.clone());
+    }
+
+    // The swarm runs in its own task; the handle is used to publish mined blocks
+    let p2p_handle = match p2p_network.start().await {
+        Ok(()) => p2p_network.handle(),
+        Err(e) => {
+            error!("P2P network error: {}", e);
+            None
+        }
+    };
+
+    if let Some(engine) = &poa_engine {
+        if let Some(handle) = &p2p_handle {
+            engine.attach_network(handle.clone());
+        }
+        if enable_mining {
+            let engine = engine.clone();
+            tokio::spawn(async move {
+                if let Err(e) = engine.start_consensus().await {
+                    error!("PoA consensus error: {}", e);
+                }
+            });
+        }
+        let follower = engine.clone();
         tokio::spawn(async move {
-            if let Err(e) = p2p.start().await {
-                error!("P2P network error: {}", e);
+            if let Err(e) = follower.follow_chain().await {
+                error!("PoA liveness tracking error: {}", e);
             }
-        })
-    };
+        });
+
+        let finality_handle = p2p_handle.as_ref().filter(|_| config.consensus.poa.finality.enabled);
+        if let Some(handle) = finality_handle {
+            let gadget = FinalityGadget::new(
+                engine.authority_keys(),
+                engine.signing_key(),
+                &config.consensus.poa.finality,
+            )?;
+            let finality = finality::run(
+                gadget,
+                blockchain.clone(),
+                storage.clone(),
+                handle.clone(),
+                p2p_network.subscribe_consensus(),
+            );
+            tokio::spawn(async move {
+                if let Err(e) = finality.await {
+                    error!("Finality gadget error: {}", e);
+                }
+            });
+        }
+    }
+
+    // Seal metered readings into attestation roots once each interval has elapsed
+    let attestations = Arc::new(AttestationService::new(blockchain.clone(), storage.clone()));
+    tokio::spawn(attestations.clone().run(Duration::from_secs(60)));
+
+    // Demand-response dispatch; completed events are settled in the background
+    let demand_response = Arc::new(DemandResponseEngine::new(
+        blockchain.clone(),
+        config.grid.demand_response.clone(),
+    ));
+    if config.grid.demand_response.enabled {
+        tokio::spawn(demand_response.clone().run_settlement());
+    }
 
     // Start API server
     let api_config = config.api.clone();
@@ -148,6 +316,8 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
         energy_trading.clone(),
         grid_manager.clone(),
         governance.clone(),
+        attestations.clone(),
+        demand_response.clone(),
     );
 
     // Start API server in background
@@ -167,12 +337,13 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
     loop {
         tokio::time::sleep(tokio::time::Duration::from_secs(10)).await;
 
-        // Mine a block if mining is enabled
-        if enable_mining {
+        // Mine a block if mining is enabled and no PoA authority schedule is configured
+        if enable_mining && poa_engine.is_none() {
             let blockchain_clone = blockchain.clone();
-            
+            let p2p_clone = p2p_handle.clone();
+
             tokio::spawn(async move {
-                if let Err(e) = mine_block(blockchain_clone).await {
+                if let Err(e) = mine_block(blockchain_clone, p2p_clone).await {
                     error!("Mining error: {}", e);
                 }
             });
@@ -190,7 +361,7 @@ async fn start_node(config_path: String, enable_mining: bool, node_type: String)
 }
 
 /// Simple mining function
-async fn mine_block(blockchain: Arc<RwLock<Blockchain>>) -> Result<()> {
+async fn mine_block(blockchain: Arc<RwLock<Blockchain>>, p2p: Option<P2PHandle>) -> Result<()> {
     let pending_transactions = {
         let bc = blockchain.read().await;
         bc.get_pending_transactions(100).await
@@ -228,6 +399,12 @@ async fn mine_block(blockchain: Arc<RwLock<Blockchain>>) -> Result<()> {
         bc.remove_pending_transactions(&tx_ids).await;
 
         info!("Mined block at height: {}", new_block.header.height);
+
+        if let Some(p2p) = p2p {
+            if let Err(e) = p2p.broadcast_block(&new_block) {
+                error!("Failed to broadcast block: {}", e);
+            }
+        }
     }
 
     Ok(())
@@ -248,7 +425,7 @@ async fn init_blockchain(genesis_config: Option<String>) -> Result<()> {
     let storage = Arc::new(StorageManager::new(&config.storage.path).await?);
 
     // Create genesis block
-    let genesis_block = create_genesis_block(genesis_config).await?;
+    let genesis_block = create_genesis_block(&config, genesis_config).await?;
 
     // Initialize blockchain with genesis block
     let mut blockchain = Blockchain::new(storage).await?;
@@ -260,39 +437,20 @@ async fn init_blockchain(genesis_config: Option<String>) -> Result<()> {
     Ok(())
 }
 
-async fn create_genesis_block(_genesis_config: Option<String>) -> Result<Block> {
+/// Build the genesis block from the node config, or from a separate genesis file
+async fn create_genesis_block(config: &NodeConfig, genesis_config: Option<String>) -> Result<Block> {
     info!("Creating genesis block...");
 
-    // Default genesis configuration for Thai energy market
-    let genesis_transactions = vec![
-        // Initial token distribution
-        Transaction::new_genesis_mint(
-            "system".to_string(),
-            1_000_000_000, // 1 billion tokens initial supply
-            "Initial token supply for Thai energy market".to_string(),
-        )?,
-        // Register energy authorities
-        Transaction::new_authority_registration(
-            "EGAT".to_string(), // Electricity Generating Authority of Thailand
-            "Primary electricity generator".to_string(),
-        )?,
-        Transaction::new_authority_registration(
-            "MEA".to_string(), // Metropolitan Electricity Authority
-            "Bangkok and surrounding areas distribution".to_string(),
-        )?,
-        Transaction::new_authority_registration(
-            "PEA".to_string(), // Provincial Electricity Authority
-            "Provincial electricity distribution".to_string(),
-        )?,
-    ];
-
-    let genesis_block = Block::new_genesis(
-        genesis_transactions,
-        "GridTokenX Genesis Block - Thai Energy Market".to_string(),
-    )?;
+    let genesis = match genesis_config {
+        Some(path) => GenesisConfig::load(&path)?,
+        None => config.genesis.clone(),
+    };
+    let genesis_block = build_genesis(&genesis)?;
+    verify_genesis(&genesis_block, &config.network.genesis_hash)?;
 
     info!(
-        "Genesis block created with {} transactions",
+        "Genesis block {} created with {} transactions",
+        genesis_block.header.hash,
         genesis_block.transactions.len()
     );
 
@@ -336,6 +494,76 @@ async fn show_status() -> Result<()> {
     Ok(())
 }
 
+fn parse_propagation(mode: &str) -> Result<BlockPropagation> {
+    match mode.to_lowercase().as_str() {
+        "compact" => Ok(BlockPropagation::Compact),
+        "full" => Ok(BlockPropagation::Full),
+        "erasure" => Ok(BlockPropagation::Erasure),
+        other => Err(anyhow::anyhow!("Unknown propagation mode: {}", other)),
+    }
+}
+
+fn parse_consensus(mode: &str) -> Result<SimulatedConsensus> {
+    match mode.to_lowercase().as_str() {
+        "rotation" => Ok(SimulatedConsensus::Rotation),
+        "poa" => Ok(SimulatedConsensus::Poa),
+        other => Err(anyhow::anyhow!("Unknown simulated consensus: {}", other)),
+    }
+}
+
+async fn run_simulations(
+    config: SimulationConfig,
+    node_counts: Vec<usize>,
+    modes: Vec<BlockPropagation>,
+) -> Result<()> {
+    info!("Simulating networks of {:?} nodes...", node_counts);
+    let mut reports = Vec::new();
+    for propagation in modes {
+        let config = SimulationConfig {
+            propagation,
+            ..config.clone()
+        };
+        // Virtual time needs a paused current-thread runtime of its own
+        let node_counts = node_counts.clone();
+        let sweep = std::thread::spawn(move || simulator::sweep_in_virtual_time(&config, &node_counts));
+        reports.extend(
+            sweep
+                .join()
+                .map_err(|_| anyhow::anyhow!("Simulation thread panicked"))??,
+        );
+    }
+
+    println!("GridTokenX Network Simulation");
+    println!("=============================");
+    println!(
+        "{:>6} {:>8} {:>8} {:>8} {:>8} {:>8} {:>12} {:>10} {:>10} {:>12} {:>12} {:>12}",
+        "nodes", "mode", "p50 ms", "p90 ms", "p99 ms", "forks", "undelivered", "TPS", "MB sent",
+        "interval ms", "final p50", "final p99"
+    );
+    for report in &reports {
+        println!(
+            "{:>6} {:>8} {:>8.1} {:>8.1} {:>8.1} {:>8.3} {:>12.3} {:>10.1} {:>10.1} {:>12.1} {:>12.1} {:>12.1}",
+            report.nodes,
+            format!("{:?}", report.propagation).to_lowercase(),
+            report.propagation_p50_ms,
+            report.propagation_p90_ms,
+            report.propagation_p99_ms,
+            report.fork_rate,
+            report.undelivered_rate,
+            report.sustained_tps,
+            report.bytes_sent as f64 / 1_000_000.0,
+            report.block_interval_ms,
+            report.finality_p50_ms,
+            report.finality_p99_ms
+        );
+    }
+    println!();
+    println!("Times are virtual: TPS is committed load per simulated second, capped by --tps,");
+    println!("and does not measure node processing speed.");
+
+    Ok(())
+}
+
 async fn generate_wallet() -> Result<()> {
     info!("Generating new GridTokenX wallet...");
 
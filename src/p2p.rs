@@ -1,247 +0,0 @@
-//! GridTokenX P2P Network Module
-//!
-//! This module implements peer-to-peer networking for the GridTokenX blockchain,
-//! including node discovery, message propagation, and network synchronization.
-
-use anyhow::{anyhow, Result};
-use chrono::{DateTime, Utc};
-use serde::{Deserialize, Serialize};
-use std::collections::HashMap;
-use std::sync::Arc;
-use tokio::sync::RwLock;
-
-use crate::blockchain::{Block, Blockchain, Transaction};
-use crate::config::P2PConfig;
-
-/// P2P network manager (simplified version)
-#[derive(Debug)]
-pub struct P2PNetwork {
-    config: P2PConfig,
-    blockchain: Arc<RwLock<Blockchain>>,
-    peers: RwLock<HashMap<String, PeerInfo>>,
-    message_handler: RwLock<MessageHandler>,
-}
-
-/// Peer information
-#[derive(Debug, Clone, Serialize, Deserialize)]
-pub struct PeerInfo {
-    pub peer_id: String,
-    pub addresses: Vec<String>,
-    pub node_type: String,
-    pub version: String,
-    pub connected_at: DateTime<Utc>,
-    pub last_seen: DateTime<Utc>,
-    pub reputation: f64,
-    pub latency: Option<u64>,
-    pub synced_height: u64,
-}
-
-/// Message handler for network messages
-#[derive(Debug, Default)]
-pub struct MessageHandler {
-    pending_blocks: HashMap<String, Block>,
-    pending_transactions: HashMap<String, Transaction>,
-    sync_requests: HashMap<String, SyncRequest>,
-}
-
-/// Synchronization request
-#[derive(Debug, Clone, Serialize, Deserialize)]
-pub struct SyncRequest {
-    pub request_id: String,
-    pub requester: String,
-    pub start_height: u64,
-    pub end_height: u64,
-    pub requested_at: DateTime<Utc>,
-}
-
-/// Network message types
-#[derive(Debug, Clone, Serialize, Deserialize)]
-pub enum NetworkMessage {
-    /// New block announcement
-    BlockAnnouncement { block: Block, sender: String },
-    /// Request specific block
-    BlockRequest {
-        request_id: String,
-        height: u64,
-        requester: String,
-    },
-    /// Block response
-    BlockResponse {
-        request_id: String,
-        block: Option<Block>,
-        responder: String,
-    },
-    /// New transaction
-    TransactionBroadcast {
-        transaction: Transaction,
-        sender: String,
-    },
-    /// Blockchain sync request
-    SyncRequest {
-        request_id: String,
-        start_height: u64,
-        end_height: u64,
-        requester: String,
-    },
-    /// Sync response with multiple blocks
-    SyncResponse {
-        request_id: String,
-        blocks: Vec<Block>,
-        responder: String,
-    },
-    /// Peer information exchange
-    PeerInfo { info: PeerInfo },
-    /// Consensus message
-    ConsensusMessage {
-        message_type: String,
-        data: Vec<u8>,
-        sender: String,
-    },
-    /// Ping for connectivity check
-    Ping {
-        timestamp: DateTime<Utc>,
-        sender: String,
-    },
-    /// Pong response
-    Pong {
-        timestamp: DateTime<Utc>,
-        original_timestamp: DateTime<Utc>,
-        sender: String,
-    },
-}
-
-/// Network statistics
-#[derive(Debug, Clone, Serialize, Deserialize)]
-pub struct NetworkStats {
-    pub connected_peers: u64,
-    pub total_messages_sent: u64,
-    pub total_messages_received: u64,
-    pub blocks_synced: u64,
-    pub transactions_relayed: u64,
-    pub average_latency: f64,
-    pub network_health: f64,
-}
-
-impl P2PNetwork {
-    /// Create new P2P network
-    pub async fn new(
-        config: P2PConfig,
-        blockchain: Arc<RwLock<Blockchain>>,
-    ) -> Result<Self> {
-        Ok(Self {
-            config,
-            blockchain,
-            peers: RwLock::new(HashMap::new()),
-            message_handler: RwLock::new(MessageHandler::default()),
-        })
-    }
-
-    /// Start the P2P network (simplified implementation)
-    pub async fn start(&mut self) -> Result<()> {
-        tracing::info!("Starting P2P network on {}", self.config.listen_addr);
-        
-        // Simulate P2P network startup
-        tracing::info!("P2P network started successfully");
-        tracing::info!("Listening for connections...");
-        
-        // In a real implementation, this would set up libp2p networking
-        // For now, we'll just log that the network is ready
-        
-        Ok(())
-    }
-
-    /// Handle new block announcement
-    pub async fn handle_block_announcement(&self, block: Block) -> Result<()> {
-        let blockchain = self.blockchain.read().await;
-        let current_height = blockchain.get_height().await?;
-
-        if block.header.height > current_height {
-            // New block ahead of our chain
-            drop(blockchain);
-            let blockchain = self.blockchain.write().await;
-            // This would cause a deadlock, so we need to refactor
-            // blockchain.add_block(block.clone()).await?;
-            tracing::info!("Received new block at height {}", block.header.height);
-        } else if block.header.height == current_height {
-            // Potential fork - would need more sophisticated handling
-            tracing::warn!("Received block at current height - potential fork");
-        }
-
-        Ok(())
-    }
-
-    /// Handle transaction broadcast
-    pub async fn handle_transaction_broadcast(&self, transaction: Transaction) -> Result<()> {
-        let blockchain = self.blockchain.read().await;
-        // Similar deadlock issue - would need to refactor
-        // blockchain.add_pending_transaction(transaction.clone()).await?;
-        tracing::debug!("Received transaction broadcast: {}", transaction.id);
-        Ok(())
-    }
-
-    /// Broadcast new block (simulated)
-    pub async fn broadcast_block(&self, block: &Block) -> Result<()> {
-        tracing::info!("Broadcasting block at height {}", block.header.height);
-        // In a real implementation, this would send the block to all connected peers
-        Ok(())
-    }
-
-    /// Broadcast transaction (simulated)
-    pub async fn broadcast_transaction(&self, transaction: &Transaction) -> Result<()> {
-        tracing::debug!("Broadcasting transaction: {}", transaction.id);
-        // In a real implementation, this would send the transaction to all connected peers
-        Ok(())
-    }
-
-    /// Request blockchain sync (simulated)
-    pub async fn request_sync(&self, start_height: u64, end_height: u64) -> Result<()> {
-        tracing::info!("Requesting sync from height {} to {}", start_height, end_height);
-        // In a real implementation, this would request blocks from peers
-        Ok(())
-    }
-
-    /// Get connected peers
-    pub async fn get_peers(&self) -> Vec<PeerInfo> {
-        let peers = self.peers.read().await;
-        peers.values().cloned().collect()
-    }
-
-    /// Get network statistics
-    pub async fn get_stats(&self) -> NetworkStats {
-        let peers = self.peers.read().await;
-        let connected_peers = peers.len() as u64;
-
-        // Calculate average latency
-        let latencies: Vec<u64> = peers.values().filter_map(|p| p.latency).collect();
-
-        let average_latency = if !latencies.is_empty() {
-            latencies.iter().sum::<u64>() as f64 / latencies.len() as f64
-        } else {
-            0.0
-        };
-
-        // Calculate network health (simplified)
-        let network_health = if connected_peers > 0 {
-            let healthy_peers = peers.values().filter(|p| p.reputation > 70.0).count() as f64;
-            (healthy_peers / connected_peers as f64) * 100.0
-        } else {
-            100.0 // Perfect health when no peers (for testing)
-        };
-
-        NetworkStats {
-            connected_peers,
-            total_messages_sent: 0,     // Would track in real implementation
-            total_messages_received: 0, // Would track in real implementation
-            blocks_synced: 0,           // Would track in real implementation
-            transactions_relayed: 0,    // Would track in real implementation
-            average_latency,
-            network_health,
-        }
-    }
-
-    /// Add a simulated peer for testing
-    pub async fn add_test_peer(&self, peer_info: PeerInfo) {
-        let mut peers = self.peers.write().await;
-        peers.insert(peer_info.peer_id.clone(), peer_info);
-    }
-}
@@ -0,0 +1,210 @@
+//! GridTokenX Network-to-Chain Bridge
+//!
+//! Bounded queues between the swarm, the inbound message processor and the
+//! chain-writer tasks. Gossip producers never wait on a full queue: the item
+//! is shed and counted, and the block or transaction is picked up again from
+//! a later announcement or by range sync. Only the ordered sync pipeline
+//! waits for space, which slows its own intake instead of the event loop.
+//! Every queue reports its depth and drop count ([`QueueStats`]).
+
+use anyhow::{anyhow, Result};
+use serde::{Deserialize, Serialize};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::Arc;
+use tokio::sync::mpsc;
+use tokio::sync::mpsc::error::TrySendError;
+
+/// Snapshot of one bridge queue
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct QueueStats {
+    pub name: String,
+    pub capacity: usize,
+    /// Items waiting for the consumer
+    pub depth: usize,
+    pub accepted: u64,
+    /// Items shed because the queue was full
+    pub dropped: u64,
+}
+
+/// Counters shared by both ends of a queue
+#[derive(Debug)]
+pub struct QueueCounters {
+    name: &'static str,
+    capacity: usize,
+    depth: AtomicUsize,
+    accepted: AtomicU64,
+    dropped: AtomicU64,
+}
+
+impl QueueCounters {
+    /// Counters for a bounded buffer that is not a channel
+    pub fn new(name: &'static str, capacity: usize) -> Self {
+        Self {
+            name,
+            capacity,
+            depth: AtomicUsize::new(0),
+            accepted: AtomicU64::new(0),
+            dropped: AtomicU64::new(0),
+        }
+    }
+
+    /// Count an item taken in, with the buffer's new depth
+    pub fn record_accepted(&self, depth: usize) {
+        self.accepted.fetch_add(1, Ordering::Relaxed);
+        self.depth.store(depth, Ordering::Relaxed);
+    }
+
+    /// Count an item shed because the buffer was full
+    pub fn record_dropped(&self) {
+        self.dropped.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn set_depth(&self, depth: usize) {
+        self.depth.store(depth, Ordering::Relaxed);
+    }
+
+    pub fn snapshot(&self) -> QueueStats {
+        QueueStats {
+            name: self.name.to_string(),
+            capacity: self.capacity,
+            depth: self.depth.load(Ordering::Relaxed),
+            accepted: self.accepted.load(Ordering::Relaxed),
+            dropped: self.dropped.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// Bounded queue with depth and drop accounting
+pub fn channel<T>(name: &'static str, capacity: usize) -> (BridgeSender<T>, BridgeReceiver<T>) {
+    let (sender, receiver) = mpsc::channel(capacity);
+    let counters = Arc::new(QueueCounters::new(name, capacity));
+    (
+        BridgeSender {
+            inner: sender,
+            counters: counters.clone(),
+        },
+        BridgeReceiver {
+            inner: receiver,
+            counters,
+        },
+    )
+}
+
+/// Producer end of a bridge queue
+#[derive(Debug)]
+pub struct BridgeSender<T> {
+    inner: mpsc::Sender<T>,
+    counters: Arc<QueueCounters>,
+}
+
+impl<T> Clone for BridgeSender<T> {
+    fn clone(&self) -> Self {
+        Self {
+            inner: self.inner.clone(),
+            counters: self.counters.clone(),
+        }
+    }
+}
+
+impl<T> BridgeSender<T> {
+    /// Queue without waiting; a full queue sheds the item and counts the drop
+    pub fn offer(&self, item: T) -> Result<(), TrySendError<T>> {
+        self.counters.depth.fetch_add(1, Ordering::Relaxed);
+        match self.inner.try_send(item) {
+            Ok(()) => {
+                self.counters.accepted.fetch_add(1, Ordering::Relaxed);
+                Ok(())
+            }
+            Err(e) => {
+                self.counters.depth.fetch_sub(1, Ordering::Relaxed);
+                if matches!(e, TrySendError::Full(_)) {
+                    self.counters.dropped.fetch_add(1, Ordering::Relaxed);
+                }
+                Err(e)
+            }
+        }
+    }
+
+    /// Queue, waiting for space
+    pub async fn send(&self, item: T) -> Result<()> {
+        let permit = self
+            .inner
+            .reserve()
+            .await
+            .map_err(|_| anyhow!("{} queue closed", self.counters.name))?;
+        self.counters.depth.fetch_add(1, Ordering::Relaxed);
+        self.counters.accepted.fetch_add(1, Ordering::Relaxed);
+        permit.send(item);
+        Ok(())
+    }
+
+    pub fn is_closed(&self) -> bool {
+        self.inner.is_closed()
+    }
+
+    pub fn counters(&self) -> Arc<QueueCounters> {
+        self.counters.clone()
+    }
+}
+
+/// Consumer end of a bridge queue
+#[derive(Debug)]
+pub struct BridgeReceiver<T> {
+    inner: mpsc::Receiver<T>,
+    counters: Arc<QueueCounters>,
+}
+
+impl<T> BridgeReceiver<T> {
+    pub async fn recv(&mut self) -> Option<T> {
+        let item = self.inner.recv().await?;
+        self.counters.depth.fetch_sub(1, Ordering::Relaxed);
+        Some(item)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    #[test]
+    fn test_full_queue_sheds_and_counts() {
+        let (sender, _receiver) = channel::<u32>("test", 2);
+        assert!(sender.offer(1).is_ok());
+        assert!(sender.offer(2).is_ok());
+        assert!(matches!(sender.offer(3), Err(TrySendError::Full(3))));
+
+        let stats = sender.counters().snapshot();
+        assert_eq!(stats.depth, 2);
+        assert_eq!(stats.accepted, 2);
+        assert_eq!(stats.dropped, 1);
+    }
+
+    #[tokio::test]
+    async fn test_depth_follows_the_consumer() {
+        let (sender, mut receiver) = channel::<u32>("test", 4);
+        sender.offer(1).unwrap();
+        sender.send(2).await.unwrap();
+        assert_eq!(receiver.recv().await, Some(1));
+        assert_eq!(sender.counters().snapshot().depth, 1);
+
+        drop(receiver);
+        assert!(sender.is_closed());
+        assert!(matches!(sender.offer(3), Err(TrySendError::Closed(3))));
+        assert_eq!(sender.counters().snapshot().dropped, 0);
+    }
+
+    #[tokio::test]
+    async fn test_send_waits_for_space() {
+        let (sender, mut receiver) = channel::<u32>("test", 1);
+        sender.send(1).await.unwrap();
+        assert!(tokio::time::timeout(Duration::from_millis(20), sender.send(2))
+            .await
+            .is_err());
+
+        assert_eq!(receiver.recv().await, Some(1));
+        sender.send(2).await.unwrap();
+        assert_eq!(receiver.recv().await, Some(2));
+        assert_eq!(sender.counters().snapshot().depth, 0);
+    }
+}
@@ -0,0 +1,431 @@
+//! GridTokenX Wire Codec
+//!
+//! Every network message travels in a versioned frame:
+//!
+//! ```text
+//! | version u8 | flags u8 | tag u8 | length u32 BE | crc32 u32 BE | payload |
+//! ```
+//!
+//! The payload is bincode, zstd-compressed when `FLAG_ZSTD` is set (see
+//! [`super::compression`]). A message is encoded once, straight into a
+//! reference-counted `Bytes` buffer, and that buffer is handed to the swarm
+//! without copying. Decoding validates the header (version, tag, declared
+//! length against `max_message_size`, checksum) before the payload is
+//! decompressed or deserialized, so an oversized or corrupt frame is rejected
+//! without allocating for it. Uncompressed frames keep the payload as a
+//! zero-copy slice of the received buffer.
+//!
+//! Decoding stops short of borrowed views: `NetworkMessage` owns its fields
+//! (`String`, `Vec`), so [`Frame::message`] copies the payload into an owned
+//! message. Handlers that only route or forward a frame should use its `tag`
+//! and `payload` and skip deserialization.
+
+use anyhow::{anyhow, Result};
+use bytes::{BufMut, Bytes, BytesMut};
+use std::sync::Arc;
+use std::time::Instant;
+
+use super::compression::{self, CodecStats, FrameCompression};
+use super::NetworkMessage;
+
+/// Current wire format version
+pub const WIRE_VERSION: u8 = 2;
+
+/// Bytes before the payload
+pub const FRAME_HEADER_LEN: usize = 11;
+
+/// Payload is zstd-compressed with the shared dictionary
+pub const FLAG_ZSTD: u8 = 0x01;
+
+/// Message type carried in the frame header
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+#[repr(u8)]
+pub enum MessageTag {
+    BlockAnnouncement = 1,
+    CompactBlockAnnouncement = 2,
+    GetBlockTransactions = 3,
+    BlockTransactions = 4,
+    BlockRequest = 5,
+    BlockResponse = 6,
+    TransactionBroadcast = 7,
+    TransactionInventory = 8,
+    GetTransactions = 9,
+    Transactions = 10,
+    SyncRequest = 11,
+    SyncResponse = 12,
+    HeadersRequest = 13,
+    HeadersResponse = 14,
+    PeerInfo = 15,
+    ConsensusMessage = 16,
+    Ping = 17,
+    Pong = 18,
+    BlockChunk = 19,
+}
+
+impl MessageTag {
+    /// Number of message types
+    pub const COUNT: usize = 19;
+
+    pub const ALL: [MessageTag; Self::COUNT] = [
+        MessageTag::BlockAnnouncement,
+        MessageTag::CompactBlockAnnouncement,
+        MessageTag::GetBlockTransactions,
+        MessageTag::BlockTransactions,
+        MessageTag::BlockRequest,
+        MessageTag::BlockResponse,
+        MessageTag::TransactionBroadcast,
+        MessageTag::TransactionInventory,
+        MessageTag::GetTransactions,
+        MessageTag::Transactions,
+        MessageTag::SyncRequest,
+        MessageTag::SyncResponse,
+        MessageTag::HeadersRequest,
+        MessageTag::HeadersResponse,
+        MessageTag::PeerInfo,
+        MessageTag::ConsensusMessage,
+        MessageTag::Ping,
+        MessageTag::Pong,
+        MessageTag::BlockChunk,
+    ];
+
+    /// Tag for a message
+    pub fn of(message: &NetworkMessage) -> Self {
+        match message {
+            NetworkMessage::BlockAnnouncement { .. } => MessageTag::BlockAnnouncement,
+            NetworkMessage::CompactBlockAnnouncement { .. } => MessageTag::CompactBlockAnnouncement,
+            NetworkMessage::GetBlockTransactions { .. } => MessageTag::GetBlockTransactions,
+            NetworkMessage::BlockTransactions { .. } => MessageTag::BlockTransactions,
+            NetworkMessage::BlockRequest { .. } => MessageTag::BlockRequest,
+            NetworkMessage::BlockResponse { .. } => MessageTag::BlockResponse,
+            NetworkMessage::TransactionBroadcast { .. } => MessageTag::TransactionBroadcast,
+            NetworkMessage::TransactionInventory { .. } => MessageTag::TransactionInventory,
+            NetworkMessage::GetTransactions { .. } => MessageTag::GetTransactions,
+            NetworkMessage::Transactions { .. } => MessageTag::Transactions,
+            NetworkMessage::SyncRequest { .. } => MessageTag::SyncRequest,
+            NetworkMessage::SyncResponse { .. } => MessageTag::SyncResponse,
+            NetworkMessage::HeadersRequest { .. } => MessageTag::HeadersRequest,
+            NetworkMessage::HeadersResponse { .. } => MessageTag::HeadersResponse,
+            NetworkMessage::PeerInfo { .. } => MessageTag::PeerInfo,
+            NetworkMessage::ConsensusMessage { .. } => MessageTag::ConsensusMessage,
+            NetworkMessage::Ping { .. } => MessageTag::Ping,
+            NetworkMessage::Pong { .. } => MessageTag::Pong,
+            NetworkMessage::BlockChunk { .. } => MessageTag::BlockChunk,
+        }
+    }
+
+    pub fn from_u8(value: u8) -> Option<Self> {
+        Self::ALL.into_iter().find(|tag| *tag as u8 == value)
+    }
+
+    /// Dense index for per-type tables
+    pub fn index(&self) -> usize {
+        *self as usize - 1
+    }
+}
+
+/// A validated frame whose payload has not been deserialized yet
+#[derive(Debug, Clone)]
+pub struct Frame {
+    pub version: u8,
+    pub tag: MessageTag,
+    /// Uncompressed payload; a zero-copy view unless it was compressed
+    pub payload: Bytes,
+    /// Frame size on the wire
+    pub wire_len: usize,
+}
+
+impl Frame {
+    /// Deserialize the payload into an owned message; this copies out of `payload`
+    pub fn message(&self) -> Result<NetworkMessage> {
+        let message: NetworkMessage = bincode::deserialize(&self.payload)
+            .map_err(|e| anyhow!("Failed to deserialize {:?} payload: {}", self.tag, e))?;
+        if MessageTag::of(&message) != self.tag {
+            return Err(anyhow!("Frame tag {:?} does not match its payload", self.tag));
+        }
+        Ok(message)
+    }
+}
+
+/// Frame encoder/decoder bound to a maximum message size
+#[derive(Debug, Clone)]
+pub struct WireCodec {
+    max_message_size: usize,
+    compression: Option<Arc<FrameCompression>>,
+    stats: Arc<CodecStats>,
+}
+
+impl WireCodec {
+    pub fn new(max_message_size: usize) -> Self {
+        Self {
+            max_message_size,
+            compression: None,
+            stats: Arc::new(CodecStats::default()),
+        }
+    }
+
+    /// Enable compressed frames
+    pub fn with_compression(mut self, compression: Option<FrameCompression>) -> Self {
+        self.compression = compression.map(Arc::new);
+        self
+    }
+
+    /// Compression settings, if enabled
+    pub fn compression(&self) -> Option<&FrameCompression> {
+        self.compression.as_deref()
+    }
+
+    /// Per-message-type byte and timing counters
+    pub fn stats(&self) -> &CodecStats {
+        &self.stats
+    }
+
+    /// Largest frame, header included, that will be encoded or accepted
+    pub fn max_message_size(&self) -> usize {
+        self.max_message_size
+    }
+
+    /// Encode a message once into a shareable buffer
+    pub fn encode(&self, message: &NetworkMessage) -> Result<Bytes> {
+        let started = Instant::now();
+        let tag = MessageTag::of(message);
+        let mut buffer = BytesMut::with_capacity(FRAME_HEADER_LEN + 256);
+        buffer.put_u8(WIRE_VERSION);
+        buffer.put_u8(0); // flags
+        buffer.put_u8(tag as u8);
+        buffer.put_u32(0); // length, patched below
+        buffer.put_u32(0); // checksum, patched below
+
+        let mut writer = buffer.writer();
+        bincode::serialize_into(&mut writer, message)
+            .map_err(|e| anyhow!("Failed to serialize message: {}", e))?;
+        let mut buffer = writer.into_inner();
+        let raw_len = buffer.len() - FRAME_HEADER_LEN;
+
+        if let Some(compression) = self.compression.as_deref() {
+            if compression.should_compress(raw_len) {
+                let compressed = compression.compress(&buffer[FRAME_HEADER_LEN..])?;
+                if compressed.len() < raw_len {
+                    buffer.truncate(FRAME_HEADER_LEN);
+                    buffer.extend_from_slice(&compressed);
+                    buffer[1] |= FLAG_ZSTD;
+                }
+            }
+        }
+
+        if buffer.len() > self.max_message_size {
+            return Err(anyhow!(
+                "Message of {} bytes exceeds the {} byte limit",
+                buffer.len(),
+                self.max_message_size
+            ));
+        }
+        let payload_len = (buffer.len() - FRAME_HEADER_LEN) as u32;
+        let checksum = crc32fast::hash(&buffer[FRAME_HEADER_LEN..]);
+        buffer[3..7].copy_from_slice(&payload_len.to_be_bytes());
+        buffer[7..11].copy_from_slice(&checksum.to_be_bytes());
+
+        self.stats.record_sent(
+            tag,
+            raw_len,
+            buffer.len(),
+            started.elapsed().as_nanos() as u64,
+        );
+        Ok(buffer.freeze())
+    }
+
+    /// Validate a frame header; returns the tag and the total frame length
+    pub fn peek_header(&self, data: &[u8]) -> Result<(MessageTag, usize)> {
+        if data.len() < FRAME_HEADER_LEN {
+            return Err(anyhow!("Frame shorter than its header"));
+        }
+        if data[0] != WIRE_VERSION {
+            return Err(anyhow!("Unsupported wire version {}", data[0]));
+        }
+        if data[1] & !FLAG_ZSTD != 0 {
+            return Err(anyhow!("Unknown frame flags {:#04x}", data[1]));
+        }
+        let tag = MessageTag::from_u8(data[2]).ok_or_else(|| anyhow!("Unknown message tag {}", data[2]))?;
+        let payload_len = u32::from_be_bytes(data[3..7].try_into().unwrap()) as usize;
+        let frame_len = FRAME_HEADER_LEN + payload_len;
+        if frame_len > self.max_message_size {
+            return Err(anyhow!(
+                "Frame of {} bytes exceeds the {} byte limit",
+                frame_len,
+                self.max_message_size
+            ));
+        }
+        Ok((tag, frame_len))
+    }
+
+    /// Validate a complete frame without deserializing its payload
+    pub fn decode_frame(&self, data: Bytes) -> Result<Frame> {
+        let (tag, frame_len) = self.peek_header(&data)?;
+        if data.len() != frame_len {
+            return Err(anyhow!(
+                "Frame length {} does not match header length {}",
+                data.len(),
+                frame_len
+            ));
+        }
+        let checksum = u32::from_be_bytes(data[7..11].try_into().unwrap());
+        let mut payload = data.slice(FRAME_HEADER_LEN..);
+        if crc32fast::hash(&payload) != checksum {
+            return Err(anyhow!("Frame checksum mismatch"));
+        }
+
+        // Relayed frames may be compressed even when our own outbound is not
+        if data[1] & FLAG_ZSTD != 0 {
+            let limit = self.max_message_size.saturating_sub(FRAME_HEADER_LEN);
+            payload = Bytes::from(compression::decompress(&payload, limit)?);
+        }
+
+        Ok(Frame {
+            version: data[0],
+            tag,
+            payload,
+            wire_len: frame_len,
+        })
+    }
+
+    /// Validate and deserialize a complete frame
+    pub fn decode(&self, data: Bytes) -> Result<NetworkMessage> {
+        let started = Instant::now();
+        let frame = self.decode_frame(data)?;
+        let message = frame.message()?;
+        self.stats.record_received(
+            frame.tag,
+            frame.payload.len(),
+            frame.wire_len,
+            started.elapsed().as_nanos() as u64,
+        );
+        Ok(message)
+    }
+
+    /// Split the next frame off a stream buffer; `None` until it is complete
+    pub fn decode_from(&self, buffer: &mut BytesMut) -> Result<Option<Frame>> {
+        if buffer.len() < FRAME_HEADER_LEN {
+            return Ok(None);
+        }
+        let (_, frame_len) = self.peek_header(buffer)?;
+        if buffer.len() < frame_len {
+            buffer.reserve(frame_len - buffer.len());
+            return Ok(None);
+        }
+        self.decode_frame(buffer.split_to(frame_len).freeze()).map(Some)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use chrono::Utc;
+
+    fn ping() -> NetworkMessage {
+        NetworkMessage::Ping {
+            timestamp: Utc::now(),
+            sender: "peer".to_string(),
+            height: 1,
+        }
+    }
+
+    #[test]
+    fn test_round_trip_shares_one_buffer() {
+        let codec = WireCodec::new(1 << 20);
+        let encoded = codec.encode(&ping()).unwrap();
+        assert_eq!(encoded[0], WIRE_VERSION);
+        assert_eq!(encoded[2], MessageTag::Ping as u8);
+
+        // Fan-out clones share the allocation
+        let copy = encoded.clone();
+        assert_eq!(copy.as_ptr(), encoded.as_ptr());
+
+        let frame = codec.decode_frame(copy).unwrap();
+        assert_eq!(frame.tag, MessageTag::Ping);
+        assert_eq!(frame.payload.as_ptr(), encoded[FRAME_HEADER_LEN..].as_ptr());
+        assert!(matches!(frame.message().unwrap(), NetworkMessage::Ping { .. }));
+    }
+
+    #[test]
+    fn test_rejects_oversized_and_corrupt_frames() {
+        let codec = WireCodec::new(1 << 20);
+        let encoded = codec.encode(&ping()).unwrap();
+
+        let mut corrupt = encoded.to_vec();
+        *corrupt.last_mut().unwrap() ^= 0xff;
+        assert!(codec.decode(Bytes::from(corrupt)).is_err());
+
+        // Declared length over the limit is refused from the header alone
+        let mut header = vec![WIRE_VERSION, 0, MessageTag::Ping as u8];
+        header.extend_from_slice(&u32::MAX.to_be_bytes());
+        header.extend_from_slice(&[0; 4]);
+        assert!(codec.peek_header(&header).is_err());
+
+        let tiny = WireCodec::new(FRAME_HEADER_LEN + 4);
+        assert!(tiny.encode(&ping()).is_err());
+        assert!(tiny.decode(encoded).is_err());
+    }
+
+    #[test]
+    fn test_stream_decoding_waits_for_complete_frames() {
+        let codec = WireCodec::new(1 << 20);
+        let first = codec.encode(&ping()).unwrap();
+        let second = codec.encode(&ping()).unwrap();
+
+        let mut stream = BytesMut::new();
+        stream.extend_from_slice(&first[..5]);
+        assert!(codec.decode_from(&mut stream).unwrap().is_none());
+        stream.extend_from_slice(&first[5..]);
+        stream.extend_from_slice(&second);
+
+        assert_eq!(codec.decode_from(&mut stream).unwrap().unwrap().tag, MessageTag::Ping);
+        assert_eq!(codec.decode_from(&mut stream).unwrap().unwrap().tag, MessageTag::Ping);
+        assert!(stream.is_empty());
+    }
+
+    #[test]
+    fn test_large_payloads_are_compressed_when_negotiated() {
+        use crate::blockchain::{Transaction, TransactionType};
+        use crate::config::CompressionConfig;
+
+        let transactions: Vec<Transaction> = (0..50)
+            .map(|nonce| {
+                Transaction::new(
+                    TransactionType::TokenTransfer {
+                        amount: 10,
+                        message: None,
+                    },
+                    "gtx_producer_0001".to_string(),
+                    Some("gtx_consumer_0001".to_string()),
+                    10,
+                    nonce,
+                )
+                .unwrap()
+            })
+            .collect();
+        let message = NetworkMessage::Transactions {
+            transactions,
+            requester: "local".to_string(),
+            responder: "peer".to_string(),
+        };
+
+        let compression = FrameCompression::from_config(&CompressionConfig::default());
+        let codec = WireCodec::new(1 << 20).with_compression(compression);
+        let plain = codec.encode(&message).unwrap();
+        assert_eq!(plain[1], 0); // not negotiated yet
+
+        codec.compression().unwrap().set_outbound(true);
+        let compressed = codec.encode(&message).unwrap();
+        assert_eq!(compressed[1], FLAG_ZSTD);
+        assert!(compressed.len() < plain.len() / 2);
+        assert!(matches!(
+            codec.decode(compressed).unwrap(),
+            NetworkMessage::Transactions { .. }
+        ));
+        // A node with compression disabled still reads compressed frames
+        assert!(matches!(
+            WireCodec::new(1 << 20).decode(codec.encode(&message).unwrap()).unwrap(),
+            NetworkMessage::Transactions { .. }
+        ));
+        assert_eq!(codec.stats().snapshot()[0].messages_received, 1);
+    }
+}
@@ -0,0 +1,332 @@
+//! GridTokenX Compact Block Relay
+//!
+//! Instead of shipping every transaction, a block is announced as its header
+//! plus a 6-byte short id per transaction. Short ids are SipHash-2-4 of the
+//! transaction id, keyed per block from the block hash and a random salt so
+//! collisions cannot be precomputed. Receivers rebuild the block from their
+//! mempool and ask only for the transactions they are missing.
+
+use anyhow::{anyhow, Result};
+use serde::{Deserialize, Serialize};
+use sha2::{Digest, Sha256};
+use std::collections::{HashMap, HashSet};
+
+use crate::blockchain::block::BlockHeader;
+use crate::blockchain::{Block, Transaction};
+
+/// 48-bit short transaction id
+pub type ShortTxId = [u8; 6];
+
+/// Transaction sent in full alongside the short ids
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct PrefilledTransaction {
+    /// Position in the block
+    pub index: u32,
+    pub transaction: Transaction,
+}
+
+/// Header plus short ids for every transaction not prefilled
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct CompactBlock {
+    pub header: BlockHeader,
+    /// Per-announcement salt mixed into the SipHash key
+    pub salt: u64,
+    /// Short ids of the non-prefilled transactions, in block order
+    pub short_ids: Vec<ShortTxId>,
+    pub prefilled: Vec<PrefilledTransaction>,
+}
+
+impl CompactBlock {
+    /// Build a compact block, sending the transactions at `prefill` in full
+    pub fn from_block(block: &Block, salt: u64, prefill: &[usize]) -> Self {
+        let keys = sip_keys(&block.header.hash, salt);
+        let prefill: HashSet<usize> = prefill.iter().copied().collect();
+
+        let mut short_ids = Vec::with_capacity(block.transactions.len());
+        let mut prefilled = Vec::new();
+        for (index, tx) in block.transactions.iter().enumerate() {
+            if prefill.contains(&index) {
+                prefilled.push(PrefilledTransaction {
+                    index: index as u32,
+                    transaction: tx.clone(),
+                });
+            } else {
+                short_ids.push(short_id(keys, &tx.id));
+            }
+        }
+
+        Self {
+            header: block.header.clone(),
+            salt,
+            short_ids,
+            prefilled,
+        }
+    }
+
+    /// Total number of transactions in the block
+    pub fn transaction_count(&self) -> usize {
+        self.short_ids.len() + self.prefilled.len()
+    }
+}
+
+/// Block being reconstructed from a compact announcement
+#[derive(Debug, Clone)]
+pub struct PartialBlock {
+    header: BlockHeader,
+    keys: (u64, u64),
+    slots: Vec<Option<Transaction>>,
+    /// Short id expected at each non-prefilled position
+    expected: HashMap<usize, u64>,
+}
+
+impl PartialBlock {
+    /// Fill as many slots as possible from the local mempool
+    pub fn new(compact: &CompactBlock, mempool: &[Transaction]) -> Result<Self> {
+        let total = compact.transaction_count();
+        let mut slots: Vec<Option<Transaction>> = vec![None; total];
+
+        for prefilled in &compact.prefilled {
+            let slot = slots
+                .get_mut(prefilled.index as usize)
+                .ok_or_else(|| anyhow!("Prefilled index out of range"))?;
+            if slot.is_some() {
+                return Err(anyhow!("Duplicate prefilled index {}", prefilled.index));
+            }
+            *slot = Some(prefilled.transaction.clone());
+        }
+
+        // Non-prefilled positions take the short ids in order
+        let positions = (0..total).filter(|i| slots[*i].is_none());
+        let expected: HashMap<usize, u64> = positions
+            .zip(compact.short_ids.iter().map(short_id_value))
+            .collect();
+
+        let mut by_short_id: HashMap<u64, usize> = HashMap::with_capacity(expected.len());
+        let mut ambiguous: HashSet<usize> = HashSet::new();
+        for (&position, &id) in &expected {
+            if let Some(other) = by_short_id.insert(id, position) {
+                // Two transactions in the block share a short id; fetch both explicitly
+                ambiguous.insert(other);
+                ambiguous.insert(position);
+            }
+        }
+
+        let keys = sip_keys(&compact.header.hash, compact.salt);
+        for tx in mempool {
+            let id = short_id_value(&short_id(keys, &tx.id));
+            let Some(&position) = by_short_id.get(&id) else {
+                continue;
+            };
+            if slots[position].is_some() {
+                ambiguous.insert(position);
+            } else {
+                slots[position] = Some(tx.clone());
+            }
+        }
+        for position in ambiguous {
+            slots[position] = None;
+        }
+
+        Ok(Self {
+            header: compact.header.clone(),
+            keys,
+            slots,
+            expected,
+        })
+    }
+
+    /// Block hash
+    pub fn hash(&self) -> &str {
+        &self.header.hash
+    }
+
+    /// Block height
+    pub fn height(&self) -> u64 {
+        self.header.height
+    }
+
+    /// Positions still to be fetched
+    pub fn missing_indexes(&self) -> Vec<u32> {
+        self.slots
+            .iter()
+            .enumerate()
+            .filter(|(_, slot)| slot.is_none())
+            .map(|(index, _)| index as u32)
+            .collect()
+    }
+
+    /// Transactions at `indexes`, if every one of them is already known
+    pub fn transactions_at(&self, indexes: &[u32]) -> Option<Vec<Transaction>> {
+        indexes
+            .iter()
+            .map(|index| self.slots.get(*index as usize)?.clone())
+            .collect()
+    }
+
+    /// Fill the missing positions (in `missing_indexes` order) and assemble the block
+    pub fn complete(mut self, transactions: Vec<Transaction>) -> Result<Block> {
+        let missing = self.missing_indexes();
+        if missing.len() != transactions.len() {
+            return Err(anyhow!(
+                "Expected {} missing transactions, got {}",
+                missing.len(),
+                transactions.len()
+            ));
+        }
+
+        for (index, tx) in missing.into_iter().zip(transactions) {
+            let index = index as usize;
+            let id = short_id_value(&short_id(self.keys, &tx.id));
+            if self.expected.get(&index) != Some(&id) {
+                return Err(anyhow!("Transaction {} does not match its short id", tx.id));
+            }
+            self.slots[index] = Some(tx);
+        }
+
+        let transactions = self.slots.into_iter().flatten().collect();
+        Block::from_parts(self.header, transactions)
+    }
+}
+
+/// SipHash key for a block announcement
+fn sip_keys(block_hash: &str, salt: u64) -> (u64, u64) {
+    let mut hasher = Sha256::new();
+    hasher.update(block_hash.as_bytes());
+    hasher.update(salt.to_le_bytes());
+    let digest = hasher.finalize();
+    (
+        u64::from_le_bytes(digest[0..8].try_into().unwrap()),
+        u64::from_le_bytes(digest[8..16].try_into().unwrap()),
+    )
+}
+
+/// Short id of a transaction under a block's key
+pub fn short_id(keys: (u64, u64), tx_id: &str) -> ShortTxId {
+    let hash = siphash24(keys.0, keys.1, tx_id.as_bytes()).to_le_bytes();
+    let mut id = [0u8; 6];
+    id.copy_from_slice(&hash[..6]);
+    id
+}
+
+fn short_id_value(id: &ShortTxId) -> u64 {
+    let mut bytes = [0u8; 8];
+    bytes[..6].copy_from_slice(id);
+    u64::from_le_bytes(bytes)
+}
+
+/// SipHash-2-4
+fn siphash24(k0: u64, k1: u64, data: &[u8]) -> u64 {
+    let mut v = [
+        0x736f_6d65_7073_6575 ^ k0,
+        0x646f_7261_6e64_6f6d ^ k1,
+        0x6c79_6765_6e65_7261 ^ k0,
+        0x7465_6462_7974_6573 ^ k1,
+    ];
+
+    let mut chunks = data.chunks_exact(8);
+    for chunk in &mut chunks {
+        let m = u64::from_le_bytes(chunk.try_into().unwrap());
+        v[3] ^= m;
+        sip_round(&mut v);
+        sip_round(&mut v);
+        v[0] ^= m;
+    }
+
+    let mut last = (data.len() as u64 & 0xff) << 56;
+    for (i, byte) in chunks.remainder().iter().enumerate() {
+        last |= (*byte as u64) << (8 * i);
+    }
+    v[3] ^= last;
+    sip_round(&mut v);
+    sip_round(&mut v);
+    v[0] ^= last;
+
+    v[2] ^= 0xff;
+    for _ in 0..4 {
+        sip_round(&mut v);
+    }
+    v[0] ^ v[1] ^ v[2] ^ v[3]
+}
+
+#[inline]
+fn sip_round(v: &mut [u64; 4]) {
+    v[0] = v[0].wrapping_add(v[1]);
+    v[1] = v[1].rotate_left(13) ^ v[0];
+    v[0] = v[0].rotate_left(32);
+    v[2] = v[2].wrapping_add(v[3]);
+    v[3] = v[3].rotate_left(16) ^ v[2];
+    v[0] = v[0].wrapping_add(v[3]);
+    v[3] = v[3].rotate_left(21) ^ v[0];
+    v[2] = v[2].wrapping_add(v[1]);
+    v[1] = v[1].rotate_left(17) ^ v[2];
+    v[2] = v[2].rotate_left(32);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::{TransactionType, ValidatorInfo};
+
+    fn transfers(count: usize) -> Vec<Transaction> {
+        (0..count)
+            .map(|i| {
+                Transaction::new(
+                    TransactionType::TokenTransfer {
+                        amount: 10,
+                        message: Some(format!("payment {}", i)),
+                    },
+                    "sender".to_string(),
+                    Some("receiver".to_string()),
+                    1,
+                    i as u64,
+                )
+                .unwrap()
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_siphash_reference_vectors() {
+        let (k0, k1) = (0x0706_0504_0302_0100, 0x0f0e_0d0c_0b0a_0908);
+        assert_eq!(siphash24(k0, k1, &[]), 0x726f_db47_dd0e_0e31);
+        let message: Vec<u8> = (0..15).collect();
+        assert_eq!(siphash24(k0, k1, &message), 0xa129_ca61_49be_45e5);
+    }
+
+    #[test]
+    fn test_reconstruct_requests_only_missing_transactions() {
+        let transactions = transfers(10);
+        let block =
+            Block::new("parent".to_string(), transactions.clone(), 1, ValidatorInfo::default())
+                .unwrap();
+        let compact = CompactBlock::from_block(&block, 42, &[0]);
+
+        // Mempool lacks transaction 7
+        let mempool: Vec<Transaction> = transactions[1..]
+            .iter()
+            .enumerate()
+            .filter(|(i, _)| *i != 6)
+            .map(|(_, tx)| tx.clone())
+            .collect();
+        let partial = PartialBlock::new(&compact, &mempool).unwrap();
+        assert_eq!(partial.missing_indexes(), vec![7]);
+        assert_eq!(partial.transactions_at(&[0, 3]).unwrap()[1].id, transactions[3].id);
+        assert!(partial.transactions_at(&[7]).is_none());
+
+        assert!(partial.clone().complete(vec![transactions[6].clone()]).is_err());
+        let rebuilt = partial.complete(vec![transactions[7].clone()]).unwrap();
+        assert_eq!(rebuilt.header.hash, block.header.hash);
+        assert_eq!(rebuilt.transactions.len(), 10);
+        assert_eq!(rebuilt.transactions[7].id, transactions[7].id);
+    }
+
+    #[test]
+    fn test_compact_announcement_saves_bandwidth() {
+        let block = Block::new("parent".to_string(), transfers(1000), 1, ValidatorInfo::default())
+            .unwrap();
+        let full = bincode::serialize(&block).unwrap().len();
+        let compact = bincode::serialize(&CompactBlock::from_block(&block, 7, &[])).unwrap().len();
+
+        assert!(compact * 10 < full, "compact {} vs full {}", compact, full);
+    }
+}
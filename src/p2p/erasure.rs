@@ -0,0 +1,343 @@
+//! GridTokenX Erasure-Coded Block Propagation
+//!
+//! Large blocks can be announced as Reed-Solomon chunks instead of one large
+//! message. A block's encoding is split into `k` data shards and `m` parity
+//! shards over GF(2^8), and any `k` of the `n = k + m` chunks rebuild it. The
+//! producer hands each neighbour a different share of the chunks, so they
+//! travel the mesh in parallel along different paths, and a node can rebuild
+//! the block from the first `k` that arrive instead of waiting for the
+//! slowest link. A node relays only the chunks it receives before it can
+//! rebuild, at most `k` per link, so parity costs bandwidth only where chunks
+//! were actually lost or late.
+//!
+//! The code is systematic: data shards are the payload itself and parity
+//! rows come from a Cauchy matrix, so every `k x k` submatrix of the
+//! generator is invertible.
+
+use anyhow::{anyhow, Result};
+use std::sync::OnceLock;
+use std::time::Instant;
+
+/// Most chunks a block may be split into (GF(2^8) has 256 elements)
+pub const MAX_SHARDS: usize = 256;
+
+/// Log and exponent tables for GF(2^8) with polynomial x^8+x^4+x^3+x^2+1
+struct Field {
+    exp: [u8; 512],
+    log: [u8; 256],
+}
+
+fn field() -> &'static Field {
+    static FIELD: OnceLock<Field> = OnceLock::new();
+    FIELD.get_or_init(|| {
+        let mut exp = [0u8; 512];
+        let mut log = [0u8; 256];
+        let mut x: u16 = 1;
+        for i in 0..255 {
+            exp[i] = x as u8;
+            log[x as usize] = i as u8;
+            x <<= 1;
+            if x & 0x100 != 0 {
+                x ^= 0x11d;
+            }
+        }
+        for i in 255..512 {
+            exp[i] = exp[i - 255];
+        }
+        Field { exp, log }
+    })
+}
+
+fn mul(a: u8, b: u8) -> u8 {
+    if a == 0 || b == 0 {
+        return 0;
+    }
+    let field = field();
+    field.exp[field.log[a as usize] as usize + field.log[b as usize] as usize]
+}
+
+fn inv(a: u8) -> u8 {
+    let field = field();
+    field.exp[255 - field.log[a as usize] as usize]
+}
+
+/// `out ^= coefficient * input`, byte by byte
+fn mul_add(out: &mut [u8], input: &[u8], coefficient: u8) {
+    if coefficient == 0 {
+        return;
+    }
+    let mut row = [0u8; 256];
+    for (x, product) in row.iter_mut().enumerate() {
+        *product = mul(coefficient, x as u8);
+    }
+    for (out, input) in out.iter_mut().zip(input) {
+        *out ^= row[*input as usize];
+    }
+}
+
+/// Systematic Reed-Solomon code with `data_shards` of `total_shards` needed
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ErasureCoder {
+    data_shards: usize,
+    total_shards: usize,
+}
+
+impl ErasureCoder {
+    pub fn new(data_shards: usize, parity_shards: usize) -> Result<Self> {
+        let total_shards = data_shards + parity_shards;
+        if data_shards == 0 || total_shards > MAX_SHARDS {
+            return Err(anyhow!(
+                "Invalid erasure code: {} data and {} parity shards",
+                data_shards,
+                parity_shards
+            ));
+        }
+        Ok(Self {
+            data_shards,
+            total_shards,
+        })
+    }
+
+    pub fn data_shards(&self) -> usize {
+        self.data_shards
+    }
+
+    pub fn total_shards(&self) -> usize {
+        self.total_shards
+    }
+
+    /// Length of every shard for a payload
+    pub fn shard_len(&self, payload_len: usize) -> usize {
+        payload_len.div_ceil(self.data_shards).max(1)
+    }
+
+    /// Generator coefficient of shard `row` for data shard `column`
+    fn coefficient(&self, row: usize, column: usize) -> u8 {
+        if row < self.data_shards {
+            (row == column) as u8
+        } else {
+            // Cauchy entry 1 / (x_row + y_column); rows and columns never collide
+            inv(row as u8 ^ column as u8)
+        }
+    }
+
+    /// Split a payload into `total_shards` equal-length shards
+    pub fn encode(&self, payload: &[u8]) -> Vec<Vec<u8>> {
+        let shard_len = self.shard_len(payload.len());
+        let mut shards: Vec<Vec<u8>> = (0..self.data_shards)
+            .map(|index| {
+                let start = (index * shard_len).min(payload.len());
+                let end = (start + shard_len).min(payload.len());
+                let mut shard = payload[start..end].to_vec();
+                shard.resize(shard_len, 0);
+                shard
+            })
+            .collect();
+        for row in self.data_shards..self.total_shards {
+            let mut parity = vec![0u8; shard_len];
+            for (column, data) in shards[..self.data_shards].iter().enumerate() {
+                mul_add(&mut parity, data, self.coefficient(row, column));
+            }
+            shards.push(parity);
+        }
+        shards
+    }
+
+    /// Rebuild the payload from at least `data_shards` distinct `(index, shard)` pairs
+    pub fn decode(&self, shards: &[(usize, &[u8])], payload_len: usize) -> Result<Vec<u8>> {
+        let shard_len = self.shard_len(payload_len);
+        let mut chosen: Vec<(usize, &[u8])> = Vec::with_capacity(self.data_shards);
+        for &(index, shard) in shards {
+            if index >= self.total_shards || shard.len() != shard_len {
+                return Err(anyhow!("Invalid shard {} of {} bytes", index, shard.len()));
+            }
+            if chosen.len() < self.data_shards && !chosen.iter().any(|(seen, _)| *seen == index) {
+                chosen.push((index, shard));
+            }
+        }
+        if chosen.len() < self.data_shards {
+            return Err(anyhow!(
+                "Need {} shards to decode, have {}",
+                self.data_shards,
+                chosen.len()
+            ));
+        }
+        chosen.sort_by_key(|(index, _)| *index);
+
+        let mut payload = Vec::with_capacity(shard_len * self.data_shards);
+        if chosen.iter().enumerate().all(|(position, (index, _))| position == *index) {
+            // Every data shard arrived; nothing to solve
+            for (_, shard) in &chosen {
+                payload.extend_from_slice(shard);
+            }
+        } else {
+            let decoder = self.invert(&chosen)?;
+            for row in &decoder {
+                let mut data = vec![0u8; shard_len];
+                for ((_, shard), coefficient) in chosen.iter().zip(row) {
+                    mul_add(&mut data, shard, *coefficient);
+                }
+                payload.extend_from_slice(&data);
+            }
+        }
+        payload.truncate(payload_len);
+        Ok(payload)
+    }
+
+    /// Inverse of the generator rows of the chosen shards (Gauss-Jordan)
+    fn invert(&self, chosen: &[(usize, &[u8])]) -> Result<Vec<Vec<u8>>> {
+        let k = self.data_shards;
+        let mut matrix: Vec<Vec<u8>> = chosen
+            .iter()
+            .map(|(index, _)| (0..k).map(|column| self.coefficient(*index, column)).collect())
+            .collect();
+        let mut inverse: Vec<Vec<u8>> = (0..k)
+            .map(|row| (0..k).map(|column| (row == column) as u8).collect())
+            .collect();
+
+        for column in 0..k {
+            let pivot = (column..k)
+                .find(|row| matrix[*row][column] != 0)
+                .ok_or_else(|| anyhow!("Erasure decoding matrix is singular"))?;
+            matrix.swap(column, pivot);
+            inverse.swap(column, pivot);
+
+            let scale = inv(matrix[column][column]);
+            for value in matrix[column].iter_mut().chain(inverse[column].iter_mut()) {
+                *value = mul(*value, scale);
+            }
+            for row in 0..k {
+                let factor = matrix[row][column];
+                if row == column || factor == 0 {
+                    continue;
+                }
+                for c in 0..k {
+                    matrix[row][c] ^= mul(factor, matrix[column][c]);
+                    inverse[row][c] ^= mul(factor, inverse[column][c]);
+                }
+            }
+        }
+        Ok(inverse)
+    }
+}
+
+/// Chunks of one block received so far
+#[derive(Debug)]
+pub struct ChunkAssembly {
+    coder: ErasureCoder,
+    payload_len: usize,
+    shards: Vec<Option<Vec<u8>>>,
+    received: usize,
+    /// Set once the block has been rebuilt; later chunks are ignored
+    done: bool,
+    pub started: Instant,
+}
+
+impl ChunkAssembly {
+    pub fn new(coder: ErasureCoder, payload_len: usize, now: Instant) -> Self {
+        Self {
+            coder,
+            payload_len,
+            shards: vec![None; coder.total_shards()],
+            received: 0,
+            done: false,
+            started: now,
+        }
+    }
+
+    /// Whether a chunk describes the same encoding as this assembly
+    pub fn matches(&self, coder: ErasureCoder, payload_len: usize) -> bool {
+        self.coder == coder && self.payload_len == payload_len
+    }
+
+    pub fn is_done(&self) -> bool {
+        self.done
+    }
+
+    /// Whether the chunk at `index` has already been stored
+    pub fn has(&self, index: usize) -> bool {
+        self.shards.get(index).is_some_and(Option::is_some)
+    }
+
+    /// Store a chunk; returns the payload once enough chunks have arrived
+    pub fn add(&mut self, index: usize, chunk: Vec<u8>) -> Result<Option<Vec<u8>>> {
+        if self.done || self.shards.get(index).is_some_and(Option::is_some) {
+            return Ok(None);
+        }
+        if index >= self.shards.len() || chunk.len() != self.coder.shard_len(self.payload_len) {
+            return Err(anyhow!("Chunk {} does not fit its block encoding", index));
+        }
+        self.shards[index] = Some(chunk);
+        self.received += 1;
+        if self.received < self.coder.data_shards() {
+            return Ok(None);
+        }
+
+        self.done = true;
+        let shards: Vec<(usize, &[u8])> = self
+            .shards
+            .iter()
+            .enumerate()
+            .filter_map(|(index, shard)| Some((index, shard.as_deref()?)))
+            .collect();
+        let payload = self.coder.decode(&shards, self.payload_len)?;
+        self.shards.clear();
+        Ok(Some(payload))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_field_inverse() {
+        for a in 1..=255u8 {
+            assert_eq!(mul(a, inv(a)), 1);
+        }
+        assert_eq!(mul(0, 7), 0);
+    }
+
+    #[test]
+    fn test_any_k_of_n_shards_rebuild_the_payload() {
+        let coder = ErasureCoder::new(4, 3).unwrap();
+        let payload: Vec<u8> = (0..1_001u32).map(|i| (i * 31 % 251) as u8).collect();
+        let shards = coder.encode(&payload);
+        assert_eq!(shards.len(), 7);
+        assert!(shards.iter().all(|shard| shard.len() == coder.shard_len(payload.len())));
+
+        // Every 4-subset of the 7 shards
+        for mask in 0u32..(1 << 7) {
+            if mask.count_ones() != 4 {
+                continue;
+            }
+            let subset: Vec<(usize, &[u8])> = (0..7)
+                .filter(|index| mask & (1 << index) != 0)
+                .map(|index| (index, shards[index].as_slice()))
+                .collect();
+            assert_eq!(coder.decode(&subset, payload.len()).unwrap(), payload);
+        }
+
+        let three: Vec<(usize, &[u8])> = (4..7).map(|i| (i, shards[i].as_slice())).collect();
+        assert!(coder.decode(&three, payload.len()).is_err());
+        assert!(ErasureCoder::new(200, 100).is_err());
+    }
+
+    #[test]
+    fn test_assembly_completes_once_and_rejects_bad_chunks() {
+        let coder = ErasureCoder::new(2, 2).unwrap();
+        let payload = b"grid block payload".to_vec();
+        let shards = coder.encode(&payload);
+        let mut assembly = ChunkAssembly::new(coder, payload.len(), Instant::now());
+
+        assert!(assembly.add(3, vec![0; 3]).is_err());
+        assert!(assembly.add(9, shards[0].clone()).is_err());
+        assert!(!assembly.has(3));
+        assert_eq!(assembly.add(3, shards[3].clone()).unwrap(), None);
+        assert!(assembly.has(3) && !assembly.has(9));
+        assert_eq!(assembly.add(3, shards[3].clone()).unwrap(), None);
+        assert_eq!(assembly.add(1, shards[1].clone()).unwrap(), Some(payload));
+        assert!(assembly.is_done());
+        assert_eq!(assembly.add(0, shards[0].clone()).unwrap(), None);
+    }
+}
@@ -0,0 +1,351 @@
+//! GridTokenX Transaction Inventory
+//!
+//! Transactions are relayed by inventory: nodes announce batches of
+//! transaction ids to each neighbour directly, and receivers fetch only the
+//! ids they have not seen from the neighbour that announced them. A rolling
+//! bloom filter remembers every id this node has seen, and one per connected
+//! neighbour remembers what that neighbour is known to have, so ids are never
+//! announced back to the peers they came from. Memory stays bounded no matter
+//! how many transactions pass through.
+
+use std::collections::hash_map::RandomState;
+use std::collections::{HashMap, VecDeque};
+use std::hash::BuildHasher;
+use std::time::{Duration, Instant};
+
+use crate::blockchain::Transaction;
+
+/// Ids remembered per generation of the seen filter
+const SEEN_CAPACITY: usize = 50_000;
+/// Ids remembered per generation of a peer's known-inventory filter
+const PEER_KNOWN_CAPACITY: usize = 10_000;
+/// Target false-positive rate for inventory filters
+const FALSE_POSITIVE_RATE: f64 = 0.001;
+/// Transactions kept for answering requests after announcing them
+const RELAY_CACHE_SIZE: usize = 4096;
+/// Time to wait for a requested transaction before asking another announcer
+const REQUEST_TIMEOUT: Duration = Duration::from_secs(10);
+
+/// Fixed-size bloom filter over string keys
+#[derive(Debug, Clone)]
+pub struct BloomFilter {
+    bits: Vec<u64>,
+    num_bits: u64,
+    hashes: u32,
+    state: RandomState,
+    count: usize,
+}
+
+impl BloomFilter {
+    /// Size the filter for `capacity` items at the given false-positive rate
+    pub fn new(capacity: usize, false_positive_rate: f64) -> Self {
+        let capacity = capacity.max(1) as f64;
+        let ln2 = std::f64::consts::LN_2;
+        let num_bits = (-capacity * false_positive_rate.ln() / (ln2 * ln2)).ceil().max(64.0) as u64;
+        let hashes = ((num_bits as f64 / capacity) * ln2).round().clamp(1.0, 16.0) as u32;
+        Self {
+            bits: vec![0; num_bits.div_ceil(64) as usize],
+            num_bits,
+            hashes,
+            state: RandomState::new(),
+            count: 0,
+        }
+    }
+
+    /// Bit positions via double hashing
+    fn positions(&self, item: &str) -> impl Iterator<Item = u64> + '_ {
+        let hash = self.state.hash_one(item);
+        let (h1, h2) = (hash & 0xffff_ffff, (hash >> 32) | 1);
+        (0..self.hashes as u64).map(move |i| h1.wrapping_add(i.wrapping_mul(h2)) % self.num_bits)
+    }
+
+    pub fn insert(&mut self, item: &str) {
+        let positions: Vec<u64> = self.positions(item).collect();
+        for bit in positions {
+            self.bits[(bit / 64) as usize] |= 1 << (bit % 64);
+        }
+        self.count += 1;
+    }
+
+    pub fn contains(&self, item: &str) -> bool {
+        self.positions(item)
+            .all(|bit| self.bits[(bit / 64) as usize] & (1 << (bit % 64)) != 0)
+    }
+
+    /// Number of insertions since the last clear
+    pub fn len(&self) -> usize {
+        self.count
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.count == 0
+    }
+
+    pub fn clear(&mut self) {
+        self.bits.iter_mut().for_each(|word| *word = 0);
+        self.count = 0;
+    }
+}
+
+/// Two-generation bloom filter that forgets the oldest ids once full
+#[derive(Debug, Clone)]
+pub struct RollingBloom {
+    current: BloomFilter,
+    previous: BloomFilter,
+    capacity: usize,
+}
+
+impl RollingBloom {
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            current: BloomFilter::new(capacity, FALSE_POSITIVE_RATE),
+            previous: BloomFilter::new(capacity, FALSE_POSITIVE_RATE),
+            capacity: capacity.max(1),
+        }
+    }
+
+    pub fn insert(&mut self, item: &str) {
+        if self.current.len() >= self.capacity {
+            std::mem::swap(&mut self.current, &mut self.previous);
+            self.current.clear();
+        }
+        self.current.insert(item);
+    }
+
+    pub fn contains(&self, item: &str) -> bool {
+        self.current.contains(item) || self.previous.contains(item)
+    }
+}
+
+/// Inventory relay state shared by announcement, request and response handling
+#[derive(Debug)]
+pub struct InventoryTracker {
+    seen: RollingBloom,
+    peer_known: HashMap<String, RollingBloom>,
+    relay: HashMap<String, Transaction>,
+    relay_order: VecDeque<String>,
+    outgoing: Vec<String>,
+    requested: HashMap<String, Instant>,
+}
+
+impl InventoryTracker {
+    pub fn new() -> Self {
+        Self {
+            seen: RollingBloom::new(SEEN_CAPACITY),
+            peer_known: HashMap::new(),
+            relay: HashMap::new(),
+            relay_order: VecDeque::new(),
+            outgoing: Vec::new(),
+            requested: HashMap::new(),
+        }
+    }
+
+    pub fn add_peer(&mut self, peer: &str) {
+        self.peer_known
+            .entry(peer.to_string())
+            .or_insert_with(|| RollingBloom::new(PEER_KNOWN_CAPACITY));
+    }
+
+    pub fn remove_peer(&mut self, peer: &str) {
+        self.peer_known.remove(peer);
+    }
+
+    /// Whether a transaction id has been seen before
+    pub fn has_seen(&self, tx_id: &str) -> bool {
+        self.seen.contains(tx_id)
+    }
+
+    /// Record a neighbour's announcement and return the ids worth requesting.
+    ///
+    /// Only connected neighbours have a filter; announcements never create one.
+    pub fn on_announcement(&mut self, peer: &str, tx_ids: Vec<String>, now: Instant) -> Vec<String> {
+        let mut known = self.peer_known.get_mut(peer);
+
+        let mut wanted = Vec::new();
+        for tx_id in tx_ids {
+            if let Some(known) = known.as_deref_mut() {
+                known.insert(&tx_id);
+            }
+            if self.seen.contains(&tx_id) || self.requested.contains_key(&tx_id) {
+                continue;
+            }
+            self.requested.insert(tx_id.clone(), now);
+            wanted.push(tx_id);
+        }
+        wanted
+    }
+
+    /// Record a valid transaction and queue it for announcement
+    pub fn accept(&mut self, transaction: Transaction, from: Option<&str>) {
+        let tx_id = transaction.id.clone();
+        self.seen.insert(&tx_id);
+        self.requested.remove(&tx_id);
+        if let Some(known) = from.and_then(|peer| self.peer_known.get_mut(peer)) {
+            known.insert(&tx_id);
+        }
+
+        if self.relay.insert(tx_id.clone(), transaction).is_none() {
+            self.relay_order.push_back(tx_id.clone());
+            if self.relay_order.len() > RELAY_CACHE_SIZE {
+                if let Some(oldest) = self.relay_order.pop_front() {
+                    self.relay.remove(&oldest);
+                }
+            }
+        }
+        self.outgoing.push(tx_id);
+    }
+
+    /// Record an invalid transaction so it is not requested again
+    pub fn reject(&mut self, tx_id: &str) {
+        self.seen.insert(tx_id);
+        self.requested.remove(tx_id);
+    }
+
+    /// Drain queued ids into one announcement per connected peer, holding only
+    /// the ids that peer may not have.
+    ///
+    /// Announced ids are marked known for the peer they are sent to.
+    pub fn take_announcements(&mut self) -> Vec<(String, Vec<String>)> {
+        let outgoing = std::mem::take(&mut self.outgoing);
+        let mut announcements = Vec::new();
+        for (peer, known) in &mut self.peer_known {
+            let tx_ids: Vec<String> = outgoing
+                .iter()
+                .filter(|tx_id| !known.contains(tx_id))
+                .cloned()
+                .collect();
+            if tx_ids.is_empty() {
+                continue;
+            }
+            for tx_id in &tx_ids {
+                known.insert(tx_id);
+            }
+            announcements.push((peer.clone(), tx_ids));
+        }
+        announcements
+    }
+
+    /// Transactions available to answer a request; the requester now knows them
+    pub fn lookup(&mut self, requester: &str, tx_ids: &[String]) -> Vec<Transaction> {
+        let found: Vec<Transaction> = tx_ids
+            .iter()
+            .filter_map(|tx_id| self.relay.get(tx_id).cloned())
+            .collect();
+        if let Some(known) = self.peer_known.get_mut(requester) {
+            for tx in &found {
+                known.insert(&tx.id);
+            }
+        }
+        found
+    }
+
+    /// Forget requests that went unanswered so another announcer can be asked
+    pub fn expire_requests(&mut self, now: Instant) {
+        self.requested
+            .retain(|_, requested_at| now.duration_since(*requested_at) < REQUEST_TIMEOUT);
+    }
+}
+
+impl Default for InventoryTracker {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::TransactionType;
+
+    fn transfer(nonce: u64) -> Transaction {
+        Transaction::new(
+            TransactionType::TokenTransfer {
+                amount: 1,
+                message: None,
+            },
+            "alice".to_string(),
+            Some("bob".to_string()),
+            1,
+            nonce,
+        )
+        .unwrap()
+    }
+
+    #[test]
+    fn test_bloom_filter_has_no_false_negatives_and_rolls_over() {
+        let mut filter = BloomFilter::new(1000, 0.01);
+        for i in 0..1000 {
+            filter.insert(&format!("tx-{}", i));
+        }
+        assert!((0..1000).all(|i| filter.contains(&format!("tx-{}", i))));
+        let false_positives = (1000..11_000)
+            .filter(|i| filter.contains(&format!("tx-{}", i)))
+            .count();
+        assert!(false_positives < 300, "{} false positives", false_positives);
+
+        let mut rolling = RollingBloom::new(10);
+        for i in 0..25 {
+            rolling.insert(&format!("tx-{}", i));
+        }
+        assert!(rolling.contains("tx-24"));
+        assert!(!rolling.contains("tx-0"));
+    }
+
+    #[test]
+    fn test_announcements_request_only_unseen_ids_once() {
+        let mut inventory = InventoryTracker::new();
+        let known = transfer(1);
+        inventory.accept(known.clone(), None);
+
+        let now = Instant::now();
+        let ids = vec![known.id.clone(), "new".to_string()];
+        assert_eq!(inventory.on_announcement("a", ids.clone(), now), vec!["new"]);
+        // A second announcer does not trigger a duplicate request
+        assert!(inventory.on_announcement("b", ids.clone(), now).is_empty());
+
+        inventory.expire_requests(now + REQUEST_TIMEOUT);
+        assert_eq!(inventory.on_announcement("b", ids, now), vec!["new"]);
+    }
+
+    #[test]
+    fn test_ids_are_not_echoed_to_peers_that_have_them() {
+        let mut inventory = InventoryTracker::new();
+        inventory.add_peer("a");
+        inventory.add_peer("b");
+
+        let from_a = transfer(1);
+        inventory.on_announcement("a", vec![from_a.id.clone()], Instant::now());
+        inventory.accept(from_a.clone(), Some("a"));
+        let local = transfer(2);
+        inventory.accept(local.clone(), None);
+
+        // a only lacks the local one, b has neither yet
+        let mut announcements = inventory.take_announcements();
+        announcements.sort();
+        assert_eq!(
+            announcements,
+            vec![
+                ("a".to_string(), vec![local.id.clone()]),
+                ("b".to_string(), vec![from_a.id.clone(), local.id.clone()]),
+            ]
+        );
+
+        // Once every peer has it, re-queuing does not announce again
+        inventory.accept(local.clone(), None);
+        assert!(inventory.take_announcements().is_empty());
+        assert_eq!(inventory.lookup("b", &[local.id.clone()]).len(), 1);
+    }
+
+    #[test]
+    fn test_announcements_from_non_neighbours_create_no_filter() {
+        let mut inventory = InventoryTracker::new();
+        let now = Instant::now();
+        assert_eq!(inventory.on_announcement("stranger", vec!["x".to_string()], now), vec!["x"]);
+        assert!(inventory.peer_known.is_empty());
+
+        inventory.add_peer("a");
+        inventory.remove_peer("a");
+        inventory.on_announcement("a", vec!["y".to_string()], now);
+        assert!(inventory.peer_known.is_empty());
+    }
+}
@@ -0,0 +1,319 @@
+//! GridTokenX Light-Client Protocol
+//!
+//! Smart meters and mobile wallets that cannot hold the chain ask full nodes
+//! for what they need over a request/response protocol ([`LIGHT_PROTOCOL`])
+//! instead of the REST API: ranges of block headers, Merkle proofs that a
+//! transaction is in a block, and account state. Recent headers are answered
+//! from memory, and each client has its own request budget.
+
+use anyhow::{anyhow, Result};
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashMap};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Instant;
+use tokio::sync::RwLock;
+
+use super::limits::TokenBucket;
+use crate::blockchain::block::{BlockHeader, TransactionProof};
+use crate::blockchain::{Account, Blockchain, Transaction};
+use crate::config::LightClientConfig;
+
+/// Protocol name negotiated on light-client streams
+pub const LIGHT_PROTOCOL: &str = "/gridtokenx/light/1";
+/// Idle client budgets are forgotten once this many clients are tracked
+const MAX_TRACKED_CLIENTS: usize = 1024;
+
+/// Request from a light client
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub enum LightRequest {
+    /// Headers from `start_height`, at most `count`
+    Headers { start_height: u64, count: u64 },
+    /// Inclusion proof for a transaction in a block
+    TransactionProof { block_hash: String, tx_id: String },
+    /// Current state of an account
+    AccountState { address: String },
+}
+
+/// Answer to a [`LightRequest`]
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub enum LightResponse {
+    Headers(Vec<BlockHeader>),
+    /// Check with `proof.verify(transaction.hash(), header.merkle_root)`
+    TransactionProof {
+        header: BlockHeader,
+        transaction: Transaction,
+        proof: TransactionProof,
+    },
+    /// Account as of the block at `height`; headers do not commit to state,
+    /// so this is only as trustworthy as the serving node
+    AccountState {
+        account: Option<Account>,
+        height: u64,
+        block_hash: String,
+    },
+    Error(String),
+}
+
+/// Requests served and refused
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct LightServerStats {
+    pub requests_served: u64,
+    pub requests_rate_limited: u64,
+    pub cached_headers: usize,
+}
+
+/// Answers light-client requests from the local chain
+#[derive(Debug)]
+pub struct LightServer {
+    config: LightClientConfig,
+    blockchain: Arc<RwLock<Blockchain>>,
+    /// Recent headers by height
+    headers: Mutex<BTreeMap<u64, BlockHeader>>,
+    clients: Mutex<HashMap<String, TokenBucket>>,
+    served: AtomicU64,
+    rate_limited: AtomicU64,
+}
+
+impl LightServer {
+    pub fn new(config: LightClientConfig, blockchain: Arc<RwLock<Blockchain>>) -> Self {
+        Self {
+            config,
+            blockchain,
+            headers: Mutex::new(BTreeMap::new()),
+            clients: Mutex::new(HashMap::new()),
+            served: AtomicU64::new(0),
+            rate_limited: AtomicU64::new(0),
+        }
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.config.enabled
+    }
+
+    /// Keep a header for later requests, evicting the oldest
+    pub fn cache_header(&self, header: BlockHeader) {
+        let Ok(mut headers) = self.headers.lock() else {
+            return;
+        };
+        headers.insert(header.height, header);
+        while headers.len() > self.config.header_cache_size {
+            headers.pop_first();
+        }
+    }
+
+    /// Take one request from the client's budget
+    fn admit(&self, client: &str, now: Instant) -> bool {
+        let Ok(mut clients) = self.clients.lock() else {
+            return false;
+        };
+        if clients.len() >= MAX_TRACKED_CLIENTS && !clients.contains_key(client) {
+            clients.retain(|_, bucket| !bucket.is_full(now));
+        }
+        let rate = self.config.requests_per_second.max(1) as f64;
+        clients
+            .entry(client.to_string())
+            .or_insert_with(|| TokenBucket::new(rate, rate, now))
+            .try_take(now)
+    }
+
+    /// Answer a request from `client`
+    pub async fn serve(&self, client: &str, request: LightRequest) -> LightResponse {
+        if !self.admit(client, Instant::now()) {
+            self.rate_limited.fetch_add(1, Ordering::Relaxed);
+            return LightResponse::Error("Rate limit exceeded".to_string());
+        }
+        self.served.fetch_add(1, Ordering::Relaxed);
+        match self.answer(request).await {
+            Ok(response) => response,
+            Err(e) => LightResponse::Error(e.to_string()),
+        }
+    }
+
+    async fn answer(&self, request: LightRequest) -> Result<LightResponse> {
+        match request {
+            LightRequest::Headers {
+                start_height,
+                count,
+            } => Ok(LightResponse::Headers(self.headers(start_height, count).await?)),
+            LightRequest::TransactionProof { block_hash, tx_id } => {
+                let block = self.blockchain.read().await.get_block_by_hash(&block_hash).await?;
+                let proof = block
+                    .transaction_proof(&tx_id)?
+                    .ok_or_else(|| anyhow!("Transaction {} is not in block {}", tx_id, block_hash))?;
+                let transaction = block.transactions[proof.index as usize].clone();
+                Ok(LightResponse::TransactionProof {
+                    header: block.header,
+                    transaction,
+                    proof,
+                })
+            }
+            LightRequest::AccountState { address } => {
+                let blockchain = self.blockchain.read().await;
+                let tip = blockchain
+                    .get_height()
+                    .await?
+                    .checked_sub(1)
+                    .ok_or_else(|| anyhow!("Chain is empty"))?;
+                let block_hash = match self.cached(tip) {
+                    Some(header) => header.hash,
+                    None => blockchain.get_block_by_height(tip).await?.header.hash,
+                };
+                Ok(LightResponse::AccountState {
+                    account: blockchain.get_account(&address).await,
+                    height: tip,
+                    block_hash,
+                })
+            }
+        }
+    }
+
+    fn cached(&self, height: u64) -> Option<BlockHeader> {
+        self.headers.lock().ok()?.get(&height).cloned()
+    }
+
+    async fn headers(&self, start_height: u64, count: u64) -> Result<Vec<BlockHeader>> {
+        let count = count.min(self.config.max_headers_per_request);
+        let blockchain = self.blockchain.read().await;
+        let end = start_height
+            .saturating_add(count)
+            .min(blockchain.get_height().await?);
+
+        let mut headers = Vec::new();
+        for height in start_height..end {
+            let header = match self.cached(height) {
+                Some(header) => header,
+                None => match blockchain.get_block_by_height(height).await {
+                    Ok(block) => {
+                        self.cache_header(block.header.clone());
+                        block.header
+                    }
+                    Err(_) => break,
+                },
+            };
+            headers.push(header);
+        }
+        Ok(headers)
+    }
+
+    pub fn stats(&self) -> LightServerStats {
+        LightServerStats {
+            requests_served: self.served.load(Ordering::Relaxed),
+            requests_rate_limited: self.rate_limited.load(Ordering::Relaxed),
+            cached_headers: self.headers.lock().map(|headers| headers.len()).unwrap_or(0),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::{Block, ValidatorInfo};
+    use crate::storage::StorageManager;
+
+    async fn server(config: LightClientConfig) -> (LightServer, Block, Block) {
+        let mut chain = Blockchain::new(Arc::new(StorageManager::new_memory())).await.unwrap();
+        let genesis = Block::new_genesis(
+            vec![Transaction::new_genesis_mint("system".to_string(), 1_000, "Mint".to_string())
+                .unwrap()],
+            "Test Genesis".to_string(),
+        )
+        .unwrap();
+        chain.add_genesis_block(genesis.clone()).await.unwrap();
+        let block1 = Block::new(genesis.header.hash.clone(), vec![], 1, ValidatorInfo::default())
+            .unwrap();
+        chain.add_block(block1.clone()).await.unwrap();
+        let server = LightServer::new(config, Arc::new(RwLock::new(chain)));
+        (server, genesis, block1)
+    }
+
+    #[tokio::test]
+    async fn test_header_ranges_are_capped_and_cached() {
+        let config = LightClientConfig {
+            max_headers_per_request: 1,
+            ..LightClientConfig::default()
+        };
+        let (server, genesis, block1) = server(config).await;
+
+        let LightResponse::Headers(headers) = server
+            .serve("meter", LightRequest::Headers { start_height: 0, count: 10 })
+            .await
+        else {
+            panic!("expected headers");
+        };
+        assert_eq!(headers.len(), 1);
+        assert_eq!(headers[0].hash, genesis.header.hash);
+
+        let LightResponse::Headers(headers) = server
+            .serve("meter", LightRequest::Headers { start_height: 1, count: 10 })
+            .await
+        else {
+            panic!("expected headers");
+        };
+        assert_eq!(headers[0].hash, block1.header.hash);
+        assert_eq!(server.stats().cached_headers, 2);
+    }
+
+    #[tokio::test]
+    async fn test_transaction_proof_verifies_against_header() {
+        let (server, genesis, _) = server(LightClientConfig::default()).await;
+        let tx_id = genesis.transactions[0].id.clone();
+
+        let response = server
+            .serve(
+                "wallet",
+                LightRequest::TransactionProof {
+                    block_hash: genesis.header.hash.clone(),
+                    tx_id,
+                },
+            )
+            .await;
+        let LightResponse::TransactionProof {
+            header,
+            transaction,
+            proof,
+        } = response
+        else {
+            panic!("expected a proof, got {:?}", response);
+        };
+        assert!(proof.verify(&transaction.hash().unwrap(), &header.merkle_root));
+
+        let missing = server
+            .serve(
+                "wallet",
+                LightRequest::TransactionProof {
+                    block_hash: genesis.header.hash,
+                    tx_id: "missing".to_string(),
+                },
+            )
+            .await;
+        assert!(matches!(missing, LightResponse::Error(_)));
+    }
+
+    #[tokio::test]
+    async fn test_clients_are_rate_limited_independently() {
+        let config = LightClientConfig {
+            requests_per_second: 2,
+            ..LightClientConfig::default()
+        };
+        let (server, _, block1) = server(config).await;
+        let request = || LightRequest::AccountState {
+            address: "system".to_string(),
+        };
+
+        for _ in 0..2 {
+            let response = server.serve("meter-1", request()).await;
+            let LightResponse::AccountState { height, block_hash, .. } = response else {
+                panic!("expected account state, got {:?}", response);
+            };
+            assert_eq!(height, 1);
+            assert_eq!(block_hash, block1.header.hash);
+        }
+        assert!(matches!(server.serve("meter-1", request()).await, LightResponse::Error(_)));
+        assert!(matches!(
+            server.serve("meter-2", request()).await,
+            LightResponse::AccountState { .. }
+        ));
+        assert_eq!(server.stats().requests_rate_limited, 1);
+    }
+}
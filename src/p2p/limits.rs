@@ -0,0 +1,444 @@
+//! GridTokenX Connection Limits
+//!
+//! Keeps inbound floods from costing file descriptors or decode time. The
+//! swarm consults a [`ConnectionGuard`] when a connection is accepted: banned
+//! and blacklisted addresses are refused, each IP draws from a token bucket of
+//! connection attempts, and established connections count against the
+//! inbound/outbound caps and a per-IP cap. Gossip frames are checked for size
+//! and per-peer rate before they are decoded. Bans are kept in a sharded map
+//! shared by the swarm and the inbound processor and lapse on their own.
+
+use anyhow::{anyhow, Result};
+use std::collections::{HashMap, HashSet};
+use std::hash::{DefaultHasher, Hash, Hasher};
+use std::net::IpAddr;
+use std::sync::{Mutex, RwLock};
+use std::time::{Duration, Instant};
+
+use crate::config::{NetworkSecurityConfig, P2PConfig};
+
+/// Shards in the ban list
+const BAN_SHARDS: usize = 16;
+/// Rate-limited frames from one peer before it is reported for banning
+pub const MAX_RATE_VIOLATIONS: u32 = 50;
+
+/// Refilling allowance of events
+#[derive(Debug, Clone)]
+pub struct TokenBucket {
+    capacity: f64,
+    tokens: f64,
+    refill_per_sec: f64,
+    updated: Instant,
+}
+
+impl TokenBucket {
+    /// Full bucket of `capacity` tokens refilled at `refill_per_sec`
+    pub fn new(capacity: f64, refill_per_sec: f64, now: Instant) -> Self {
+        Self {
+            capacity,
+            tokens: capacity,
+            refill_per_sec,
+            updated: now,
+        }
+    }
+
+    fn refill(&mut self, now: Instant) {
+        let elapsed = now.saturating_duration_since(self.updated).as_secs_f64();
+        self.tokens = (self.tokens + elapsed * self.refill_per_sec).min(self.capacity);
+        self.updated = now;
+    }
+
+    /// Take one token if available
+    pub fn try_take(&mut self, now: Instant) -> bool {
+        self.refill(now);
+        if self.tokens >= 1.0 {
+            self.tokens -= 1.0;
+            true
+        } else {
+            false
+        }
+    }
+
+    /// Whether the bucket has refilled completely
+    pub fn is_full(&mut self, now: Instant) -> bool {
+        self.refill(now);
+        self.tokens >= self.capacity
+    }
+}
+
+/// Banned addresses with expiry, sharded so readers rarely contend
+#[derive(Debug)]
+pub struct BanList {
+    shards: [RwLock<HashMap<IpAddr, Instant>>; BAN_SHARDS],
+}
+
+impl Default for BanList {
+    fn default() -> Self {
+        Self {
+            shards: std::array::from_fn(|_| RwLock::new(HashMap::new())),
+        }
+    }
+}
+
+impl BanList {
+    fn shard(&self, ip: &IpAddr) -> &RwLock<HashMap<IpAddr, Instant>> {
+        let mut hasher = DefaultHasher::new();
+        ip.hash(&mut hasher);
+        &self.shards[hasher.finish() as usize % BAN_SHARDS]
+    }
+
+    /// Ban an address until `until`, extending any shorter ban
+    pub fn ban(&self, ip: IpAddr, until: Instant) {
+        if let Ok(mut shard) = self.shard(&ip).write() {
+            let expiry = shard.entry(ip).or_insert(until);
+            *expiry = (*expiry).max(until);
+        }
+    }
+
+    pub fn is_banned(&self, ip: &IpAddr, now: Instant) -> bool {
+        self.shard(ip)
+            .read()
+            .map(|shard| shard.get(ip).is_some_and(|until| *until > now))
+            .unwrap_or(false)
+    }
+
+    /// Drop expired bans; returns how many remain
+    pub fn purge(&self, now: Instant) -> usize {
+        self.shards
+            .iter()
+            .filter_map(|shard| shard.write().ok())
+            .map(|mut shard| {
+                shard.retain(|_, until| *until > now);
+                shard.len()
+            })
+            .sum()
+    }
+}
+
+/// Direction of a connection
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Direction {
+    Inbound,
+    Outbound,
+}
+
+#[derive(Debug, Default)]
+struct ConnectionCounts {
+    inbound: usize,
+    outbound: usize,
+    per_ip: HashMap<IpAddr, usize>,
+    /// Connection attempts per IP
+    attempts: HashMap<IpAddr, TokenBucket>,
+}
+
+#[derive(Debug)]
+struct PeerRate {
+    bucket: TokenBucket,
+    violations: u32,
+}
+
+/// Verdict on a frame checked before decoding
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FrameCheck {
+    Accept,
+    /// Larger than any valid frame; the peer is penalised
+    Oversized,
+    /// Over the peer's message rate; dropped undecoded
+    Drop,
+    /// Dropped, and the peer has been dropping frames long enough to ban
+    Ban,
+}
+
+/// Connection and message limits shared by the swarm and inbound processor
+#[derive(Debug)]
+pub struct ConnectionGuard {
+    max_inbound: usize,
+    max_outbound: usize,
+    max_per_ip: usize,
+    /// Connection attempts per IP per minute
+    connection_rate: u32,
+    /// Frames per peer per second (0 = unlimited)
+    message_rate: u32,
+    max_frame_size: usize,
+    ban_duration: Duration,
+    ddos_protection: bool,
+    whitelist: HashSet<IpAddr>,
+    blacklist: HashSet<IpAddr>,
+    bans: BanList,
+    connections: Mutex<ConnectionCounts>,
+    peers: Mutex<HashMap<String, PeerRate>>,
+}
+
+impl ConnectionGuard {
+    pub fn new(config: &P2PConfig, security: &NetworkSecurityConfig) -> Self {
+        let parse = |list: &[String]| -> HashSet<IpAddr> {
+            list.iter()
+                .filter_map(|ip| match ip.parse() {
+                    Ok(ip) => Some(ip),
+                    Err(_) => {
+                        tracing::warn!("Ignoring invalid IP address {} in network security list", ip);
+                        None
+                    }
+                })
+                .collect()
+        };
+        let limits = &security.connection_limits;
+        Self {
+            max_inbound: config.max_inbound_connections,
+            max_outbound: config.max_outbound_connections,
+            max_per_ip: limits.max_connections_per_ip,
+            connection_rate: limits.connection_rate_limit,
+            message_rate: limits.message_rate_limit,
+            // Frame header and compression overhead on top of the largest payload
+            max_frame_size: config.gossip.max_message_size + 1024,
+            ban_duration: Duration::from_secs(limits.ban_duration),
+            ddos_protection: security.ddos_protection,
+            whitelist: parse(&security.ip_whitelist),
+            blacklist: parse(&security.ip_blacklist),
+            bans: BanList::default(),
+            connections: Mutex::new(ConnectionCounts::default()),
+            peers: Mutex::new(HashMap::new()),
+        }
+    }
+
+    fn counts(&self) -> Result<std::sync::MutexGuard<'_, ConnectionCounts>> {
+        self.connections
+            .lock()
+            .map_err(|_| anyhow!("Connection limits poisoned"))
+    }
+
+    /// Cheap checks on an inbound connection before the handshake
+    pub fn check_inbound(&self, ip: Option<IpAddr>, now: Instant) -> Result<()> {
+        let Some(ip) = ip else {
+            return Ok(());
+        };
+        if self.blacklist.contains(&ip) {
+            return Err(anyhow!("{} is blacklisted", ip));
+        }
+        if !self.whitelist.is_empty() && !self.whitelist.contains(&ip) {
+            return Err(anyhow!("{} is not whitelisted", ip));
+        }
+        if !self.ddos_protection {
+            return Ok(());
+        }
+        if self.bans.is_banned(&ip, now) {
+            return Err(anyhow!("{} is banned", ip));
+        }
+        let per_minute = self.connection_rate.max(1) as f64;
+        let mut counts = self.counts()?;
+        let allowed = counts
+            .attempts
+            .entry(ip)
+            .or_insert_with(|| TokenBucket::new(per_minute, per_minute / 60.0, now))
+            .try_take(now);
+        if !allowed {
+            return Err(anyhow!("{} exceeded {} connections per minute", ip, per_minute));
+        }
+        Ok(())
+    }
+
+    /// Count an established connection, refusing it when over a cap
+    pub fn admit(&self, ip: Option<IpAddr>, direction: Direction) -> Result<()> {
+        let mut counts = self.counts()?;
+        match direction {
+            Direction::Inbound if counts.inbound >= self.max_inbound => {
+                return Err(anyhow!("Inbound connection limit {} reached", self.max_inbound));
+            }
+            Direction::Outbound if counts.outbound >= self.max_outbound => {
+                return Err(anyhow!("Outbound connection limit {} reached", self.max_outbound));
+            }
+            _ => {}
+        }
+        if let Some(ip) = ip {
+            let open = counts.per_ip.entry(ip).or_insert(0);
+            if direction == Direction::Inbound && *open >= self.max_per_ip {
+                return Err(anyhow!("{} already has {} connections", ip, open));
+            }
+            *open += 1;
+        }
+        match direction {
+            Direction::Inbound => counts.inbound += 1,
+            Direction::Outbound => counts.outbound += 1,
+        }
+        Ok(())
+    }
+
+    /// Release a connection counted by [`Self::admit`]
+    pub fn release(&self, ip: Option<IpAddr>, direction: Direction) {
+        let Ok(mut counts) = self.counts() else {
+            return;
+        };
+        match direction {
+            Direction::Inbound => counts.inbound = counts.inbound.saturating_sub(1),
+            Direction::Outbound => counts.outbound = counts.outbound.saturating_sub(1),
+        }
+        if let Some(ip) = ip {
+            if let Some(open) = counts.per_ip.get_mut(&ip) {
+                *open -= 1;
+                if *open == 0 {
+                    counts.per_ip.remove(&ip);
+                }
+            }
+        }
+    }
+
+    /// Open connections (inbound, outbound)
+    pub fn open_connections(&self) -> (usize, usize) {
+        self.counts()
+            .map(|counts| (counts.inbound, counts.outbound))
+            .unwrap_or_default()
+    }
+
+    /// Whether there is room to dial more peers
+    pub fn wants_outbound(&self) -> bool {
+        self.open_connections().1 < self.max_outbound
+    }
+
+    /// Size and rate checks on a received frame, before it is decoded
+    pub fn check_frame(&self, peer: &str, size: usize, now: Instant) -> FrameCheck {
+        if size > self.max_frame_size {
+            return FrameCheck::Oversized;
+        }
+        if !self.ddos_protection || self.message_rate == 0 {
+            return FrameCheck::Accept;
+        }
+        let Ok(mut peers) = self.peers.lock() else {
+            return FrameCheck::Accept;
+        };
+        let rate = self.message_rate as f64;
+        let state = peers.entry(peer.to_string()).or_insert_with(|| PeerRate {
+            // One second of burst on top of the sustained rate
+            bucket: TokenBucket::new(rate, rate, now),
+            violations: 0,
+        });
+        if state.bucket.try_take(now) {
+            return FrameCheck::Accept;
+        }
+        state.violations += 1;
+        if state.violations >= MAX_RATE_VIOLATIONS {
+            FrameCheck::Ban
+        } else {
+            FrameCheck::Drop
+        }
+    }
+
+    /// Forget a disconnected peer's message rate
+    pub fn remove_peer(&self, peer: &str) {
+        if let Ok(mut peers) = self.peers.lock() {
+            peers.remove(peer);
+        }
+    }
+
+    /// Ban an address for the configured duration (whitelisted addresses are exempt)
+    pub fn ban(&self, ip: IpAddr, now: Instant) {
+        if self.ddos_protection && !self.whitelist.contains(&ip) {
+            tracing::warn!("Banning {} for {}s", ip, self.ban_duration.as_secs());
+            self.bans.ban(ip, now + self.ban_duration);
+        }
+    }
+
+    pub fn is_banned(&self, ip: &IpAddr, now: Instant) -> bool {
+        self.ddos_protection && self.bans.is_banned(ip, now)
+    }
+
+    /// Drop expired bans and idle attempt buckets; returns active bans
+    pub fn purge(&self, now: Instant) -> usize {
+        if let Ok(mut counts) = self.counts() {
+            counts.attempts.retain(|_, bucket| !bucket.is_full(now));
+        }
+        self.bans.purge(now)
+    }
+}
+
+/// IP address of a multiaddr such as `/ip4/10.0.0.1/tcp/9000`
+pub fn ip_of(address: &str) -> Option<IpAddr> {
+    let mut parts = address.split('/').skip_while(|part| *part != "ip4" && *part != "ip6");
+    parts.next()?;
+    parts.next()?.parse().ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn guard(configure: impl FnOnce(&mut P2PConfig, &mut NetworkSecurityConfig)) -> ConnectionGuard {
+        let mut config = P2PConfig::default();
+        let mut security = NetworkSecurityConfig::default();
+        configure(&mut config, &mut security);
+        ConnectionGuard::new(&config, &security)
+    }
+
+    #[test]
+    fn test_inbound_attempts_are_rate_limited_and_bans_expire() {
+        let guard = guard(|_, security| {
+            security.connection_limits.connection_rate_limit = 3;
+            security.connection_limits.ban_duration = 60;
+            security.ip_blacklist = vec!["10.0.0.9".to_string()];
+        });
+        let ip: IpAddr = "10.0.0.1".parse().unwrap();
+        let now = Instant::now();
+
+        for _ in 0..3 {
+            guard.check_inbound(Some(ip), now).unwrap();
+        }
+        assert!(guard.check_inbound(Some(ip), now).is_err());
+        // One attempt refills every 20s
+        guard.check_inbound(Some(ip), now + Duration::from_secs(20)).unwrap();
+        assert!(guard.check_inbound(ip_of("/ip4/10.0.0.9/tcp/9000"), now).is_err());
+        guard.check_inbound(None, now).unwrap();
+
+        let other: IpAddr = "10.0.0.2".parse().unwrap();
+        guard.ban(other, now);
+        assert!(guard.check_inbound(Some(other), now).is_err());
+        assert_eq!(guard.purge(now), 1);
+        assert_eq!(guard.purge(now + Duration::from_secs(61)), 0);
+        guard.check_inbound(Some(other), now + Duration::from_secs(61)).unwrap();
+    }
+
+    #[test]
+    fn test_established_connections_respect_caps() {
+        let guard = guard(|config, security| {
+            config.max_inbound_connections = 3;
+            config.max_outbound_connections = 1;
+            security.connection_limits.max_connections_per_ip = 2;
+        });
+        let a: IpAddr = "192.168.1.1".parse().unwrap();
+        let b: IpAddr = "192.168.1.2".parse().unwrap();
+
+        guard.admit(Some(a), Direction::Inbound).unwrap();
+        guard.admit(Some(a), Direction::Inbound).unwrap();
+        assert!(guard.admit(Some(a), Direction::Inbound).is_err());
+        guard.admit(Some(b), Direction::Inbound).unwrap();
+        assert!(guard.admit(Some(b), Direction::Inbound).is_err());
+
+        guard.admit(Some(a), Direction::Outbound).unwrap();
+        assert!(guard.admit(None, Direction::Outbound).is_err());
+        assert_eq!(guard.open_connections(), (3, 1));
+
+        guard.release(Some(a), Direction::Inbound);
+        guard.admit(Some(b), Direction::Inbound).unwrap();
+        assert_eq!(guard.open_connections(), (3, 1));
+    }
+
+    #[test]
+    fn test_frames_checked_before_decode() {
+        let guard = guard(|config, security| {
+            config.gossip.max_message_size = 1_000;
+            security.connection_limits.message_rate_limit = 10;
+        });
+        let now = Instant::now();
+
+        assert_eq!(guard.check_frame("peer", 10_000, now), FrameCheck::Oversized);
+        for _ in 0..10 {
+            assert_eq!(guard.check_frame("peer", 100, now), FrameCheck::Accept);
+        }
+        assert_eq!(guard.check_frame("peer", 100, now), FrameCheck::Drop);
+        assert_eq!(guard.check_frame("other", 100, now), FrameCheck::Accept);
+
+        let verdicts: Vec<_> = (0..MAX_RATE_VIOLATIONS)
+            .map(|_| guard.check_frame("peer", 100, now))
+            .collect();
+        assert_eq!(verdicts.last(), Some(&FrameCheck::Ban));
+        assert_eq!(guard.check_frame("peer", 100, now + Duration::from_secs(1)), FrameCheck::Accept);
+    }
+}
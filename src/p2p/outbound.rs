@@ -0,0 +1,414 @@
+//! GridTokenX Outbound Scheduling
+//!
+//! Published frames wait in one queue per priority class until the swarm task
+//! hands them to gossipsub, or to the direct protocol for frames addressed to
+//! a single peer. Consensus traffic (votes, pings, peer info) is always sent
+//! first; block relay, transaction relay and sync share the remaining capacity
+//! by deficit round robin, weighted in that order, so a burst of large
+//! `SyncResponse`s can never hold back a vote or a new block.
+//! Each class has a byte budget for queued frames; publishing into a full
+//! class fails instead of growing memory. Queue depth and wait time are
+//! tracked per class. A dispatch batch carries only a few sync frames, so a
+//! backlog of large responses reaches the transport a little at a time,
+//! between polls of the swarm's events, rather than 32 frames at once.
+
+use anyhow::{anyhow, Result};
+use bytes::Bytes;
+use serde::{Deserialize, Serialize};
+use std::collections::VecDeque;
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+use tokio::sync::Notify;
+
+use super::codec::MessageTag;
+use super::Destination;
+
+/// Bytes credited per round of the weighted classes, times the class weight
+const QUANTUM_BYTES: usize = 16 * 1024;
+/// Frames handed to gossipsub before the swarm task polls its events again
+pub const DISPATCH_BATCH: usize = 32;
+/// Most sync frames in one dispatch batch
+const MAX_SYNC_PER_BATCH: usize = 2;
+
+/// Outbound priority class, highest first
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum Priority {
+    Consensus,
+    Block,
+    Transaction,
+    Sync,
+}
+
+impl Priority {
+    pub const COUNT: usize = 4;
+
+    pub const ALL: [Priority; Self::COUNT] = [
+        Priority::Consensus,
+        Priority::Block,
+        Priority::Transaction,
+        Priority::Sync,
+    ];
+
+    /// Class a message type is sent in
+    pub fn of(tag: MessageTag) -> Self {
+        match tag {
+            MessageTag::ConsensusMessage
+            | MessageTag::Ping
+            | MessageTag::Pong
+            | MessageTag::PeerInfo => Priority::Consensus,
+            MessageTag::BlockAnnouncement
+            | MessageTag::CompactBlockAnnouncement
+            | MessageTag::BlockChunk
+            | MessageTag::GetBlockTransactions
+            | MessageTag::BlockTransactions
+            | MessageTag::BlockRequest
+            | MessageTag::BlockResponse => Priority::Block,
+            MessageTag::TransactionBroadcast
+            | MessageTag::TransactionInventory
+            | MessageTag::GetTransactions
+            | MessageTag::Transactions => Priority::Transaction,
+            MessageTag::SyncRequest
+            | MessageTag::SyncResponse
+            | MessageTag::HeadersRequest
+            | MessageTag::HeadersResponse => Priority::Sync,
+        }
+    }
+
+    pub fn name(&self) -> &'static str {
+        match self {
+            Priority::Consensus => "consensus",
+            Priority::Block => "block",
+            Priority::Transaction => "transaction",
+            Priority::Sync => "sync",
+        }
+    }
+
+    /// Share of round-robin capacity (consensus is strict priority)
+    fn weight(&self) -> usize {
+        match self {
+            Priority::Consensus => 0,
+            Priority::Block => 4,
+            Priority::Transaction => 2,
+            Priority::Sync => 1,
+        }
+    }
+
+    /// Most bytes queued in this class at once
+    fn byte_budget(&self) -> usize {
+        match self {
+            Priority::Consensus => 1024 * 1024,
+            Priority::Block => 8 * 1024 * 1024,
+            Priority::Transaction => 4 * 1024 * 1024,
+            Priority::Sync => 16 * 1024 * 1024,
+        }
+    }
+}
+
+/// Frame waiting to be published
+#[derive(Debug)]
+struct QueuedFrame {
+    destination: Destination,
+    data: Bytes,
+    queued_at: Instant,
+}
+
+#[derive(Debug, Default)]
+struct ClassQueue {
+    frames: VecDeque<QueuedFrame>,
+    bytes: usize,
+    deficit: usize,
+    frames_sent: u64,
+    bytes_sent: u64,
+    frames_dropped: u64,
+    total_wait: Duration,
+    max_wait: Duration,
+}
+
+/// Queue depth and wait time for one class
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct OutboundClassStats {
+    pub class: String,
+    pub queued_frames: usize,
+    pub queued_bytes: usize,
+    pub frames_sent: u64,
+    pub bytes_sent: u64,
+    /// Frames refused because the class was over its byte budget
+    pub frames_dropped: u64,
+    pub average_wait_ms: f64,
+    pub max_wait_ms: f64,
+}
+
+/// Per-class queues with strict consensus priority and weighted round robin
+#[derive(Debug, Default)]
+pub struct OutboundScheduler {
+    queues: [ClassQueue; Priority::COUNT],
+    /// Weighted class currently being served
+    cursor: usize,
+    /// Whether the current class has received its quantum this visit
+    credited: bool,
+}
+
+impl OutboundScheduler {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Queue a frame; fails when its class is over budget
+    pub fn push(
+        &mut self,
+        priority: Priority,
+        destination: Destination,
+        data: Bytes,
+        now: Instant,
+    ) -> Result<()> {
+        let queue = &mut self.queues[priority as usize];
+        if queue.bytes + data.len() > priority.byte_budget() {
+            queue.frames_dropped += 1;
+            return Err(anyhow!("Outbound {} queue is full", priority.name()));
+        }
+        queue.bytes += data.len();
+        queue.frames.push_back(QueuedFrame {
+            destination,
+            data,
+            queued_at: now,
+        });
+        Ok(())
+    }
+
+    /// Next frame to publish
+    pub fn pop(&mut self, now: Instant) -> Option<(Destination, Bytes)> {
+        self.pop_class(now, true).map(|(_, destination, data)| (destination, data))
+    }
+
+    /// Up to `limit` frames in scheduling order, at most [`MAX_SYNC_PER_BATCH`] of them sync
+    pub fn pop_batch(&mut self, limit: usize, now: Instant) -> Vec<(Destination, Bytes)> {
+        let mut batch = Vec::new();
+        let mut sync = 0;
+        while batch.len() < limit {
+            let Some((class, destination, data)) = self.pop_class(now, sync < MAX_SYNC_PER_BATCH) else {
+                break;
+            };
+            if class == Priority::Sync {
+                sync += 1;
+            }
+            batch.push((destination, data));
+        }
+        batch
+    }
+
+    /// Next frame and its class, skipping sync unless `sync_allowed`
+    fn pop_class(&mut self, now: Instant, sync_allowed: bool) -> Option<(Priority, Destination, Bytes)> {
+        if !self.queues[Priority::Consensus as usize].frames.is_empty() {
+            return self.take(Priority::Consensus as usize, now);
+        }
+        let eligible = |class: &Priority| sync_allowed || *class != Priority::Sync;
+        let waiting = Priority::ALL[1..]
+            .iter()
+            .filter(|class| eligible(class))
+            .any(|class| !self.queues[*class as usize].frames.is_empty());
+        if !waiting {
+            return None;
+        }
+
+        loop {
+            let class = Priority::ALL[self.cursor];
+            if !eligible(&class) {
+                // Keeps its deficit for the next batch
+                self.advance();
+                continue;
+            }
+            let queue = &mut self.queues[self.cursor];
+            let Some(front) = queue.frames.front() else {
+                queue.deficit = 0;
+                self.advance();
+                continue;
+            };
+            if !self.credited {
+                queue.deficit += QUANTUM_BYTES * class.weight();
+                self.credited = true;
+            }
+            if front.data.len() <= queue.deficit {
+                queue.deficit -= front.data.len();
+                return self.take(self.cursor, now);
+            }
+            self.advance();
+        }
+    }
+
+    fn advance(&mut self) {
+        self.cursor = if self.cursor + 1 >= Priority::COUNT { 1 } else { self.cursor + 1 };
+        self.credited = false;
+    }
+
+    fn take(&mut self, index: usize, now: Instant) -> Option<(Priority, Destination, Bytes)> {
+        let queue = &mut self.queues[index];
+        let frame = queue.frames.pop_front()?;
+        let wait = now.saturating_duration_since(frame.queued_at);
+        queue.bytes -= frame.data.len();
+        queue.frames_sent += 1;
+        queue.bytes_sent += frame.data.len() as u64;
+        queue.total_wait += wait;
+        queue.max_wait = queue.max_wait.max(wait);
+        Some((Priority::ALL[index], frame.destination, frame.data))
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.queues.iter().all(|queue| queue.frames.is_empty())
+    }
+
+    pub fn stats(&self) -> Vec<OutboundClassStats> {
+        Priority::ALL
+            .iter()
+            .zip(&self.queues)
+            .map(|(class, queue)| OutboundClassStats {
+                class: class.name().to_string(),
+                queued_frames: queue.frames.len(),
+                queued_bytes: queue.bytes,
+                frames_sent: queue.frames_sent,
+                bytes_sent: queue.bytes_sent,
+                frames_dropped: queue.frames_dropped,
+                average_wait_ms: if queue.frames_sent == 0 {
+                    0.0
+                } else {
+                    queue.total_wait.as_secs_f64() * 1000.0 / queue.frames_sent as f64
+                },
+                max_wait_ms: queue.max_wait.as_secs_f64() * 1000.0,
+            })
+            .collect()
+    }
+}
+
+/// Scheduler shared between publishers and the swarm task
+#[derive(Debug, Default)]
+pub struct OutboundQueues {
+    scheduler: Mutex<OutboundScheduler>,
+    ready: Notify,
+}
+
+impl OutboundQueues {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Queue a frame and wake the swarm task
+    pub fn push(&self, priority: Priority, destination: Destination, data: Bytes) -> Result<()> {
+        self.scheduler
+            .lock()
+            .map_err(|_| anyhow!("Outbound queues poisoned"))?
+            .push(priority, destination, data, Instant::now())?;
+        self.ready.notify_one();
+        Ok(())
+    }
+
+    /// Up to `limit` frames in scheduling order
+    pub fn pop_batch(&self, limit: usize) -> Vec<(Destination, Bytes)> {
+        let Ok(mut scheduler) = self.scheduler.lock() else {
+            return Vec::new();
+        };
+        let batch = scheduler.pop_batch(limit, Instant::now());
+        if !scheduler.is_empty() {
+            // Come back for the rest after the swarm has polled its events
+            self.ready.notify_one();
+        }
+        batch
+    }
+
+    /// Wait until frames may be queued
+    pub async fn ready(&self) {
+        self.ready.notified().await
+    }
+
+    pub fn stats(&self) -> Vec<OutboundClassStats> {
+        self.scheduler
+            .lock()
+            .map(|scheduler| scheduler.stats())
+            .unwrap_or_default()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::p2p::GossipTopic;
+
+    const BLOCKS: Destination = Destination::Topic(GossipTopic::Blocks);
+    const CONSENSUS: Destination = Destination::Topic(GossipTopic::Consensus);
+    const TRANSACTIONS: Destination = Destination::Topic(GossipTopic::Transactions);
+
+    fn frame(len: usize) -> Bytes {
+        Bytes::from(vec![0u8; len])
+    }
+
+    #[test]
+    fn test_consensus_jumps_ahead_of_queued_sync_traffic() {
+        let mut scheduler = OutboundScheduler::new();
+        let now = Instant::now();
+        for _ in 0..10 {
+            scheduler.push(Priority::Sync, BLOCKS, frame(500_000), now).unwrap();
+        }
+        scheduler.push(Priority::Consensus, CONSENSUS, frame(200), now).unwrap();
+
+        let (topic, data) = scheduler.pop(now).unwrap();
+        assert_eq!(topic, CONSENSUS);
+        assert_eq!(data.len(), 200);
+        assert_eq!(scheduler.stats()[Priority::Sync as usize].queued_frames, 10);
+    }
+
+    #[test]
+    fn test_weighted_classes_share_bytes_by_weight() {
+        let mut scheduler = OutboundScheduler::new();
+        let now = Instant::now();
+        for _ in 0..200 {
+            scheduler.push(Priority::Block, BLOCKS, frame(4096), now).unwrap();
+            scheduler.push(Priority::Transaction, TRANSACTIONS, frame(4096), now).unwrap();
+            scheduler.push(Priority::Sync, BLOCKS, frame(4096), now).unwrap();
+        }
+        for _ in 0..140 {
+            scheduler.pop(now).unwrap();
+        }
+
+        let stats = scheduler.stats();
+        let sent = |class: Priority| stats[class as usize].bytes_sent as f64;
+        assert!((sent(Priority::Block) / sent(Priority::Sync) - 4.0).abs() < 0.5);
+        assert!((sent(Priority::Transaction) / sent(Priority::Sync) - 2.0).abs() < 0.5);
+
+        // Large frames still go out once enough credit accumulates
+        let mut scheduler = OutboundScheduler::new();
+        scheduler.push(Priority::Sync, BLOCKS, frame(1_000_000), now).unwrap();
+        assert_eq!(scheduler.pop(now).unwrap().1.len(), 1_000_000);
+        assert!(scheduler.pop(now).is_none());
+    }
+
+    #[test]
+    fn test_batches_carry_few_sync_frames() {
+        let mut scheduler = OutboundScheduler::new();
+        let now = Instant::now();
+        for _ in 0..20 {
+            scheduler.push(Priority::Sync, BLOCKS, frame(1024), now).unwrap();
+            scheduler.push(Priority::Transaction, TRANSACTIONS, frame(1024), now).unwrap();
+        }
+
+        let batch = scheduler.pop_batch(DISPATCH_BATCH, now);
+        assert_eq!(batch.len(), 20 + MAX_SYNC_PER_BATCH);
+        let stats = scheduler.stats();
+        assert_eq!(stats[Priority::Sync as usize].frames_sent, MAX_SYNC_PER_BATCH as u64);
+
+        // With nothing else queued, sync still drains a few frames per batch
+        assert_eq!(scheduler.pop_batch(DISPATCH_BATCH, now).len(), MAX_SYNC_PER_BATCH);
+    }
+
+    #[test]
+    fn test_byte_budget_refuses_frames_and_wait_is_measured() {
+        let mut scheduler = OutboundScheduler::new();
+        let now = Instant::now();
+        let budget = Priority::Consensus.byte_budget();
+        scheduler.push(Priority::Consensus, CONSENSUS, frame(budget), now).unwrap();
+        assert!(scheduler.push(Priority::Consensus, CONSENSUS, frame(1), now).is_err());
+
+        scheduler.pop(now + Duration::from_millis(40)).unwrap();
+        let stats = &scheduler.stats()[Priority::Consensus as usize];
+        assert_eq!(stats.frames_dropped, 1);
+        assert_eq!(stats.queued_bytes, 0);
+        assert_eq!(stats.max_wait_ms, 40.0);
+    }
+}
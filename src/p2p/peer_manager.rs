@@ -0,0 +1,292 @@
+//! GridTokenX Peer Manager
+//!
+//! Tracks per-peer round-trip time (from ping/pong), received bandwidth and
+//! the share of valid messages, and folds them into a 0-100 score. Scores
+//! rank sync sources and are pushed into gossipsub as application scores so
+//! the mesh keeps its fastest, most reliable members. Peers that keep
+//! sending invalid data, stop answering pings or stay very slow are flagged
+//! for disconnection.
+
+use chrono::{DateTime, Utc};
+use std::collections::{HashMap, HashSet};
+
+/// Reputation lost per invalid message
+const INVALID_PENALTY: f64 = 10.0;
+/// Reputation regained per valid message
+const VALID_REWARD: f64 = 0.1;
+/// Smoothing factor for round-trip time
+const RTT_SMOOTHING: f64 = 0.3;
+/// Round trip at which the latency component halves (ms)
+const RTT_HALF_SCORE_MS: f64 = 200.0;
+/// Weight of reputation in the score; latency gets the rest
+const REPUTATION_WEIGHT: f64 = 0.7;
+
+/// Peers below this score are dropped
+pub const MIN_PEER_SCORE: f64 = 20.0;
+/// Peers below this score are not used as sync sources
+pub const MIN_SYNC_SCORE: f64 = 50.0;
+/// Consecutive unanswered pings before a peer is dropped
+pub const MAX_MISSED_PONGS: u32 = 3;
+/// Round trip considered persistently slow (ms)
+pub const SLOW_RTT_MS: f64 = 2_000.0;
+/// Consecutive slow pongs before a peer is dropped
+pub const MAX_SLOW_PONGS: u32 = 5;
+
+/// Measurements for one peer
+#[derive(Debug, Clone)]
+pub struct PeerStats {
+    /// Smoothed round-trip time (ms)
+    pub rtt_ms: Option<f64>,
+    pub bytes_received: u64,
+    pub valid_messages: u64,
+    pub invalid_messages: u64,
+    /// Behaviour component of the score (0-100)
+    pub reputation: f64,
+    pub missed_pongs: u32,
+    pub slow_pongs: u32,
+    /// Height reported in the peer's last ping or pong
+    pub height: u64,
+    pub connected_at: DateTime<Utc>,
+}
+
+impl PeerStats {
+    fn new(now: DateTime<Utc>) -> Self {
+        Self {
+            rtt_ms: None,
+            bytes_received: 0,
+            valid_messages: 0,
+            invalid_messages: 0,
+            reputation: 100.0,
+            missed_pongs: 0,
+            slow_pongs: 0,
+            height: 0,
+            connected_at: now,
+        }
+    }
+
+    /// Combined score (0-100)
+    pub fn score(&self) -> f64 {
+        let latency = match self.rtt_ms {
+            Some(rtt) => 100.0 / (1.0 + rtt / RTT_HALF_SCORE_MS),
+            None => 50.0,
+        };
+        REPUTATION_WEIGHT * self.reputation + (1.0 - REPUTATION_WEIGHT) * latency
+    }
+
+    /// Share of received messages that were valid
+    pub fn delivery_rate(&self) -> f64 {
+        let total = self.valid_messages + self.invalid_messages;
+        if total == 0 {
+            1.0
+        } else {
+            self.valid_messages as f64 / total as f64
+        }
+    }
+
+    /// Average received bandwidth since connecting (bytes per second)
+    pub fn bandwidth(&self, now: DateTime<Utc>) -> f64 {
+        let secs = (now - self.connected_at).num_milliseconds().max(1) as f64 / 1000.0;
+        self.bytes_received as f64 / secs
+    }
+}
+
+/// Per-peer scoring state
+#[derive(Debug, Default)]
+pub struct PeerManager {
+    peers: HashMap<String, PeerStats>,
+    /// Timestamp of the ping round in progress
+    ping_round: Option<DateTime<Utc>>,
+    /// Peers that have not answered the current round
+    awaiting_pong: HashSet<String>,
+}
+
+impl PeerManager {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn connect(&mut self, peer: &str, now: DateTime<Utc>) {
+        self.peers
+            .entry(peer.to_string())
+            .or_insert_with(|| PeerStats::new(now));
+    }
+
+    pub fn disconnect(&mut self, peer: &str) {
+        self.peers.remove(peer);
+        self.awaiting_pong.remove(peer);
+    }
+
+    pub fn stats(&self, peer: &str) -> Option<&PeerStats> {
+        self.peers.get(peer)
+    }
+
+    pub fn score(&self, peer: &str) -> Option<f64> {
+        self.peers.get(peer).map(PeerStats::score)
+    }
+
+    /// Record a message received from a peer
+    pub fn record_message(&mut self, peer: &str, bytes: usize, valid: bool) {
+        let Some(stats) = self.peers.get_mut(peer) else {
+            return;
+        };
+        stats.bytes_received += bytes as u64;
+        if valid {
+            stats.valid_messages += 1;
+            stats.reputation = (stats.reputation + VALID_REWARD).min(100.0);
+        } else {
+            stats.invalid_messages += 1;
+            stats.reputation = (stats.reputation - INVALID_PENALTY).max(0.0);
+        }
+    }
+
+    /// Start a ping round; peers that missed the previous one are counted
+    pub fn start_ping_round(&mut self, now: DateTime<Utc>) -> DateTime<Utc> {
+        for peer in self.awaiting_pong.drain() {
+            if let Some(stats) = self.peers.get_mut(&peer) {
+                stats.missed_pongs += 1;
+            }
+        }
+        self.awaiting_pong = self.peers.keys().cloned().collect();
+        self.ping_round = Some(now);
+        now
+    }
+
+    /// Record a pong; returns the measured round trip (ms) if it answers our ping
+    pub fn record_pong(
+        &mut self,
+        peer: &str,
+        original_timestamp: DateTime<Utc>,
+        height: u64,
+        now: DateTime<Utc>,
+    ) -> Option<f64> {
+        if self.ping_round != Some(original_timestamp) || !self.awaiting_pong.remove(peer) {
+            return None;
+        }
+        let stats = self.peers.get_mut(peer)?;
+
+        let rtt = (now - original_timestamp).num_microseconds()?.max(0) as f64 / 1000.0;
+        stats.rtt_ms = Some(match stats.rtt_ms {
+            Some(previous) => RTT_SMOOTHING * rtt + (1.0 - RTT_SMOOTHING) * previous,
+            None => rtt,
+        });
+        stats.missed_pongs = 0;
+        stats.slow_pongs = if rtt > SLOW_RTT_MS { stats.slow_pongs + 1 } else { 0 };
+        stats.height = height;
+        Some(rtt)
+    }
+
+    /// Record a height a peer reported.
+    ///
+    /// Claims are unverified, so the latest one replaces the last rather
+    /// than raising a maximum a peer could pin forever.
+    pub fn record_height(&mut self, peer: &str, height: u64) {
+        if let Some(stats) = self.peers.get_mut(peer) {
+            stats.height = height;
+        }
+    }
+
+    /// Peers ordered by score, best first
+    pub fn ranked(&self) -> Vec<(String, f64)> {
+        let mut ranked: Vec<(String, f64)> = self
+            .peers
+            .iter()
+            .map(|(peer, stats)| (peer.clone(), stats.score()))
+            .collect();
+        ranked.sort_by(|a, b| b.1.total_cmp(&a.1).then_with(|| a.0.cmp(&b.0)));
+        ranked
+    }
+
+    /// Peers good enough to sync from, best first
+    pub fn sync_sources(&self) -> Vec<String> {
+        self.ranked()
+            .into_iter()
+            .filter(|(_, score)| *score >= MIN_SYNC_SCORE)
+            .map(|(peer, _)| peer)
+            .collect()
+    }
+
+    /// Peers that should be disconnected
+    pub fn peers_to_drop(&self) -> Vec<String> {
+        self.peers
+            .iter()
+            .filter(|(_, stats)| {
+                stats.score() < MIN_PEER_SCORE
+                    || stats.missed_pongs >= MAX_MISSED_PONGS
+                    || stats.slow_pongs >= MAX_SLOW_PONGS
+            })
+            .map(|(peer, _)| peer.clone())
+            .collect()
+    }
+
+    /// Best height reported by any peer
+    pub fn best_height(&self) -> u64 {
+        self.peers.values().map(|stats| stats.height).max().unwrap_or(0)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use chrono::Duration;
+
+    #[test]
+    fn test_pongs_measure_rtt_and_rank_peers() {
+        let mut manager = PeerManager::new();
+        let now = Utc::now();
+        manager.connect("near", now);
+        manager.connect("far", now);
+
+        let round = manager.start_ping_round(now);
+        assert_eq!(manager.record_pong("near", round, 10, now + Duration::milliseconds(20)), Some(20.0));
+        assert!(manager.record_pong("far", round, 12, now + Duration::milliseconds(900)).is_some());
+        // Duplicate and stale pongs are ignored
+        assert!(manager.record_pong("near", round, 10, now).is_none());
+        assert!(manager.record_pong("far", now - Duration::seconds(5), 0, now).is_none());
+
+        let ranked = manager.ranked();
+        assert_eq!(ranked[0].0, "near");
+        assert_eq!(manager.best_height(), 12);
+        assert_eq!(manager.stats("near").unwrap().rtt_ms, Some(20.0));
+
+        // A later, lower claim replaces an earlier inflated one
+        manager.record_height("far", u64::MAX);
+        assert_eq!(manager.best_height(), u64::MAX);
+        manager.record_height("far", 11);
+        assert_eq!(manager.best_height(), 11);
+    }
+
+    #[test]
+    fn test_invalid_data_drops_peer() {
+        let mut manager = PeerManager::new();
+        let now = Utc::now();
+        manager.connect("bad", now);
+        manager.connect("good", now);
+
+        for _ in 0..10 {
+            manager.record_message("good", 1_000, true);
+            manager.record_message("bad", 1_000, false);
+        }
+        assert_eq!(manager.stats("bad").unwrap().delivery_rate(), 0.0);
+        assert_eq!(manager.peers_to_drop(), vec!["bad".to_string()]);
+        assert_eq!(manager.sync_sources(), vec!["good".to_string()]);
+        assert!(manager.stats("good").unwrap().bandwidth(now + Duration::seconds(10)) >= 1_000.0);
+    }
+
+    #[test]
+    fn test_unresponsive_peer_is_dropped_after_missed_rounds() {
+        let mut manager = PeerManager::new();
+        let now = Utc::now();
+        manager.connect("silent", now);
+        manager.connect("alive", now);
+
+        for round in 0..=MAX_MISSED_PONGS as i64 {
+            let at = now + Duration::seconds(round * 10);
+            let ping = manager.start_ping_round(at);
+            manager.record_pong("alive", ping, 1, at + Duration::milliseconds(50));
+        }
+        assert_eq!(manager.peers_to_drop(), vec!["silent".to_string()]);
+
+        manager.disconnect("silent");
+        assert!(manager.peers_to_drop().is_empty());
+    }
+}
@@ -0,0 +1,226 @@
+//! GridTokenX Peer Address Book
+//!
+//! Remembers the dialable address, last score and last-seen time of every
+//! peer this node has connected out to. The book is persisted through
+//! [`crate::storage::StorageManager`], so a restarted node dials its
+//! best-known peers straight away instead of waiting for bootstrap nodes,
+//! Kademlia or mDNS to rediscover them. Stale and low-scoring entries are
+//! pruned, and the book is capped in size.
+
+use chrono::{DateTime, Duration, Utc};
+use serde::{Deserialize, Serialize};
+use std::collections::{HashMap, HashSet};
+
+use super::peer_manager::MIN_PEER_SCORE;
+
+/// Entries not seen for this long are forgotten (days)
+const MAX_RECORD_AGE_DAYS: i64 = 7;
+/// Most peers remembered
+const MAX_RECORDS: usize = 1024;
+
+/// Persisted knowledge of one peer
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct PeerRecord {
+    pub peer_id: String,
+    /// Address we dialed the peer on
+    pub address: String,
+    /// Score when last measured (0-100)
+    pub score: f64,
+    pub last_seen: DateTime<Utc>,
+}
+
+impl PeerRecord {
+    /// Address to dial, including the peer id
+    pub fn dial_address(&self) -> String {
+        if self.address.contains("/p2p/") {
+            self.address.clone()
+        } else {
+            format!("{}/p2p/{}", self.address, self.peer_id)
+        }
+    }
+}
+
+/// In-memory address book with change tracking for persistence
+#[derive(Debug, Default)]
+pub struct PeerStore {
+    records: HashMap<String, PeerRecord>,
+    /// Changed since the last flush
+    dirty: HashSet<String>,
+    /// Removed since the last flush
+    removed: HashSet<String>,
+}
+
+impl PeerStore {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Book loaded from storage
+    pub fn from_records(records: Vec<PeerRecord>) -> Self {
+        Self {
+            records: records
+                .into_iter()
+                .map(|record| (record.peer_id.clone(), record))
+                .collect(),
+            ..Default::default()
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.records.len()
+    }
+
+    pub fn get(&self, peer: &str) -> Option<&PeerRecord> {
+        self.records.get(peer)
+    }
+
+    /// Record a dialable address for a connected peer
+    pub fn observe(&mut self, peer: &str, address: &str, now: DateTime<Utc>) {
+        let record = self
+            .records
+            .entry(peer.to_string())
+            .or_insert_with(|| PeerRecord {
+                peer_id: peer.to_string(),
+                address: address.to_string(),
+                score: 50.0,
+                last_seen: now,
+            });
+        record.address = address.to_string();
+        record.last_seen = now;
+        self.removed.remove(peer);
+        self.dirty.insert(peer.to_string());
+    }
+
+    /// Update a known peer's score
+    pub fn update_score(&mut self, peer: &str, score: f64, now: DateTime<Utc>) {
+        if let Some(record) = self.records.get_mut(peer) {
+            record.score = score;
+            record.last_seen = now;
+            self.dirty.insert(peer.to_string());
+        }
+    }
+
+    /// Forget a peer, e.g. after banning it
+    pub fn forget(&mut self, peer: &str) {
+        if self.records.remove(peer).is_some() {
+            self.dirty.remove(peer);
+            self.removed.insert(peer.to_string());
+        }
+    }
+
+    /// Best peers to dial, highest score and most recently seen first
+    pub fn best(&self, limit: usize, now: DateTime<Utc>) -> Vec<PeerRecord> {
+        let cutoff = now - Duration::days(MAX_RECORD_AGE_DAYS);
+        let mut candidates: Vec<&PeerRecord> = self
+            .records
+            .values()
+            .filter(|record| record.last_seen >= cutoff && record.score >= MIN_PEER_SCORE)
+            .collect();
+        candidates.sort_by(|a, b| {
+            b.score
+                .total_cmp(&a.score)
+                .then_with(|| b.last_seen.cmp(&a.last_seen))
+                .then_with(|| a.peer_id.cmp(&b.peer_id))
+        });
+        candidates.into_iter().take(limit).cloned().collect()
+    }
+
+    /// Drop stale and poorly scored entries, then the worst beyond the cap
+    pub fn prune(&mut self, now: DateTime<Utc>) {
+        let cutoff = now - Duration::days(MAX_RECORD_AGE_DAYS);
+        let stale: Vec<String> = self
+            .records
+            .values()
+            .filter(|record| record.last_seen < cutoff || record.score < MIN_PEER_SCORE)
+            .map(|record| record.peer_id.clone())
+            .collect();
+        for peer in stale {
+            self.forget(&peer);
+        }
+        if self.records.len() > MAX_RECORDS {
+            let keep: HashSet<String> = self
+                .best(MAX_RECORDS, now)
+                .into_iter()
+                .map(|record| record.peer_id)
+                .collect();
+            let excess: Vec<String> = self
+                .records
+                .keys()
+                .filter(|peer| !keep.contains(*peer))
+                .cloned()
+                .collect();
+            for peer in excess {
+                self.forget(&peer);
+            }
+        }
+    }
+
+    /// Records changed and peer ids removed since the last call
+    pub fn take_changes(&mut self) -> (Vec<PeerRecord>, Vec<String>) {
+        let changed = self
+            .dirty
+            .drain()
+            .filter_map(|peer| self.records.get(&peer).cloned())
+            .collect();
+        (changed, self.removed.drain().collect())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_best_peers_ranked_by_score_then_recency() {
+        let now = Utc::now();
+        let mut store = PeerStore::new();
+        store.observe("a", "/ip4/10.0.0.1/tcp/9000", now - Duration::hours(2));
+        store.observe("b", "/ip4/10.0.0.2/tcp/9000", now - Duration::hours(1));
+        store.observe("c", "/ip4/10.0.0.3/tcp/9000", now);
+        store.update_score("a", 90.0, now - Duration::hours(2));
+        store.update_score("b", 60.0, now - Duration::hours(1));
+        store.update_score("c", 60.0, now);
+
+        let best: Vec<String> = store.best(2, now).into_iter().map(|r| r.peer_id).collect();
+        assert_eq!(best, vec!["a".to_string(), "c".to_string()]);
+        assert_eq!(
+            store.get("a").unwrap().dial_address(),
+            "/ip4/10.0.0.1/tcp/9000/p2p/a"
+        );
+    }
+
+    #[test]
+    fn test_prune_forgets_stale_and_bad_peers() {
+        let now = Utc::now();
+        let mut store = PeerStore::new();
+        store.observe("old", "/ip4/10.0.0.1/tcp/9000", now - Duration::days(MAX_RECORD_AGE_DAYS + 1));
+        store.observe("bad", "/ip4/10.0.0.2/tcp/9000", now);
+        store.update_score("bad", MIN_PEER_SCORE - 1.0, now);
+        store.observe("good", "/ip4/10.0.0.3/tcp/9000", now);
+        store.take_changes();
+
+        store.prune(now);
+        assert_eq!(store.len(), 1);
+        let (changed, mut removed) = store.take_changes();
+        removed.sort();
+        assert!(changed.is_empty());
+        assert_eq!(removed, vec!["bad".to_string(), "old".to_string()]);
+    }
+
+    #[test]
+    fn test_changes_survive_a_reload() {
+        let now = Utc::now();
+        let mut store = PeerStore::new();
+        store.observe("a", "/ip4/10.0.0.1/tcp/9000", now);
+        store.observe("b", "/ip4/10.0.0.2/tcp/9000", now);
+        store.forget("b");
+
+        let (changed, removed) = store.take_changes();
+        assert_eq!(changed.len(), 1);
+        assert_eq!(removed, vec!["b".to_string()]);
+        assert_eq!(store.take_changes(), (Vec::new(), Vec::new()));
+
+        let reloaded = PeerStore::from_records(changed);
+        assert_eq!(reloaded.best(10, now)[0].peer_id, "a");
+    }
+}
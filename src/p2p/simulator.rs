@@ -0,0 +1,1186 @@
+//! GridTokenX Network Simulator
+//!
+//! Runs many full `P2PNetwork` nodes on one tokio runtime over an in-memory
+//! transport, so propagation and throughput can be measured without real
+//! machines. The transport stands in for the libp2p swarm: nodes are linked
+//! in a random mesh of configurable degree and frames are flooded along it
+//! with gossipsub-style deduplication, each hop relaying a message only once
+//! its node has validated it, while frames addressed to one peer
+//! cross only the link to that peer. Every link has its own latency,
+//! jitter, bandwidth and loss, and nodes can be split into partitions.
+//!
+//! Blocks are produced either by the simulator rotating authorities, one slot
+//! per block interval, each building on its own tip, or by running the real
+//! PoA engine and finality gadget on every node. A run reports block
+//! propagation percentiles, the fork rate, the block interval, sustained
+//! committed TPS and the bytes put on links, plus finality latency in PoA mode.
+//! Runs can use any [`BlockPropagation`] mode, so erasure-coded chunks can be
+//! compared against whole-block gossip on the same links, on bandwidth as
+//! well as latency. Chunks cross each link as direct messages: the producer
+//! splits them among its neighbours and every node re-shares the ones it
+//! receives until it can rebuild the block.
+//!
+//! Simulations run on a current-thread runtime with tokio time paused (see
+//! [`sweep_in_virtual_time`]): link delays, block intervals and consensus
+//! timeouts pass in virtual time, so a run costs only the nodes' CPU time and
+//! its timings do not depend on how loaded the machine is. Slots and block
+//! timestamps follow the same clock through [`Clock::runtime`]. Pausing the
+//! clock needs tokio's `test-util`, so the node binary only runs simulations
+//! when built with the `simulator` feature. Because node CPU time is free in
+//! virtual time, sustained TPS reports how much of the injected load the
+//! network committed, not how fast the nodes can process it.
+
+use anyhow::{anyhow, Result};
+use bytes::Bytes;
+use ed25519_dalek::SigningKey;
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use serde::{Deserialize, Serialize};
+use sha2::{Digest, Sha256};
+use std::collections::{HashMap, HashSet};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+use tokio::sync::broadcast::error::RecvError;
+use tokio::sync::{broadcast, mpsc, watch, RwLock};
+use tokio::task::JoinHandle;
+use tokio::time::Instant;
+
+use super::bridge::BridgeSender;
+use super::limits::ConnectionGuard;
+use super::outbound::{OutboundQueues, DISPATCH_BATCH};
+use super::{
+    Destination, GossipTopic, MessageValidation, NetworkEvent, P2PHandle, P2PNetwork, SwarmCommand,
+};
+use crate::blockchain::block::{BlockHeader, BLOCK_GAS_LIMIT};
+use crate::blockchain::{
+    build_genesis, Block, Blockchain, Transaction, TransactionType, ValidatorInfo,
+};
+use crate::config::{
+    AuthorityConfig, BlockPropagation, GenesisAllocation, GenesisConfig, P2PConfig, POAConfig,
+};
+use crate::consensus_poa::finality::{self, FinalityGadget};
+use crate::consensus_poa::poa::Clock;
+use crate::consensus_poa::{POAConsensusEngine, ThaiAuthorityType};
+use crate::storage::StorageManager;
+
+/// How often queued transactions are injected
+const INJECT_TICK: Duration = Duration::from_millis(50);
+/// How often each node's stored commit certificates are checked
+const FINALITY_POLL: Duration = Duration::from_millis(10);
+/// Funded account every simulated transaction is sent from
+const FAUCET: &str = "system";
+
+/// Conditions on one direction of a link
+#[derive(Debug, Clone, Copy, Serialize, Deserialize)]
+pub struct LinkConditions {
+    pub latency: Duration,
+    /// Uniform extra delay in `[0, jitter)`
+    pub jitter: Duration,
+    /// `None` for unlimited
+    pub bandwidth_bytes_per_sec: Option<u64>,
+    /// Probability that a frame is lost (0.0 - 1.0)
+    pub loss: f64,
+}
+
+impl Default for LinkConditions {
+    fn default() -> Self {
+        Self {
+            latency: Duration::from_millis(20),
+            jitter: Duration::from_millis(5),
+            bandwidth_bytes_per_sec: Some(12_500_000), // 100 Mbit/s
+            loss: 0.0,
+        }
+    }
+}
+
+/// Who produces blocks in a simulated run
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub enum SimulatedConsensus {
+    /// The simulator proposes for each node in turn, once per block interval
+    Rotation,
+    /// Every node is a PoA authority running the engine and finality gadget
+    Poa,
+}
+
+/// Parameters of one simulated run
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SimulationConfig {
+    pub nodes: usize,
+    /// Target number of neighbours per node (gossipsub mesh degree)
+    pub degree: usize,
+    pub link: LinkConditions,
+    pub block_interval: Duration,
+    /// Blocks to produce
+    pub blocks: u64,
+    /// Transactions submitted per second across all nodes
+    pub transactions_per_second: u64,
+    pub max_block_transactions: usize,
+    /// How every node announces its blocks, regardless of block size
+    pub propagation: BlockPropagation,
+    pub consensus: SimulatedConsensus,
+    pub seed: u64,
+}
+
+impl Default for SimulationConfig {
+    fn default() -> Self {
+        Self {
+            nodes: 4,
+            degree: 6,
+            link: LinkConditions::default(),
+            block_interval: Duration::from_secs(1),
+            blocks: 10,
+            transactions_per_second: 100,
+            max_block_transactions: 1000,
+            propagation: BlockPropagation::Compact,
+            consensus: SimulatedConsensus::Rotation,
+            seed: 42,
+        }
+    }
+}
+
+/// Results of one simulated run
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SimulationReport {
+    pub nodes: usize,
+    pub propagation: BlockPropagation,
+    pub consensus: SimulatedConsensus,
+    pub blocks_proposed: u64,
+    /// Share of proposals at a height that already had a block
+    pub fork_rate: f64,
+    /// Mean gap between consecutive block timestamps on the longest chain
+    pub block_interval_ms: f64,
+    pub propagation_p50_ms: f64,
+    pub propagation_p90_ms: f64,
+    pub propagation_p99_ms: f64,
+    /// Share of (block, node) pairs never delivered
+    pub undelivered_rate: f64,
+    pub transactions_submitted: u64,
+    pub transactions_committed: u64,
+    /// Committed transactions per virtual second; bounded by the injection
+    /// rate, since processing costs no virtual time
+    pub sustained_tps: f64,
+    /// Bytes sent over all links, relays and transaction traffic included
+    pub bytes_sent: u64,
+    pub min_height: u64,
+    pub max_height: u64,
+    /// Block timestamp to commit certificate, per (block, node); PoA only
+    pub finality_p50_ms: f64,
+    pub finality_p99_ms: f64,
+    /// Lowest height every node holds a certificate for
+    pub finalized_height: u64,
+}
+
+/// Directional link state
+#[derive(Debug)]
+struct Link {
+    conditions: LinkConditions,
+    /// When the last queued frame finishes transmitting
+    busy_until: Instant,
+}
+
+#[derive(Debug, Default)]
+struct TransportState {
+    peer_ids: Vec<String>,
+    events: Vec<Option<BridgeSender<NetworkEvent>>>,
+    neighbours: Vec<Vec<usize>>,
+    links: HashMap<(usize, usize), Link>,
+    /// Partition group per node; frames only cross links within a group
+    groups: Vec<usize>,
+    /// Message ids each node has already received
+    seen: Vec<HashSet<[u8; 32]>>,
+    /// Gossip held by (node, message id) until the node reports a verdict
+    unvalidated: HashMap<(usize, [u8; 32]), (usize, GossipTopic, Bytes)>,
+    /// Bytes handed to links, lost frames included
+    bytes_sent: u64,
+}
+
+/// In-memory transport connecting simulated nodes
+#[derive(Debug)]
+pub struct SimulatedTransport {
+    state: Mutex<TransportState>,
+    rng: Mutex<StdRng>,
+    shutdown: watch::Sender<bool>,
+}
+
+impl SimulatedTransport {
+    pub fn new(seed: u64) -> Arc<Self> {
+        Arc::new(Self {
+            state: Mutex::new(TransportState::default()),
+            rng: Mutex::new(StdRng::seed_from_u64(seed)),
+            shutdown: watch::channel(false).0,
+        })
+    }
+
+    /// Attach a node; returns a transport spawner for `P2PNetwork::start_with_transport`
+    pub fn attach(
+        self: &Arc<Self>,
+        peer_id: String,
+    ) -> impl FnOnce(
+        &P2PConfig,
+        mpsc::Receiver<SwarmCommand>,
+        Arc<OutboundQueues>,
+        BridgeSender<NetworkEvent>,
+        Arc<ConnectionGuard>,
+    ) -> Result<String> {
+        let transport = self.clone();
+        // Simulated links have no IP addresses to limit
+        move |_config, commands, outbound, events, _guard| {
+            let index = {
+                let mut state = transport.lock();
+                state.peer_ids.push(peer_id.clone());
+                state.events.push(Some(events));
+                state.neighbours.push(Vec::new());
+                state.groups.push(0);
+                state.seen.push(HashSet::new());
+                state.peer_ids.len() - 1
+            };
+            tokio::spawn(transport.clone().route(index, commands, outbound));
+            Ok(peer_id)
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, TransportState> {
+        self.state.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Link two nodes in both directions and tell both about it
+    pub fn connect(&self, a: usize, b: usize, conditions: LinkConditions) {
+        if a == b {
+            return;
+        }
+        let mut state = self.lock();
+        if state.links.contains_key(&(a, b)) {
+            return;
+        }
+        let now = Instant::now();
+        for (from, to) in [(a, b), (b, a)] {
+            state.links.insert((from, to), Link { conditions, busy_until: now });
+            state.neighbours[from].push(to);
+        }
+        for (local, remote) in [(a, b), (b, a)] {
+            let event = NetworkEvent::PeerConnected {
+                peer_id: state.peer_ids[remote].clone(),
+                address: format!("/memory/{}", remote),
+                outbound: local < remote,
+            };
+            Self::notify(&state, local, event);
+        }
+    }
+
+    /// Remove a link in both directions
+    pub fn disconnect(&self, a: usize, b: usize) {
+        let mut state = self.lock();
+        if state.links.remove(&(a, b)).is_none() {
+            return;
+        }
+        state.links.remove(&(b, a));
+        state.neighbours[a].retain(|n| *n != b);
+        state.neighbours[b].retain(|n| *n != a);
+        for (local, remote) in [(a, b), (b, a)] {
+            let event = NetworkEvent::PeerDisconnected {
+                peer_id: state.peer_ids[remote].clone(),
+            };
+            Self::notify(&state, local, event);
+        }
+    }
+
+    /// Change the conditions of an existing link in both directions
+    pub fn set_link(&self, a: usize, b: usize, conditions: LinkConditions) {
+        let mut state = self.lock();
+        for key in [(a, b), (b, a)] {
+            if let Some(link) = state.links.get_mut(&key) {
+                link.conditions = conditions;
+            }
+        }
+    }
+
+    /// Split the network; nodes not listed form one more group
+    pub fn partition(&self, groups: &[Vec<usize>]) {
+        let mut state = self.lock();
+        state.groups.iter_mut().for_each(|group| *group = 0);
+        for (index, members) in groups.iter().enumerate() {
+            for node in members {
+                if let Some(group) = state.groups.get_mut(*node) {
+                    *group = index + 1;
+                }
+            }
+        }
+    }
+
+    /// Remove all partitions
+    pub fn heal(&self) {
+        self.partition(&[]);
+    }
+
+    /// Bytes sent over all links so far
+    pub fn bytes_sent(&self) -> u64 {
+        self.lock().bytes_sent
+    }
+
+    /// Stop all routing tasks and close every node's event queue
+    pub fn shutdown(&self) {
+        let _ = self.shutdown.send(true);
+        self.lock().events.iter_mut().for_each(|events| *events = None);
+    }
+
+    fn notify(state: &TransportState, node: usize, event: NetworkEvent) {
+        if let Some(events) = &state.events[node] {
+            let _ = events.offer(event);
+        }
+    }
+
+    /// Carry a node's commands and outbound frames until shutdown
+    async fn route(
+        self: Arc<Self>,
+        index: usize,
+        mut commands: mpsc::Receiver<SwarmCommand>,
+        outbound: Arc<OutboundQueues>,
+    ) {
+        let mut shutdown = self.shutdown.subscribe();
+        loop {
+            tokio::select! {
+                _ = shutdown.changed() => break,
+                command = commands.recv() => match command {
+                    Some(SwarmCommand::Disconnect(peer)) => {
+                        let remote = self.lock().peer_ids.iter().position(|id| *id == peer);
+                        if let Some(remote) = remote {
+                            self.disconnect(index, remote);
+                        }
+                    }
+                    Some(SwarmCommand::ReportValidation { message_id, validation, .. }) => {
+                        self.validated(index, &message_id, validation);
+                    }
+                    Some(_) => {}
+                    None => break,
+                },
+                _ = outbound.ready() => {
+                    for (destination, data) in outbound.pop_batch(DISPATCH_BATCH) {
+                        match destination {
+                            Destination::Topic(topic) => self.publish(index, topic, data),
+                            Destination::Peer(peer) => self.send(index, &peer, data),
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    fn publish(self: &Arc<Self>, from: usize, topic: GossipTopic, data: Bytes) {
+        let id: [u8; 32] = Sha256::digest(&data).into();
+        let mut state = self.lock();
+        state.seen[from].insert(id);
+        self.relay(&mut state, from, None, topic, data, id);
+    }
+
+    /// Relay held gossip once its receiver accepts it; otherwise drop it
+    fn validated(self: &Arc<Self>, at: usize, message_id: &[u8], validation: MessageValidation) {
+        let Ok(id) = <[u8; 32]>::try_from(message_id) else {
+            return;
+        };
+        let mut state = self.lock();
+        let Some((from, topic, data)) = state.unvalidated.remove(&(at, id)) else {
+            return;
+        };
+        if validation == MessageValidation::Accept {
+            self.relay(&mut state, at, Some(from), topic, data, id);
+        }
+    }
+
+    /// Send a frame over the link to one peer only
+    fn send(self: &Arc<Self>, from: usize, peer: &str, data: Bytes) {
+        let mut state = self.lock();
+        let Some(to) = state.peer_ids.iter().position(|id| id == peer) else {
+            return;
+        };
+        if state.groups[from] != state.groups[to] {
+            return;
+        }
+        if let Some(arrival) = self.transmit(&mut state, from, to, data.len()) {
+            tokio::spawn(self.clone().deliver(from, to, None, data, arrival));
+        }
+    }
+
+    /// Schedule delivery to every reachable neighbour except `except`
+    fn relay(
+        self: &Arc<Self>,
+        state: &mut TransportState,
+        at: usize,
+        except: Option<usize>,
+        topic: GossipTopic,
+        data: Bytes,
+        id: [u8; 32],
+    ) {
+        for to in state.neighbours[at].clone() {
+            if Some(to) == except || state.groups[at] != state.groups[to] {
+                continue;
+            }
+            if let Some(arrival) = self.transmit(state, at, to, data.len()) {
+                tokio::spawn(self.clone().deliver(at, to, Some((topic, id)), data.clone(), arrival));
+            }
+        }
+    }
+
+    /// Queue `len` bytes on a link; returns when they arrive, or None if lost
+    fn transmit(&self, state: &mut TransportState, from: usize, to: usize, len: usize) -> Option<Instant> {
+        let link = state.links.get_mut(&(from, to))?;
+        state.bytes_sent += len as u64;
+        let mut rng = self.rng.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        let conditions = link.conditions;
+        if conditions.loss > 0.0 && rng.random::<f64>() < conditions.loss {
+            return None;
+        }
+        let transmit = conditions
+            .bandwidth_bytes_per_sec
+            .map(|rate| Duration::from_secs_f64(len as f64 / rate.max(1) as f64))
+            .unwrap_or_default();
+        link.busy_until = link.busy_until.max(Instant::now()) + transmit;
+        let jitter = conditions.jitter.mul_f64(rng.random::<f64>());
+        Some(link.busy_until + conditions.latency + jitter)
+    }
+
+    /// Hand a frame to its receiver; gossip (`topic` and message id) is held for relay
+    async fn deliver(
+        self: Arc<Self>,
+        from: usize,
+        to: usize,
+        gossip: Option<(GossipTopic, [u8; 32])>,
+        data: Bytes,
+        arrival: Instant,
+    ) {
+        tokio::time::sleep_until(arrival).await;
+        let (events, source) = {
+            let mut state = self.lock();
+            let reachable = state.links.contains_key(&(from, to)) && state.groups[from] == state.groups[to];
+            if !reachable {
+                return;
+            }
+            if let Some((topic, id)) = gossip {
+                if !state.seen[to].insert(id) {
+                    return;
+                }
+                // Gossip: relayed once the node accepts it, as gossipsub does
+                state.unvalidated.insert((to, id), (from, topic, data.clone()));
+            }
+            let Some(events) = state.events[to].clone() else {
+                return;
+            };
+            (events, state.peer_ids[from].clone())
+        };
+        let event = match gossip {
+            Some((topic, id)) => NetworkEvent::Message {
+                topic,
+                source,
+                message_id: id.to_vec(),
+                data: data.to_vec(),
+            },
+            None => NetworkEvent::Direct {
+                source,
+                data: data.to_vec(),
+            },
+        };
+        if events.offer(event).is_err() {
+            if let Some((_, id)) = gossip {
+                self.lock().unvalidated.remove(&(to, id));
+            }
+        }
+    }
+}
+
+/// One simulated node
+struct SimNode {
+    network: P2PNetwork,
+    blockchain: Arc<RwLock<Blockchain>>,
+    storage: Arc<StorageManager>,
+    handle: P2PHandle,
+    /// PoA engine, in [`SimulatedConsensus::Poa`] runs
+    engine: Option<Arc<POAConsensusEngine>>,
+}
+
+/// Proposal and import times shared by the measurement tasks
+#[derive(Debug, Default)]
+struct Measurements {
+    /// Block hash -> proposal time
+    proposals: HashMap<String, Instant>,
+    /// Heights that received a proposal
+    heights: HashSet<u64>,
+    forks: u64,
+    /// Proposal-to-import delays
+    delays: Vec<Duration>,
+    /// Block-to-certificate delays
+    finality: Vec<Duration>,
+}
+
+/// A set of nodes connected by a simulated transport
+pub struct Simulation {
+    config: SimulationConfig,
+    transport: Arc<SimulatedTransport>,
+    nodes: Vec<SimNode>,
+    measurements: Arc<Mutex<Measurements>>,
+    /// Shared by every node, so block timestamps follow virtual time
+    clock: Clock,
+    /// Measurement tasks, stopped at shutdown
+    tasks: Vec<JoinHandle<()>>,
+}
+
+impl Simulation {
+    /// Create the nodes, each building the genesis block from the same
+    /// configuration as real nodes do, and link them in a random mesh
+    pub async fn new(config: SimulationConfig) -> Result<Self> {
+        if config.nodes < 2 {
+            return Err(anyhow!("A simulation needs at least two nodes"));
+        }
+        let genesis = GenesisConfig {
+            extra_data: "GridTokenX Simulation Genesis".to_string(),
+            allocations: vec![GenesisAllocation {
+                address: FAUCET.to_string(),
+                amount: u64::MAX / 2,
+                description: "Simulation faucet".to_string(),
+            }],
+            authorities: Vec::new(),
+            ..GenesisConfig::default()
+        };
+
+        let mut rng = StdRng::seed_from_u64(config.seed);
+        let keys: Vec<SigningKey> = (0..config.nodes)
+            .map(|_| SigningKey::from_bytes(&rng.random()))
+            .collect();
+        let poa = poa_config(&config, &keys);
+
+        let clock = Clock::runtime();
+        let transport = SimulatedTransport::new(config.seed);
+        let measurements = Arc::new(Mutex::new(Measurements::default()));
+        let mut nodes = Vec::with_capacity(config.nodes);
+        let mut tasks = Vec::new();
+        for (index, key) in keys.into_iter().enumerate() {
+            let storage = Arc::new(StorageManager::new_memory());
+            let mut chain = Blockchain::new(storage.clone()).await?;
+            chain.add_genesis_block(build_genesis(&genesis)?).await?;
+            let blockchain = Arc::new(RwLock::new(chain));
+
+            let mut p2p = P2PConfig::default();
+            p2p.propagation.mode = config.propagation;
+            p2p.propagation.min_block_bytes = 0;
+            let mut network = P2PNetwork::new(p2p, blockchain.clone()).await?;
+            let engine = match config.consensus {
+                SimulatedConsensus::Rotation => None,
+                SimulatedConsensus::Poa => {
+                    let engine = POAConsensusEngine::with_signing_key(blockchain.clone(), poa.clone(), Some(key))
+                        .await?
+                        .with_clock(clock);
+                    Some(Arc::new(engine))
+                }
+            };
+            if let Some(engine) = &engine {
+                network = network.with_block_verifier(engine.clone());
+            }
+            network.start_with_transport(transport.attach(format!("sim-node-{}", index)))?;
+            let handle = network
+                .handle()
+                .ok_or_else(|| anyhow!("Simulated node {} did not start", index))?;
+            if let Some(engine) = &engine {
+                engine.attach_network(handle.clone());
+            }
+            tasks.push(tokio::spawn(record_imports(
+                network.subscribe_imported_blocks(),
+                measurements.clone(),
+                clock,
+            )));
+            nodes.push(SimNode {
+                network,
+                blockchain,
+                storage,
+                handle,
+                engine,
+            });
+        }
+
+        // Ring for connectivity, then random links up to the target degree
+        let degree = config.degree.max(2).min(config.nodes - 1);
+        let mut edges: HashSet<(usize, usize)> = HashSet::new();
+        for a in 0..config.nodes {
+            edges.insert(ordered(a, (a + 1) % config.nodes));
+        }
+        for a in 0..config.nodes {
+            let mut attempts = 0;
+            while edges.iter().filter(|(x, y)| *x == a || *y == a).count() < degree && attempts < 8 * degree {
+                edges.insert(ordered(a, rng.random_range(0..config.nodes)));
+                edges.retain(|(x, y)| x != y);
+                attempts += 1;
+            }
+        }
+        let mut edges: Vec<_> = edges.into_iter().collect();
+        edges.sort_unstable();
+        for (a, b) in edges {
+            transport.connect(a, b, config.link);
+        }
+
+        Ok(Self {
+            config,
+            transport,
+            nodes,
+            measurements,
+            clock,
+            tasks,
+        })
+    }
+
+    /// Transport, for changing links and partitions during a run
+    pub fn transport(&self) -> &Arc<SimulatedTransport> {
+        &self.transport
+    }
+
+    /// Network of one node
+    pub fn network(&self, index: usize) -> Option<&P2PNetwork> {
+        self.nodes.get(index).map(|node| &node.network)
+    }
+
+    /// Produce the configured number of blocks under a steady transaction load
+    pub async fn run(&mut self) -> Result<SimulationReport> {
+        let started = Instant::now();
+        let submitted = Arc::new(AtomicU64::new(0));
+        let injector = tokio::spawn(inject_transactions(
+            self.nodes.iter().map(|node| (node.blockchain.clone(), node.handle.clone())).collect(),
+            self.config.transactions_per_second,
+            submitted.clone(),
+        ));
+
+        match self.config.consensus {
+            SimulatedConsensus::Rotation => self.rotate_proposers().await,
+            SimulatedConsensus::Poa => self.run_authorities().await?,
+        }
+        injector.abort();
+        // Let the last block propagate and finalize
+        tokio::time::sleep(self.config.block_interval).await;
+        let elapsed = started.elapsed();
+
+        self.report(submitted.load(Ordering::Relaxed), elapsed).await
+    }
+
+    /// Propose for each node in turn, one block per interval
+    async fn rotate_proposers(&self) {
+        let mut slots = tokio::time::interval(self.config.block_interval);
+        slots.tick().await;
+        for slot in 0..self.config.blocks {
+            slots.tick().await;
+            let proposer = (slot % self.nodes.len() as u64) as usize;
+            if let Err(e) = self.propose(proposer).await {
+                tracing::debug!("Simulated node {} failed to propose: {}", proposer, e);
+            }
+        }
+    }
+
+    /// Run every node's PoA engine and finality gadget until some node holds
+    /// the configured number of blocks; the gadgets keep running until shutdown
+    async fn run_authorities(&mut self) -> Result<()> {
+        let mut authorities = Vec::with_capacity(self.nodes.len());
+        for node in &self.nodes {
+            let Some(engine) = node.engine.clone() else {
+                continue;
+            };
+            let gadget = FinalityGadget::new(
+                engine.authority_keys(),
+                engine.signing_key(),
+                &POAConfig::default().finality,
+            )?;
+            let gadget = finality::run(
+                gadget,
+                node.blockchain.clone(),
+                node.storage.clone(),
+                node.handle.clone(),
+                node.network.subscribe_consensus(),
+            );
+            self.tasks.push(tokio::spawn(async move {
+                if let Err(e) = gadget.await {
+                    tracing::debug!("Simulated finality gadget stopped: {}", e);
+                }
+            }));
+            self.tasks.push(tokio::spawn(record_finality(
+                node.blockchain.clone(),
+                node.storage.clone(),
+                self.measurements.clone(),
+                self.clock,
+            )));
+            authorities.push(tokio::spawn(async move {
+                if let Err(e) = engine.start_consensus().await {
+                    tracing::debug!("Simulated authority stopped: {}", e);
+                }
+            }));
+        }
+
+        // Give up after four intervals per block, in case the authorities stall
+        let deadline = Instant::now() + self.config.block_interval * (4 * self.config.blocks as u32 + 4);
+        while Instant::now() < deadline && self.max_height().await? < self.config.blocks {
+            tokio::time::sleep(self.config.block_interval).await;
+        }
+        authorities.iter().for_each(JoinHandle::abort);
+        Ok(())
+    }
+
+    async fn max_height(&self) -> Result<u64> {
+        let mut max = 0;
+        for node in &self.nodes {
+            max = max.max(node.blockchain.read().await.get_height().await?.saturating_sub(1));
+        }
+        Ok(max)
+    }
+
+    async fn propose(&self, index: usize) -> Result<()> {
+        let node = &self.nodes[index];
+        let blockchain = node.blockchain.read().await;
+        let tip = blockchain.get_latest_block().await?;
+        // Fill the block up to its gas limit
+        let mut gas = 0u64;
+        let transactions: Vec<Transaction> = blockchain
+            .get_pending_transactions(self.config.max_block_transactions)
+            .await
+            .into_iter()
+            .take_while(|tx| {
+                gas += tx.gas_limit;
+                gas <= BLOCK_GAS_LIMIT
+            })
+            .collect();
+        let mut block = Block::new(
+            tip.header.hash.clone(),
+            transactions,
+            tip.header.height + 1,
+            ValidatorInfo {
+                address: node.handle.local_peer_id().to_string(),
+                stake: 0,
+                reputation: 100.0,
+                authority_type: Some("SIMULATED".to_string()),
+            },
+        )?;
+        block.header.timestamp = self.clock.now().max(tip.header.timestamp);
+        block.header.hash = block.calculate_hash()?;
+
+        blockchain.add_block(block.clone()).await?;
+        {
+            let mut measurements = self.measurements.lock().unwrap_or_else(|p| p.into_inner());
+            if !measurements.heights.insert(block.header.height) {
+                measurements.forks += 1;
+            }
+            measurements
+                .proposals
+                .insert(block.header.hash.clone(), Instant::now());
+        }
+        let tx_ids: Vec<String> = block.transactions.iter().map(|tx| tx.id.clone()).collect();
+        blockchain.remove_pending_transactions(&tx_ids).await;
+        node.handle.broadcast_block(&block)
+    }
+
+    async fn report(&self, submitted: u64, elapsed: Duration) -> Result<SimulationReport> {
+        let mut heights = Vec::with_capacity(self.nodes.len());
+        let mut finalized = Vec::with_capacity(self.nodes.len());
+        for node in &self.nodes {
+            heights.push(node.blockchain.read().await.get_height().await?.saturating_sub(1));
+            let mut height = 0;
+            while node.storage.get_commit_certificate(height + 1).await?.is_some() {
+                height += 1;
+            }
+            finalized.push(height);
+        }
+
+        // Transactions on the longest chain count as committed
+        let (longest, max_height) = heights
+            .iter()
+            .copied()
+            .enumerate()
+            .max_by_key(|(_, height)| *height)
+            .unwrap_or_default();
+        let mut committed = 0u64;
+        let mut timestamps = Vec::with_capacity(max_height as usize);
+        let mut chain = Vec::with_capacity(max_height as usize);
+        {
+            let blockchain = self.nodes[longest].blockchain.read().await;
+            for height in 1..=max_height {
+                let block = blockchain.get_block_by_height(height).await?;
+                committed += block.transactions.len() as u64;
+                timestamps.push(block.header.timestamp);
+                chain.push(block.header.hash);
+            }
+        }
+        let block_interval_ms = match (timestamps.first(), timestamps.last()) {
+            (Some(first), Some(last)) if timestamps.len() > 1 => {
+                (*last - *first).num_milliseconds() as f64 / (timestamps.len() - 1) as f64
+            }
+            _ => 0.0,
+        };
+
+        // Authorities never propose on a tip they do not hold, so a fork
+        // shows up as nodes holding different blocks at one height
+        let mut diverged = HashSet::new();
+        if self.config.consensus == SimulatedConsensus::Poa {
+            for (node, &height) in self.nodes.iter().zip(&heights) {
+                let blockchain = node.blockchain.read().await;
+                for (at, hash) in (1..=height.min(max_height)).zip(&chain) {
+                    if blockchain.get_block_by_height(at).await?.header.hash != *hash {
+                        diverged.insert(at);
+                    }
+                }
+            }
+        }
+
+        let measurements = self.measurements.lock().unwrap_or_else(|p| p.into_inner());
+        let milliseconds = |samples: &[Duration]| {
+            let mut samples: Vec<f64> = samples.iter().map(|delay| delay.as_secs_f64() * 1000.0).collect();
+            samples.sort_by(f64::total_cmp);
+            samples
+        };
+        let delays = milliseconds(&measurements.delays);
+        let finality = milliseconds(&measurements.finality);
+        let (proposed, forks) = match self.config.consensus {
+            SimulatedConsensus::Rotation => (measurements.proposals.len() as u64, measurements.forks),
+            SimulatedConsensus::Poa => (max_height, diverged.len() as u64),
+        };
+        let expected = proposed as usize * (self.nodes.len() - 1);
+
+        Ok(SimulationReport {
+            nodes: self.nodes.len(),
+            propagation: self.config.propagation,
+            consensus: self.config.consensus,
+            blocks_proposed: proposed,
+            fork_rate: ratio(forks, proposed),
+            block_interval_ms,
+            propagation_p50_ms: percentile(&delays, 0.50),
+            propagation_p90_ms: percentile(&delays, 0.90),
+            propagation_p99_ms: percentile(&delays, 0.99),
+            undelivered_rate: ratio(expected.saturating_sub(delays.len()) as u64, expected as u64),
+            transactions_submitted: submitted,
+            transactions_committed: committed,
+            sustained_tps: committed as f64 / elapsed.as_secs_f64(),
+            bytes_sent: self.transport.bytes_sent(),
+            min_height: heights.iter().copied().min().unwrap_or_default(),
+            max_height,
+            finality_p50_ms: percentile(&finality, 0.50),
+            finality_p99_ms: percentile(&finality, 0.99),
+            finalized_height: finalized.iter().copied().min().unwrap_or_default(),
+        })
+    }
+
+    /// Stop the transport and every node's background tasks
+    pub fn shutdown(self) {
+        self.tasks.iter().for_each(JoinHandle::abort);
+        self.transport.shutdown();
+    }
+}
+
+/// One authority per node, with the simulated block interval as block time
+fn poa_config(config: &SimulationConfig, keys: &[SigningKey]) -> POAConfig {
+    let block_time_ms = config.block_interval.as_millis().max(1) as u64;
+    POAConfig {
+        block_time_ms,
+        proposer_timeout_ms: 2 * block_time_ms,
+        max_block_transactions: config.max_block_transactions,
+        initial_authorities: keys
+            .iter()
+            .enumerate()
+            .map(|(index, key)| AuthorityConfig {
+                public_key: hex::encode(key.verifying_key().as_bytes()),
+                authority_type: ThaiAuthorityType::GridOperator,
+                license_number: format!("SIM-{}", index),
+                organization: format!("sim-authority-{}", index),
+            })
+            .collect(),
+        ..POAConfig::default()
+    }
+}
+
+/// Run one simulation and tear it down
+pub async fn run_simulation(config: SimulationConfig) -> Result<SimulationReport> {
+    let mut simulation = Simulation::new(config).await?;
+    let report = simulation.run().await;
+    simulation.shutdown();
+    report
+}
+
+/// Run the same scenario at each node count
+pub async fn sweep(config: &SimulationConfig, node_counts: &[usize]) -> Result<Vec<SimulationReport>> {
+    let mut reports = Vec::with_capacity(node_counts.len());
+    for &nodes in node_counts {
+        let report = run_simulation(SimulationConfig {
+            nodes,
+            ..config.clone()
+        })
+        .await?;
+        tracing::info!(
+            "Simulated {} nodes ({:?}, {:?}): p50 {:.1} ms, p99 {:.1} ms, forks {:.3}, {:.1} TPS",
+            report.nodes,
+            report.consensus,
+            report.propagation,
+            report.propagation_p50_ms,
+            report.propagation_p99_ms,
+            report.fork_rate,
+            report.sustained_tps
+        );
+        reports.push(report);
+    }
+    Ok(reports)
+}
+
+/// Run [`sweep`] on its own current-thread runtime with time paused.
+///
+/// Must not be called from inside another runtime.
+#[cfg(any(test, feature = "simulator"))]
+pub fn sweep_in_virtual_time(
+    config: &SimulationConfig,
+    node_counts: &[usize],
+) -> Result<Vec<SimulationReport>> {
+    tokio::runtime::Builder::new_current_thread()
+        .enable_all()
+        .start_paused(true)
+        .build()?
+        .block_on(sweep(config, node_counts))
+}
+
+/// Pausing time needs tokio's `test-util`, enabled by the `simulator` feature
+#[cfg(not(any(test, feature = "simulator")))]
+pub fn sweep_in_virtual_time(
+    _config: &SimulationConfig,
+    _node_counts: &[usize],
+) -> Result<Vec<SimulationReport>> {
+    Err(anyhow!(
+        "Simulations need virtual time; rebuild with `--features simulator`"
+    ))
+}
+
+/// Record how long each imported block took to arrive
+async fn record_imports(
+    mut imported: broadcast::Receiver<BlockHeader>,
+    measurements: Arc<Mutex<Measurements>>,
+    clock: Clock,
+) {
+    loop {
+        match imported.recv().await {
+            Ok(header) => {
+                let mut measurements = measurements.lock().unwrap_or_else(|p| p.into_inner());
+                // Blocks proposed by PoA engines are timed from their timestamp
+                let delay = match measurements.proposals.get(&header.hash) {
+                    Some(proposed_at) => Some(proposed_at.elapsed()),
+                    None if measurements.proposals.is_empty() => {
+                        (clock.now() - header.timestamp).to_std().ok()
+                    }
+                    None => None,
+                };
+                if let Some(delay) = delay {
+                    measurements.delays.push(delay);
+                }
+            }
+            Err(RecvError::Lagged(_)) => continue,
+            Err(RecvError::Closed) => break,
+        }
+    }
+}
+
+/// Record how long after its timestamp each block got a stored commit certificate
+async fn record_finality(
+    blockchain: Arc<RwLock<Blockchain>>,
+    storage: Arc<StorageManager>,
+    measurements: Arc<Mutex<Measurements>>,
+    clock: Clock,
+) {
+    let mut poll = tokio::time::interval(FINALITY_POLL);
+    let mut next = 1;
+    loop {
+        poll.tick().await;
+        while let Ok(Some(certificate)) = storage.get_commit_certificate(next).await {
+            let block = blockchain.read().await.get_block_by_height(next).await;
+            let timestamp = block
+                .ok()
+                .filter(|block| block.header.hash == certificate.block_hash)
+                .map(|block| block.header.timestamp);
+            if let Some(delay) = timestamp.and_then(|timestamp| (clock.now() - timestamp).to_std().ok()) {
+                measurements.lock().unwrap_or_else(|p| p.into_inner()).finality.push(delay);
+            }
+            next += 1;
+        }
+    }
+}
+
+/// Submit transfers round-robin across nodes at a fixed rate
+async fn inject_transactions(
+    nodes: Vec<(Arc<RwLock<Blockchain>>, P2PHandle)>,
+    per_second: u64,
+    submitted: Arc<AtomicU64>,
+) {
+    let mut tick = tokio::time::interval(INJECT_TICK);
+    let per_tick = per_second as f64 * INJECT_TICK.as_secs_f64();
+    let mut owed = 0.0;
+    let mut nonce = 0u64;
+    loop {
+        tick.tick().await;
+        owed += per_tick;
+        while owed >= 1.0 {
+            owed -= 1.0;
+            nonce += 1;
+            let (blockchain, handle) = &nodes[nonce as usize % nodes.len()];
+            let Ok(transaction) = Transaction::new(
+                TransactionType::TokenTransfer {
+                    amount: 1,
+                    message: None,
+                },
+                FAUCET.to_string(),
+                Some(format!("sim-account-{}", nonce % 1000)),
+                1,
+                nonce,
+            ) else {
+                continue;
+            };
+            if blockchain
+                .read()
+                .await
+                .add_pending_transaction(transaction.clone())
+                .await
+                .is_ok()
+                && handle.broadcast_transaction(&transaction).is_ok()
+            {
+                submitted.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+fn ordered(a: usize, b: usize) -> (usize, usize) {
+    (a.min(b), a.max(b))
+}
+
+fn ratio(part: u64, whole: u64) -> f64 {
+    if whole == 0 { 0.0 } else { part as f64 / whole as f64 }
+}
+
+/// Nearest-rank percentile of sorted samples
+fn percentile(sorted: &[f64], quantile: f64) -> f64 {
+    if sorted.is_empty() {
+        return 0.0;
+    }
+    let rank = (quantile * sorted.len() as f64).ceil() as usize;
+    sorted[rank.clamp(1, sorted.len()) - 1]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn fast_config(nodes: usize) -> SimulationConfig {
+        SimulationConfig {
+            nodes,
+            degree: 3,
+            link: LinkConditions {
+                latency: Duration::from_millis(5),
+                jitter: Duration::from_millis(1),
+                ..LinkConditions::default()
+            },
+            block_interval: Duration::from_millis(300),
+            blocks: 4,
+            transactions_per_second: 40,
+            ..SimulationConfig::default()
+        }
+    }
+
+    #[test]
+    fn test_percentile_uses_nearest_rank() {
+        let samples: Vec<f64> = (1..=100).map(f64::from).collect();
+        assert_eq!(percentile(&samples, 0.5), 50.0);
+        assert_eq!(percentile(&samples, 0.99), 99.0);
+        assert_eq!(percentile(&[], 0.5), 0.0);
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_blocks_propagate_to_every_node() {
+        let report = run_simulation(fast_config(5)).await.unwrap();
+        assert_eq!(report.blocks_proposed, 4);
+        assert_eq!(report.fork_rate, 0.0);
+        assert_eq!(report.min_height, 4);
+        assert_eq!(report.undelivered_rate, 0.0);
+        assert!(report.propagation_p50_ms >= 5.0);
+        assert!(report.transactions_committed > 0);
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_independently_started_nodes_exchange_blocks() {
+        // Each node minted its own genesis; blocks only import if they agree
+        let report = run_simulation(fast_config(2)).await.unwrap();
+        assert_eq!(report.min_height, 4);
+        assert_eq!(report.undelivered_rate, 0.0);
+        assert_eq!(report.fork_rate, 0.0);
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_poa_authorities_produce_and_finalize_blocks() {
+        let config = SimulationConfig {
+            consensus: SimulatedConsensus::Poa,
+            ..fast_config(4)
+        };
+        let report = run_simulation(config).await.unwrap();
+        assert!(report.min_height >= 4, "min height {}", report.min_height);
+        assert_eq!(report.fork_rate, 0.0);
+        assert!(
+            (300.0..400.0).contains(&report.block_interval_ms),
+            "interval {} ms",
+            report.block_interval_ms
+        );
+        assert!(report.finalized_height >= 3, "finalized {}", report.finalized_height);
+        assert!(report.finality_p50_ms >= 5.0);
+        assert!(report.transactions_committed > 0);
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_erasure_coded_blocks_reach_every_node() {
+        let config = SimulationConfig {
+            propagation: BlockPropagation::Erasure,
+            ..fast_config(5)
+        };
+        let report = run_simulation(config).await.unwrap();
+        assert_eq!(report.min_height, 4);
+        assert_eq!(report.undelivered_rate, 0.0);
+        assert!(report.transactions_committed > 0);
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_erasure_coding_propagates_faster_than_full_blocks() {
+        // Large blocks over slow links in a multi-hop mesh, where a whole
+        // block must arrive at each hop before it is relayed further
+        let config = |propagation| SimulationConfig {
+            propagation,
+            degree: 4,
+            link: LinkConditions {
+                bandwidth_bytes_per_sec: Some(125_000),
+                ..fast_config(24).link
+            },
+            transactions_per_second: 800,
+            ..fast_config(24)
+        };
+        let erasure = run_simulation(config(BlockPropagation::Erasure)).await.unwrap();
+        let full = run_simulation(config(BlockPropagation::Full)).await.unwrap();
+        assert_eq!(erasure.undelivered_rate, 0.0);
+        assert_eq!(full.undelivered_rate, 0.0);
+        assert!(
+            erasure.propagation_p50_ms < full.propagation_p50_ms
+                && erasure.propagation_p90_ms < full.propagation_p90_ms,
+            "erasure p50/p90 {}/{}ms vs full {}/{}ms",
+            erasure.propagation_p50_ms,
+            erasure.propagation_p90_ms,
+            full.propagation_p50_ms,
+            full.propagation_p90_ms
+        );
+        // Parity is the only overhead: at most n / k times the bytes
+        assert!(
+            erasure.bytes_sent * 2 < full.bytes_sent * 3,
+            "erasure {} bytes vs full {}",
+            erasure.bytes_sent,
+            full.bytes_sent
+        );
+    }
+
+    #[tokio::test(start_paused = true)]
+    async fn test_partitioned_nodes_fall_behind() {
+        let mut simulation = Simulation::new(fast_config(4)).await.unwrap();
+        simulation.transport().partition(&[vec![3]]);
+        let report = simulation.run().await.unwrap();
+        simulation.shutdown();
+
+        assert_eq!(report.min_height, 1); // node 3 only has its own block
+        assert!(report.undelivered_rate > 0.0);
+        assert!(report.fork_rate > 0.0);
+    }
+}
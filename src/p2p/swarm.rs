@@ -0,0 +1,679 @@
+//! GridTokenX libp2p Swarm
+//!
+//! This module owns the libp2p swarm (TCP + Noise + Yamux transport with
+//! gossipsub, Kademlia and mDNS). Peers are discovered through bootstrap
+//! nodes, Kademlia random walks and mDNS on the LAN. Frames meant for a single
+//! peer (fetches and their answers) go over a direct request/response
+//! protocol instead of gossip, and light clients talk to the node over a
+//! separate request/response protocol. The swarm runs in its own
+//! task and talks to the rest of the node only through bounded channels:
+//! commands come in from `P2PHandle`, outbound frames are taken from the
+//! priority queues in [`super::outbound`], and received messages and peer
+//! events go out to the inbound processor. It never touches the blockchain.
+//! Gossipsub holds each received message until the inbound processor reports
+//! it valid, invalid or ignored, so invalid messages are neither relayed nor
+//! free for the peer that sent them.
+//! Connections are admitted or refused by the [`super::limits`] guard before
+//! any protocol handler is set up for them, and every received frame passes
+//! the guard's size and rate check before it is handed to the node.
+
+use anyhow::{anyhow, Result};
+use bytes::Bytes;
+use futures::StreamExt;
+use libp2p::core::Endpoint;
+use libp2p::multiaddr::Protocol;
+use libp2p::request_response::{self, ProtocolSupport};
+use libp2p::swarm::behaviour::toggle::Toggle;
+use libp2p::swarm::{
+    dummy, ConnectionDenied, ConnectionId, FromSwarm, NetworkBehaviour, SwarmEvent, THandler,
+    THandlerInEvent, THandlerOutEvent, ToSwarm,
+};
+use libp2p::{
+    gossipsub, identity, kad, mdns, noise, tcp, yamux, Multiaddr, PeerId, StreamProtocol, Swarm,
+};
+use serde::de::{self, Visitor};
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use sha2::{Digest, Sha256};
+use std::collections::HashMap;
+use std::convert::Infallible;
+use std::fmt;
+use std::net::IpAddr;
+use std::sync::Arc;
+use std::task::{Context, Poll};
+use std::time::{Duration, Instant};
+use tokio::sync::mpsc;
+
+use super::bridge::BridgeSender;
+use super::light::{LightRequest, LightResponse, LIGHT_PROTOCOL};
+use super::limits::{ConnectionGuard, Direction, FrameCheck};
+use super::outbound::{OutboundQueues, DISPATCH_BATCH};
+use super::{
+    peer_multiaddr, Destination, GossipTopic, MessageValidation, NetworkEvent, SwarmCommand,
+};
+use crate::config::P2PConfig;
+
+/// Combined network behaviour
+#[derive(NetworkBehaviour)]
+struct GridBehaviour {
+    /// First, so the derive asks it before any other behaviour sets up
+    /// handler state for a connection it refuses
+    limits: LimitsBehaviour,
+    gossipsub: gossipsub::Behaviour,
+    kademlia: kad::Behaviour<kad::store::MemoryStore>,
+    mdns: Toggle<mdns::tokio::Behaviour>,
+    direct: request_response::cbor::Behaviour<DirectFrame, DirectAck>,
+    light: Toggle<request_response::cbor::Behaviour<LightRequest, LightResponse>>,
+}
+
+/// Most light-client requests awaiting an answer
+const MAX_PENDING_LIGHT_REQUESTS: usize = 1024;
+/// Protocol for frames sent to a single peer
+const DIRECT_PROTOCOL: &str = "/gridtokenx/direct/1";
+
+/// One wire frame sent to a single peer, carried as a CBOR byte string
+#[derive(Debug, Clone)]
+struct DirectFrame(Vec<u8>);
+
+impl Serialize for DirectFrame {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        serializer.serialize_bytes(&self.0)
+    }
+}
+
+impl<'de> Deserialize<'de> for DirectFrame {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+        struct FrameVisitor;
+
+        impl<'de> Visitor<'de> for FrameVisitor {
+            type Value = DirectFrame;
+
+            fn expecting(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+                f.write_str("a byte string")
+            }
+
+            fn visit_bytes<E: de::Error>(self, bytes: &[u8]) -> Result<DirectFrame, E> {
+                Ok(DirectFrame(bytes.to_vec()))
+            }
+
+            fn visit_byte_buf<E: de::Error>(self, bytes: Vec<u8>) -> Result<DirectFrame, E> {
+                Ok(DirectFrame(bytes))
+            }
+        }
+
+        deserializer.deserialize_bytes(FrameVisitor)
+    }
+}
+
+/// Receipt for a direct frame; answers travel as frames of their own
+#[derive(Debug, Clone, Serialize, Deserialize)]
+struct DirectAck;
+
+/// Light-client requests handed to the inbound processor, by request id
+#[derive(Default)]
+struct PendingLightRequests {
+    channels: HashMap<u64, request_response::ResponseChannel<LightResponse>>,
+    next_id: u64,
+}
+
+/// Enforces the connection guard as connections are accepted and established
+struct LimitsBehaviour {
+    guard: Arc<ConnectionGuard>,
+    /// Connections counted against the guard
+    open: HashMap<ConnectionId, (Option<IpAddr>, Direction)>,
+}
+
+impl LimitsBehaviour {
+    fn establish(
+        &mut self,
+        connection_id: ConnectionId,
+        address: &Multiaddr,
+        direction: Direction,
+    ) -> Result<THandler<Self>, ConnectionDenied> {
+        let ip = remote_ip(address);
+        if ip.is_some_and(|ip| self.guard.is_banned(&ip, Instant::now())) {
+            return Err(ConnectionDenied::new(anyhow!("{} is banned", address)));
+        }
+        self.guard.admit(ip, direction).map_err(ConnectionDenied::new)?;
+        self.open.insert(connection_id, (ip, direction));
+        Ok(dummy::ConnectionHandler)
+    }
+}
+
+impl NetworkBehaviour for LimitsBehaviour {
+    type ConnectionHandler = dummy::ConnectionHandler;
+    type ToSwarm = Infallible;
+
+    fn handle_pending_inbound_connection(
+        &mut self,
+        _connection_id: ConnectionId,
+        _local_addr: &Multiaddr,
+        remote_addr: &Multiaddr,
+    ) -> Result<(), ConnectionDenied> {
+        self.guard
+            .check_inbound(remote_ip(remote_addr), Instant::now())
+            .map_err(ConnectionDenied::new)
+    }
+
+    fn handle_established_inbound_connection(
+        &mut self,
+        connection_id: ConnectionId,
+        _peer: PeerId,
+        _local_addr: &Multiaddr,
+        remote_addr: &Multiaddr,
+    ) -> Result<THandler<Self>, ConnectionDenied> {
+        self.establish(connection_id, remote_addr, Direction::Inbound)
+    }
+
+    fn handle_established_outbound_connection(
+        &mut self,
+        connection_id: ConnectionId,
+        _peer: PeerId,
+        addr: &Multiaddr,
+        _role_override: Endpoint,
+    ) -> Result<THandler<Self>, ConnectionDenied> {
+        self.establish(connection_id, addr, Direction::Outbound)
+    }
+
+    fn on_swarm_event(&mut self, event: FromSwarm) {
+        if let FromSwarm::ConnectionClosed(closed) = event {
+            if let Some((ip, direction)) = self.open.remove(&closed.connection_id) {
+                self.guard.release(ip, direction);
+            }
+        }
+    }
+
+    fn on_connection_handler_event(
+        &mut self,
+        _peer: PeerId,
+        _connection_id: ConnectionId,
+        event: THandlerOutEvent<Self>,
+    ) {
+        match event {}
+    }
+
+    fn poll(&mut self, _cx: &mut Context<'_>) -> Poll<ToSwarm<Self::ToSwarm, THandlerInEvent<Self>>> {
+        Poll::Pending
+    }
+}
+
+fn remote_ip(address: &Multiaddr) -> Option<IpAddr> {
+    address.iter().find_map(|protocol| match protocol {
+        Protocol::Ip4(ip) => Some(IpAddr::V4(ip)),
+        Protocol::Ip6(ip) => Some(IpAddr::V6(ip)),
+        _ => None,
+    })
+}
+
+/// Build the swarm, start listening and spawn its event loop.
+///
+/// `identity` is the Ed25519 secret key the peer id is derived from.
+/// Returns the local peer id.
+pub fn spawn(
+    config: &P2PConfig,
+    identity: [u8; 32],
+    commands: mpsc::Receiver<SwarmCommand>,
+    outbound: Arc<OutboundQueues>,
+    events: BridgeSender<NetworkEvent>,
+    guard: Arc<ConnectionGuard>,
+) -> Result<String> {
+    let keypair = identity::Keypair::ed25519_from_bytes(identity)
+        .map_err(|e| anyhow!("Invalid node identity key: {}", e))?;
+    let local_peer_id = keypair.public().to_peer_id();
+    let mut swarm = build_swarm(config, keypair, guard)?;
+
+    for topic in GossipTopic::ALL {
+        swarm
+            .behaviour_mut()
+            .gossipsub
+            .subscribe(&gossipsub::IdentTopic::new(topic.name()))
+            .map_err(|e| anyhow!("Failed to subscribe to {}: {:?}", topic.name(), e))?;
+    }
+
+    let listen_addr: Multiaddr = config
+        .listen_addr
+        .parse()
+        .map_err(|e| anyhow!("Invalid listen address {}: {}", config.listen_addr, e))?;
+    swarm
+        .listen_on(listen_addr)
+        .map_err(|e| anyhow!("Failed to listen: {}", e))?;
+
+    if let Some(external) = &config.external_addr {
+        let external: Multiaddr = external
+            .parse()
+            .map_err(|e| anyhow!("Invalid external address {}: {}", external, e))?;
+        swarm.add_external_address(external);
+    }
+
+    let bootstrap: Vec<Multiaddr> = config
+        .bootstrap_peers
+        .iter()
+        .filter_map(|peer| match peer_multiaddr(peer).parse() {
+            Ok(addr) => Some(addr),
+            Err(e) => {
+                tracing::warn!("Ignoring invalid bootstrap peer {}: {}", peer, e);
+                None
+            }
+        })
+        .collect();
+    for addr in &bootstrap {
+        if let Err(e) = swarm.dial(addr.clone()) {
+            tracing::warn!("Failed to dial bootstrap peer {}: {}", addr, e);
+        }
+    }
+
+    let maintenance = Duration::from_secs(config.gossip.mesh_maintenance_interval.max(1));
+    tokio::spawn(run(swarm, commands, outbound, events, bootstrap, maintenance));
+
+    Ok(local_peer_id.to_string())
+}
+
+fn build_swarm(
+    config: &P2PConfig,
+    keypair: identity::Keypair,
+    guard: Arc<ConnectionGuard>,
+) -> Result<Swarm<GridBehaviour>> {
+    let gossip = &config.gossip;
+    let gossipsub_config = gossipsub::ConfigBuilder::default()
+        .heartbeat_interval(Duration::from_secs(gossip.heartbeat_interval.max(1)))
+        .duplicate_cache_time(Duration::from_secs(gossip.message_ttl))
+        .max_transmit_size(gossip.max_message_size)
+        .validation_mode(gossipsub::ValidationMode::Strict)
+        // Relay only what the inbound processor has accepted
+        .validate_messages()
+        // Identical payloads from different publishers are the same message
+        .message_id_fn(|message: &gossipsub::Message| {
+            gossipsub::MessageId::from(Sha256::digest(&message.data).to_vec())
+        })
+        .build()
+        .map_err(|e| anyhow!("Invalid gossipsub configuration: {}", e))?;
+
+    let enable_mdns = config.enable_mdns;
+    let enable_light = config.light_client.enabled;
+    let idle_timeout = Duration::from_secs(config.connection_timeout.max(1) * 2);
+
+    let swarm = libp2p::SwarmBuilder::with_existing_identity(keypair)
+        .with_tokio()
+        .with_tcp(
+            tcp::Config::default().nodelay(true),
+            noise::Config::new,
+            yamux::Config::default,
+        )
+        .map_err(|e| anyhow!("Failed to build TCP transport: {}", e))?
+        .with_dns()
+        .map_err(|e| anyhow!("Failed to build DNS transport: {}", e))?
+        .with_behaviour(|key| -> Result<GridBehaviour, Box<dyn std::error::Error + Send + Sync>> {
+            let peer_id = key.public().to_peer_id();
+            let mut gossipsub = gossipsub::Behaviour::new(
+                gossipsub::MessageAuthenticity::Signed(key.clone()),
+                gossipsub_config,
+            )?;
+            // Application scores from the peer manager steer mesh membership
+            gossipsub.with_peer_score(
+                gossipsub::PeerScoreParams::default(),
+                gossipsub::PeerScoreThresholds::default(),
+            )?;
+            let mut kademlia = kad::Behaviour::new(peer_id, kad::store::MemoryStore::new(peer_id));
+            // Answer DHT queries even before an external address is confirmed
+            kademlia.set_mode(Some(kad::Mode::Server));
+            let mdns = if enable_mdns {
+                Some(mdns::tokio::Behaviour::new(mdns::Config::default(), peer_id)?)
+            } else {
+                None
+            };
+            let direct = request_response::cbor::Behaviour::new(
+                [(StreamProtocol::new(DIRECT_PROTOCOL), ProtocolSupport::Full)],
+                request_response::Config::default(),
+            );
+            // Serve only; this node never asks other nodes light-client questions
+            let light = enable_light.then(|| {
+                request_response::cbor::Behaviour::new(
+                    [(StreamProtocol::new(LIGHT_PROTOCOL), ProtocolSupport::Inbound)],
+                    request_response::Config::default(),
+                )
+            });
+            Ok(GridBehaviour {
+                limits: LimitsBehaviour {
+                    guard,
+                    open: HashMap::new(),
+                },
+                gossipsub,
+                kademlia,
+                mdns: Toggle::from(mdns),
+                direct,
+                light: Toggle::from(light),
+            })
+        })
+        .map_err(|e| anyhow!("Failed to build network behaviour: {}", e))?
+        .with_swarm_config(|c| c.with_idle_connection_timeout(idle_timeout))
+        .build();
+
+    Ok(swarm)
+}
+
+async fn run(
+    mut swarm: Swarm<GridBehaviour>,
+    mut commands: mpsc::Receiver<SwarmCommand>,
+    outbound: Arc<OutboundQueues>,
+    events: BridgeSender<NetworkEvent>,
+    bootstrap: Vec<Multiaddr>,
+    maintenance_interval: Duration,
+) {
+    let mut maintenance = tokio::time::interval(maintenance_interval);
+    let mut light_requests = PendingLightRequests::default();
+
+    loop {
+        tokio::select! {
+            command = commands.recv() => match command {
+                Some(command) => handle_command(&mut swarm, command, &mut light_requests),
+                None => {
+                    tracing::info!("P2P command channel closed, stopping swarm");
+                    break;
+                }
+            },
+            _ = outbound.ready() => {
+                // A bounded batch, so inbound events are polled between batches
+                for (destination, data) in outbound.pop_batch(DISPATCH_BATCH) {
+                    match destination {
+                        Destination::Topic(topic) => publish(&mut swarm, topic, data),
+                        Destination::Peer(peer) => send_direct(&mut swarm, &peer, data),
+                    }
+                }
+            }
+            event = swarm.select_next_some() => {
+                handle_swarm_event(&mut swarm, event, &events, &mut light_requests)
+            }
+            _ = maintenance.tick() => {
+                // Re-dial bootstrap peers when isolated and refresh the DHT
+                if swarm.connected_peers().next().is_none() {
+                    for addr in &bootstrap {
+                        let _ = swarm.dial(addr.clone());
+                    }
+                }
+                let _ = swarm.behaviour_mut().kademlia.bootstrap();
+                // Random walk to find more peers while outbound slots are free
+                if swarm.behaviour().limits.guard.wants_outbound() {
+                    swarm.behaviour_mut().kademlia.get_closest_peers(PeerId::random());
+                }
+            }
+        }
+    }
+}
+
+fn publish(swarm: &mut Swarm<GridBehaviour>, topic: GossipTopic, data: Bytes) {
+    let topic_hash = gossipsub::IdentTopic::new(topic.name()).hash();
+    match swarm.behaviour_mut().gossipsub.publish(topic_hash, data) {
+        Ok(_) => {}
+        Err(gossipsub::PublishError::InsufficientPeers) => {
+            tracing::debug!("No peers subscribed to {}", topic.name());
+        }
+        Err(e) => tracing::warn!("Failed to publish on {}: {:?}", topic.name(), e),
+    }
+}
+
+fn send_direct(swarm: &mut Swarm<GridBehaviour>, peer: &str, data: Bytes) {
+    match peer.parse::<PeerId>() {
+        Ok(peer_id) => {
+            swarm
+                .behaviour_mut()
+                .direct
+                .send_request(&peer_id, DirectFrame(data.to_vec()));
+        }
+        Err(e) => tracing::warn!("Invalid peer id {}: {}", peer, e),
+    }
+}
+
+fn handle_command(
+    swarm: &mut Swarm<GridBehaviour>,
+    command: SwarmCommand,
+    light_requests: &mut PendingLightRequests,
+) {
+    match command {
+        SwarmCommand::Dial(addr) => match peer_multiaddr(&addr).parse::<Multiaddr>() {
+            Ok(addr) => {
+                if let Err(e) = swarm.dial(addr) {
+                    tracing::warn!("Dial failed: {}", e);
+                }
+            }
+            Err(e) => tracing::warn!("Invalid dial address {}: {}", addr, e),
+        },
+        SwarmCommand::Disconnect(peer) => match peer.parse::<PeerId>() {
+            Ok(peer_id) => {
+                let _ = swarm.disconnect_peer_id(peer_id);
+            }
+            Err(e) => tracing::warn!("Invalid peer id {}: {}", peer, e),
+        },
+        SwarmCommand::SetPeerScore { peer, score } => {
+            if let Ok(peer_id) = peer.parse::<PeerId>() {
+                swarm
+                    .behaviour_mut()
+                    .gossipsub
+                    .set_application_score(&peer_id, score);
+            }
+        }
+        SwarmCommand::ReportValidation {
+            message_id,
+            source,
+            validation,
+        } => {
+            if let Ok(peer_id) = source.parse::<PeerId>() {
+                report_validation(swarm, gossipsub::MessageId(message_id), &peer_id, validation);
+            }
+        }
+        SwarmCommand::LightResponse {
+            request_id,
+            response,
+        } => {
+            let channel = light_requests.channels.remove(&request_id);
+            if let (Some(channel), Some(light)) = (channel, swarm.behaviour_mut().light.as_mut()) {
+                // Fails only if the client has gone away
+                let _ = light.send_response(channel, response);
+            }
+        }
+    }
+}
+
+fn handle_swarm_event(
+    swarm: &mut Swarm<GridBehaviour>,
+    event: SwarmEvent<GridBehaviourEvent>,
+    events: &BridgeSender<NetworkEvent>,
+    light_requests: &mut PendingLightRequests,
+) {
+    match event {
+        SwarmEvent::NewListenAddr { address, .. } => {
+            tracing::info!("P2P listening on {}", address);
+        }
+        SwarmEvent::ConnectionEstablished {
+            peer_id, endpoint, ..
+        } => {
+            let mut address = endpoint.get_remote_address().clone();
+            if matches!(address.iter().last(), Some(Protocol::P2p(_))) {
+                address.pop();
+            }
+            // Only addresses we dialed are reachable; inbound ones are ephemeral ports
+            if endpoint.is_dialer() {
+                swarm.behaviour_mut().kademlia.add_address(&peer_id, address.clone());
+            }
+            forward(
+                events,
+                NetworkEvent::PeerConnected {
+                    peer_id: peer_id.to_string(),
+                    address: address.to_string(),
+                    outbound: endpoint.is_dialer(),
+                },
+            );
+        }
+        SwarmEvent::ConnectionClosed {
+            peer_id,
+            num_established,
+            ..
+        } if num_established == 0 => {
+            forward(
+                events,
+                NetworkEvent::PeerDisconnected {
+                    peer_id: peer_id.to_string(),
+                },
+            );
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Gossipsub(gossipsub::Event::Message {
+            propagation_source,
+            message_id,
+            message,
+        })) => {
+            let Some(topic) = GossipTopic::from_name(message.topic.as_str()) else {
+                report_validation(swarm, message_id, &propagation_source, MessageValidation::Ignore);
+                return;
+            };
+            match check_frame(swarm, events, &propagation_source, message.data.len()) {
+                FrameCheck::Accept => {}
+                FrameCheck::Drop => {
+                    report_validation(swarm, message_id, &propagation_source, MessageValidation::Ignore);
+                    return;
+                }
+                FrameCheck::Oversized | FrameCheck::Ban => {
+                    report_validation(swarm, message_id, &propagation_source, MessageValidation::Reject);
+                    return;
+                }
+            }
+            let event = NetworkEvent::Message {
+                topic,
+                source: propagation_source.to_string(),
+                message_id: message_id.0.clone(),
+                data: message.data,
+            };
+            if !forward(events, event) {
+                // Never reaches the node, so nothing else will release it
+                report_validation(swarm, message_id, &propagation_source, MessageValidation::Ignore);
+            }
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Kademlia(kad::Event::RoutingUpdated {
+            peer,
+            addresses,
+            ..
+        })) => {
+            if !swarm.is_connected(&peer) && swarm.behaviour().limits.guard.wants_outbound() {
+                let _ = swarm.dial(addresses.first().clone());
+            }
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Direct(request_response::Event::Message {
+            peer,
+            message: request_response::Message::Request { request, channel, .. },
+            ..
+        })) => {
+            // Fails only if the peer has gone away
+            let _ = swarm.behaviour_mut().direct.send_response(channel, DirectAck);
+            if check_frame(swarm, events, &peer, request.0.len()) != FrameCheck::Accept {
+                return;
+            }
+            forward(
+                events,
+                NetworkEvent::Direct {
+                    source: peer.to_string(),
+                    data: request.0,
+                },
+            );
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Direct(request_response::Event::OutboundFailure {
+            peer,
+            error,
+            ..
+        })) => {
+            tracing::debug!("Direct frame to {} failed: {}", peer, error);
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Light(request_response::Event::Message {
+            peer,
+            message: request_response::Message::Request { request, channel, .. },
+            ..
+        })) => {
+            let pending = &mut light_requests.channels;
+            if pending.len() >= MAX_PENDING_LIGHT_REQUESTS {
+                pending.retain(|_, channel| channel.is_open());
+                if pending.len() >= MAX_PENDING_LIGHT_REQUESTS {
+                    // Dropping the channel fails the request on the client side
+                    tracing::debug!("Too many light-client requests, refusing {}", peer);
+                    return;
+                }
+            }
+            let request_id = light_requests.next_id;
+            light_requests.next_id += 1;
+            let event = NetworkEvent::LightRequest {
+                client: peer.to_string(),
+                request_id,
+                request,
+            };
+            if events.offer(event).is_ok() {
+                pending.insert(request_id, channel);
+            } else {
+                tracing::debug!("Inbound network queue full, refusing light-client request");
+            }
+        }
+        SwarmEvent::Behaviour(GridBehaviourEvent::Mdns(mdns::Event::Discovered(peers))) => {
+            for (peer_id, address) in peers {
+                discovered(swarm, peer_id, address);
+            }
+        }
+        SwarmEvent::OutgoingConnectionError { peer_id, error, .. } => {
+            tracing::debug!("Outgoing connection to {:?} failed: {}", peer_id, error);
+        }
+        SwarmEvent::IncomingConnectionError {
+            send_back_addr, error, ..
+        } => {
+            tracing::debug!("Incoming connection from {} refused: {}", send_back_addr, error);
+        }
+        _ => {}
+    }
+}
+
+fn discovered(swarm: &mut Swarm<GridBehaviour>, peer_id: PeerId, address: Multiaddr) {
+    swarm.behaviour_mut().kademlia.add_address(&peer_id, address.clone());
+    if !swarm.is_connected(&peer_id) {
+        let _ = swarm.dial(address);
+    }
+}
+
+/// Size and rate check on a received frame; refusals that count against the
+/// peer are passed on so the node can penalise or ban it
+fn check_frame(
+    swarm: &Swarm<GridBehaviour>,
+    events: &BridgeSender<NetworkEvent>,
+    peer: &PeerId,
+    size: usize,
+) -> FrameCheck {
+    let source = peer.to_string();
+    let verdict = swarm.behaviour().limits.guard.check_frame(&source, size, Instant::now());
+    if matches!(verdict, FrameCheck::Oversized | FrameCheck::Ban) {
+        forward(events, NetworkEvent::FrameRefused { source, size, verdict });
+    }
+    verdict
+}
+
+/// Tell gossipsub whether to relay a held message and how to score its sender
+fn report_validation(
+    swarm: &mut Swarm<GridBehaviour>,
+    message_id: gossipsub::MessageId,
+    source: &PeerId,
+    validation: MessageValidation,
+) {
+    let acceptance = match validation {
+        MessageValidation::Accept => gossipsub::MessageAcceptance::Accept,
+        MessageValidation::Reject => gossipsub::MessageAcceptance::Reject,
+        MessageValidation::Ignore => gossipsub::MessageAcceptance::Ignore,
+    };
+    // Nothing to do if the message has already left the cache
+    let _ = swarm
+        .behaviour_mut()
+        .gossipsub
+        .report_message_validation_result(&message_id, source, acceptance);
+}
+
+/// Hand an event to the inbound processor without ever blocking the swarm;
+/// false if it was dropped
+fn forward(events: &BridgeSender<NetworkEvent>, event: NetworkEvent) -> bool {
+    match events.offer(event) {
+        Ok(()) => true,
+        Err(mpsc::error::TrySendError::Full(event)) => {
+            tracing::warn!("Inbound network queue full, dropping {:?}", event.kind());
+            false
+        }
+        Err(mpsc::error::TrySendError::Closed(_)) => false,
+    }
+}
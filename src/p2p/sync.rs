@@ -0,0 +1,632 @@
+//! GridTokenX Block Range Sync
+//!
+//! The sync manager splits a missing height range into fixed-size chunks and
+//! spreads them over every connected peer. Each peer gets a window of
+//! concurrent requests sized from its measured throughput; requests that time
+//! out are re-queued and shrink that peer's window. Downloaded chunks may
+//! arrive in any order and are released to the import stage strictly in
+//! height order.
+//!
+//! With fast sync enabled the manager first downloads the header chain, checks
+//! its linkage, and only then fetches bodies, which must match the headers.
+//!
+//! The end of the range is only what peers claim, and pings are not
+//! authenticated. Chunks are therefore generated lazily, at most
+//! [`MAX_BLOCKS_AHEAD`] past the import stage, and the target is cut back to
+//! the last verified height when peers cannot back it: a short header batch in
+//! fast sync, or an empty block chunk otherwise.
+//!
+//! The manager is a plain state machine; the network layer sends the requests
+//! it returns and feeds responses back in.
+
+use anyhow::{anyhow, Result};
+use std::collections::{BTreeMap, HashMap, VecDeque};
+use std::time::{Duration, Instant};
+
+use crate::blockchain::block::BlockHeader;
+use crate::blockchain::Block;
+use crate::config::SyncConfig;
+
+/// Headers requested in one message during fast sync
+pub const HEADER_BATCH: u64 = 512;
+
+/// Smoothing factor for per-peer throughput
+const THROUGHPUT_SMOOTHING: f64 = 0.3;
+
+/// Heights planned ahead of the import stage; later chunks wait for it to advance
+pub const MAX_BLOCKS_AHEAD: u64 = 4096;
+
+/// What a chunk request asks for
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ChunkKind {
+    Headers,
+    Blocks,
+}
+
+/// Request to send to a peer for heights `[start, end)`
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ChunkRequest {
+    pub request_id: String,
+    pub peer: String,
+    pub kind: ChunkKind,
+    pub start: u64,
+    pub end: u64,
+}
+
+#[derive(Debug, Clone)]
+struct InFlight {
+    peer: String,
+    kind: ChunkKind,
+    start: u64,
+    end: u64,
+    sent_at: Instant,
+}
+
+/// Download statistics for one peer
+#[derive(Debug, Clone)]
+pub struct PeerSyncStats {
+    /// Concurrent requests allowed
+    pub window: usize,
+    /// Requests currently outstanding
+    pub in_flight: usize,
+    /// Smoothed throughput (blocks per second)
+    pub blocks_per_sec: f64,
+    /// Requests that timed out
+    pub timeouts: u32,
+}
+
+impl PeerSyncStats {
+    fn new() -> Self {
+        Self {
+            window: 1,
+            in_flight: 0,
+            blocks_per_sec: 0.0,
+            timeouts: 0,
+        }
+    }
+}
+
+/// Parallel range sync state
+#[derive(Debug)]
+pub struct SyncManager {
+    config: SyncConfig,
+    /// Next height to hand to the import stage
+    next_import: u64,
+    /// End of the range being synced (exclusive); claimed by peers and cut
+    /// back once they fail to back it
+    target: u64,
+    /// Block chunks to request again, lowest first
+    pending: VecDeque<(u64, u64)>,
+    /// Start of the first chunk not planned yet
+    next_chunk: u64,
+    in_flight: HashMap<String, InFlight>,
+    peers: HashMap<String, PeerSyncStats>,
+    /// Downloaded blocks waiting for their predecessors
+    ready: BTreeMap<u64, Block>,
+    /// Verified header hashes (fast sync only)
+    headers: BTreeMap<u64, String>,
+    /// Hash the next header must link to (fast sync only)
+    header_tip: Option<String>,
+    /// Heights below this have verified headers
+    headers_end: u64,
+}
+
+impl SyncManager {
+    pub fn new(config: SyncConfig) -> Self {
+        Self {
+            config,
+            next_import: 0,
+            target: 0,
+            pending: VecDeque::new(),
+            next_chunk: 0,
+            in_flight: HashMap::new(),
+            peers: HashMap::new(),
+            ready: BTreeMap::new(),
+            headers: BTreeMap::new(),
+            header_tip: None,
+            headers_end: 0,
+        }
+    }
+
+    /// Start syncing `[start, end)` on top of the block with `anchor_hash`
+    pub fn start(&mut self, start: u64, end: u64, anchor_hash: Option<String>) {
+        self.next_import = start;
+        self.target = end.max(start);
+        self.pending.clear();
+        self.next_chunk = start;
+        self.in_flight.clear();
+        self.ready.clear();
+        self.headers.clear();
+        self.header_tip = anchor_hash;
+        self.headers_end = if self.config.fast_sync { start } else { self.target };
+        for stats in self.peers.values_mut() {
+            stats.in_flight = 0;
+        }
+    }
+
+    /// Whether a sync is in progress
+    pub fn is_active(&self) -> bool {
+        self.next_import < self.target
+    }
+
+    /// Whether every block of the range has been handed to the import stage
+    pub fn is_complete(&self) -> bool {
+        !self.is_active()
+    }
+
+    /// Next height the import stage expects
+    pub fn next_import(&self) -> u64 {
+        self.next_import
+    }
+
+    /// End of the range currently being synced (exclusive)
+    pub fn target(&self) -> u64 {
+        self.target
+    }
+
+    pub fn add_peer(&mut self, peer: &str) {
+        self.peers
+            .entry(peer.to_string())
+            .or_insert_with(PeerSyncStats::new);
+    }
+
+    /// Forget a peer and re-queue everything it was fetching
+    pub fn remove_peer(&mut self, peer: &str) {
+        self.peers.remove(peer);
+        let orphaned: Vec<String> = self
+            .in_flight
+            .iter()
+            .filter(|(_, request)| request.peer == peer)
+            .map(|(id, _)| id.clone())
+            .collect();
+        for id in orphaned {
+            if let Some(request) = self.in_flight.remove(&id) {
+                self.requeue(&request);
+            }
+        }
+    }
+
+    pub fn peer_stats(&self, peer: &str) -> Option<&PeerSyncStats> {
+        self.peers.get(peer)
+    }
+
+    /// Assign queued chunks to peers with free window slots
+    pub fn next_requests(&mut self, now: Instant) -> Vec<ChunkRequest> {
+        let mut requests = Vec::new();
+        if !self.is_active() || self.peers.is_empty() {
+            return requests;
+        }
+
+        // Fastest peers first
+        let mut peers: Vec<String> = self.peers.keys().cloned().collect();
+        peers.sort_by(|a, b| {
+            self.peers[b]
+                .blocks_per_sec
+                .total_cmp(&self.peers[a].blocks_per_sec)
+                .then_with(|| a.cmp(b))
+        });
+
+        if self.headers_end < self.target
+            && !self.in_flight.values().any(|r| r.kind == ChunkKind::Headers)
+        {
+            let end = self.headers_end.saturating_add(HEADER_BATCH).min(self.target);
+            let peer = peers[0].clone();
+            requests.push(self.issue(peer, ChunkKind::Headers, self.headers_end, end, now));
+        }
+
+        for peer in peers {
+            loop {
+                let stats = &self.peers[&peer];
+                if stats.in_flight >= stats.window {
+                    break;
+                }
+                let Some((start, end)) = self.next_chunk() else {
+                    return requests;
+                };
+                requests.push(self.issue(peer.clone(), ChunkKind::Blocks, start, end, now));
+            }
+        }
+        requests
+    }
+
+    /// Take the next block chunk to request: re-queued chunks first, then a
+    /// fresh one if it lies within [`MAX_BLOCKS_AHEAD`] of the import stage
+    fn next_chunk(&mut self) -> Option<(u64, u64)> {
+        let (chunk, requeued) = match self.pending.front() {
+            Some(&chunk) => (chunk, true),
+            None => {
+                let horizon = self.target.min(self.next_import.saturating_add(MAX_BLOCKS_AHEAD));
+                if self.next_chunk >= horizon {
+                    return None;
+                }
+                let end = self
+                    .next_chunk
+                    .saturating_add(self.config.chunk_size.max(1))
+                    .min(self.target);
+                ((self.next_chunk, end), false)
+            }
+        };
+        // Bodies are only fetched once their headers are verified
+        if chunk.1 > self.headers_end {
+            return None;
+        }
+        if requeued {
+            self.pending.pop_front();
+        } else {
+            self.next_chunk = chunk.1;
+        }
+        Some(chunk)
+    }
+
+    /// Peers could not back the claimed range; stop at `end`
+    fn cut_target(&mut self, end: u64) {
+        let end = end.max(self.next_import);
+        if end >= self.target {
+            return;
+        }
+        tracing::debug!("Peers cannot back sync target {}, stopping at {}", self.target, end);
+        self.target = end;
+        self.next_chunk = self.next_chunk.min(end);
+        self.headers_end = self.headers_end.min(end);
+        self.pending = self
+            .pending
+            .iter()
+            .filter(|(start, _)| *start < end)
+            .map(|&(start, chunk_end)| (start, chunk_end.min(end)))
+            .collect();
+    }
+
+    fn issue(
+        &mut self,
+        peer: String,
+        kind: ChunkKind,
+        start: u64,
+        end: u64,
+        now: Instant,
+    ) -> ChunkRequest {
+        let request_id = uuid::Uuid::new_v4().to_string();
+        if let Some(stats) = self.peers.get_mut(&peer) {
+            stats.in_flight += 1;
+        }
+        self.in_flight.insert(
+            request_id.clone(),
+            InFlight {
+                peer: peer.clone(),
+                kind,
+                start,
+                end,
+                sent_at: now,
+            },
+        );
+        ChunkRequest {
+            request_id,
+            peer,
+            kind,
+            start,
+            end,
+        }
+    }
+
+    /// Whether a response id belongs to an outstanding request
+    pub fn is_pending_request(&self, request_id: &str) -> bool {
+        self.in_flight.contains_key(request_id)
+    }
+
+    /// Accept a header chain response
+    pub fn on_headers(
+        &mut self,
+        request_id: &str,
+        headers: Vec<BlockHeader>,
+        now: Instant,
+    ) -> Result<()> {
+        let request = self.take_request(request_id, ChunkKind::Headers)?;
+
+        let mut accepted = 0u64;
+        for header in headers {
+            if header.height != self.headers_end || header.height >= request.end {
+                break;
+            }
+            if let Some(tip) = &self.header_tip {
+                if &header.previous_hash != tip {
+                    self.finish_request(&request, accepted as usize, now);
+                    return Err(anyhow!("Header {} does not link to the chain", header.height));
+                }
+            }
+            self.headers.insert(header.height, header.hash.clone());
+            self.header_tip = Some(header.hash);
+            self.headers_end += 1;
+            accepted += 1;
+        }
+
+        // Only heights confirmed by headers stay in the target
+        if accepted < request.end - request.start {
+            self.cut_target(self.headers_end);
+        }
+        self.finish_request(&request, accepted as usize, now);
+        Ok(())
+    }
+
+    /// Accept a block chunk response
+    pub fn on_blocks(&mut self, request_id: &str, blocks: Vec<Block>, now: Instant) -> Result<()> {
+        let request = self.take_request(request_id, ChunkKind::Blocks)?;
+
+        let mut received = request.start;
+        let mut previous_hash: Option<String> = None;
+        for block in blocks {
+            if block.header.height != received || received >= request.end {
+                break;
+            }
+            if let Some(expected) = self.headers.get(&received) {
+                if expected != &block.header.hash {
+                    break;
+                }
+            }
+            if let Some(parent) = &previous_hash {
+                if parent != &block.header.previous_hash {
+                    break;
+                }
+            }
+            previous_hash = Some(block.header.hash.clone());
+            self.ready.insert(received, block);
+            received += 1;
+        }
+
+        // Without headers, an empty chunk is the only sign the claim was false
+        if received == request.start && !self.config.fast_sync {
+            self.cut_target(request.start);
+        }
+        // Ask again for whatever the peer did not deliver
+        if received < request.end.min(self.target) {
+            self.pending.push_front((received, request.end.min(self.target)));
+        }
+        self.finish_request(&request, (received - request.start) as usize, now);
+        Ok(())
+    }
+
+    /// Re-queue requests older than the timeout and shrink their peers' windows
+    pub fn expire(&mut self, now: Instant) -> usize {
+        let timeout = Duration::from_secs(self.config.request_timeout_secs.max(1));
+        let expired: Vec<String> = self
+            .in_flight
+            .iter()
+            .filter(|(_, request)| now.duration_since(request.sent_at) >= timeout)
+            .map(|(id, _)| id.clone())
+            .collect();
+
+        for id in &expired {
+            let request = self.in_flight.remove(id).unwrap();
+            if let Some(stats) = self.peers.get_mut(&request.peer) {
+                stats.in_flight = stats.in_flight.saturating_sub(1);
+                stats.timeouts += 1;
+                stats.window = (stats.window / 2).max(1);
+                stats.blocks_per_sec *= 0.5;
+            }
+            tracing::debug!(
+                "Sync request {}..{} to {} timed out",
+                request.start,
+                request.end,
+                request.peer
+            );
+            self.requeue(&request);
+        }
+        expired.len()
+    }
+
+    /// Blocks that can be imported now, in height order
+    pub fn drain_ready(&mut self) -> Vec<Block> {
+        let mut blocks = Vec::new();
+        while let Some(block) = self.ready.remove(&self.next_import) {
+            blocks.push(block);
+            self.next_import += 1;
+        }
+        blocks
+    }
+
+    fn take_request(&mut self, request_id: &str, kind: ChunkKind) -> Result<InFlight> {
+        match self.in_flight.get(request_id) {
+            Some(request) if request.kind == kind => Ok(self.in_flight.remove(request_id).unwrap()),
+            Some(_) => Err(anyhow!("Sync response {} has the wrong kind", request_id)),
+            None => Err(anyhow!("Unknown sync request {}", request_id)),
+        }
+    }
+
+    fn requeue(&mut self, request: &InFlight) {
+        if request.kind == ChunkKind::Blocks && request.start < self.target {
+            self.pending.push_front((request.start, request.end.min(self.target)));
+        }
+    }
+
+    /// Update a peer's throughput and resize its window after a response
+    fn finish_request(&mut self, request: &InFlight, delivered: usize, now: Instant) {
+        let Some(stats) = self.peers.get_mut(&request.peer) else {
+            return;
+        };
+        stats.in_flight = stats.in_flight.saturating_sub(1);
+        if request.kind == ChunkKind::Headers {
+            return;
+        }
+
+        let elapsed = now.duration_since(request.sent_at).as_secs_f64().max(0.001);
+        let sample = delivered as f64 / elapsed;
+        stats.blocks_per_sec = if stats.blocks_per_sec == 0.0 {
+            sample
+        } else {
+            THROUGHPUT_SMOOTHING * sample + (1.0 - THROUGHPUT_SMOOTHING) * stats.blocks_per_sec
+        };
+
+        // Keep enough chunks outstanding to cover one round trip at the measured rate
+        let per_round_trip = stats.blocks_per_sec * elapsed / self.config.chunk_size.max(1) as f64;
+        stats.window = (per_round_trip.ceil() as usize + 1)
+            .clamp(1, self.config.max_requests_per_peer.max(1));
+    }
+}
+
+impl Default for SyncManager {
+    fn default() -> Self {
+        Self::new(SyncConfig::default())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::blockchain::ValidatorInfo;
+
+    fn chain(count: u64) -> Vec<Block> {
+        let mut blocks: Vec<Block> = Vec::new();
+        for height in 0..count {
+            let parent = blocks
+                .last()
+                .map(|b| b.header.hash.clone())
+                .unwrap_or_default();
+            blocks.push(Block::new(parent, vec![], height, ValidatorInfo::default()).unwrap());
+        }
+        blocks
+    }
+
+    fn config(fast_sync: bool) -> SyncConfig {
+        SyncConfig {
+            fast_sync,
+            chunk_size: 4,
+            max_requests_per_peer: 4,
+            request_timeout_secs: 5,
+        }
+    }
+
+    fn slice(blocks: &[Block], request: &ChunkRequest) -> Vec<Block> {
+        blocks[request.start as usize..request.end as usize].to_vec()
+    }
+
+    #[test]
+    fn test_chunks_spread_over_peers_and_import_in_order() {
+        let blocks = chain(17);
+        let mut sync = SyncManager::new(config(false));
+        sync.add_peer("a");
+        sync.add_peer("b");
+        sync.start(1, 17, Some(blocks[0].header.hash.clone()));
+
+        let now = Instant::now();
+        let first = sync.next_requests(now);
+        assert_eq!(first.len(), 2);
+        assert_ne!(first[0].peer, first[1].peer);
+
+        // Second chunk arrives first and is held back
+        sync.on_blocks(&first[1].request_id, slice(&blocks, &first[1]), now)
+            .unwrap();
+        assert!(sync.drain_ready().is_empty());
+        sync.on_blocks(&first[0].request_id, slice(&blocks, &first[0]), now)
+            .unwrap();
+        let ready: Vec<u64> = sync.drain_ready().iter().map(|b| b.header.height).collect();
+        assert_eq!(ready, (1..9).collect::<Vec<_>>());
+
+        // Windows grew after fast responses
+        let later = now + Duration::from_millis(10);
+        let more = sync.next_requests(later);
+        assert_eq!(more.len(), 2);
+        for request in &more {
+            sync.on_blocks(&request.request_id, slice(&blocks, request), later)
+                .unwrap();
+        }
+        assert_eq!(sync.drain_ready().len(), 8);
+        assert!(sync.is_complete());
+    }
+
+    #[test]
+    fn test_timeouts_and_short_responses_are_requeued() {
+        let blocks = chain(9);
+        let mut sync = SyncManager::new(config(false));
+        sync.add_peer("slow");
+        sync.start(1, 9, None);
+
+        let now = Instant::now();
+        let request = sync.next_requests(now).remove(0);
+        assert_eq!(sync.expire(now + Duration::from_secs(6)), 1);
+        assert_eq!(sync.peer_stats("slow").unwrap().timeouts, 1);
+        assert!(sync.on_blocks(&request.request_id, vec![], now).is_err());
+
+        sync.add_peer("fast");
+        sync.remove_peer("slow");
+        let retry = sync.next_requests(now).remove(0);
+        assert_eq!((retry.peer.as_str(), retry.start), ("fast", 1));
+
+        // Only half the chunk delivered; the rest is asked for again
+        sync.on_blocks(&retry.request_id, blocks[1..3].to_vec(), now)
+            .unwrap();
+        let rest = sync.next_requests(now);
+        assert_eq!((rest[0].start, rest[0].end), (3, 5));
+    }
+
+    #[test]
+    fn test_fast_sync_fetches_headers_before_matching_bodies() {
+        let blocks = chain(9);
+        let mut sync = SyncManager::new(config(true));
+        sync.add_peer("a");
+        sync.start(1, 9, Some(blocks[0].header.hash.clone()));
+
+        let now = Instant::now();
+        let requests = sync.next_requests(now);
+        assert_eq!(requests.len(), 1);
+        assert_eq!(requests[0].kind, ChunkKind::Headers);
+
+        let headers: Vec<BlockHeader> = blocks[1..].iter().map(|b| b.header.clone()).collect();
+        sync.on_headers(&requests[0].request_id, headers, now).unwrap();
+
+        let bodies = sync.next_requests(now);
+        assert!(bodies.iter().all(|r| r.kind == ChunkKind::Blocks));
+
+        // A body that does not match its header is rejected and re-requested
+        let forged = chain(9);
+        sync.on_blocks(&bodies[0].request_id, slice(&forged, &bodies[0]), now)
+            .unwrap();
+        assert!(sync.drain_ready().is_empty());
+        let retry = sync.next_requests(now);
+        assert!(retry.iter().any(|r| r.start == bodies[0].start));
+    }
+
+    #[test]
+    fn test_unbacked_height_claims_are_bounded_and_cut_back() {
+        let blocks = chain(9);
+        let mut sync = SyncManager::new(config(false));
+        sync.add_peer("liar");
+        sync.start(1, u64::MAX, Some(blocks[0].header.hash.clone()));
+
+        // Only a window's worth of chunks is ever planned
+        let now = Instant::now();
+        let first = sync.next_requests(now);
+        assert_eq!(first.len(), 1);
+        assert!(first[0].end <= 1 + MAX_BLOCKS_AHEAD);
+        sync.on_blocks(&first[0].request_id, slice(&blocks, &first[0]), now)
+            .unwrap();
+        assert_eq!(sync.drain_ready().len(), 4);
+
+        let mut requests = sync.next_requests(now);
+        while let Some(request) = requests.pop() {
+            let served = blocks.get(request.start as usize..(request.end as usize).min(9));
+            sync.on_blocks(&request.request_id, served.unwrap_or_default().to_vec(), now)
+                .unwrap();
+            sync.drain_ready();
+            requests.extend(sync.next_requests(now));
+        }
+        assert_eq!(sync.target(), 9);
+        assert!(sync.is_complete());
+    }
+
+    #[test]
+    fn test_fast_sync_target_stops_at_verified_headers() {
+        let blocks = chain(9);
+        let mut sync = SyncManager::new(config(true));
+        sync.add_peer("a");
+        sync.start(1, u64::MAX, Some(blocks[0].header.hash.clone()));
+
+        let now = Instant::now();
+        let requests = sync.next_requests(now);
+        assert_eq!(requests.len(), 1);
+        assert_eq!(requests[0].end, 1 + HEADER_BATCH);
+        let headers: Vec<BlockHeader> = blocks[1..].iter().map(|b| b.header.clone()).collect();
+        sync.on_headers(&requests[0].request_id, headers, now).unwrap();
+        assert_eq!(sync.target(), 9);
+
+        let bodies = sync.next_requests(now);
+        assert!(bodies.iter().all(|r| r.kind == ChunkKind::Blocks && r.end <= 9));
+    }
+}
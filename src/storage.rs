@@ -9,7 +9,11 @@ use std::path::Path;
 use std::sync::Arc;
 use tokio::sync::RwLock;
 
+use crate::blockchain::attestation::{AttestationCommitment, StoredAttestationProof};
+use crate::blockchain::carbon::{CarbonCounters, CarbonLedgerState, CertificateLot, RetirementRecord};
 use crate::blockchain::{Account, Block, BlockchainStats, Transaction};
+use crate::consensus_poa::finality::CommitCertificate;
+use crate::p2p::peer_store::PeerRecord;
 
 /// Storage manager that handles all persistent data operations
 #[derive(Debug)]
@@ -35,8 +39,18 @@ pub struct MemoryStorage {
     blocks: HashMap<String, Block>,
     transactions: HashMap<String, Transaction>,
     accounts: HashMap<String, Account>,
+    account_regions: HashMap<String, String>,
+    account_nonces: HashMap<String, u64>,
+    carbon_lots: HashMap<String, CertificateLot>,
+    carbon_retirements: Vec<RetirementRecord>,
+    carbon_counters: CarbonCounters,
     stats: Option<BlockchainStats>,
     height: u64,
+    attestation_proofs: HashMap<String, StoredAttestationProof>,
+    attestation_commitments: HashMap<(String, u64), AttestationCommitment>,
+    peers: HashMap<String, PeerRecord>,
+    certificates: HashMap<u64, CommitCertificate>,
+    node_identity: Option<Vec<u8>>,
 }
 
 impl StorageManager {
@@ -270,6 +284,192 @@ impl StorageManager {
         }
     }
 
+    /// Store the accounts a block touched together with their indexed regions and
+    /// highest applied nonces
+    pub async fn store_account_state(
+        &self,
+        accounts: &[Account],
+        regions: &[(String, String)],
+        nonces: &[(String, u64)],
+    ) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut batch = sled::Batch::default();
+                    for account in accounts {
+                        let serialized = bincode::serialize(account)
+                            .map_err(|e| anyhow!("Failed to serialize account: {}", e))?;
+                        batch.insert(format!("account:{}", account.address).as_bytes(), serialized);
+                    }
+                    for (address, region) in regions {
+                        batch.insert(format!("region:{}", address).as_bytes(), region.as_bytes());
+                    }
+                    for (address, nonce) in nonces {
+                        batch.insert(format!("nonce:{}", address).as_bytes(), &nonce.to_be_bytes());
+                    }
+                    db.apply_batch(batch)
+                        .map_err(|e| anyhow!("Failed to store account state: {}", e))?;
+                    db.flush().map_err(|e| anyhow!("Failed to flush: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                for account in accounts {
+                    storage.accounts.insert(account.address.clone(), account.clone());
+                }
+                for (address, region) in regions {
+                    storage.account_regions.insert(address.clone(), region.clone());
+                }
+                for (address, nonce) in nonces {
+                    storage.account_nonces.insert(address.clone(), *nonce);
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// Load the region (province code) each account was last indexed under
+    pub async fn load_account_regions(&self) -> Result<HashMap<String, String>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut regions = HashMap::new();
+                    for item in db.scan_prefix("region:") {
+                        let (key, value) = item.map_err(|e| anyhow!("Failed to scan regions: {}", e))?;
+                        let key = String::from_utf8(key.to_vec())
+                            .map_err(|e| anyhow!("Failed to parse region key: {}", e))?;
+                        let region = String::from_utf8(value.to_vec())
+                            .map_err(|e| anyhow!("Failed to parse region: {}", e))?;
+                        if let Some(address) = key.strip_prefix("region:") {
+                            regions.insert(address.to_string(), region);
+                        }
+                    }
+                    Ok(regions)
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.account_regions.clone())
+            }
+        }
+    }
+
+    /// Load the highest applied nonce of every sender
+    pub async fn load_account_nonces(&self) -> Result<HashMap<String, u64>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut nonces = HashMap::new();
+                    for item in db.scan_prefix("nonce:") {
+                        let (key, value) = item.map_err(|e| anyhow!("Failed to scan nonces: {}", e))?;
+                        let key = String::from_utf8(key.to_vec())
+                            .map_err(|e| anyhow!("Failed to parse nonce key: {}", e))?;
+                        let nonce: [u8; 8] = value
+                            .as_ref()
+                            .try_into()
+                            .map_err(|_| anyhow!("Invalid nonce for {}", key))?;
+                        if let Some(address) = key.strip_prefix("nonce:") {
+                            nonces.insert(address.to_string(), u64::from_be_bytes(nonce));
+                        }
+                    }
+                    Ok(nonces)
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.account_nonces.clone())
+            }
+        }
+    }
+
+    /// Store carbon ledger lots and retirements changed by a block
+    pub async fn store_carbon_state(&self, changes: &CarbonLedgerState) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut batch = sled::Batch::default();
+                    for lot in &changes.lots {
+                        let serialized = bincode::serialize(lot)
+                            .map_err(|e| anyhow!("Failed to serialize certificate lot: {}", e))?;
+                        batch.insert(format!("lot:{}", lot.id).as_bytes(), serialized);
+                    }
+                    for record in &changes.retirements {
+                        let serialized = bincode::serialize(record)
+                            .map_err(|e| anyhow!("Failed to serialize retirement: {}", e))?;
+                        let key = format!("retire:{:020}:{}", record.block_height, record.tx_id);
+                        batch.insert(key.as_bytes(), serialized);
+                    }
+                    let counters = bincode::serialize(&changes.counters)
+                        .map_err(|e| anyhow!("Failed to serialize carbon counters: {}", e))?;
+                    batch.insert("carbon_counters", counters);
+                    db.apply_batch(batch)
+                        .map_err(|e| anyhow!("Failed to store carbon state: {}", e))?;
+                    db.flush().map_err(|e| anyhow!("Failed to flush: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                for lot in &changes.lots {
+                    storage.carbon_lots.insert(lot.id.clone(), lot.clone());
+                }
+                storage.carbon_retirements.extend(changes.retirements.iter().cloned());
+                storage.carbon_counters = changes.counters;
+                Ok(())
+            }
+        }
+    }
+
+    /// Load the whole persisted carbon ledger
+    pub async fn load_carbon_state(&self) -> Result<CarbonLedgerState> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut state = CarbonLedgerState::default();
+                    for item in db.scan_prefix("lot:") {
+                        let (_, value) = item.map_err(|e| anyhow!("Failed to scan lots: {}", e))?;
+                        let lot = bincode::deserialize(&value)
+                            .map_err(|e| anyhow!("Failed to deserialize certificate lot: {}", e))?;
+                        state.lots.push(lot);
+                    }
+                    for item in db.scan_prefix("retire:") {
+                        let (_, value) = item.map_err(|e| anyhow!("Failed to scan retirements: {}", e))?;
+                        let record = bincode::deserialize(&value)
+                            .map_err(|e| anyhow!("Failed to deserialize retirement: {}", e))?;
+                        state.retirements.push(record);
+                    }
+                    if let Some(data) = db
+                        .get("carbon_counters")
+                        .map_err(|e| anyhow!("Failed to get carbon counters: {}", e))?
+                    {
+                        state.counters = bincode::deserialize(&data)
+                            .map_err(|e| anyhow!("Failed to deserialize carbon counters: {}", e))?;
+                    }
+                    Ok(state)
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(CarbonLedgerState {
+                    lots: storage.carbon_lots.values().cloned().collect(),
+                    retirements: storage.carbon_retirements.clone(),
+                    counters: storage.carbon_counters,
+                })
+            }
+        }
+    }
+
     /// Get all accounts
     pub async fn get_all_accounts(&self) -> Result<Vec<Account>> {
         match &self.backend {
@@ -421,13 +621,331 @@ impl StorageManager {
                 storage.blocks.clear();
                 storage.transactions.clear();
                 storage.accounts.clear();
+                storage.account_regions.clear();
+                storage.account_nonces.clear();
+                storage.carbon_lots.clear();
+                storage.carbon_retirements.clear();
+                storage.carbon_counters = CarbonCounters::default();
                 storage.stats = None;
                 storage.height = 0;
+                storage.attestation_proofs.clear();
+                storage.attestation_commitments.clear();
+                storage.certificates.clear();
+                Ok(())
+            }
+        }
+    }
+
+    /// Store off-chain attestation proofs for a sealed producer-interval batch
+    pub async fn store_attestation_proofs(&self, proofs: &[StoredAttestationProof]) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut batch = sled::Batch::default();
+                    for stored in proofs {
+                        let serialized = bincode::serialize(stored)
+                            .map_err(|e| anyhow!("Failed to serialize attestation proof: {}", e))?;
+                        batch.insert(Self::attestation_key(stored).as_bytes(), serialized);
+                    }
+                    db.apply_batch(batch)
+                        .map_err(|e| anyhow!("Failed to store attestation proofs: {}", e))?;
+                    db.flush().map_err(|e| anyhow!("Failed to flush: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                for stored in proofs {
+                    storage
+                        .attestation_proofs
+                        .insert(Self::attestation_key(stored), stored.clone());
+                }
                 Ok(())
             }
         }
     }
 
+    /// Store attestation roots committed on chain
+    pub async fn store_attestation_commitments(&self, commitments: &[AttestationCommitment]) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut batch = sled::Batch::default();
+                    for commitment in commitments {
+                        let serialized = bincode::serialize(commitment)
+                            .map_err(|e| anyhow!("Failed to serialize attestation: {}", e))?;
+                        let key = format!("commit:{}:{:020}", commitment.producer, commitment.interval);
+                        batch.insert(key.as_bytes(), serialized);
+                    }
+                    db.apply_batch(batch)
+                        .map_err(|e| anyhow!("Failed to store attestations: {}", e))?;
+                    db.flush().map_err(|e| anyhow!("Failed to flush: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                for commitment in commitments {
+                    storage.attestation_commitments.insert(
+                        (commitment.producer.clone(), commitment.interval),
+                        commitment.clone(),
+                    );
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// Load every attestation root committed on chain
+    pub async fn load_attestation_commitments(&self) -> Result<Vec<AttestationCommitment>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut commitments = Vec::new();
+                    for item in db.scan_prefix("commit:") {
+                        let (_, value) = item.map_err(|e| anyhow!("Failed to scan attestations: {}", e))?;
+                        let commitment = bincode::deserialize(&value)
+                            .map_err(|e| anyhow!("Failed to deserialize attestation: {}", e))?;
+                        commitments.push(commitment);
+                    }
+                    Ok(commitments)
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.attestation_commitments.values().cloned().collect())
+            }
+        }
+    }
+
+    /// Get the attestation proof for a single reading
+    pub async fn get_attestation_proof(
+        &self,
+        producer: &str,
+        interval: u64,
+        reading_id: &str,
+    ) -> Result<Option<StoredAttestationProof>> {
+        let key = format!("attest:{}:{:020}:{}", producer, interval, reading_id);
+
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    match db.get(&key).map_err(|e| anyhow!("Failed to get attestation proof: {}", e))? {
+                        Some(data) => {
+                            let stored = bincode::deserialize(&data)
+                                .map_err(|e| anyhow!("Failed to deserialize attestation proof: {}", e))?;
+                            Ok(Some(stored))
+                        }
+                        None => Ok(None),
+                    }
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.attestation_proofs.get(&key).cloned())
+            }
+        }
+    }
+
+    /// Save changed peer address book entries and delete removed ones
+    pub async fn store_peer_records(&self, records: &[PeerRecord], removed: &[String]) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut batch = sled::Batch::default();
+                    for record in records {
+                        let serialized = bincode::serialize(record)
+                            .map_err(|e| anyhow!("Failed to serialize peer record: {}", e))?;
+                        batch.insert(format!("peer:{}", record.peer_id).as_bytes(), serialized);
+                    }
+                    for peer in removed {
+                        batch.remove(format!("peer:{}", peer).as_bytes());
+                    }
+                    db.apply_batch(batch)
+                        .map_err(|e| anyhow!("Failed to store peer records: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                for record in records {
+                    storage.peers.insert(record.peer_id.clone(), record.clone());
+                }
+                for peer in removed {
+                    storage.peers.remove(peer);
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// Load the peer address book
+    pub async fn load_peer_records(&self) -> Result<Vec<PeerRecord>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let mut records = Vec::new();
+                    for item in db.scan_prefix("peer:") {
+                        let (_, value) = item.map_err(|e| anyhow!("Failed to scan peer records: {}", e))?;
+                        match bincode::deserialize::<PeerRecord>(&value) {
+                            Ok(record) => records.push(record),
+                            Err(e) => tracing::warn!("Skipping unreadable peer record: {}", e),
+                        }
+                    }
+                    Ok(records)
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.peers.values().cloned().collect())
+            }
+        }
+    }
+
+    /// Store the secret key behind this node's P2P peer id
+    pub async fn store_node_identity(&self, secret: &[u8]) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    db.insert("node_identity", secret)
+                        .map_err(|e| anyhow!("Failed to store node identity: {}", e))?;
+                    db.flush().map_err(|e| anyhow!("Failed to flush: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                storage.node_identity = Some(secret.to_vec());
+                Ok(())
+            }
+        }
+    }
+
+    /// Load the secret key behind this node's P2P peer id
+    pub async fn load_node_identity(&self) -> Result<Option<Vec<u8>>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let secret = db
+                        .get("node_identity")
+                        .map_err(|e| anyhow!("Failed to get node identity: {}", e))?;
+                    Ok(secret.map(|secret| secret.to_vec()))
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.node_identity.clone())
+            }
+        }
+    }
+
+    /// Store the commit certificate that finalized a block
+    pub async fn store_commit_certificate(&self, certificate: &CommitCertificate) -> Result<()> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    let serialized = bincode::serialize(certificate)
+                        .map_err(|e| anyhow!("Failed to serialize commit certificate: {}", e))?;
+                    db.insert(Self::certificate_key(certificate.height).as_bytes(), serialized)
+                        .map_err(|e| anyhow!("Failed to store commit certificate: {}", e))?;
+                    Ok(())
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let mut storage = self.memory_storage.write().await;
+                storage.certificates.insert(certificate.height, certificate.clone());
+                Ok(())
+            }
+        }
+    }
+
+    /// Get the commit certificate of the block at a height
+    pub async fn get_commit_certificate(&self, height: u64) -> Result<Option<CommitCertificate>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    match db
+                        .get(Self::certificate_key(height))
+                        .map_err(|e| anyhow!("Failed to get commit certificate: {}", e))?
+                    {
+                        Some(data) => {
+                            let certificate = bincode::deserialize(&data)
+                                .map_err(|e| anyhow!("Failed to deserialize commit certificate: {}", e))?;
+                            Ok(Some(certificate))
+                        }
+                        None => Ok(None),
+                    }
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage.certificates.get(&height).cloned())
+            }
+        }
+    }
+
+    /// Get the stored commit certificate with the highest height
+    pub async fn latest_commit_certificate(&self) -> Result<Option<CommitCertificate>> {
+        match &self.backend {
+            StorageBackend::Sled(_) => {
+                if let Some(db) = &self.sled_db {
+                    // Keys are zero-padded, so the last one is the highest
+                    match db.scan_prefix("cert:").next_back() {
+                        Some(item) => {
+                            let (_, data) =
+                                item.map_err(|e| anyhow!("Failed to scan commit certificates: {}", e))?;
+                            let certificate = bincode::deserialize(&data)
+                                .map_err(|e| anyhow!("Failed to deserialize commit certificate: {}", e))?;
+                            Ok(Some(certificate))
+                        }
+                        None => Ok(None),
+                    }
+                } else {
+                    Err(anyhow!("Sled database not initialized"))
+                }
+            }
+            StorageBackend::Memory => {
+                let storage = self.memory_storage.read().await;
+                Ok(storage
+                    .certificates
+                    .iter()
+                    .max_by_key(|(height, _)| **height)
+                    .map(|(_, certificate)| certificate.clone()))
+            }
+        }
+    }
+
+    fn certificate_key(height: u64) -> String {
+        format!("cert:{:020}", height)
+    }
+
+    fn attestation_key(stored: &StoredAttestationProof) -> String {
+        format!(
+            "attest:{}:{:020}:{}",
+            stored.producer, stored.interval, stored.reading.reading_id
+        )
+    }
+
     /// Get pending transactions (simplified for the new storage)
     pub async fn get_pending_transactions(&self, limit: usize) -> Vec<Transaction> {
         match &self.backend {
@@ -592,6 +1110,7 @@ mod tests {
             gas_used: 0,
             gas_limit: 1000000,
             extra_data: vec![],
+            signature: String::new(),
         };
 
         let block = Block {